@@ -0,0 +1,131 @@
+//|___________________________________________________________________
+//!
+//! \file alloc_counter.cpp
+//!
+//! \brief Count of the program's C++ heap allocations.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+
+#include "alloc_counter.h"
+
+//|___________________
+//|
+//| Global Variables
+//|___________________
+
+static std::atomic<uint64_t> heap_allocation_count(0);     // Calls of operator new
+
+//|___________________
+//|
+//| Local Functions
+//|___________________
+
+//|____________________________________________________________________
+//|
+//| Function: CountedAlloc
+//|
+//! \param size       [in] Bytes.
+//! \param alignment  [in] Power of two; 0 for the default alignment.
+//! \return Memory for operator new; throws std::bad_alloc when the heap
+//!         is exhausted and no new-handler can free any.
+//!
+//! Retries after each call of the current new-handler, as the standard
+//! operator new does.
+//|____________________________________________________________________
+
+static void* CountedAlloc(size_t size, size_t alignment)
+{
+	heap_allocation_count.fetch_add(1, std::memory_order_relaxed);
+	if (size == 0) {
+		size = 1;
+	}
+
+	for (;;) {
+		void* p;
+		if (alignment == 0) {
+			p = malloc(size);
+		}
+		else {
+#ifdef _WIN32
+			p = _aligned_malloc(size, alignment);
+#else
+			p = aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+#endif
+		}
+		if (p) {
+			return p;
+		}
+
+		std::new_handler handler = std::get_new_handler();
+		if (!handler) {
+			throw std::bad_alloc();
+		}
+		handler();
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: HeapAllocationCount
+//|
+//! \param None.
+//! \return C++ heap allocations (operator new) since the program started.
+//|____________________________________________________________________
+
+uint64_t HeapAllocationCount()
+{
+	return heap_allocation_count.load(std::memory_order_relaxed);
+}
+
+//|____________________________________________________________________
+//|
+//| Replaced global allocation functions. The array and nothrow forms
+//| forward to these by default.
+//|____________________________________________________________________
+
+void* operator new(size_t size)
+{
+	return CountedAlloc(size, 0);
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+#ifdef __cpp_aligned_new
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	return CountedAlloc(size, (size_t)alignment);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+void operator delete(void* p, size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(p, alignment);
+}
+
+#endif
@@ -0,0 +1,25 @@
+//|___________________________________________________________________
+//!
+//! \file alloc_counter.h
+//!
+//! \brief Count of the program's C++ heap allocations.
+//!
+//! alloc_counter.cpp replaces the global operator new and delete with
+//! versions that count every allocation, so a frame loop can show that it
+//! no longer touches the heap (see frame_arena.h). The replacement is
+//! program-wide, so it is opt-in: only programs that want the count link
+//! alloc_counter.cpp (the GLUT program and bench_render). Every form of
+//! operator new is counted: the plain and over-aligned ones are replaced,
+//! and the array and nothrow forms forward to them.
+//|___________________________________________________________________
+
+#pragma once
+
+#include <stdint.h>
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+uint64_t HeapAllocationCount();
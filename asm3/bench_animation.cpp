@@ -0,0 +1,212 @@
+//|___________________________________________________________________
+//!
+//! \file bench_animation.cpp
+//!
+//! \brief Benchmark and check of the batched keyframe animation.
+//!
+//! Every turtle loops one of the default clips (see turtle_animation.h)
+//! at its own phase and speed, as the crowd does in the program. Times a
+//! tick of three evaluations over the same turtles and prints one JSON
+//! line each, with the bytes of shared tracks and per-turtle clocks:
+//!
+//!   search   each joint sampled by binary search (SampleAnimTrack())
+//!   batched  StepAnimations() over all turtles, cursors instead of search
+//!   threads  StepAnimations() in chunks on a ThreadPool
+//!
+//! Exits with 1 unless all three end with the same angles, bit for bit.
+//!
+//! Standalone program (not part of asm3.vcxproj):
+//!   g++ -O2 -pthread -I<gmtl> bench_animation.cpp turtle_animation.cpp thread_pool.cpp -o bench_animation
+//!   ./bench_animation [turtles] [ticks] [threads]
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "thread_pool.h"
+#include "turtle_animation.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const int DEFAULT_TURTLES = 100000;
+const int DEFAULT_TICKS = 600;              // 10 s at the simulation rate
+const int ANIM_GRAIN = 4096;                // Turtles per chunk
+const int PHASE_STEP = 37;                  // As the program's crowd (turtle_scene.cpp)
+const float MIN_SPEED = 0.75f;
+const float MAX_SPEED = 1.25f;
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+struct StepContext
+{
+	TurtleAnimations* anim;
+	const AnimLibrary* lib;
+	float* joints;
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void BuildAnimations(TurtleAnimations& anim, const AnimLibrary& lib, int count);
+void StepSearch(TurtleAnimations& anim, const AnimLibrary& lib, float* joints);
+void StepChunk(int begin, int end, void* context);
+
+//|____________________________________________________________________
+//|
+//| Function: BuildAnimations
+//|
+//! \param anim   [out] Playback clocks.
+//! \param lib    [in] Library with the default clips.
+//! \param count  [in] Number of turtles.
+//! \return None.
+//|____________________________________________________________________
+
+void BuildAnimations(TurtleAnimations& anim, const AnimLibrary& lib, int count)
+{
+	ResizeAnimations(anim, count);
+	for (int t = 0; t < count; t++) {
+		int clip = t % ANIM_DEFAULT_CLIP_COUNT;
+		PlayAnimation(anim, lib, t, clip, (float)(t * PHASE_STEP % lib.clips[clip].length),
+		              MIN_SPEED + (MAX_SPEED - MIN_SPEED) * (t * 53 % 101) / 100.0f);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: StepSearch
+//|
+//! \param anim    [in,out] Playback clocks (cursors unused).
+//! \param lib     [in] Animation library.
+//! \param joints  [out] JOINT_COUNT angles per turtle.
+//! \return None.
+//!
+//! The straightforward evaluation: advance each clock, then binary
+//! search every joint's track.
+//|____________________________________________________________________
+
+void StepSearch(TurtleAnimations& anim, const AnimLibrary& lib, float* joints)
+{
+	for (int t = 0; t < AnimationCount(anim); t++) {
+		const AnimClip& clip = lib.clips[anim.clip[t]];
+		float time = anim.time[t] + anim.speed[t];
+		if (time >= clip.length) {
+			time -= clip.length;
+		}
+		anim.time[t] = time;
+
+		for (int j = 0; j < JOINT_COUNT; j++) {
+			if (clip.tracks[j] != ANIM_NO_TRACK) {
+				joints[t * JOINT_COUNT + j] = SampleAnimTrack(lib, clip.tracks[j], time);
+			}
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: StepChunk
+//|
+//! \param begin    [in] First turtle of the chunk.
+//! \param end      [in] One past the last turtle.
+//! \param context  [in] StepContext.
+//! \return None.
+//|____________________________________________________________________
+
+void StepChunk(int begin, int end, void* context)
+{
+	StepContext* c = (StepContext*)context;
+	StepAnimations(*c->anim, *c->lib, c->joints, begin, end);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: main
+//|
+//! \param argc   [in] Number of command line arguments.
+//! \param argv   [in] [turtles] [ticks] [threads].
+//! \return 0 if every evaluation gives the same angles, 1 otherwise.
+//|____________________________________________________________________
+
+int main(int argc, char** argv)
+{
+	int turtles = argc > 1 ? atoi(argv[1]) : DEFAULT_TURTLES;
+	int ticks = argc > 2 ? atoi(argv[2]) : DEFAULT_TICKS;
+	int threads = argc > 3 ? atoi(argv[3]) : (int)std::thread::hardware_concurrency();
+	if (turtles <= 0) {
+		turtles = DEFAULT_TURTLES;
+	}
+	if (ticks <= 0) {
+		ticks = DEFAULT_TICKS;
+	}
+	if (threads <= 0) {
+		threads = 1;
+	}
+
+	AnimLibrary lib;
+	BuildDefaultClips(lib);
+	TurtleAnimations initial;
+	BuildAnimations(initial, lib, turtles);
+
+	size_t library_bytes = lib.keys.size() * sizeof(AnimKey) + lib.tracks.size() * sizeof(AnimTrack) +
+	                       lib.clips.size() * sizeof(AnimClip);
+	size_t clock_bytes = sizeof(int16_t) + 2 * sizeof(float) + JOINT_COUNT * sizeof(uint16_t);
+
+	const char* names[3] = { "search", "batched", "threads" };
+	std::vector<float> results[3];
+	bool ok = true;
+
+	for (int v = 0; v < 3; v++) {
+		TurtleAnimations anim = initial;
+		std::vector<float>& joints = results[v];
+		joints.assign(turtles * JOINT_COUNT, 0.0f);
+
+		ThreadPool* pool = v == 2 ? CreateThreadPool(threads) : NULL;
+		StepContext context = { &anim, &lib, &joints[0] };
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int k = 0; k < ticks; k++) {
+			if (v == 0) {
+				StepSearch(anim, lib, &joints[0]);
+			}
+			else if (v == 1) {
+				StepAnimations(anim, lib, &joints[0], 0, turtles);
+			}
+			else {
+				ParallelFor(pool, turtles, ANIM_GRAIN, StepChunk, &context);
+			}
+		}
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / ticks;
+		if (pool) {
+			DestroyThreadPool(pool);
+		}
+
+		bool match = memcmp(&joints[0], &results[0][0], joints.size() * sizeof(float)) == 0;
+		ok = ok && match;
+
+		printf("{\"variant\":\"%s\",\"threads\":%d,\"turtles\":%d,\"ticks\":%d,\"tick_ms\":%.4f,\"ns_per_turtle\":%.2f,"
+			"\"library_bytes\":%zu,\"clock_bytes_per_turtle\":%zu,\"match\":%s}\n",
+			names[v], v == 2 ? threads : 1, turtles, ticks, ms, ms * 1e6 / turtles, library_bytes, clock_bytes,
+			match ? "true" : "false");
+		fflush(stdout);
+	}
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,278 @@
+//|___________________________________________________________________
+//!
+//! \file bench_grid.cpp
+//!
+//! \brief Benchmark and check of the turtle proximity grid.
+//!
+//! Runs the turtle simulation for a number of ticks. After every tick the
+//! grid is updated and every turtle queries the turtles within
+//! NEIGHBOUR_RADIUS of it as one batch. Prints the time per tick of the
+//! simulation, the grid update and the batch as one JSON line, with the
+//! estimated time of the same queries as O(n^2) scans.
+//!
+//! The last tick's results are checked against brute-force scans (radius
+//! and box queries on a sample of turtles) and against the same batch run
+//! on one thread; the program exits with 1 on any difference.
+//!
+//! Standalone program (not part of asm3.vcxproj):
+//!   g++ -O2 -pthread -I<gmtl> bench_grid.cpp turtle_grid.cpp turtle_sim.cpp turtle_poses.cpp thread_pool.cpp -o bench_grid
+//!   ./bench_grid [turtles] [ticks] [threads]
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <gmtl/gmtl.h>
+
+#include "thread_pool.h"
+#include "turtle_grid.h"
+#include "turtle_sim.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const int DEFAULT_TURTLES = 100000;
+const int DEFAULT_TICKS = 60;
+const float SIM_SPACING = 12.0f;            // CROWD_SPACING
+const float SIM_TURN = 2.0f;                // Yaw per tick (degs)
+const float SIM_SPEED = 0.5f;               // Distance per tick
+const float NEIGHBOUR_RADIUS = 20.0f;
+const float CELL_SIZE = 2 * NEIGHBOUR_RADIUS;  // Most queries then overlap 2x2x2 cells
+const float BOX_HALF_SIZE = 30.0f;          // Half edge of the checked box queries
+const int CHECK_SAMPLES = 200;              // Turtles whose queries are checked by brute force
+const double TICK_MS = 1000.0 / 60.0;       // Simulation tick (SIM_RATE)
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void BuildSim(TurtleSim& sim, int count);
+void BuildQueries(const TurtlePoses& poses, std::vector<GridQuery>& queries);
+void BruteForce(const TurtlePoses& poses, const GridQuery& query, std::vector<int>& turtles);
+bool SameTurtles(std::vector<int> a, std::vector<int> b);
+double Milliseconds(std::chrono::steady_clock::time_point start);
+
+//|____________________________________________________________________
+//|
+//| Function: BuildSim
+//|
+//! \param sim    [out] Simulation.
+//! \param count  [in] Number of turtles.
+//! \return None.
+//!
+//! Same scene as bench_sim: a square grid of turtles, each yawed
+//! differently, all turning the same way.
+//|____________________________________________________________________
+
+void BuildSim(TurtleSim& sim, int count)
+{
+	gmtl::Quatf turn;
+	gmtl::set(turn, gmtl::AxisAnglef(gmtl::Math::deg2Rad(SIM_TURN), 0.0f, 1.0f, 0.0f));
+	InitSim(sim, turn, SIM_SPEED, gmtl::Point3f(0, 0, 0));
+
+	int side = 1;
+	while (side * side < count) {
+		side++;
+	}
+	for (int i = 0; i < count; i++) {
+		gmtl::Quatf q;
+		gmtl::set(q, gmtl::AxisAnglef(gmtl::Math::deg2Rad(i * 37.0f), 0.0f, 1.0f, 0.0f));
+		AddSimTurtle(sim, gmtl::Point4f((i % side) * SIM_SPACING, 0.0f, (i / side) * SIM_SPACING, 1.0f), q);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: BuildQueries
+//|
+//! \param poses   [in] Positions.
+//! \param queries [out] One neighbour query per turtle, excluding itself.
+//! \return None.
+//|____________________________________________________________________
+
+void BuildQueries(const TurtlePoses& poses, std::vector<GridQuery>& queries)
+{
+	queries.resize(PoseCount(poses));
+	for (int i = 0; i < PoseCount(poses); i++) {
+		GridQuery& q = queries[i];
+		q.type = GRID_QUERY_RADIUS;
+		q.center[0] = poses.px[i];
+		q.center[1] = poses.py[i];
+		q.center[2] = poses.pz[i];
+		q.radius = NEIGHBOUR_RADIUS;
+		q.exclude = i;
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: BruteForce
+//|
+//! \param poses   [in] Positions.
+//! \param query   [in] Radius or box query.
+//! \param turtles [out] Matching turtles, by testing every turtle.
+//! \return None.
+//|____________________________________________________________________
+
+void BruteForce(const TurtlePoses& poses, const GridQuery& query, std::vector<int>& turtles)
+{
+	turtles.clear();
+	for (int t = 0; t < PoseCount(poses); t++) {
+		bool inside;
+		if (query.type == GRID_QUERY_RADIUS) {
+			float dx = poses.px[t] - query.center[0];
+			float dy = poses.py[t] - query.center[1];
+			float dz = poses.pz[t] - query.center[2];
+			inside = dx * dx + dy * dy + dz * dz <= query.radius * query.radius;
+		}
+		else {
+			inside = poses.px[t] >= query.min[0] && poses.px[t] <= query.max[0] &&
+			         poses.py[t] >= query.min[1] && poses.py[t] <= query.max[1] &&
+			         poses.pz[t] >= query.min[2] && poses.pz[t] <= query.max[2];
+		}
+		if (inside && t != query.exclude) {
+			turtles.push_back(t);
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SameTurtles
+//|
+//! \param a, b   [in] Turtle lists (copied).
+//! \return True if both hold the same turtles in any order.
+//|____________________________________________________________________
+
+bool SameTurtles(std::vector<int> a, std::vector<int> b)
+{
+	std::sort(a.begin(), a.end());
+	std::sort(b.begin(), b.end());
+	return a == b;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: Milliseconds
+//|
+//! \param start  [in] Start time.
+//! \return Milliseconds since start.
+//|____________________________________________________________________
+
+double Milliseconds(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//|____________________________________________________________________
+//|
+//| Function: main
+//|
+//! \param argc   [in] Number of command line arguments.
+//! \param argv   [in] [turtles] [ticks] [threads].
+//! \return 0 if every checked query matches, 1 otherwise.
+//|____________________________________________________________________
+
+int main(int argc, char** argv)
+{
+	int turtles = argc > 1 ? atoi(argv[1]) : DEFAULT_TURTLES;
+	int ticks = argc > 2 ? atoi(argv[2]) : DEFAULT_TICKS;
+	int threads = argc > 3 ? atoi(argv[3]) : (int)std::thread::hardware_concurrency();
+	if (turtles <= 0) {
+		turtles = DEFAULT_TURTLES;
+	}
+	if (ticks <= 0) {
+		ticks = DEFAULT_TICKS;
+	}
+	if (threads <= 0) {
+		threads = 1;
+	}
+
+	ThreadPool* pool = CreateThreadPool(threads);
+	TurtleSim sim;
+	BuildSim(sim, turtles);
+
+	TurtleGrid grid;
+	InitTurtleGrid(grid, CELL_SIZE);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	UpdateTurtleGrid(grid, sim.poses, pool);
+	double build_ms = Milliseconds(start);
+
+	std::vector<GridQuery> queries;
+	GridResults results;
+	double sim_ms = 0, update_ms = 0, query_ms = 0;
+	long long moved = 0;
+
+	for (int t = 0; t < ticks; t++) {
+		start = std::chrono::steady_clock::now();
+		StepSim(sim, pool);
+		sim_ms += Milliseconds(start);
+
+		start = std::chrono::steady_clock::now();
+		UpdateTurtleGrid(grid, sim.poses, pool);
+		update_ms += Milliseconds(start);
+		moved += grid.moved;
+
+		BuildQueries(sim.poses, queries);
+		start = std::chrono::steady_clock::now();
+		QueryTurtleGridBatch(grid, &queries[0], (int)queries.size(), results, pool);
+		query_ms += Milliseconds(start);
+	}
+	sim_ms /= ticks;
+	update_ms /= ticks;
+	query_ms /= ticks;
+
+	// Same batch on one thread: identical results, in the same order
+	GridResults serial;
+	QueryTurtleGridBatch(grid, &queries[0], (int)queries.size(), serial, NULL);
+	bool ok = serial.offsets == results.offsets && serial.turtles == results.turtles;
+
+	// Sampled radius and box queries against brute force, also timing the scans
+	std::vector<int> expected, found;
+	int samples = CHECK_SAMPLES < turtles ? CHECK_SAMPLES : turtles;
+	double brute_ms = 0;
+	for (int s = 0; s < samples; s++) {
+		int i = (int)((long long)s * turtles / samples);
+		std::vector<int> batch(results.turtles.begin() + results.offsets[i], results.turtles.begin() + results.offsets[i + 1]);
+
+		start = std::chrono::steady_clock::now();
+		BruteForce(sim.poses, queries[i], expected);
+		brute_ms += Milliseconds(start);
+		ok = ok && SameTurtles(batch, expected);
+
+		GridQuery box;
+		box.type = GRID_QUERY_BOX;
+		for (int k = 0; k < 3; k++) {
+			box.min[k] = queries[i].center[k] - BOX_HALF_SIZE;
+			box.max[k] = queries[i].center[k] + BOX_HALF_SIZE;
+		}
+		box.exclude = -1;
+		BruteForce(sim.poses, box, expected);
+		QueryTurtleGrid(grid, box, found);
+		ok = ok && SameTurtles(found, expected);
+	}
+	double brute_batch_ms = brute_ms / samples * turtles;
+
+	printf("{\"turtles\":%d,\"ticks\":%d,\"threads\":%d,\"cells\":%d,\"build_ms\":%.3f,\"sim_ms\":%.3f,"
+		"\"update_ms\":%.3f,\"moved_per_tick\":%.1f,\"query_batch_ms\":%.3f,\"neighbours_per_turtle\":%.2f,"
+		"\"brute_force_batch_ms\":%.1f,\"grid_fits_tick\":%s,\"match\":%s}\n",
+		turtles, ticks, threads, (int)grid.cells.size() - grid.empty_cells, build_ms, sim_ms,
+		update_ms, (double)moved / ticks, query_ms, (double)results.turtles.size() / turtles,
+		brute_batch_ms, update_ms + query_ms <= TICK_MS ? "true" : "false", ok ? "true" : "false");
+
+	DestroyThreadPool(pool);
+	return ok ? 0 : 1;
+}
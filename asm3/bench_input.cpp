@@ -0,0 +1,247 @@
+//|___________________________________________________________________
+//!
+//! \file bench_input.cpp
+//!
+//! \brief Input lag of per-event and coalesced mouse handling under load.
+//!
+//! A producer thread pushes timestamped motion events into an input queue
+//! (see input_queue.h) at a fixed polling rate while the main thread runs
+//! frames that each take a fixed CPU time, like slow software rendering.
+//!
+//!   per_event  every event gets its own camera update and frame, as when
+//!              each motion callback updated the camera and redrew
+//!   coalesced  each frame applies every pending event in one update
+//!
+//! Prints, per mode, the time from each event's arrival to the end of the
+//! frame that shows it (mean, p99, max), the events still queued when the
+//! producer stops and how far the camera trails the last position, as one
+//! JSON line. Exits with 1 if an event is lost or reordered, or if the
+//! coalesced camera does not end on the last position.
+//!
+//! Standalone program (not part of asm3.vcxproj):
+//!   g++ -O2 -pthread bench_input.cpp input_queue.cpp -o bench_input
+//!   ./bench_input [rate hz] [frame ms] [seconds]
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "input_queue.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const int DEFAULT_RATE = 1000;              // Gaming mouse polling rate
+const double DEFAULT_FRAME_MS = 25.0;       // 40 fps software rendering
+const double DEFAULT_SECONDS = 2.0;
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+struct ModeResult
+{
+	int frames;
+	std::vector<double> lag_ms;             // Per event shown
+	uint32_t backlog;                       // Events still queued when the producer stopped
+	int shown_x;                            // Camera position at the end
+	int full_waits;                         // Pushes retried on a full queue
+	bool ordered;                           // Events came out in push order
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void ProduceMotion(InputQueue* queue, int rate, int count, std::atomic<int>* full_waits, std::atomic<bool>* done);
+void Render(double frame_ms);
+ModeResult RunMode(bool coalesce, int rate, double frame_ms, int count);
+
+//|____________________________________________________________________
+//|
+//| Function: ProduceMotion
+//|
+//! \param queue       [in,out] Input queue (producer side).
+//! \param rate        [in] Events per second.
+//! \param count       [in] Events to push; event i moves the mouse to x = i + 1.
+//! \param full_waits  [out] Pushes retried because the queue was full.
+//! \param done        [out] Set once every event is pushed.
+//! \return None.
+//|____________________________________________________________________
+
+void ProduceMotion(InputQueue* queue, int rate, int count, std::atomic<int>* full_waits, std::atomic<bool>* done)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = 0; i < count; i++) {
+		std::this_thread::sleep_until(start + std::chrono::microseconds((long long)i * 1000000 / rate));
+
+		QueuedInput e;
+		e.time_us = InputClockUs();
+		e.type = INPUT_MOTION;
+		e.code = e.state = e.modifiers = 0;
+		e.x = i + 1;
+		e.y = 0;
+		while (!PushInput(*queue, e)) {
+			full_waits->fetch_add(1);
+			std::this_thread::yield();
+		}
+	}
+	done->store(true);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: Render
+//|
+//! \param frame_ms  [in] CPU time of the frame.
+//! \return None.
+//|____________________________________________________________________
+
+void Render(double frame_ms)
+{
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() +
+		std::chrono::microseconds((long long)(frame_ms * 1000));
+	while (std::chrono::steady_clock::now() < end) {
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: RunMode
+//|
+//! \param coalesce  [in] Apply every pending event per frame (else one).
+//! \param rate      [in] Events per second.
+//! \param frame_ms  [in] CPU time per frame.
+//! \param count     [in] Events produced.
+//! \return Lags and end state.
+//!
+//! Runs frames until the producer has stopped and, when coalescing, the
+//! queue is drained; a per-event consumer stops with its backlog.
+//|____________________________________________________________________
+
+ModeResult RunMode(bool coalesce, int rate, double frame_ms, int count)
+{
+	static InputQueue queue;
+	InitInputQueue(queue);
+
+	ModeResult result;
+	result.frames = 0;
+	result.backlog = 0;
+	result.shown_x = 0;
+	result.ordered = true;
+
+	std::atomic<int> full_waits(0);
+	std::atomic<bool> done(false);
+	std::thread producer(ProduceMotion, &queue, rate, count, &full_waits, &done);
+
+	int camera_x = 0;
+	int last_x = 0;
+	std::vector<uint64_t> shown;            // Arrival times of the events in this frame
+	for (;;) {
+		bool stopped = done.load();
+
+		// Input: one update of the camera from the frame's events
+		shown.clear();
+		QueuedInput e;
+		while ((coalesce || shown.empty()) && PopInput(queue, e)) {
+			result.ordered = result.ordered && e.x == last_x + 1;
+			last_x = e.x;
+			shown.push_back(e.time_us);
+		}
+		if (shown.empty()) {
+			if (stopped) {
+				break;
+			}
+			std::this_thread::yield();
+			continue;
+		}
+		camera_x = last_x;
+
+		Render(frame_ms);
+		result.frames++;
+
+		uint64_t now = InputClockUs();
+		for (size_t k = 0; k < shown.size(); k++) {
+			result.lag_ms.push_back((now - shown[k]) / 1000.0);
+		}
+
+		if (stopped && !coalesce) {
+			break;                          // The rest would take a frame each
+		}
+	}
+
+	producer.join();
+	result.backlog = PendingInputs(queue);
+	result.shown_x = camera_x;
+	result.full_waits = full_waits.load();
+	return result;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: main
+//|
+//! \param argc   [in] Number of command line arguments.
+//! \param argv   [in] [rate hz] [frame ms] [seconds].
+//! \return 0 if every check passes, 1 otherwise.
+//|____________________________________________________________________
+
+int main(int argc, char** argv)
+{
+	int rate = argc > 1 ? atoi(argv[1]) : DEFAULT_RATE;
+	double frame_ms = argc > 2 ? atof(argv[2]) : DEFAULT_FRAME_MS;
+	double seconds = argc > 3 ? atof(argv[3]) : DEFAULT_SECONDS;
+	if (rate <= 0) {
+		rate = DEFAULT_RATE;
+	}
+	if (frame_ms <= 0) {
+		frame_ms = DEFAULT_FRAME_MS;
+	}
+	if (seconds <= 0) {
+		seconds = DEFAULT_SECONDS;
+	}
+	int count = (int)(rate * seconds);
+
+	bool ok = true;
+	for (int m = 0; m < 2; m++) {
+		bool coalesce = m == 1;
+		ModeResult r = RunMode(coalesce, rate, frame_ms, count);
+
+		std::vector<double>& lag = r.lag_ms;
+		std::sort(lag.begin(), lag.end());
+		double mean = 0;
+		for (size_t k = 0; k < lag.size(); k++) {
+			mean += lag[k];
+		}
+		mean = lag.empty() ? 0 : mean / lag.size();
+		double p99 = lag.empty() ? 0 : lag[(lag.size() - 1) * 99 / 100];
+		double worst = lag.empty() ? 0 : lag.back();
+
+		// Every event is shown or still queued, in order; coalescing catches up
+		bool mode_ok = r.ordered && (int)lag.size() + (int)r.backlog == count && (!coalesce || r.shown_x == count);
+		ok = ok && mode_ok;
+
+		printf("{\"mode\":\"%s\",\"rate_hz\":%d,\"frame_ms\":%.1f,\"events\":%d,\"frames\":%d,\"mean_lag_ms\":%.3f,"
+			"\"p99_lag_ms\":%.3f,\"max_lag_ms\":%.3f,\"backlog\":%u,\"trail_px\":%d,\"full_waits\":%d,\"ok\":%s}\n",
+			coalesce ? "coalesced" : "per_event", rate, frame_ms, count, r.frames, mean, p99, worst, r.backlog,
+			count - r.shown_x, r.full_waits, mode_ok ? "true" : "false");
+		fflush(stdout);
+	}
+
+	return ok ? 0 : 1;
+}
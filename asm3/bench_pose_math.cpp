@@ -0,0 +1,265 @@
+//|___________________________________________________________________
+//!
+//! \file bench_pose_math.cpp
+//!
+//! \brief Microbenchmarks of pose_math.h against the gmtl paths it replaces.
+//!
+//! For every case the old and the new path run over the same random
+//! poses; the program prints the time per operation of both, the speedup
+//! and the largest difference between their results, one JSON line per
+//! case. It exits with 1 if any difference exceeds the tolerance.
+//!
+//!   camera_matrix   quaternion -> axis-angle -> rotation matrix, then
+//!                   translation (what glRotatef/glTranslatef did) vs
+//!                   PoseInverseMatrix()
+//!   rotate_vector   q * v * conj(q) with two quaternion products vs
+//!                   RotateVector()
+//!   step_quat       runtime cos/sin of InitTransforms() vs the constexpr
+//!                   StepQuatCos/StepQuatSin (accuracy only: no run time)
+//!
+//! Standalone program (not part of asm3.vcxproj):
+//!   g++ -O2 -I<gmtl> bench_pose_math.cpp pose_math.cpp -o bench_pose_math
+//!   ./bench_pose_math [poses] [repeats]
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <vector>
+
+#include <gmtl/gmtl.h>
+
+#include "pose_math.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const int DEFAULT_POSES = 1 << 16;
+const int DEFAULT_REPEATS = 50;
+const float MAX_ERROR = 1e-4f;
+
+//|___________________
+//|
+//| Global Variables
+//|___________________
+
+std::vector<gmtl::Point4f> positions;
+std::vector<gmtl::Quatf> orientations;
+volatile float sink;                        // Keeps the optimizer from dropping results
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void InitPoses(int count);
+double Elapsed(std::chrono::steady_clock::time_point start, int ops);
+void Report(const char* name, double old_ns, double new_ns, float error);
+
+//|____________________________________________________________________
+//|
+//| Function: InitPoses
+//|
+//! \param count  [in] Number of poses.
+//! \return None.
+//!
+//! Reproducible random unit quaternions and positions.
+//|____________________________________________________________________
+
+void InitPoses(int count)
+{
+	unsigned int seed = 12345;
+
+	for (int i = 0; i < count; i++) {
+		float a[7];
+		for (int k = 0; k < 7; k++) {
+			seed = seed * 1664525u + 1013904223u;
+			a[k] = (float)(seed >> 8) / (float)(1 << 24) * 2.0f - 1.0f;
+		}
+		gmtl::Quatf q(a[0], a[1], a[2], a[3]);
+		gmtl::normalize(q);
+		orientations.push_back(q);
+		positions.push_back(gmtl::Point4f(a[4] * 100, a[5] * 100, a[6] * 100, 1.0f));
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: Elapsed
+//|
+//! \param start  [in] Start time.
+//! \param ops    [in] Operations run since start.
+//! \return Nanoseconds per operation.
+//|____________________________________________________________________
+
+double Elapsed(std::chrono::steady_clock::time_point start, int ops)
+{
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ops;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: Report
+//|
+//! \param name   [in] Case name.
+//! \param old_ns [in] gmtl path, ns per operation.
+//! \param new_ns [in] pose_math path, ns per operation.
+//! \param error  [in] Largest difference between the two paths.
+//! \return None.
+//|____________________________________________________________________
+
+void Report(const char* name, double old_ns, double new_ns, float error)
+{
+	char speedup[32] = "null";              // Nothing to compare against a compile-time constant
+	if (new_ns > 0) {
+		snprintf(speedup, sizeof(speedup), "%.2f", old_ns / new_ns);
+	}
+	printf("{\"case\":\"%s\",\"gmtl_ns\":%.3f,\"pose_math_ns\":%.3f,\"speedup\":%s,\"max_error\":%g,\"ok\":%s}\n",
+		name, old_ns, new_ns, speedup, error, error <= MAX_ERROR ? "true" : "false");
+}
+
+//|____________________________________________________________________
+//|
+//| Function: main
+//|
+//! \param argc   [in] Number of command line arguments.
+//! \param argv   [in] [poses] [repeats].
+//! \return 0 if every case matches gmtl, 1 otherwise.
+//|____________________________________________________________________
+
+int main(int argc, char** argv)
+{
+	int count = argc > 1 ? atoi(argv[1]) : DEFAULT_POSES;
+	int repeats = argc > 2 ? atoi(argv[2]) : DEFAULT_REPEATS;
+	if (count <= 0) {
+		count = DEFAULT_POSES;
+	}
+	if (repeats <= 0) {
+		repeats = DEFAULT_REPEATS;
+	}
+	InitPoses(count);
+
+	int ops = count * repeats;
+	float worst = 0;
+
+	//|___________________
+	//| camera_matrix
+	//|___________________
+
+	float acc = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int r = 0; r < repeats; r++) {
+		for (int i = 0; i < count; i++) {
+			gmtl::AxisAnglef aa;
+			gmtl::set(aa, orientations[i]);
+			const gmtl::Point4f& p = positions[i];
+			gmtl::Matrix44f m = gmtl::makeRot<gmtl::Matrix44f>(gmtl::AxisAnglef(-aa.getAngle(), aa.getAxis())) *
+			                    gmtl::makeTrans<gmtl::Matrix44f>(gmtl::Vec3f(-p[0], -p[1], -p[2]));
+			acc += m.getData()[12];
+		}
+	}
+	double old_ns = Elapsed(start, ops);
+
+	start = std::chrono::steady_clock::now();
+	for (int r = 0; r < repeats; r++) {
+		for (int i = 0; i < count; i++) {
+			float m[16];
+			PoseInverseMatrix(positions[i], orientations[i], m);
+			acc += m[12];
+		}
+	}
+	double new_ns = Elapsed(start, ops);
+	sink = acc;
+
+	float error = 0;
+	for (int i = 0; i < count; i++) {
+		gmtl::AxisAnglef aa;
+		gmtl::set(aa, orientations[i]);
+		const gmtl::Point4f& p = positions[i];
+		gmtl::Matrix44f ref = gmtl::makeRot<gmtl::Matrix44f>(gmtl::AxisAnglef(-aa.getAngle(), aa.getAxis())) *
+		                      gmtl::makeTrans<gmtl::Matrix44f>(gmtl::Vec3f(-p[0], -p[1], -p[2]));
+		float m[16];
+		PoseInverseMatrix(p, orientations[i], m);
+		for (int k = 0; k < 16; k++) {
+			// Translation scales with |p| (up to 100), so compare it relative to that
+			float scale = k >= 12 ? 100.0f : 1.0f;
+			error = fmaxf(error, fabsf(m[k] - ref.getData()[k]) / scale);
+		}
+	}
+	Report("camera_matrix", old_ns, new_ns, error);
+	worst = fmaxf(worst, error);
+
+	//|___________________
+	//| rotate_vector
+	//|___________________
+
+	const gmtl::Vec3f forward(0, 0, 1.0f);
+	acc = 0;
+	start = std::chrono::steady_clock::now();
+	for (int r = 0; r < repeats; r++) {
+		for (int i = 0; i < count; i++) {
+			const gmtl::Quatf& q = orientations[i];
+			gmtl::Quatf v_q = q * gmtl::Quatf(forward[0], forward[1], forward[2], 0) * gmtl::makeConj(q);
+			acc += v_q[0] + v_q[1] + v_q[2];
+		}
+	}
+	old_ns = Elapsed(start, ops);
+
+	start = std::chrono::steady_clock::now();
+	for (int r = 0; r < repeats; r++) {
+		for (int i = 0; i < count; i++) {
+			gmtl::Vec3f v = RotateVector(orientations[i], forward);
+			acc += v[0] + v[1] + v[2];
+		}
+	}
+	new_ns = Elapsed(start, ops);
+	sink = acc;
+
+	error = 0;
+	for (int i = 0; i < count; i++) {
+		const gmtl::Quatf& q = orientations[i];
+		gmtl::Quatf v_q = q * gmtl::Quatf(forward[0], forward[1], forward[2], 0) * gmtl::makeConj(q);
+		gmtl::Vec3f v = RotateVector(q, forward);
+		for (int k = 0; k < 3; k++) {
+			error = fmaxf(error, fabsf(v[k] - v_q[k]));
+		}
+	}
+	Report("rotate_vector", old_ns, new_ns, error);
+	worst = fmaxf(worst, error);
+
+	//|___________________
+	//| step_quat
+	//|___________________
+
+	constexpr float STEP_DEGS[] = { 1.5f, 5.0f, 15.0f, 45.0f };
+	constexpr float STEP_COS[] = { StepQuatCos(1.5f), StepQuatCos(5.0f), StepQuatCos(15.0f), StepQuatCos(45.0f) };
+	constexpr float STEP_SIN[] = { StepQuatSin(1.5f), StepQuatSin(5.0f), StepQuatSin(15.0f), StepQuatSin(45.0f) };
+
+	acc = 0;
+	start = std::chrono::steady_clock::now();
+	for (int r = 0; r < ops; r++) {
+		float degs = STEP_DEGS[r & 3] + (float)(r & 1) * sink * 0.0f;   // Not foldable by the compiler
+		acc += cos(gmtl::Math::deg2Rad(degs / 2)) + sin(gmtl::Math::deg2Rad(degs / 2));
+	}
+	old_ns = Elapsed(start, ops);
+	sink = acc;
+
+	error = 0;
+	for (int k = 0; k < 4; k++) {
+		error = fmaxf(error, fabsf(STEP_COS[k] - cosf(gmtl::Math::deg2Rad(STEP_DEGS[k] / 2))));
+		error = fmaxf(error, fabsf(STEP_SIN[k] - sinf(gmtl::Math::deg2Rad(STEP_DEGS[k] / 2))));
+	}
+	Report("step_quat", old_ns, 0.0, error);
+	worst = fmaxf(worst, error);
+
+	return worst <= MAX_ERROR ? 0 : 1;
+}
@@ -0,0 +1,291 @@
+//|___________________________________________________________________
+//!
+//! \file bench_pose_share.cpp
+//!
+//! \brief Benchmark and check of the shared-memory pose publication.
+//!
+//! Publishes synthetic poses for a number of ticks into a pose share (see
+//! pose_share.h), first with no reader, then while forked reader processes
+//! read the latest snapshot in place as fast as they can. Every record
+//! encodes the tick it was written at, so a reader can tell whether a
+//! snapshot it accepted mixes two ticks. Prints, per run, the mean and
+//! worst publish time and the readers' accepted snapshots and retries as
+//! one JSON line.
+//!
+//! Exits with 1 if a reader accepts a torn snapshot, sees the snapshots go
+//! backwards or never gets one.
+//!
+//! Standalone program (POSIX, not part of asm3.vcxproj):
+//!   g++ -O2 -I<gmtl> bench_pose_share.cpp pose_share.cpp -o bench_pose_share   (add -lrt before glibc 2.34)
+//!   ./bench_pose_share [turtles] [ticks] [readers]
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+
+#include "pose_share.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const int DEFAULT_TURTLES = 1000;
+const int DEFAULT_TICKS = 20000;            // Ticks stay exact as floats (below 2^24)
+const int DEFAULT_READERS = 2;
+const int MAX_READERS = 32;
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+// Results of one reader process, in memory shared with the writer
+struct ReaderStats
+{
+	uint64_t snapshots;                     // Accepted (EndPoseRead() succeeded) and consistent
+	uint64_t retries;                       // Rejected by EndPoseRead()
+	uint64_t torn;                          // Accepted but mixing ticks: must stay 0
+	uint64_t backwards;                     // Older than the previous accepted one: must stay 0
+	bool opened;
+};
+
+struct BenchShared
+{
+	std::atomic<int> ready;                 // Readers that mapped the share
+	std::atomic<int> stop;                  // Set by the writer once every tick is published
+	ReaderStats readers[MAX_READERS];
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void RunReader(const char* name, int turtles, BenchShared* shared, ReaderStats& stats);
+bool CheckSnapshot(const PoseShareSlot* slot, int turtles);
+void PublishTick(PoseShare& share, uint64_t tick, int turtles);
+
+//|____________________________________________________________________
+//|
+//| Function: PublishTick
+//|
+//! \param share    [in,out] Writable pose share.
+//! \param tick     [in] Tick written into every record.
+//! \param turtles  [in] Records to publish.
+//! \return None.
+//|____________________________________________________________________
+
+void PublishTick(PoseShare& share, uint64_t tick, int turtles)
+{
+	SceneFileTurtle* records = BeginPosePublish(share, tick, turtles);
+	float f = (float)tick;
+	for (int t = 0; t < turtles; t++) {
+		SceneFileTurtle& record = records[t];
+		record.position[0] = f;
+		record.position[1] = (float)t;
+		record.position[2] = -f;
+		record.orientation[0] = record.orientation[1] = record.orientation[2] = 0.0f;
+		record.orientation[3] = 1.0f;
+		for (int j = 0; j < JOINT_COUNT; j++) {
+			record.joints[j] = f + j;
+		}
+	}
+	EndPosePublish(share);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: CheckSnapshot
+//|
+//! \param slot     [in] Slot being read (its records are read in place).
+//! \param turtles  [in] Records expected.
+//! \return True if every record was written at the slot's tick.
+//!
+//! The result only means something once EndPoseRead() accepts the read.
+//|____________________________________________________________________
+
+bool CheckSnapshot(const PoseShareSlot* slot, int turtles)
+{
+	float f = (float)slot->tick;
+	bool ok = slot->turtle_count == (uint64_t)turtles && slot->snapshot == slot->tick;
+	const SceneFileTurtle* records = PoseSlotTurtles(slot);
+	for (int t = 0; t < turtles && ok; t++) {
+		const SceneFileTurtle& record = records[t];
+		ok = record.position[0] == f && record.position[1] == (float)t && record.position[2] == -f &&
+		     record.orientation[3] == 1.0f;
+		for (int j = 0; j < JOINT_COUNT && ok; j++) {
+			ok = record.joints[j] == f + j;
+		}
+	}
+	return ok;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: RunReader
+//|
+//! \param name     [in] Pose share name.
+//! \param turtles  [in] Records per snapshot.
+//! \param shared   [in,out] Start and stop flags.
+//! \param stats    [out] Reader results.
+//! \return None.
+//!
+//! Body of a reader process: reads the latest snapshot over and over
+//! until the writer stops.
+//|____________________________________________________________________
+
+void RunReader(const char* name, int turtles, BenchShared* shared, ReaderStats& stats)
+{
+	PoseShare share;
+	stats.opened = OpenPoseShare(name, share);
+	shared->ready.fetch_add(1);
+	if (!stats.opened) {
+		return;
+	}
+
+	uint64_t last = 0;
+	while (!shared->stop.load(std::memory_order_acquire)) {
+		uint64_t sequence;
+		const PoseShareSlot* slot = BeginPoseRead(share, sequence);
+		if (!slot) {
+			continue;
+		}
+		uint64_t snapshot = slot->snapshot;
+		bool consistent = CheckSnapshot(slot, turtles);
+		if (!EndPoseRead(slot, sequence)) {
+			stats.retries++;
+			continue;
+		}
+		if (!consistent) {
+			stats.torn++;
+		}
+		else {
+			stats.snapshots++;
+		}
+		if (snapshot < last) {
+			stats.backwards++;
+		}
+		last = snapshot;
+	}
+
+	ClosePoseShare(share);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: main
+//|
+//! \param argc   [in] Number of command line arguments.
+//! \param argv   [in] [turtles] [ticks] [readers].
+//! \return 0 if every check passes, 1 otherwise.
+//|____________________________________________________________________
+
+int main(int argc, char** argv)
+{
+	int turtles = argc > 1 ? atoi(argv[1]) : DEFAULT_TURTLES;
+	int ticks = argc > 2 ? atoi(argv[2]) : DEFAULT_TICKS;
+	int readers = argc > 3 ? atoi(argv[3]) : DEFAULT_READERS;
+	if (turtles <= 0) {
+		turtles = DEFAULT_TURTLES;
+	}
+	if (ticks <= 0 || ticks >= (1 << 24) - JOINT_COUNT) {
+		ticks = DEFAULT_TICKS;
+	}
+	if (readers < 1 || readers > MAX_READERS) {
+		readers = DEFAULT_READERS;
+	}
+
+	char name[64];
+	snprintf(name, sizeof(name), "/asm3_bench_poses_%d", (int)getpid());
+
+	BenchShared* shared = (BenchShared*)mmap(NULL, sizeof(BenchShared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) {
+		printf("Cannot map the reader results\n");
+		return 1;
+	}
+
+	bool ok = true;
+
+	// A run without readers, then one with them: the writer must not notice
+	int runs[2] = { 0, readers };
+	for (int r = 0; r < 2; r++) {
+		int count = runs[r];
+		shared->ready.store(0);
+		shared->stop.store(0);
+		memset(shared->readers, 0, sizeof(shared->readers));
+
+		PoseShare share;
+		if (!CreatePoseShare(name, turtles, share)) {
+			return 1;
+		}
+
+		for (int i = 0; i < count; i++) {
+			if (fork() == 0) {
+				RunReader(name, turtles, shared, shared->readers[i]);
+				_exit(0);
+			}
+		}
+		while (shared->ready.load() < count) {
+			usleep(1000);
+		}
+
+		double total_us = 0, worst_us = 0;
+		for (int tick = 1; tick <= ticks; tick++) {
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			PublishTick(share, tick, turtles);
+			double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+			total_us += us;
+			if (us > worst_us) {
+				worst_us = us;
+			}
+			if (count > 0 && tick % 64 == 0) {
+				sched_yield();                  // Lets the readers in on a single core
+			}
+		}
+
+		shared->stop.store(1, std::memory_order_release);
+		for (int i = 0; i < count; i++) {
+			wait(NULL);
+		}
+		ClosePoseShare(share);
+
+		ReaderStats sum;
+		memset(&sum, 0, sizeof(sum));
+		bool opened = true;
+		for (int i = 0; i < count; i++) {
+			const ReaderStats& s = shared->readers[i];
+			sum.snapshots += s.snapshots;
+			sum.retries += s.retries;
+			sum.torn += s.torn;
+			sum.backwards += s.backwards;
+			opened = opened && s.opened && s.snapshots > 0;
+		}
+		bool run_ok = opened && sum.torn == 0 && sum.backwards == 0;
+		ok = ok && run_ok;
+
+		printf("{\"turtles\":%d,\"ticks\":%d,\"readers\":%d,\"slot_kb\":%.1f,\"publish_us\":%.3f,\"worst_publish_us\":%.3f,"
+			"\"snapshots\":%llu,\"retries\":%llu,\"torn\":%llu,\"backwards\":%llu,\"ok\":%s}\n",
+			turtles, ticks, count, (sizeof(PoseShareSlot) + turtles * sizeof(SceneFileTurtle)) / 1024.0,
+			total_us / ticks, worst_us, (unsigned long long)sum.snapshots, (unsigned long long)sum.retries,
+			(unsigned long long)sum.torn, (unsigned long long)sum.backwards, run_ok ? "true" : "false");
+		fflush(stdout);
+	}
+
+	munmap(shared, sizeof(BenchShared));
+	return ok ? 0 : 1;
+}
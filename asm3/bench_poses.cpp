@@ -0,0 +1,252 @@
+//|___________________________________________________________________
+//!
+//! \file bench_poses.cpp
+//!
+//! \brief Cross-check and timing of the batched pose kernels.
+//!
+//! Moves a population of turtles the way KeyboardFunc() moves one (roll,
+//! yaw, forward step, then renormalize) with the gmtl operations and with
+//! every pose kernel this CPU runs. Each kernel must match gmtl within a
+//! small tolerance before it is timed; results are printed as JSON lines.
+//!
+//! Standalone program (not part of asm3.vcxproj):
+//!   g++ -O2 -I<gmtl> bench_poses.cpp turtle_poses.cpp -o bench_poses
+//!   ./bench_poses [turtles] [ticks]
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <vector>
+
+#include <gmtl/gmtl.h>
+
+#include "turtle_poses.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const int DEFAULT_TURTLES = 100003;         // Not a multiple of 8, so the scalar tails run too
+const int DEFAULT_TICKS = 100;
+const int CHECK_TICKS = 10;                 // Ticks compared against gmtl
+const float STEP_ROTATION = 5.0f;           // Rotation per tick (degs)
+const float MAX_QUAT_ERROR = 1e-5f;
+const float MAX_POSITION_ERROR = 1e-4f;
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+// Reference state, laid out as the GLUT program keeps its poses
+struct GmtlPoses
+{
+	std::vector<gmtl::Point4f> p;
+	std::vector<gmtl::Quatf> q;
+};
+
+//|___________________
+//|
+//| Global Variables
+//|___________________
+
+gmtl::Quatf roll_q;                         // zrotp_q
+gmtl::Quatf yaw_q;                          // yrotp_q
+const gmtl::Vec3f FORWARD(0, 0, 1.0f);      // Forward step per tick (as PLANE_FORWARD)
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void InitPoses(int count, GmtlPoses& ref, TurtlePoses& soa);
+void TickGmtl(GmtlPoses& ref);
+void TickKernels(TurtlePoses& soa);
+bool Compare(const GmtlPoses& ref, const TurtlePoses& soa, float& q_err, float& p_err);
+
+//|____________________________________________________________________
+//|
+//| Function: InitPoses
+//|
+//! \param count  [in] Number of turtles.
+//! \param ref    [out] gmtl poses.
+//! \param soa    [out] The same poses in structure-of-arrays form.
+//! \return None.
+//!
+//! Spreads the turtles over a grid with reproducible, varied orientations.
+//|____________________________________________________________________
+
+void InitPoses(int count, GmtlPoses& ref, TurtlePoses& soa)
+{
+	unsigned int seed = 12345;
+
+	for (int i = 0; i < count; i++) {
+		float a[4];
+		for (int k = 0; k < 4; k++) {
+			seed = seed * 1664525u + 1013904223u;
+			a[k] = (float)(seed >> 8) / (float)(1 << 24) * 2.0f - 1.0f;
+		}
+		gmtl::Quatf q(a[0], a[1], a[2], a[3]);
+		gmtl::normalize(q);
+		gmtl::Point4f p((float)(i % 1000), 0.0f, (float)(i / 1000), 1.0f);
+
+		ref.p.push_back(p);
+		ref.q.push_back(q);
+		AddPose(soa, p, q);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: TickGmtl
+//|
+//! \param ref    [in,out] gmtl poses.
+//! \return None.
+//!
+//! One tick with the per-turtle code of KeyboardFunc() ('e', 'a', 's').
+//|____________________________________________________________________
+
+void TickGmtl(GmtlPoses& ref)
+{
+	for (size_t i = 0; i < ref.q.size(); i++) {
+		gmtl::Quatf& q = ref.q[i];
+		q = q * roll_q;
+		q = q * yaw_q;
+
+		gmtl::Quatf v_q = q * gmtl::Quatf(FORWARD[0], FORWARD[1], FORWARD[2], 0) * gmtl::makeConj(q);
+		ref.p[i] = ref.p[i] + v_q.mData;
+
+		gmtl::normalize(q);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: TickKernels
+//|
+//! \param soa    [in,out] Turtle poses.
+//! \return None.
+//!
+//! The same tick with the batched kernels.
+//|____________________________________________________________________
+
+void TickKernels(TurtlePoses& soa)
+{
+	int n = PoseCount(soa);
+	RotatePoses(soa, roll_q, 0, n);
+	RotatePoses(soa, yaw_q, 0, n);
+	MovePosesForward(soa, FORWARD[2], 0, n);
+	NormalizePoses(soa, 0, n);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: Compare
+//|
+//! \param ref    [in] gmtl poses.
+//! \param soa    [in] Kernel poses.
+//! \param q_err  [out] Largest quaternion component difference.
+//! \param p_err  [out] Largest position component difference (relative to
+//!                      the coordinate's magnitude when above 1).
+//! \return True if both are within tolerance.
+//|____________________________________________________________________
+
+bool Compare(const GmtlPoses& ref, const TurtlePoses& soa, float& q_err, float& p_err)
+{
+	q_err = 0;
+	p_err = 0;
+	for (int i = 0; i < PoseCount(soa); i++) {
+		gmtl::Point4f p;
+		gmtl::Quatf q;
+		GetPose(soa, i, p, q);
+		for (int k = 0; k < 4; k++) {
+			q_err = fmaxf(q_err, fabsf(q[k] - ref.q[i][k]));
+		}
+		for (int k = 0; k < 3; k++) {
+			p_err = fmaxf(p_err, fabsf(p[k] - ref.p[i][k]) / fmaxf(1.0f, fabsf(ref.p[i][k])));
+		}
+	}
+	return q_err <= MAX_QUAT_ERROR && p_err <= MAX_POSITION_ERROR;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: main
+//|
+//! \param argc   [in] Number of command line arguments.
+//! \param argv   [in] [turtles] [ticks].
+//! \return 0 if every kernel matches gmtl, 1 otherwise.
+//|____________________________________________________________________
+
+int main(int argc, char** argv)
+{
+	int turtles = argc > 1 ? atoi(argv[1]) : DEFAULT_TURTLES;
+	int ticks = argc > 2 ? atoi(argv[2]) : DEFAULT_TICKS;
+	if (turtles <= 0) {
+		turtles = DEFAULT_TURTLES;
+	}
+	if (ticks <= 0) {
+		ticks = DEFAULT_TICKS;
+	}
+
+	gmtl::set(roll_q, gmtl::AxisAnglef(gmtl::Math::deg2Rad(STEP_ROTATION), 0.0f, 0.0f, 1.0f));
+	gmtl::set(yaw_q, gmtl::AxisAnglef(gmtl::Math::deg2Rad(STEP_ROTATION), 0.0f, 1.0f, 0.0f));
+
+	GmtlPoses initial_ref;
+	TurtlePoses initial_soa;
+	InitPoses(turtles, initial_ref, initial_soa);
+
+	// Reference: gmtl results after CHECK_TICKS, and the gmtl tick time
+	GmtlPoses checked = initial_ref;
+	for (int t = 0; t < CHECK_TICKS; t++) {
+		TickGmtl(checked);
+	}
+
+	GmtlPoses ref = initial_ref;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int t = 0; t < ticks; t++) {
+		TickGmtl(ref);
+	}
+	double gmtl_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / ticks;
+	printf("{\"kernel\":\"gmtl\",\"turtles\":%d,\"ticks\":%d,\"tick_ms\":%.4f,\"speedup\":1.00}\n",
+		turtles, ticks, gmtl_ms);
+
+	bool ok = true;
+	for (int k = 0; k < POSE_KERNEL_COUNT; k++) {
+		PoseKernel kernel = (PoseKernel)k;
+		if (!PoseKernelSupported(kernel)) {
+			continue;
+		}
+		SetPoseKernel(kernel);
+
+		TurtlePoses soa = initial_soa;
+		for (int t = 0; t < CHECK_TICKS; t++) {
+			TickKernels(soa);
+		}
+		float q_err, p_err;
+		bool match = Compare(checked, soa, q_err, p_err);
+		ok = ok && match;
+
+		soa = initial_soa;
+		start = std::chrono::steady_clock::now();
+		for (int t = 0; t < ticks; t++) {
+			TickKernels(soa);
+		}
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / ticks;
+
+		printf("{\"kernel\":\"%s\",\"turtles\":%d,\"ticks\":%d,\"tick_ms\":%.4f,\"speedup\":%.2f,"
+			"\"max_quat_error\":%g,\"max_position_error\":%g,\"matches_gmtl\":%s}\n",
+			PoseKernelName(kernel), turtles, ticks, ms, gmtl_ms / ms, q_err, p_err, match ? "true" : "false");
+	}
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,649 @@
+//|___________________________________________________________________
+//!
+//! \file bench_primitives.cpp
+//!
+//! \brief Microbenchmark suite of the math and draw building blocks.
+//!
+//! Each case times the code the program started from (gmtl calls, the
+//! immediate-mode drawing of the original plane2_base_a.cpp) and, when
+//! there is one, the replacement the program uses now:
+//!
+//!   quat_mult           gmtl Quatf * Quatf (the rotation keys' updates)
+//!   quat_conj           gmtl::makeConj()
+//!   quat_to_axis_angle  gmtl::set(AxisAnglef, Quatf)
+//!   quat_to_rotation    set(AxisAnglef, Quatf) + makeRot (what glRotatef
+//!                       was fed) vs PoseMatrix()
+//!   rotate_vector       q * v * conj(q) of the s/f handlers vs RotateVector()
+//!   draw_cube           drawCube() in glBegin/glEnd vs DrawMesh() of the
+//!                       same cube from the shared vertex buffer
+//!   coordinate_frame    DrawCoordinateFrame() in glBegin/glEnd vs its
+//!                       MESH_FRAME draw
+//!
+//! A small harness doubles the iterations of a sample until it lasts
+//! SAMPLE_MS, then takes the median and minimum over the samples. Draw
+//! cases submit into a tiny offscreen framebuffer (EGL surfaceless, e.g.
+//! Mesa llvmpipe) and finish once per sample, so they measure submission
+//! rather than fill; without a context they are skipped.
+//!
+//! Prints one JSON line per case, in a fixed order with fixed keys, so two
+//! runs diff line by line. Exits with 1 if a replacement's results differ
+//! from the gmtl ones beyond MAX_ERROR.
+//!
+//! Standalone program (Linux, not part of asm3.vcxproj):
+//!   g++ -O2 -I<gmtl> bench_primitives.cpp pose_math.cpp turtle_mesh.cpp scene_graph.cpp gl_ext.cpp -o bench_primitives -lEGL -lGL
+//!   ./bench_primitives [samples] [results.jsonl]
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <gmtl/gmtl.h>
+
+#include "gl_ext.h"
+#include "pose_math.h"
+#include "turtle_mesh.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const int DEFAULT_SAMPLES = 7;
+const double SAMPLE_MS = 20.0;              // Minimum length of a sample
+const int POSE_COUNT = 1024;                // Operands cycled through (fit in L1)
+const float MAX_ERROR = 1e-4f;
+const int FRAMEBUFFER_SIZE = 16;            // Pixels; draws measure submission, not fill
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA   0x31DD
+#endif
+
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER          0x8D40
+#define GL_RENDERBUFFER         0x8D41
+#define GL_COLOR_ATTACHMENT0    0x8CE0
+#define GL_DEPTH_ATTACHMENT     0x8D00
+#define GL_DEPTH_COMPONENT24    0x81A6
+#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#endif
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+typedef float (*BenchFunc)(long iterations);   // Returns a value derived from every result
+
+struct BenchCase
+{
+	const char* name;
+	const char* baseline;           // What the original code did
+	BenchFunc baseline_func;
+	const char* replacement;        // What the program does now, NULL if unchanged
+	BenchFunc replacement_func;
+	bool draws;                     // Needs a GL context
+};
+
+struct BenchTiming
+{
+	double median_ns;               // Per operation
+	double min_ns;
+	long iterations;                // Per sample
+};
+
+typedef void (APIENTRY *PFNGENFRAMEBUFFERS)(GLsizei n, GLuint* ids);
+typedef void (APIENTRY *PFNBINDFRAMEBUFFER)(GLenum target, GLuint id);
+typedef void (APIENTRY *PFNFRAMEBUFFERRENDERBUFFER)(GLenum target, GLenum attachment, GLenum rbtarget, GLuint rb);
+typedef GLenum (APIENTRY *PFNCHECKFRAMEBUFFERSTATUS)(GLenum target);
+typedef void (APIENTRY *PFNGENRENDERBUFFERS)(GLsizei n, GLuint* ids);
+typedef void (APIENTRY *PFNBINDRENDERBUFFER)(GLenum target, GLuint id);
+typedef void (APIENTRY *PFNRENDERBUFFERSTORAGE)(GLenum target, GLenum format, GLsizei w, GLsizei h);
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void InitPoses();
+BenchTiming TimeBench(BenchFunc func, int samples);
+float MaxRotationError();
+float MaxRotateVectorError();
+
+float GmtlQuatMult(long iterations);
+float GmtlQuatConj(long iterations);
+float GmtlQuatToAxisAngle(long iterations);
+float GmtlQuatToRotation(long iterations);
+float PoseMatrixRotation(long iterations);
+float GmtlRotateVector(long iterations);
+float RotateVectorDirect(long iterations);
+float ImmediateCube(long iterations);
+float MeshCube(long iterations);
+float ImmediateCoordinateFrame(long iterations);
+float MeshCoordinateFrame(long iterations);
+
+void DrawCubeImmediate(const float width, const float length, const float height, const float colours[3]);
+void DrawCoordinateFrameImmediate(const float l);
+GLProc GetProcAddressEGL(const char* name);
+bool CreateOffscreenContext(int width, int height);
+
+//|___________________
+//|
+//| Global Variables
+//|___________________
+
+gmtl::Quatf quats[POSE_COUNT];
+gmtl::Point4f points[POSE_COUNT];
+gmtl::Vec3f vectors[POSE_COUNT];
+
+const BenchCase CASES[] = {
+	{ "quat_mult",           "gmtl Quatf * Quatf",             GmtlQuatMult,              NULL,                    NULL,                 false },
+	{ "quat_conj",           "gmtl::makeConj",                 GmtlQuatConj,              NULL,                    NULL,                 false },
+	{ "quat_to_axis_angle",  "gmtl::set(AxisAnglef, Quatf)",   GmtlQuatToAxisAngle,       NULL,                    NULL,                 false },
+	{ "quat_to_rotation",    "set(AxisAnglef) + makeRot",      GmtlQuatToRotation,        "PoseMatrix",            PoseMatrixRotation,   false },
+	{ "rotate_vector",       "q * v * conj(q)",                GmtlRotateVector,          "RotateVector",          RotateVectorDirect,   false },
+	{ "draw_cube",           "drawCube (glBegin)",             ImmediateCube,             "DrawMesh(MESH_HEAD)",   MeshCube,             true },
+	{ "coordinate_frame",    "DrawCoordinateFrame (glBegin)",  ImmediateCoordinateFrame,  "DrawMesh(MESH_FRAME)",  MeshCoordinateFrame,  true },
+};
+
+//|____________________________________________________________________
+//|
+//| Function: InitPoses
+//|
+//! \param None.
+//! \return None.
+//!
+//! Reproducible random unit quaternions, positions and vectors.
+//|____________________________________________________________________
+
+void InitPoses()
+{
+	unsigned int seed = 12345;
+
+	for (int i = 0; i < POSE_COUNT; i++) {
+		float a[10];
+		for (int k = 0; k < 10; k++) {
+			seed = seed * 1664525u + 1013904223u;
+			a[k] = (float)(seed >> 8) / (float)(1 << 24) * 2.0f - 1.0f;
+		}
+		quats[i].set(a[0], a[1], a[2], a[3]);
+		gmtl::normalize(quats[i]);
+		points[i].set(a[4] * 100, a[5] * 100, a[6] * 100, 1.0f);
+		vectors[i].set(a[7], a[8], a[9]);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: TimeBench
+//|
+//! \param func     [in] Case body.
+//! \param samples  [in] Samples to take.
+//! \return Median and minimum time per operation over the samples.
+//!
+//! Doubles the iterations until one run lasts SAMPLE_MS (which also warms
+//! up caches and the driver), then times that many per sample.
+//|____________________________________________________________________
+
+BenchTiming TimeBench(BenchFunc func, int samples)
+{
+	volatile float sink = 0;                // Keeps the optimizer from dropping results
+	long iterations = 1;
+	for (;;) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		sink = sink + func(iterations);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (ms >= SAMPLE_MS || iterations >= (1L << 30)) {
+			break;
+		}
+		iterations *= 2;
+	}
+
+	std::vector<double> ns(samples);
+	for (int s = 0; s < samples; s++) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		sink = sink + func(iterations);
+		ns[s] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+	}
+	std::sort(ns.begin(), ns.end());
+
+	BenchTiming timing = { ns[samples / 2], ns[0], iterations };
+	return timing;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: MaxRotationError
+//|
+//! \param None.
+//! \return Largest difference between the rotation of PoseMatrix() and
+//!         the one built from gmtl's axis-angle.
+//|____________________________________________________________________
+
+float MaxRotationError()
+{
+	float error = 0;
+	for (int i = 0; i < POSE_COUNT; i++) {
+		gmtl::AxisAnglef aa;
+		gmtl::set(aa, quats[i]);
+		gmtl::Matrix44f ref = gmtl::makeRot<gmtl::Matrix44f>(aa);
+		float m[16];
+		PoseMatrix(gmtl::Point4f(0, 0, 0, 1), quats[i], m);
+		for (int k = 0; k < 12; k++) {
+			error = fmaxf(error, fabsf(m[k] - ref.getData()[k]));
+		}
+	}
+	return error;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: MaxRotateVectorError
+//|
+//! \param None.
+//! \return Largest difference between RotateVector() and q * v * conj(q).
+//|____________________________________________________________________
+
+float MaxRotateVectorError()
+{
+	float error = 0;
+	for (int i = 0; i < POSE_COUNT; i++) {
+		const gmtl::Quatf& q = quats[i];
+		const gmtl::Vec3f& v = vectors[i];
+		gmtl::Quatf v_q = q * gmtl::Quatf(v[0], v[1], v[2], 0) * gmtl::makeConj(q);
+		gmtl::Vec3f r = RotateVector(q, v);
+		for (int k = 0; k < 3; k++) {
+			error = fmaxf(error, fabsf(r[k] - v_q[k]));
+		}
+	}
+	return error;
+}
+
+//|____________________________________________________________________
+//|
+//| Math cases: one operation per iteration, over the operand arrays
+//|____________________________________________________________________
+
+float GmtlQuatMult(long iterations)
+{
+	gmtl::Quatf acc = quats[0];
+	for (long i = 0; i < iterations; i++) {
+		acc = acc * quats[i & (POSE_COUNT - 1)];
+	}
+	return acc[0] + acc[3];
+}
+
+float GmtlQuatConj(long iterations)
+{
+	float acc = 0;
+	for (long i = 0; i < iterations; i++) {
+		gmtl::Quatf c = gmtl::makeConj(quats[i & (POSE_COUNT - 1)]);
+		acc += c[0] + c[3];
+	}
+	return acc;
+}
+
+float GmtlQuatToAxisAngle(long iterations)
+{
+	float acc = 0;
+	for (long i = 0; i < iterations; i++) {
+		gmtl::AxisAnglef aa;
+		gmtl::set(aa, quats[i & (POSE_COUNT - 1)]);
+		acc += aa.getAngle() + aa.getAxis()[0];
+	}
+	return acc;
+}
+
+float GmtlQuatToRotation(long iterations)
+{
+	float acc = 0;
+	for (long i = 0; i < iterations; i++) {
+		gmtl::AxisAnglef aa;
+		gmtl::set(aa, quats[i & (POSE_COUNT - 1)]);
+		gmtl::Matrix44f m = gmtl::makeRot<gmtl::Matrix44f>(aa);
+		acc += m.getData()[0] + m.getData()[6];
+	}
+	return acc;
+}
+
+float PoseMatrixRotation(long iterations)
+{
+	float acc = 0;
+	for (long i = 0; i < iterations; i++) {
+		float m[16];
+		PoseMatrix(points[i & (POSE_COUNT - 1)], quats[i & (POSE_COUNT - 1)], m);
+		acc += m[0] + m[6];
+	}
+	return acc;
+}
+
+float GmtlRotateVector(long iterations)
+{
+	float acc = 0;
+	for (long i = 0; i < iterations; i++) {
+		const gmtl::Quatf& q = quats[i & (POSE_COUNT - 1)];
+		const gmtl::Vec3f& v = vectors[i & (POSE_COUNT - 1)];
+		gmtl::Quatf v_q = q * gmtl::Quatf(v[0], v[1], v[2], 0) * gmtl::makeConj(q);
+		acc += v_q[0] + v_q[1] + v_q[2];
+	}
+	return acc;
+}
+
+float RotateVectorDirect(long iterations)
+{
+	float acc = 0;
+	for (long i = 0; i < iterations; i++) {
+		gmtl::Vec3f r = RotateVector(quats[i & (POSE_COUNT - 1)], vectors[i & (POSE_COUNT - 1)]);
+		acc += r[0] + r[1] + r[2];
+	}
+	return acc;
+}
+
+//|____________________________________________________________________
+//|
+//| Draw cases: one draw per iteration, finished once per sample
+//|____________________________________________________________________
+
+float ImmediateCube(long iterations)
+{
+	// The head, as the original drew it (MESH_HEAD is the same cube)
+	const TurtleModel& m = DEFAULT_TURTLE_MODEL;
+	for (long i = 0; i < iterations; i++) {
+		DrawCubeImmediate(0.7f * m.p_width, 0.7f * m.p_length, 0.85f * m.p_height, m.colours[COLOUR_LIME_GREEN]);
+	}
+	glFinish();
+	return 0;
+}
+
+float MeshCube(long iterations)
+{
+	BindMeshes();
+	for (long i = 0; i < iterations; i++) {
+		DrawMesh(MESH_HEAD);
+	}
+	UnbindMeshes();
+	glFinish();
+	return 0;
+}
+
+float ImmediateCoordinateFrame(long iterations)
+{
+	for (long i = 0; i < iterations; i++) {
+		DrawCoordinateFrameImmediate(1);
+	}
+	glFinish();
+	return 0;
+}
+
+float MeshCoordinateFrame(long iterations)
+{
+	BindMeshes();
+	for (long i = 0; i < iterations; i++) {
+		glPushMatrix();
+			glScalef(1, 1, 1);
+			DrawMesh(MESH_FRAME);
+		glPopMatrix();
+	}
+	UnbindMeshes();
+	glFinish();
+	return 0;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: DrawCubeImmediate
+//|
+//! \param width   [in] Width of the cube.
+//! \param length  [in] Length of the cube.
+//! \param height  [in] Height of the cube.
+//! \param colours [in] Colour of the front face; each next face is brighter.
+//! \return None.
+//!
+//! drawCube() of the original program, one glVertex3f() per corner.
+//|____________________________________________________________________
+
+void DrawCubeImmediate(const float width, const float length, const float height, const float colours[3])
+{
+	float w2 = width / 2;
+	float h2 = height / 2;
+	float l2 = length / 2;
+	const float c_delta = 0.05f;
+
+	const float faces[6][4][3] = {
+		{ { w2, h2, -l2 }, { -w2, h2, -l2 }, { -w2, -h2, -l2 }, { w2, -h2, -l2 } },     // Front
+		{ { w2, h2, -l2 }, { w2, h2, l2 }, { w2, -h2, l2 }, { w2, -h2, -l2 } },         // Right
+		{ { w2, h2, l2 }, { -w2, h2, l2 }, { -w2, h2, -l2 }, { w2, h2, -l2 } },         // Top
+		{ { w2, -h2, -l2 }, { -w2, -h2, -l2 }, { -w2, -h2, l2 }, { w2, -h2, l2 } },     // Bottom
+		{ { -w2, h2, l2 }, { w2, h2, l2 }, { w2, -h2, l2 }, { -w2, -h2, l2 } },         // Back
+		{ { -w2, h2, -l2 }, { -w2, h2, l2 }, { -w2, -h2, l2 }, { -w2, -h2, -l2 } },     // Left
+	};
+
+	glBegin(GL_QUADS);
+	for (int f = 0; f < 6; f++) {
+		glColor3f(colours[0] + f * c_delta, colours[1] + f * c_delta, colours[2] + f * c_delta);
+		for (int k = 0; k < 4; k++) {
+			glVertex3f(faces[f][k][0], faces[f][k][1], faces[f][k][2]);
+		}
+	}
+	glEnd();
+}
+
+//|____________________________________________________________________
+//|
+//| Function: DrawCoordinateFrameImmediate
+//|
+//! \param l      [in] Length of the three axes.
+//! \return None.
+//!
+//! DrawCoordinateFrame() of the original program.
+//|____________________________________________________________________
+
+void DrawCoordinateFrameImmediate(const float l)
+{
+	glBegin(GL_LINES);
+	// X axis is red
+	glColor3f(1.0f, 0.0f, 0.0f);
+	glVertex3f(0.0f, 0.0f, 0.0f);
+	glVertex3f(l, 0.0f, 0.0f);
+
+	// Y axis is green
+	glColor3f(0.0f, 1.0f, 0.0f);
+	glVertex3f(0.0f, 0.0f, 0.0f);
+	glVertex3f(0.0f, l, 0.0f);
+
+	// Z axis is blue
+	glColor3f(0.0f, 0.0f, 1.0f);
+	glVertex3f(0.0f, 0.0f, 0.0f);
+	glVertex3f(0.0f, 0.0f, l);
+	glEnd();
+}
+
+//|____________________________________________________________________
+//|
+//| Function: GetProcAddressEGL
+//|
+//! \param name   [in] GL function name.
+//! \return Entry point, or NULL when the driver lacks it.
+//|____________________________________________________________________
+
+GLProc GetProcAddressEGL(const char* name)
+{
+	return (GLProc)eglGetProcAddress(name);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: CreateOffscreenContext
+//|
+//! \param width  [in] Framebuffer width.
+//! \param height [in] Framebuffer height.
+//! \return True on success.
+//!
+//! Makes a compatibility-profile GL context current without any surface
+//! and binds a colour+depth framebuffer object of the given size to it
+//! (as bench_render.cpp does).
+//|____________________________________________________________________
+
+bool CreateOffscreenContext(int width, int height)
+{
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	EGLDisplay dpy = EGL_NO_DISPLAY;
+	if (get_platform_display) {
+		dpy = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	}
+	if (dpy == EGL_NO_DISPLAY) {
+		dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+	if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, NULL, NULL)) {
+		return false;
+	}
+
+	const EGLint config_attribs[] = {
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint num_configs = 0;
+	if (!eglBindAPI(EGL_OPENGL_API) ||
+		!eglChooseConfig(dpy, config_attribs, &config, 1, &num_configs) || num_configs == 0) {
+		return false;
+	}
+
+	EGLContext ctx = eglCreateContext(dpy, config, EGL_NO_CONTEXT, NULL);
+	if (ctx == EGL_NO_CONTEXT || !eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx)) {
+		return false;
+	}
+
+	PFNGENFRAMEBUFFERS gen_framebuffers = (PFNGENFRAMEBUFFERS)eglGetProcAddress("glGenFramebuffers");
+	PFNBINDFRAMEBUFFER bind_framebuffer = (PFNBINDFRAMEBUFFER)eglGetProcAddress("glBindFramebuffer");
+	PFNFRAMEBUFFERRENDERBUFFER framebuffer_renderbuffer = (PFNFRAMEBUFFERRENDERBUFFER)eglGetProcAddress("glFramebufferRenderbuffer");
+	PFNCHECKFRAMEBUFFERSTATUS check_framebuffer_status = (PFNCHECKFRAMEBUFFERSTATUS)eglGetProcAddress("glCheckFramebufferStatus");
+	PFNGENRENDERBUFFERS gen_renderbuffers = (PFNGENRENDERBUFFERS)eglGetProcAddress("glGenRenderbuffers");
+	PFNBINDRENDERBUFFER bind_renderbuffer = (PFNBINDRENDERBUFFER)eglGetProcAddress("glBindRenderbuffer");
+	PFNRENDERBUFFERSTORAGE renderbuffer_storage = (PFNRENDERBUFFERSTORAGE)eglGetProcAddress("glRenderbufferStorage");
+	if (!gen_framebuffers || !bind_framebuffer || !framebuffer_renderbuffer || !check_framebuffer_status ||
+		!gen_renderbuffers || !bind_renderbuffer || !renderbuffer_storage) {
+		return false;
+	}
+
+	GLuint fbo, rb[2];
+	gen_framebuffers(1, &fbo);
+	gen_renderbuffers(2, rb);
+	bind_framebuffer(GL_FRAMEBUFFER, fbo);
+
+	bind_renderbuffer(GL_RENDERBUFFER, rb[0]);
+	renderbuffer_storage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	framebuffer_renderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rb[0]);
+
+	bind_renderbuffer(GL_RENDERBUFFER, rb[1]);
+	renderbuffer_storage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	framebuffer_renderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rb[1]);
+
+	if (check_framebuffer_status(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		return false;
+	}
+
+	glViewport(0, 0, width, height);
+	return true;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: main
+//|
+//! \param argc   [in] Number of command line arguments.
+//! \param argv   [in] [samples] [results file].
+//! \return 0 if every replacement matches gmtl, 1 otherwise.
+//|____________________________________________________________________
+
+int main(int argc, char** argv)
+{
+	int samples = argc > 1 ? atoi(argv[1]) : DEFAULT_SAMPLES;
+	if (samples <= 0) {
+		samples = DEFAULT_SAMPLES;
+	}
+	FILE* out = NULL;
+	if (argc > 2 && !(out = fopen(argv[2], "w"))) {
+		fprintf(stderr, "bench_primitives: cannot write %s\n", argv[2]);
+		return 1;
+	}
+
+	InitPoses();
+
+	// The draws look at the cube from the front, as the original's camera did
+	bool gl = CreateOffscreenContext(FRAMEBUFFER_SIZE, FRAMEBUFFER_SIZE) && LoadGLExtensions(GetProcAddressEGL);
+	if (gl) {
+		InitMeshes();
+		glEnable(GL_DEPTH_TEST);
+		glMatrixMode(GL_PROJECTION);
+		glLoadIdentity();
+		glFrustum(-0.1, 0.1, -0.1, 0.1, 0.1, 100.0);
+		glMatrixMode(GL_MODELVIEW);
+		glLoadIdentity();
+		glTranslatef(0, 0, -5);
+		fprintf(stderr, "bench_primitives: %s, %d samples\n", (const char*)glGetString(GL_RENDERER), samples);
+	}
+	else {
+		fprintf(stderr, "bench_primitives: no offscreen OpenGL context, draw cases skipped\n");
+	}
+
+	bool ok = true;
+	for (size_t c = 0; c < sizeof(CASES) / sizeof(CASES[0]); c++) {
+		const BenchCase& bc = CASES[c];
+		char line[512];
+
+		if (bc.draws && !gl) {
+			snprintf(line, sizeof(line), "{\"case\":\"%s\",\"skipped\":\"no OpenGL context\"}\n", bc.name);
+		}
+		else {
+			BenchTiming base = TimeBench(bc.baseline_func, samples);
+			char replacement[160] = "\"replacement\":null,\"replacement_ns\":null,\"speedup\":null";
+			if (bc.replacement_func) {
+				BenchTiming repl = TimeBench(bc.replacement_func, samples);
+				snprintf(replacement, sizeof(replacement), "\"replacement\":\"%s\",\"replacement_ns\":%.3f,\"speedup\":%.2f",
+					bc.replacement, repl.median_ns, base.median_ns / repl.median_ns);
+			}
+
+			// Replacements of gmtl math must give gmtl's results
+			char error[64] = "null";
+			float e = -1;
+			if (bc.replacement_func == PoseMatrixRotation) {
+				e = MaxRotationError();
+			}
+			else if (bc.replacement_func == RotateVectorDirect) {
+				e = MaxRotateVectorError();
+			}
+			if (e >= 0) {
+				snprintf(error, sizeof(error), "%g", e);
+				ok = ok && e <= MAX_ERROR;
+			}
+
+			snprintf(line, sizeof(line), "{\"case\":\"%s\",\"baseline\":\"%s\",\"baseline_ns\":%.3f,\"baseline_min_ns\":%.3f,%s,"
+				"\"max_error\":%s}\n", bc.name, bc.baseline, base.median_ns, base.min_ns, replacement, error);
+		}
+
+		fputs(line, stdout);
+		fflush(stdout);
+		if (out) {
+			fputs(line, out);
+		}
+	}
+
+	if (out) {
+		fclose(out);
+	}
+	return ok ? 0 : 1;
+}
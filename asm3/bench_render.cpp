@@ -0,0 +1,486 @@
+//|___________________________________________________________________
+//!
+//! \file bench_render.cpp
+//!
+//! \brief Headless frame-time benchmark of the turtle scene.
+//!
+//! Renders the same frame as the GLUT program's DisplayFunc() into an
+//! offscreen framebuffer of an EGL surfaceless context, so it runs on a
+//! machine without a display or GPU (Mesa's llvmpipe). Each scenario
+//! draws a fixed number of frames and prints one JSON object per line
+//! with the mean/p50/p99 frame time, the frame rate and the heap
+//! allocations per measured frame (see alloc_counter.h).
+//!
+//! The software scenarios draw with the CPU rasterizer (see soft_raster.h)
+//! and run again with OpenGL for comparison; their line adds the OpenGL
+//! frame time, the speedup over it and the fraction of pixels whose colour
+//! differs from the OpenGL image of the same frame. Given a directory,
+//! both images of each software scenario are written there as PPM.
+//!
+//! Standalone program (Linux, not part of asm3.vcxproj):
+//!   g++ -O2 -pthread -I<gmtl> bench_render.cpp turtle_scene.cpp turtle_shells.cpp render_queue.cpp turtle_baking.cpp frame_profiler.cpp turtle_culling.cpp turtle_lod.cpp pose_math.cpp scene_graph.cpp
+//!       gl_ext.cpp turtle_mesh.cpp turtle_instancing.cpp scene_file.cpp pose_share.cpp turtle_animation.cpp frame_arena.cpp alloc_counter.cpp thread_pool.cpp soft_raster.cpp -o bench_render -lEGL -lGL -lGLU
+//!   ./bench_render [frames] [results.jsonl] [raster threads] [image directory] [sse2]
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "alloc_counter.h"
+#include "gl_ext.h"
+#include "pose_math.h"
+#include "turtle_scene.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const int DEFAULT_FRAMES = 300;             // Measured frames per scenario
+const int WARMUP_FRAMES = 30;               // Unmeasured frames before each scenario
+const int LARGE_CROWD = 998;                // Extra turtles for the 1k scenarios
+const float DEFAULT_DISTANCE = 20.0f;       // Initial distance[0] of the app
+const int MISMATCH_TOLERANCE = 2;           // Colour difference per channel still counted as a match
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA   0x31DD
+#endif
+
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER          0x8D40
+#define GL_RENDERBUFFER         0x8D41
+#define GL_COLOR_ATTACHMENT0    0x8CE0
+#define GL_DEPTH_ATTACHMENT     0x8D00
+#define GL_DEPTH_COMPONENT24    0x81A6
+#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#endif
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+struct Scenario
+{
+	const char* name;
+	int crowd;                  // Extra turtles besides the two controllable ones
+	int cam;                    // Viewing camera (cam_id)
+	int instancing;             // 1 = instanced, 2 = instanced with GLSL 1.20, 0 = per node, -1 = the app's default
+	bool animate;               // Moves turtle 2 and its subparts every frame
+	bool culling;               // Frustum culling
+	bool lod;                   // Level of detail
+	float distance;             // Distance of camera 0 from the origin, 0 = the app's default
+	bool split;                 // All three cameras in split screen
+	bool sorting;               // Per-node draws sorted by material and depth
+	bool baking;                // Static subtrees drawn as one baked mesh per turtle
+	bool software;              // CPU rasterizer instead of OpenGL
+};
+
+struct FrameStats
+{
+	double mean_ms;
+	double p50_ms;
+	double p99_ms;
+	double fps;
+	double heap_allocations;    // Per measured frame
+	size_t arena_bytes;         // Of the last frame
+};
+
+typedef void (APIENTRY *PFNGENFRAMEBUFFERS)(GLsizei n, GLuint* ids);
+typedef void (APIENTRY *PFNBINDFRAMEBUFFER)(GLenum target, GLuint id);
+typedef void (APIENTRY *PFNFRAMEBUFFERRENDERBUFFER)(GLenum target, GLenum attachment, GLenum rbtarget, GLuint rb);
+typedef GLenum (APIENTRY *PFNCHECKFRAMEBUFFERSTATUS)(GLenum target);
+typedef void (APIENTRY *PFNGENRENDERBUFFERS)(GLsizei n, GLuint* ids);
+typedef void (APIENTRY *PFNBINDRENDERBUFFER)(GLenum target, GLuint id);
+typedef void (APIENTRY *PFNRENDERBUFFERSTORAGE)(GLenum target, GLenum format, GLsizei w, GLsizei h);
+
+//|___________________
+//|
+//| Global Variables
+//|___________________
+
+const Scenario SCENARIOS[] = {
+	{ "2_turtles_cam0",             0,           0, -1, false, true,  true,  0,      false, true,  true,  false },
+	{ "2_turtles_cam1",             0,           1, -1, false, true,  true,  0,      false, true,  true,  false },
+	{ "2_turtles_cam2",             0,           2, -1, false, true,  true,  0,      false, true,  true,  false },
+	{ "2_turtles_animated",         0,           0, -1, true,  true,  true,  0,      false, true,  true,  false },
+	{ "1k_turtles_per_node",        LARGE_CROWD, 0,  0, false, true,  true,  0,      false, true,  true,  false },
+	{ "1k_turtles_instanced",       LARGE_CROWD, 0,  1, false, true,  true,  0,      false, true,  true,  false },
+	{ "1k_turtles_glsl120",         LARGE_CROWD, 0,  2, false, true,  true,  0,      false, true,  true,  false },
+	{ "1k_turtles_animated",        LARGE_CROWD, 0, -1, true,  true,  true,  0,      false, true,  true,  false },
+	{ "1k_turtles_cam1_per_node",   LARGE_CROWD, 1,  0, false, true,  true,  0,      false, true,  true,  false },
+	{ "1k_turtles_cam1_no_culling", LARGE_CROWD, 1,  0, false, false, true,  0,      false, true,  true,  false },
+	{ "1k_turtles_far",             LARGE_CROWD, 0, -1, false, true,  true,  200.0f, false, true,  true,  false },
+	{ "1k_turtles_far_no_lod",      LARGE_CROWD, 0, -1, false, true,  false, 200.0f, false, true,  true,  false },
+	{ "1k_turtles_very_far",        LARGE_CROWD, 0, -1, false, true,  true,  600.0f, false, true,  true,  false },
+	{ "1k_turtles_very_far_no_lod", LARGE_CROWD, 0, -1, false, true,  false, 600.0f, false, true,  true,  false },
+	{ "2_turtles_split_screen",     0,           0, -1, false, true,  true,  0,      true,  true,  true,  false },
+	{ "1k_turtles_split_screen",    LARGE_CROWD, 0, -1, false, true,  true,  0,      true,  true,  true,  false },
+	{ "1k_turtles_split_animated",  LARGE_CROWD, 0, -1, true,  true,  true,  0,      true,  true,  true,  false },
+	{ "1k_turtles_unsorted",        LARGE_CROWD, 0,  0, false, true,  true,  0,      false, false, true,  false },
+	{ "1k_turtles_unbaked",         LARGE_CROWD, 0,  0, false, true,  true,  0,      false, true,  false, false },
+	{ "1k_turtles_anim_unbaked",    LARGE_CROWD, 0,  0, true,  true,  true,  0,      false, true,  false, false },
+	{ "1k_turtles_anim_per_node",   LARGE_CROWD, 0,  0, true,  true,  true,  0,      false, true,  true,  false },
+	{ "2_turtles_software",         0,           0, -1, false, true,  true,  0,      false, true,  true,  true  },
+	{ "2_turtles_cam1_software",    0,           1, -1, false, true,  true,  0,      false, true,  true,  true  },
+	{ "1k_turtles_software",        LARGE_CROWD, 0, -1, false, true,  true,  0,      false, true,  true,  true  },
+	{ "1k_turtles_anim_software",   LARGE_CROWD, 0, -1, true,  true,  true,  0,      false, true,  true,  true  },
+	{ "1k_turtles_far_software",    LARGE_CROWD, 0, -1, false, true,  true,  200.0f, false, true,  true,  true  },
+	{ "1k_turtles_split_software",  LARGE_CROWD, 0, -1, false, true,  true,  0,      true,  true,  true , true  },
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+GLProc GetProcAddressEGL(const char* name);
+bool CreateOffscreenContext(int width, int height);
+void AnimateTurtle2(int frame);
+FrameStats RunScenario(const Scenario& s, int frames);
+double CompareWithOpenGL(const char* directory, const char* name);
+
+//|____________________________________________________________________
+//|
+//| Function: GetProcAddressEGL
+//|
+//! \param name   [in] GL function name.
+//! \return Entry point, or NULL when the driver lacks it.
+//!
+//! Adapts eglGetProcAddress() to the loader signature of gl_ext.h.
+//|____________________________________________________________________
+
+GLProc GetProcAddressEGL(const char* name)
+{
+	return (GLProc)eglGetProcAddress(name);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: CreateOffscreenContext
+//|
+//! \param width  [in] Framebuffer width.
+//! \param height [in] Framebuffer height.
+//! \return True on success.
+//!
+//! Makes a compatibility-profile GL context current without any surface
+//! and binds a colour+depth framebuffer object of the given size to it.
+//|____________________________________________________________________
+
+bool CreateOffscreenContext(int width, int height)
+{
+	// Surfaceless platform when available (no X/Wayland needed), default display otherwise
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	EGLDisplay dpy = EGL_NO_DISPLAY;
+	if (get_platform_display) {
+		dpy = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	}
+	if (dpy == EGL_NO_DISPLAY) {
+		dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+	if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, NULL, NULL)) {
+		fprintf(stderr, "bench_render: no EGL display\n");
+		return false;
+	}
+
+	const EGLint config_attribs[] = {
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint num_configs = 0;
+	if (!eglBindAPI(EGL_OPENGL_API) ||
+		!eglChooseConfig(dpy, config_attribs, &config, 1, &num_configs) || num_configs == 0) {
+		fprintf(stderr, "bench_render: no desktop OpenGL config\n");
+		return false;
+	}
+
+	EGLContext ctx = eglCreateContext(dpy, config, EGL_NO_CONTEXT, NULL);
+	if (ctx == EGL_NO_CONTEXT || !eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx)) {
+		fprintf(stderr, "bench_render: cannot make a surfaceless context current\n");
+		return false;
+	}
+
+	// Without a surface there is no default framebuffer, so render into an FBO
+	PFNGENFRAMEBUFFERS gen_framebuffers = (PFNGENFRAMEBUFFERS)eglGetProcAddress("glGenFramebuffers");
+	PFNBINDFRAMEBUFFER bind_framebuffer = (PFNBINDFRAMEBUFFER)eglGetProcAddress("glBindFramebuffer");
+	PFNFRAMEBUFFERRENDERBUFFER framebuffer_renderbuffer = (PFNFRAMEBUFFERRENDERBUFFER)eglGetProcAddress("glFramebufferRenderbuffer");
+	PFNCHECKFRAMEBUFFERSTATUS check_framebuffer_status = (PFNCHECKFRAMEBUFFERSTATUS)eglGetProcAddress("glCheckFramebufferStatus");
+	PFNGENRENDERBUFFERS gen_renderbuffers = (PFNGENRENDERBUFFERS)eglGetProcAddress("glGenRenderbuffers");
+	PFNBINDRENDERBUFFER bind_renderbuffer = (PFNBINDRENDERBUFFER)eglGetProcAddress("glBindRenderbuffer");
+	PFNRENDERBUFFERSTORAGE renderbuffer_storage = (PFNRENDERBUFFERSTORAGE)eglGetProcAddress("glRenderbufferStorage");
+	if (!gen_framebuffers || !bind_framebuffer || !framebuffer_renderbuffer || !check_framebuffer_status ||
+		!gen_renderbuffers || !bind_renderbuffer || !renderbuffer_storage) {
+		fprintf(stderr, "bench_render: framebuffer objects unavailable\n");
+		return false;
+	}
+
+	GLuint fbo, rb[2];
+	gen_framebuffers(1, &fbo);
+	gen_renderbuffers(2, rb);
+	bind_framebuffer(GL_FRAMEBUFFER, fbo);
+
+	bind_renderbuffer(GL_RENDERBUFFER, rb[0]);
+	renderbuffer_storage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	framebuffer_renderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rb[0]);
+
+	bind_renderbuffer(GL_RENDERBUFFER, rb[1]);
+	renderbuffer_storage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	framebuffer_renderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rb[1]);
+
+	if (check_framebuffer_status(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		fprintf(stderr, "bench_render: incomplete framebuffer\n");
+		return false;
+	}
+
+	glViewport(0, 0, width, height);
+	return true;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: AnimateTurtle2
+//|
+//! \param frame  [in] Frame number.
+//! \return None.
+//!
+//! Stands in for held keys: yaws turtle 2, moves it forward and swings
+//! its wings and cannon, the same updates KeyboardFunc() makes.
+//|____________________________________________________________________
+
+void AnimateTurtle2(int frame)
+{
+	// Yawing while moving forward flies turtle 2 in a circle
+	plane_q2 = plane_q2 * yrotp_q;
+	gmtl::Vec3f v = RotateVector(plane_q2, PLANE_FORWARD);
+	turtle_p2.set(turtle_p2[0] + v[0], turtle_p2[1] + v[1], turtle_p2[2] + v[2], 1.0f);
+
+	float swing = (float)(frame % 36) * DELTA_ROTATION;
+	wing_angle_right = -swing;
+	wing_angle_left = swing;
+	cannon_angle_top += DELTA_ROTATION;
+	cannon_angle_subsubpart = -swing;
+
+	SyncSceneGraph();
+}
+
+//|____________________________________________________________________
+//|
+//| Function: RunScenario
+//|
+//! \param s      [in] Scenario to run.
+//! \param frames [in] Number of measured frames.
+//! \return Frame time statistics.
+//!
+//! Rebuilds the scene for the scenario and times each frame up to the
+//! point where the renderer has finished it (glFinish()).
+//|____________________________________________________________________
+
+FrameStats RunScenario(const Scenario& s, int frames)
+{
+	crowd_size = s.crowd;
+	InitTransforms();
+	cam_id = s.cam;
+	use_instancing = s.instancing < 0 ? instancing_supported : (s.instancing >= 1);
+	instancing_path = (s.instancing == 2 || !IsInstancingPathSupported(INSTANCING_GLSL330_CORE)) ? INSTANCING_GLSL120 : INSTANCING_GLSL330_CORE;
+	use_culling = s.culling;
+	use_lod = s.lod;
+	distance[0] = s.distance > 0 ? s.distance : DEFAULT_DISTANCE;
+	split_screen = s.split;
+	use_sorting = s.sorting;
+	use_baking = s.baking;
+	use_software = s.software;
+
+	std::vector<double> times;
+	times.reserve(frames);
+	uint64_t heap_start = 0;
+
+	for (int i = -WARMUP_FRAMES; i < frames; i++) {
+		if (i == 0) {
+			heap_start = HeapAllocationCount();
+		}
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		BeginArenaFrame(frame_arenas);
+		if (s.animate) {
+			AnimateTurtle2(i);
+		}
+		RenderScene();
+		glFinish();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		if (i >= 0) {
+			times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		}
+	}
+
+	FrameStats stats;
+	stats.heap_allocations = (double)(HeapAllocationCount() - heap_start) / frames;
+	BeginArenaFrame(frame_arenas);                      // Finishes the last frame's counters
+	stats.arena_bytes = frame_arenas.arena_bytes;
+	double total = 0;
+	for (int i = 0; i < frames; i++) {
+		total += times[i];
+	}
+	std::sort(times.begin(), times.end());
+	stats.mean_ms = total / frames;
+	stats.p50_ms = times[(frames - 1) / 2];
+	stats.p99_ms = times[(frames * 99 + 99) / 100 - 1];       // Nearest rank
+	stats.fps = 1000.0 / stats.mean_ms;
+	return stats;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: CompareWithOpenGL
+//|
+//! \param directory [in] Where to write both images, NULL for none.
+//! \param name      [in] Scenario name, for the image files.
+//! \return Fraction of the pixels whose colour differs by more than
+//!         MISMATCH_TOLERANCE in some channel.
+//!
+//! Draws the current frame with OpenGL and then with the CPU rasterizer
+//! (which stays on), and compares the two images.
+//|____________________________________________________________________
+
+double CompareWithOpenGL(const char* directory, const char* name)
+{
+	use_software = false;
+	BeginArenaFrame(frame_arenas);
+	RenderScene();
+	SoftFramebuffer opengl;
+	opengl.width = w_width;
+	opengl.height = w_height;
+	opengl.colour.resize((size_t)w_width * w_height);
+	glReadPixels(0, 0, w_width, w_height, GL_RGBA, GL_UNSIGNED_BYTE, &opengl.colour[0]);
+
+	use_software = true;
+	BeginArenaFrame(frame_arenas);
+	RenderScene();
+	const SoftFramebuffer& software = soft_raster.framebuffer;
+
+	size_t mismatches = 0;
+	for (size_t i = 0; i < software.colour.size(); i++) {
+		for (int c = 0; c < 3; c++) {
+			int a = (software.colour[i] >> (8 * c)) & 0xff;
+			int b = (opengl.colour[i] >> (8 * c)) & 0xff;
+			if (abs(a - b) > MISMATCH_TOLERANCE) {
+				mismatches++;
+				break;
+			}
+		}
+	}
+
+	const SoftFramebuffer* images[2] = { &software, &opengl };
+	const char* suffixes[2] = { "software", "opengl" };
+	for (int k = 0; directory && k < 2; k++) {
+		char path[512];
+		snprintf(path, sizeof(path), "%s/%s_%s.ppm", directory, name, suffixes[k]);
+		FILE* f = fopen(path, "wb");
+		if (!f || !WriteSoftFramebufferPPM(*images[k], f)) {
+			fprintf(stderr, "bench_render: cannot write %s\n", path);
+		}
+		if (f) {
+			fclose(f);
+		}
+	}
+	return (double)mismatches / software.colour.size();
+}
+
+//|____________________________________________________________________
+//|
+//| Function: main
+//|
+//! \param argc   [in] Number of command line arguments.
+//! \param argv   [in] [frames] [results file] [raster threads] [image directory]
+//!                     [sse2: the CPU rasterizer's 4-wide loops even with AVX2].
+//! \return 0 on success, 1 when no offscreen context is available.
+//!
+//! Runs every scenario and prints one JSON object per scenario.
+//|____________________________________________________________________
+
+int main(int argc, char** argv)
+{
+	int frames = argc > 1 ? atoi(argv[1]) : DEFAULT_FRAMES;
+	if (frames <= 0) {
+		frames = DEFAULT_FRAMES;
+	}
+	FILE* out = NULL;
+	if (argc > 2 && !(out = fopen(argv[2], "w"))) {
+		fprintf(stderr, "bench_render: cannot write %s\n", argv[2]);
+		return 1;
+	}
+
+	int raster_threads = argc > 3 ? atoi(argv[3]) : 0;
+	const char* image_directory = argc > 4 && argv[4][0] ? argv[4] : NULL;
+
+	if (!CreateOffscreenContext(w_width, w_height)) {
+		return 1;
+	}
+	InitSceneGL(GetProcAddressEGL);
+	InitSceneSoftware(raster_threads);
+	if (argc > 5 && strcmp(argv[5], "sse2") == 0) {
+		soft_raster.avx2 = false;
+	}
+	fprintf(stderr, "bench_render: %s, %dx%d, %d frames per scenario, %d raster threads (%s)\n",
+		(const char*)glGetString(GL_RENDERER), w_width, w_height, frames, WorkerCount(soft_raster.pool), soft_raster.avx2 ? "avx2" : "sse2");
+
+	for (size_t i = 0; i < sizeof(SCENARIOS) / sizeof(SCENARIOS[0]); i++) {
+		const Scenario& s = SCENARIOS[i];
+		if ((s.instancing == 1 && !instancing_supported) || (s.instancing == 2 && !IsInstancingPathSupported(INSTANCING_GLSL120))) {
+			continue;
+		}
+
+		FrameStats stats = RunScenario(s, frames);
+
+		// The same scenario with OpenGL, then one frame drawn both ways
+		char software[256] = "";
+		if (s.software) {
+			SoftStats raster = soft_raster.stats;
+			Scenario opengl = s;
+			opengl.software = false;
+			FrameStats gl_stats = RunScenario(opengl, frames);
+			double mismatch = CompareWithOpenGL(image_directory, s.name);
+
+			snprintf(software, sizeof(software),
+				",\"raster_threads\":%d,\"raster_simd\":\"%s\",\"triangles\":%d,\"tile_refs\":%d,\"opengl_mean_ms\":%.4f,\"speedup\":%.2f,\"pixel_mismatch\":%.5f",
+				WorkerCount(soft_raster.pool), soft_raster.avx2 ? "avx2" : "sse2", raster.triangles, raster.tile_refs, gl_stats.mean_ms, gl_stats.mean_ms / stats.mean_ms,
+				mismatch);
+		}
+
+		char line[1024];
+		snprintf(line, sizeof(line),
+			"{\"scenario\":\"%s\",\"renderer\":\"%s\",\"turtles\":%d,\"cam_id\":%d,\"split_screen\":%s,\"sorting\":%s,\"baking\":%s,\"instancing\":%s,\"glsl\":\"%s\",\"culling\":%s,"
+			"\"visible_turtles\":%d,\"visible_nodes\":%d,\"lod\":%s,\"lod_turtles\":[%d,%d,%d],\"draws\":%d,\"frames\":%d,"
+			"\"mean_ms\":%.4f,\"p50_ms\":%.4f,\"p99_ms\":%.4f,\"fps\":%.2f,\"heap_allocs_per_frame\":%.2f,\"arena_kb\":%zu%s}\n",
+			s.name, use_software ? "software" : "opengl", TurtleCount(scene), cam_id, split_screen ? "true" : "false", use_sorting ? "true" : "false", use_baking ? "true" : "false", use_instancing && !use_software ? "true" : "false",
+			instancing_path == INSTANCING_GLSL330_CORE ? "330 core" : "120", use_culling ? "true" : "false",
+			cull_stats.turtles_visible, cull_stats.nodes_visible, use_lod ? "true" : "false",
+			lod_stats.turtles[LOD_FULL], lod_stats.turtles[LOD_SHELL], lod_stats.turtles[LOD_BOX], queued_draws, frames,
+			stats.mean_ms, stats.p50_ms, stats.p99_ms, stats.fps, stats.heap_allocations, stats.arena_bytes / 1024, software);
+		fputs(line, stdout);
+		fflush(stdout);
+		if (out) {
+			fputs(line, out);
+		}
+	}
+
+	if (out) {
+		fclose(out);
+	}
+	return 0;
+}
@@ -0,0 +1,131 @@
+//|___________________________________________________________________
+//!
+//! \file bench_scene_file.cpp
+//!
+//! \brief Writes a scene file and times loading it against the built-in scene.
+//!
+//! Builds the built-in scene with the requested number of turtles (the two
+//! controllable ones plus a crowd), saves it as a scene file, then maps the
+//! file and starts the scene from it, in place (see scene_file.h). Prints
+//! the file size, the time to map the file, the time to build the scene
+//! graph either way and the first world update after it as one JSON line.
+//! Exits with 1 if the scene from the file has different poses, joint
+//! angles or world matrices. The file is kept for the program's -scene
+//! option.
+//!
+//! Standalone program (not part of asm3.vcxproj):
+//!   g++ -O2 -pthread -I<gmtl> bench_scene_file.cpp scene_file.cpp pose_share.cpp turtle_scene.cpp turtle_shells.cpp render_queue.cpp turtle_baking.cpp frame_profiler.cpp turtle_culling.cpp turtle_lod.cpp
+//!       pose_math.cpp scene_graph.cpp gl_ext.cpp turtle_mesh.cpp turtle_instancing.cpp turtle_animation.cpp frame_arena.cpp thread_pool.cpp soft_raster.cpp -o bench_scene_file -lGL -lGLU
+//!   ./bench_scene_file [turtles] [scene file]
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "scene_file.h"
+#include "turtle_scene.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const int DEFAULT_TURTLES = 100000;
+const char* DEFAULT_PATH = "scene.tscn";
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+double Milliseconds(std::chrono::steady_clock::time_point start);
+
+//|____________________________________________________________________
+//|
+//| Function: Milliseconds
+//|
+//! \param start  [in] Start time.
+//! \return Milliseconds since start.
+//|____________________________________________________________________
+
+double Milliseconds(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//|____________________________________________________________________
+//|
+//| Function: main
+//|
+//! \param argc   [in] Number of command line arguments.
+//! \param argv   [in] [turtles] [scene file].
+//! \return 0 if the scene built from the file matches, 1 otherwise.
+//|____________________________________________________________________
+
+int main(int argc, char** argv)
+{
+	int turtles = argc > 1 ? atoi(argv[1]) : DEFAULT_TURTLES;
+	const char* path = argc > 2 ? argv[2] : DEFAULT_PATH;
+	if (turtles < 2) {
+		turtles = 2;
+	}
+
+	// Built-in scene: computed poses for the crowd
+	crowd_size = turtles - 2;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	InitTransforms();
+	double build_builtin_ms = Milliseconds(start);
+
+	UpdateWorldTransforms(scene);
+	std::vector<SceneFileTurtle> expected;
+	PackSceneFileTurtles(scene, expected);
+	std::vector<gmtl::Matrix44f> expected_world(scene.world.begin(), scene.world.end());
+
+	start = std::chrono::steady_clock::now();
+	if (!WriteSceneFile(path, GetTurtleModel(), scene)) {
+		return 1;
+	}
+	double write_ms = Milliseconds(start);
+
+	// Same scene from the file
+	scene = SceneGraph();
+	crowd_size = 0;
+	start = std::chrono::steady_clock::now();
+	if (!MapSceneFile(path, scene_file)) {
+		return 1;
+	}
+	ApplySceneFile(scene_file);
+	double map_ms = Milliseconds(start);
+
+	start = std::chrono::steady_clock::now();
+	InitTransforms();
+	double build_file_ms = Milliseconds(start);
+
+	start = std::chrono::steady_clock::now();
+	UpdateWorldTransforms(scene);
+	double first_update_ms = Milliseconds(start);
+
+	std::vector<SceneFileTurtle> loaded;
+	PackSceneFileTurtles(scene, loaded);
+	bool match = loaded.size() == expected.size() &&
+	             memcmp(&loaded[0], &expected[0], loaded.size() * sizeof(SceneFileTurtle)) == 0 &&
+	             scene.world.size() == expected_world.size() &&
+	             memcmp(scene.world.begin(), &expected_world[0], expected_world.size() * sizeof(gmtl::Matrix44f)) == 0;
+
+	printf("{\"turtles\":%d,\"file\":\"%s\",\"file_bytes\":%llu,\"in_place\":%s,\"write_ms\":%.3f,\"map_ms\":%.3f,"
+		"\"build_builtin_ms\":%.3f,\"build_from_file_ms\":%.3f,\"first_update_ms\":%.3f,\"match\":%s}\n",
+		turtles, path, (unsigned long long)scene_file.size, scene_file.parent ? "true" : "false", write_ms, map_ms,
+		build_builtin_ms, build_file_ms, first_update_ms, match ? "true" : "false");
+
+	UnmapSceneFile(scene_file);
+	return match ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+//|___________________________________________________________________
+//!
+//! \file bench_shells.cpp
+//!
+//! \brief Benchmark and check of the cannon shell pool.
+//!
+//! Builds a crowd of turtles with their cannons turned different ways and
+//! lets every turtle fire continuously (see FireCannons()) for a number
+//! of ticks. Prints the mean and worst time per tick of firing and of the
+//! ballistic update, with the live shells at the end, as one JSON line.
+//!
+//! Checks that the pool never reallocates, that the live shells never
+//! exceed the capacity and that a lone shell follows the closed form of
+//! the integrator; the program exits with 1 otherwise.
+//!
+//! Standalone program (not part of asm3.vcxproj):
+//!   g++ -O2 -I<gmtl> bench_shells.cpp turtle_shells.cpp scene_graph.cpp -o bench_shells
+//!   ./bench_shells [turtles] [ticks] [capacity]
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+
+#include <gmtl/gmtl.h>
+
+#include "scene_graph.h"
+#include "turtle_model.h"
+#include "turtle_shells.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const int DEFAULT_TURTLES = 2000;           // 60000 shells in flight once the first ones expire
+const int DEFAULT_TICKS = 600;
+const float SIM_STEP = 1.0f / 60.0f;        // Simulation tick (SIM_RATE)
+const float SIM_SPACING = 12.0f;            // CROWD_SPACING
+const float MUZZLE_X = WING_WIDTH * CANNON_MUZZLE;
+const int CHECK_TICKS = 120;                // Ticks the lone shell is followed
+const float CHECK_TOLERANCE = 1e-3f;        // Relative to the distance flown
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void BuildCrowd(SceneGraph& scene, int count);
+bool CheckTrajectory();
+double Milliseconds(std::chrono::steady_clock::time_point start);
+
+//|____________________________________________________________________
+//|
+//| Function: BuildCrowd
+//|
+//! \param scene  [out] Scene graph with up-to-date world matrices.
+//! \param count  [in] Number of turtles.
+//! \return None.
+//!
+//! A square grid of turtles, each yawed differently, with the cannon base
+//! and cannon turned by different angles.
+//|____________________________________________________________________
+
+void BuildCrowd(SceneGraph& scene, int count)
+{
+	int side = 1;
+	while (side * side < count) {
+		side++;
+	}
+
+	ReserveTurtles(scene, count);
+	for (int i = 0; i < count; i++) {
+		gmtl::Quatf q;
+		gmtl::set(q, gmtl::AxisAnglef(gmtl::Math::deg2Rad(i * 37.0f), 0.0f, 1.0f, 0.0f));
+		int t = AddTurtle(scene, gmtl::Point4f((i % side) * SIM_SPACING, 0.0f, (i / side) * SIM_SPACING, 1.0f), q);
+		SetTurtleJoint(scene, t, JOINT_CANNON_BASE, i * 11.0f);
+		SetTurtleJoint(scene, t, JOINT_CANNON, i * 23.0f);
+	}
+	UpdateWorldTransforms(scene);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: CheckTrajectory
+//|
+//! \param None.
+//! \return True if a lone shell follows the integrator's closed form.
+//!
+//! After k steps of semi-implicit Euler from p0, v0:
+//!   v = v0 - k g dt,  p = p0 + k dt v0 - g dt^2 k (k + 1) / 2 (along Y).
+//|____________________________________________________________________
+
+bool CheckTrajectory()
+{
+	ShellPool pool;
+	InitShellPool(pool, 1);
+
+	gmtl::Matrix44f cannon = gmtl::makeTrans<gmtl::Matrix44f>(gmtl::Vec3f(1, 2, 3)) *
+	                         gmtl::makeRot<gmtl::Matrix44f>(gmtl::AxisAnglef(gmtl::Math::deg2Rad(30.0f), 0.0f, 0.0f, 1.0f));
+	if (!FireShell(pool, cannon, gmtl::Vec3f(MUZZLE_X, 0, 0)) || FireShell(pool, cannon, gmtl::Vec3f(MUZZLE_X, 0, 0))) {
+		return false;                       // The second shot must be dropped
+	}
+
+	float p0[3] = { pool.position[0], pool.position[1], pool.position[2] };
+	float v0[3] = { pool.velocity[0], pool.velocity[1], pool.velocity[2] };
+	for (int k = 1; k <= CHECK_TICKS; k++) {
+		StepShells(pool, SIM_STEP);
+	}
+
+	double k = CHECK_TICKS;
+	double expected[3] = {
+		p0[0] + k * SIM_STEP * v0[0],
+		p0[1] + k * SIM_STEP * v0[1] - SHELL_GRAVITY * SIM_STEP * SIM_STEP * k * (k + 1) / 2,
+		p0[2] + k * SIM_STEP * v0[2],
+	};
+	double error = 0;
+	for (int i = 0; i < 3; i++) {
+		error += fabs(pool.position[i] - expected[i]);
+	}
+	return pool.count == 1 && pool.dropped == 1 &&
+	       error <= CHECK_TOLERANCE * SHELL_SPEED * k * SIM_STEP;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: Milliseconds
+//|
+//! \param start  [in] Start time.
+//! \return Milliseconds since start.
+//|____________________________________________________________________
+
+double Milliseconds(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//|____________________________________________________________________
+//|
+//| Function: main
+//|
+//! \param argc   [in] Number of command line arguments.
+//! \param argv   [in] [turtles] [ticks] [capacity].
+//! \return 0 if every check passes, 1 otherwise.
+//|____________________________________________________________________
+
+int main(int argc, char** argv)
+{
+	int turtles = argc > 1 ? atoi(argv[1]) : DEFAULT_TURTLES;
+	int ticks = argc > 2 ? atoi(argv[2]) : DEFAULT_TICKS;
+	int capacity = argc > 3 ? atoi(argv[3]) : SHELL_CAPACITY;
+	if (turtles <= 0) {
+		turtles = DEFAULT_TURTLES;
+	}
+	if (ticks <= 0) {
+		ticks = DEFAULT_TICKS;
+	}
+	if (capacity <= 0) {
+		capacity = SHELL_CAPACITY;
+	}
+
+	SceneGraph scene;
+	BuildCrowd(scene, turtles);
+
+	ShellPool pool;
+	InitShellPool(pool, capacity);
+	const float* storage = &pool.position[0];
+	gmtl::Vec3f muzzle(MUZZLE_X, 0, 0);
+
+	double fire_ms = 0, step_ms = 0, worst_ms = 0;
+	int most_live = 0;
+	bool ok = true;
+
+	for (int t = 0; t < ticks; t++) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		StepShells(pool, SIM_STEP);
+		double step = Milliseconds(start);
+
+		start = std::chrono::steady_clock::now();
+		FireCannons(pool, scene, t, muzzle);
+		double fire = Milliseconds(start);
+
+		step_ms += step;
+		fire_ms += fire;
+		if (step + fire > worst_ms) {
+			worst_ms = step + fire;
+		}
+		if (pool.count > most_live) {
+			most_live = pool.count;
+		}
+		ok = ok && pool.count <= capacity;
+	}
+	ok = ok && &pool.position[0] == storage;
+
+	bool trajectory = CheckTrajectory();
+	ok = ok && trajectory;
+
+	printf("{\"turtles\":%d,\"ticks\":%d,\"capacity\":%d,\"live\":%d,\"most_live\":%d,\"fired\":%u,\"dropped\":%u,"
+		"\"fire_ms\":%.3f,\"step_ms\":%.3f,\"worst_tick_ms\":%.3f,\"trajectory\":%s,\"ok\":%s}\n",
+		turtles, ticks, capacity, pool.count, most_live, pool.fired, pool.dropped,
+		fire_ms / ticks, step_ms / ticks, worst_ms, trajectory ? "true" : "false", ok ? "true" : "false");
+
+	return ok ? 0 : 1;
+}
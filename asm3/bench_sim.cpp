@@ -0,0 +1,182 @@
+//|___________________________________________________________________
+//!
+//! \file bench_sim.cpp
+//!
+//! \brief Thread scaling benchmark of the turtle simulation.
+//!
+//! Runs the same scene for a fixed number of ticks with 1, 2, 4, ...
+//! worker threads and prints, per thread count, the time per tick, the
+//! speedup over one thread and a checksum of the final state. Every
+//! checksum must equal the single-threaded one (the update is
+//! deterministic), otherwise the program exits with 1.
+//!
+//! Standalone program (not part of asm3.vcxproj):
+//!   g++ -O2 -pthread -I<gmtl> bench_sim.cpp turtle_sim.cpp turtle_poses.cpp thread_pool.cpp -o bench_sim
+//!   ./bench_sim [turtles] [ticks] [max threads]
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <gmtl/gmtl.h>
+
+#include "thread_pool.h"
+#include "turtle_sim.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const int DEFAULT_TURTLES = 100000;
+const int DEFAULT_TICKS = 100;
+const int MAX_THREADS = 32;
+const float SIM_SPACING = 12.0f;            // CROWD_SPACING
+const float SIM_TURN = 2.0f;                // Yaw per tick (degs)
+const float SIM_SPEED = 0.5f;               // Distance per tick
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void BuildSim(TurtleSim& sim, int count);
+unsigned int Checksum(const TurtleSim& sim);
+
+//|____________________________________________________________________
+//|
+//| Function: BuildSim
+//|
+//! \param sim    [out] Simulation.
+//! \param count  [in] Number of turtles.
+//! \return None.
+//!
+//! Lays the turtles out on a square grid, each yawed differently, all
+//! turning the same way and aiming at the origin.
+//|____________________________________________________________________
+
+void BuildSim(TurtleSim& sim, int count)
+{
+	gmtl::Quatf turn;
+	gmtl::set(turn, gmtl::AxisAnglef(gmtl::Math::deg2Rad(SIM_TURN), 0.0f, 1.0f, 0.0f));
+	InitSim(sim, turn, SIM_SPEED, gmtl::Point3f(0, 0, 0));
+
+	int side = 1;
+	while (side * side < count) {
+		side++;
+	}
+	for (int i = 0; i < count; i++) {
+		gmtl::Quatf q;
+		gmtl::set(q, gmtl::AxisAnglef(gmtl::Math::deg2Rad(i * 37.0f), 0.0f, 1.0f, 0.0f));
+		AddSimTurtle(sim, gmtl::Point4f((i % side) * SIM_SPACING, 0.0f, (i / side) * SIM_SPACING, 1.0f), q);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: Checksum
+//|
+//! \param sim    [in] Simulation.
+//! \return FNV-1a hash of every pose and joint angle, bit for bit.
+//|____________________________________________________________________
+
+unsigned int Checksum(const TurtleSim& sim)
+{
+	const std::vector<float>* arrays[] = {
+		&sim.poses.px, &sim.poses.py, &sim.poses.pz,
+		&sim.poses.qx, &sim.poses.qy, &sim.poses.qz, &sim.poses.qw,
+		&sim.joints
+	};
+	unsigned int hash = 2166136261u;
+
+	for (size_t a = 0; a < sizeof(arrays) / sizeof(arrays[0]); a++) {
+		const unsigned char* bytes = (const unsigned char*)arrays[a]->data();
+		size_t size = arrays[a]->size() * sizeof(float);
+		for (size_t i = 0; i < size; i++) {
+			hash = (hash ^ bytes[i]) * 16777619u;
+		}
+	}
+	return hash;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: main
+//|
+//! \param argc   [in] Number of command line arguments.
+//! \param argv   [in] [turtles] [ticks] [max threads].
+//! \return 0 if every thread count gives the same state, 1 otherwise.
+//|____________________________________________________________________
+
+int main(int argc, char** argv)
+{
+	int turtles = argc > 1 ? atoi(argv[1]) : DEFAULT_TURTLES;
+	int ticks = argc > 2 ? atoi(argv[2]) : DEFAULT_TICKS;
+	int max_threads = argc > 3 ? atoi(argv[3]) : (int)std::thread::hardware_concurrency();
+	if (turtles <= 0) {
+		turtles = DEFAULT_TURTLES;
+	}
+	if (ticks <= 0) {
+		ticks = DEFAULT_TICKS;
+	}
+	if (max_threads <= 0) {
+		max_threads = 1;
+	}
+	if (max_threads > MAX_THREADS) {
+		max_threads = MAX_THREADS;
+	}
+
+	TurtleSim initial;
+	BuildSim(initial, turtles);
+
+	double base_ms = 0;
+	unsigned int base_hash = 0;
+	bool ok = true;
+
+	// 1, 2, 4, ... and the maximum itself
+	std::vector<int> thread_counts;
+	for (int threads = 1; threads < max_threads; threads *= 2) {
+		thread_counts.push_back(threads);
+	}
+	thread_counts.push_back(max_threads);
+
+	for (size_t k = 0; k < thread_counts.size(); k++) {
+		int threads = thread_counts[k];
+		ThreadPool* pool = CreateThreadPool(threads);
+		TurtleSim sim = initial;
+
+		StepSim(sim, pool);                             // Warms up the threads and caches
+		sim = initial;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int t = 0; t < ticks; t++) {
+			StepSim(sim, pool);
+		}
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / ticks;
+		DestroyThreadPool(pool);
+
+		unsigned int hash = Checksum(sim);
+		if (threads == 1) {
+			base_ms = ms;
+			base_hash = hash;
+		}
+		bool match = hash == base_hash;
+		ok = ok && match;
+
+		printf("{\"threads\":%d,\"turtles\":%d,\"ticks\":%d,\"tick_ms\":%.4f,\"speedup\":%.2f,\"efficiency\":%.2f,"
+			"\"checksum\":\"%08x\",\"deterministic\":%s}\n",
+			threads, turtles, ticks, ms, base_ms / ms, base_ms / ms / threads, hash, match ? "true" : "false");
+		fflush(stdout);
+	}
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+//|___________________________________________________________________
+//!
+//! \file frame_arena.cpp
+//!
+//! \brief Double-buffered linear arenas for data that lives one frame.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include "frame_arena.h"
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+// Header of a heap block, followed by its data
+struct ArenaOverflow
+{
+	ArenaOverflow* next;
+};
+
+//|___________________
+//|
+//| Local Functions
+//|___________________
+
+//|____________________________________________________________________
+//|
+//| Function: AlignUp
+//|
+//! \param value      [in] Size or address.
+//! \param alignment  [in] Power of two.
+//! \return value rounded up to a multiple of alignment.
+//|____________________________________________________________________
+
+static inline size_t AlignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: FreeOverflow
+//|
+//! \param arena  [in,out] Arena; its heap blocks are freed.
+//! \return None.
+//|____________________________________________________________________
+
+static void FreeOverflow(FrameArena& arena)
+{
+	while (arena.overflow) {
+		ArenaOverflow* block = arena.overflow;
+		arena.overflow = block->next;
+		delete[] (unsigned char*)block;
+	}
+	arena.overflow_bytes = 0;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: ResetArena
+//|
+//! \param arena  [in,out] Arena, emptied for a new frame.
+//! \return None.
+//!
+//! If the last frame on this arena overflowed, its block is replaced by
+//! one holding that frame with a quarter to spare.
+//|____________________________________________________________________
+
+static void ResetArena(FrameArena& arena)
+{
+	if (arena.overflow) {
+		size_t needed = arena.used + arena.overflow_bytes;
+		FreeOverflow(arena);
+
+		delete[] arena.base;
+		arena.capacity = AlignUp(needed + needed / 4, ARENA_GRANULE);
+		arena.base = new unsigned char[arena.capacity];
+		arena.heap_blocks++;
+	}
+	arena.used = 0;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: BeginArenaFrame
+//|
+//! \param arenas [in,out] Frame arenas.
+//! \return None.
+//!
+//! Finishes the current frame's counters and switches to the other
+//! arena, resetting it. The data of the frame before stays valid.
+//|____________________________________________________________________
+
+void BeginArenaFrame(FrameArenas& arenas)
+{
+	if (arenas.frame > 0) {
+		const FrameArena& last = arenas.buffers[arenas.current];
+		arenas.arena_bytes = last.used + last.overflow_bytes;
+	}
+
+	arenas.current = (arenas.current + 1) % ARENA_BUFFERS;
+	ResetArena(arenas.buffers[arenas.current]);
+	arenas.frame++;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: FreeFrameArenas
+//|
+//! \param arenas [in,out] Frame arenas, emptied; their data is gone.
+//! \return None.
+//|____________________________________________________________________
+
+void FreeFrameArenas(FrameArenas& arenas)
+{
+	for (int i = 0; i < ARENA_BUFFERS; i++) {
+		FrameArena& arena = arenas.buffers[i];
+		FreeOverflow(arena);
+		delete[] arena.base;
+		arena.base = NULL;
+		arena.capacity = 0;
+		arena.used = 0;
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: ArenaAlloc
+//|
+//! \param arena      [in,out] Arena of the current frame.
+//! \param bytes      [in] Size of the allocation.
+//! \param alignment  [in] Power of two.
+//! \return Uninitialized memory, valid until the arena's next reset;
+//!         never null.
+//|____________________________________________________________________
+
+void* ArenaAlloc(FrameArena& arena, size_t bytes, size_t alignment)
+{
+	if (arena.base) {
+		size_t start = AlignUp((size_t)arena.base + arena.used, alignment) - (size_t)arena.base;
+		if (start + bytes <= arena.capacity) {
+			arena.used = start + bytes;
+			return arena.base + start;
+		}
+	}
+
+	// Outgrown: a heap block of its own, and the reset makes room for next time
+	size_t size = sizeof(ArenaOverflow) + alignment + bytes;
+	ArenaOverflow* block = (ArenaOverflow*)new unsigned char[size];
+	block->next = arena.overflow;
+	arena.overflow = block;
+	arena.overflow_bytes += size;
+	arena.heap_blocks++;
+	return (void*)AlignUp((size_t)(block + 1), alignment);
+}
@@ -0,0 +1,94 @@
+//|___________________________________________________________________
+//!
+//! \file frame_arena.h
+//!
+//! \brief Double-buffered linear arenas for data that lives one frame.
+//!
+//! Cull results, level buckets, instance records and the render queue
+//! are rebuilt every frame. Instead of growing containers they are carved
+//! out of a frame arena: an allocation bumps an offset in one block, and
+//! starting a frame resets the whole block at once, with no destructor or
+//! free per array. Only trivially destructible types go in an arena.
+//!
+//! There are two arenas, used by alternate frames. What a frame allocates
+//! stays valid until the frame after the next one starts, so a stage can
+//! read the previous frame's data (e.g. rendering frame N while the
+//! simulation builds N+1) without copying it.
+//!
+//! An empty arena is valid. When a frame needs more than the block holds,
+//! the rest comes from heap blocks, and the next reset of that arena
+//! replaces its block with one large enough for the frame; in steady
+//! state frames touch the heap no more. Programs that link the allocation
+//! counter (see alloc_counter.h) show it in their frames' heap counts.
+//|___________________________________________________________________
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <type_traits>
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const int ARENA_BUFFERS = 2;                // Frames whose data is live at once
+const size_t ARENA_ALIGNMENT = 16;          // Of every allocation, at least
+const size_t ARENA_GRANULE = 64 * 1024;     // Block sizes are multiples of this
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+struct ArenaOverflow;                       // Heap block of a frame that outgrew its arena
+
+struct FrameArena
+{
+	unsigned char* base;
+	size_t capacity;                        // Bytes in base
+	size_t used;                            // Bytes of base handed out this frame
+	size_t overflow_bytes;                  // Bytes handed out from heap blocks this frame
+	ArenaOverflow* overflow;                // Heap blocks, freed at the next reset
+	unsigned int heap_blocks;               // Heap allocations of the arena itself, ever
+};
+
+struct FrameArenas
+{
+	FrameArena buffers[ARENA_BUFFERS];
+	int current;                            // Arena of the frame being built
+	unsigned int frame;                     // Frames begun
+
+	size_t arena_bytes;                     // Arena bytes the last finished frame used, with overflow
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void BeginArenaFrame(FrameArenas& arenas);
+void FreeFrameArenas(FrameArenas& arenas);
+void* ArenaAlloc(FrameArena& arena, size_t bytes, size_t alignment);
+
+inline FrameArena& CurrentArena(FrameArenas& arenas) { return arenas.buffers[arenas.current]; }
+
+//|____________________________________________________________________
+//|
+//| Function: ArenaArray
+//|
+//! \param arena  [in,out] Arena of the current frame.
+//! \param count  [in] Elements.
+//! \return Uninitialized array of count T, valid until the arena's next
+//!         reset; never null.
+//|____________________________________________________________________
+
+template <typename T>
+inline T* ArenaArray(FrameArena& arena, size_t count)
+{
+	static_assert(std::is_trivially_destructible<T>::value, "Arena memory is reset, never destroyed");
+	size_t alignment = alignof(T) > ARENA_ALIGNMENT ? alignof(T) : ARENA_ALIGNMENT;
+	return (T*)ArenaAlloc(arena, count * sizeof(T), alignment);
+}
@@ -0,0 +1,399 @@
+//|___________________________________________________________________
+//!
+//! \file frame_profiler.cpp
+//!
+//! \brief Per-frame CPU scopes and GPU timer queries.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <stdio.h>
+
+#include <chrono>
+
+#include "frame_profiler.h"
+#include "gl_ext.h"
+
+//|___________________
+//|
+//| Global Variables
+//|___________________
+
+bool profiling = false;
+
+static const std::chrono::steady_clock::time_point profile_epoch = std::chrono::steady_clock::now();
+
+// Frame being recorded (scopes since the last frame ended) and the last finished one
+static ProfileFrame current_frame;
+static ProfileFrame last_frame;
+static unsigned int frame_count = 0;
+static int open_scopes[PROFILE_MAX_DEPTH];     // Indices into current_frame.scopes, -1 if dropped
+static int open_count = 0;
+
+// Ring of GL_TIME_ELAPSED queries, oldest pending one at gpu_head
+static GLuint gpu_queries[PROFILE_GPU_QUERIES];
+static unsigned int gpu_frame[PROFILE_GPU_QUERIES];
+static double gpu_start_us[PROFILE_GPU_QUERIES];
+static int gpu_head = 0;
+static int gpu_pending = 0;
+static bool gpu_timing = false;             // Queries created
+static bool gpu_active = false;             // Query running for the current frame
+static float gpu_ms = -1;
+
+// Chrome trace-event JSON (array format)
+static FILE* trace_file = NULL;
+static bool trace_empty = true;
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+static double ProfileNow();
+static void ReadGpuQueries();
+static void TraceEvent(const char* name, int tid, double start_us, double duration_us, unsigned int frame);
+
+//|____________________________________________________________________
+//|
+//| Function: ProfileNow
+//|
+//! \param None.
+//! \return Microseconds since the profiler started.
+//|____________________________________________________________________
+
+static double ProfileNow()
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - profile_epoch).count();
+}
+
+//|____________________________________________________________________
+//|
+//| Function: InitProfilerGL
+//|
+//! \param None.
+//! \return None.
+//!
+//! Creates the GPU timer queries; requires a current context and
+//! LoadGLExtensions(). Without timer queries only the CPU is profiled.
+//|____________________________________________________________________
+
+void InitProfilerGL()
+{
+	gpu_timing = has_timer_queries;
+	if (gpu_timing) {
+		glGenQueries(PROFILE_GPU_QUERIES, gpu_queries);
+	}
+	last_frame.gpu_ms = -1;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SetProfiling
+//|
+//! \param on     [in] Record scopes and frames.
+//! \return None.
+//!
+//! Call between frames. Scopes recorded since the last frame, GPU times
+//! still in flight and the averages are dropped, so nothing stale shows
+//! up later.
+//|____________________________________________________________________
+
+void SetProfiling(bool on)
+{
+	if (on == profiling) {
+		return;
+	}
+	if (gpu_active) {
+		glEndQuery(GL_TIME_ELAPSED);
+		gpu_active = false;
+	}
+	profiling = on;
+	current_frame.scope_count = 0;
+	last_frame.scope_count = 0;
+	open_count = 0;
+	gpu_pending = 0;
+	gpu_ms = -1;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: BeginProfileTrace
+//|
+//! \param path   [in] Trace file, overwritten.
+//! \return True if the trace is open.
+//!
+//! Frames are only traced while profiling is on.
+//|____________________________________________________________________
+
+bool BeginProfileTrace(const char* path)
+{
+	trace_file = fopen(path, "w");
+	if (!trace_file) {
+		printf("Cannot create trace file %s\n", path);
+		return false;
+	}
+
+	fprintf(trace_file, "[\n");
+	fprintf(trace_file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+	fprintf(trace_file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+	trace_empty = false;
+	return true;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: EndProfileTrace
+//|
+//! \param None.
+//! \return None.
+//!
+//! Closes the JSON array and the file. GPU times still in flight are
+//! not waited for.
+//|____________________________________________________________________
+
+void EndProfileTrace()
+{
+	if (!trace_file) {
+		return;
+	}
+	fprintf(trace_file, "\n]\n");
+	fclose(trace_file);
+	trace_file = NULL;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: IsProfileTracing
+//|
+//! \param None.
+//! \return True between BeginProfileTrace() and EndProfileTrace().
+//|____________________________________________________________________
+
+bool IsProfileTracing()
+{
+	return trace_file != NULL;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: TraceEvent
+//|
+//! \param name        [in] Event name.
+//! \param tid         [in] 1 for CPU scopes, 2 for GPU times.
+//! \param start_us    [in] Start time.
+//! \param duration_us [in] Duration.
+//! \param frame       [in] Frame the event belongs to.
+//! \return None.
+//!
+//! Writes one complete ("X") event to the trace, if open.
+//|____________________________________________________________________
+
+static void TraceEvent(const char* name, int tid, double start_us, double duration_us, unsigned int frame)
+{
+	if (!trace_file) {
+		return;
+	}
+	fprintf(trace_file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}",
+		trace_empty ? "" : ",\n", name, tid, start_us, duration_us, frame);
+	trace_empty = false;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: RecordScopeBegin
+//|
+//! \param name   [in] Scope name.
+//! \return None.
+//!
+//! Called by BeginProfileScope() while profiling. Scopes past the per-frame
+//! or nesting limits are counted as open but not recorded.
+//|____________________________________________________________________
+
+void RecordScopeBegin(const char* name)
+{
+	if (open_count >= PROFILE_MAX_DEPTH) {
+		open_count++;
+		return;
+	}
+
+	int index = -1;
+	if (current_frame.scope_count < PROFILE_MAX_SCOPES) {
+		index = current_frame.scope_count++;
+		ProfileScope& scope = current_frame.scopes[index];
+		scope.name = name;
+		scope.depth = open_count;
+		scope.duration_us = 0;
+		scope.start_us = ProfileNow();
+	}
+	open_scopes[open_count++] = index;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: RecordScopeEnd
+//|
+//! \param None.
+//! \return None.
+//!
+//! Called by EndProfileScope() while profiling.
+//|____________________________________________________________________
+
+void RecordScopeEnd()
+{
+	if (open_count == 0) {
+		return;                             // Opened before profiling was turned on
+	}
+	open_count--;
+	if (open_count < PROFILE_MAX_DEPTH && open_scopes[open_count] >= 0) {
+		ProfileScope& scope = current_frame.scopes[open_scopes[open_count]];
+		scope.duration_us = ProfileNow() - scope.start_us;
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: BeginProfileFrame
+//|
+//! \param None.
+//! \return None.
+//!
+//! Starts timing a frame on the CPU and, if a query is free, on the GPU.
+//! Scopes recorded since the last frame (e.g. the simulation that led to
+//! this redraw) belong to this frame. Reads back the GPU times that are
+//! ready without waiting for the others.
+//|____________________________________________________________________
+
+void BeginProfileFrame()
+{
+	if (!profiling) {
+		return;
+	}
+
+	current_frame.index = frame_count;
+	current_frame.start_us = ProfileNow();
+
+	if (gpu_timing) {
+		ReadGpuQueries();
+		if (gpu_pending < PROFILE_GPU_QUERIES) {
+			int slot = (gpu_head + gpu_pending) % PROFILE_GPU_QUERIES;
+			gpu_frame[slot] = frame_count;
+			gpu_start_us[slot] = current_frame.start_us;
+			glBeginQuery(GL_TIME_ELAPSED, gpu_queries[slot]);
+			gpu_active = true;
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: EndProfileGpu
+//|
+//! \param None.
+//! \return None.
+//!
+//! Ends the frame's GPU query; call once the frame's commands are issued,
+//! before swapping (EndProfileFrame() does it otherwise).
+//|____________________________________________________________________
+
+void EndProfileGpu()
+{
+	if (gpu_active) {
+		glEndQuery(GL_TIME_ELAPSED);
+		gpu_active = false;
+		gpu_pending++;
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: ReadGpuQueries
+//|
+//! \param None.
+//! \return None.
+//!
+//! Reads back the GPU frame times in order for as long as they are
+//! available; never blocks.
+//|____________________________________________________________________
+
+static void ReadGpuQueries()
+{
+	while (gpu_pending > 0) {
+		GLuint query = gpu_queries[gpu_head];
+		GLint available = 0;
+		glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) {
+			break;
+		}
+
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+		gpu_ms = (float)(ns / 1.0e6);
+		TraceEvent("gpu frame", 2, gpu_start_us[gpu_head], ns / 1.0e3, gpu_frame[gpu_head]);
+
+		gpu_head = (gpu_head + 1) % PROFILE_GPU_QUERIES;
+		gpu_pending--;
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: EndProfileFrame
+//|
+//! \param None.
+//! \return None.
+//!
+//! Finishes the frame: updates the smoothed times shown by the HUD and
+//! writes the frame and its scopes to the trace.
+//|____________________________________________________________________
+
+void EndProfileFrame()
+{
+	if (!profiling) {
+		return;
+	}
+	EndProfileGpu();
+
+	ProfileFrame& f = current_frame;
+	f.duration_us = ProfileNow() - f.start_us;
+	f.gpu_ms = gpu_ms;
+
+	// Averages follow a scope while the frames keep the same scopes in the same order
+	bool continued = last_frame.scope_count > 0;
+	f.average_ms = (float)(f.duration_us / 1000);
+	if (continued) {
+		f.average_ms = last_frame.average_ms + PROFILE_SMOOTHING * (f.average_ms - last_frame.average_ms);
+	}
+	for (int i = 0; i < f.scope_count; i++) {
+		ProfileScope& scope = f.scopes[i];
+		scope.average_ms = (float)(scope.duration_us / 1000);
+		if (continued && i < last_frame.scope_count && last_frame.scopes[i].name == scope.name) {
+			scope.average_ms = last_frame.scopes[i].average_ms + PROFILE_SMOOTHING * (scope.average_ms - last_frame.scopes[i].average_ms);
+		}
+	}
+
+	TraceEvent("frame", 1, f.start_us, f.duration_us, f.index);
+	for (int i = 0; i < f.scope_count; i++) {
+		TraceEvent(f.scopes[i].name, 1, f.scopes[i].start_us, f.scopes[i].duration_us, f.index);
+	}
+
+	last_frame = f;
+	f.scope_count = 0;
+	open_count = 0;
+	frame_count++;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: LastProfileFrame
+//|
+//! \param None.
+//! \return The last finished frame (scope_count is 0 before the first).
+//|____________________________________________________________________
+
+const ProfileFrame& LastProfileFrame()
+{
+	return last_frame;
+}
@@ -0,0 +1,114 @@
+//|___________________________________________________________________
+//!
+//! \file frame_profiler.h
+//!
+//! \brief Per-frame CPU scopes and GPU timer queries.
+//!
+//! Nested CPU scopes time the stages of a frame (input, simulation, camera
+//! setup, traversal, drawing, swap). Each frame's GPU work is timed with
+//! a GL_TIME_ELAPSED query that is read back a few frames later, once the
+//! driver reports it available, so the CPU never waits on the GPU.
+//!
+//! Finished frames feed the on-screen HUD (smoothed times) and, when a
+//! trace is open, a Chrome trace-event JSON file (chrome://tracing or
+//! Perfetto): CPU scopes on thread 1, GPU frame times on thread 2.
+//!
+//! While profiling is off every scope is a single test of a global flag.
+//|___________________________________________________________________
+
+#pragma once
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const int PROFILE_MAX_SCOPES = 64;          // Scopes recorded per frame; later ones are dropped
+const int PROFILE_MAX_DEPTH = 16;           // Nesting limit of open scopes
+const int PROFILE_GPU_QUERIES = 4;          // Frames a GPU time may lag behind before one is skipped
+const float PROFILE_SMOOTHING = 0.1f;       // Weight of the newest frame in the HUD averages
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+struct ProfileScope
+{
+	const char* name;           // String literal, compared by address
+	int depth;                  // 0 for scopes outside any other
+	double start_us;            // Since the profiler started
+	double duration_us;
+	float average_ms;           // Smoothed over the frames with the same scope at this position
+};
+
+struct ProfileFrame
+{
+	unsigned int index;
+	double start_us;
+	double duration_us;
+	float average_ms;
+	float gpu_ms;               // Latest GPU frame time read back (-1 if none yet)
+	int scope_count;
+	ProfileScope scopes[PROFILE_MAX_SCOPES];
+};
+
+//|___________________
+//|
+//| Global Variables
+//|___________________
+
+extern bool profiling;                  // Scopes and frames are recorded while set (see SetProfiling)
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void InitProfilerGL();
+void SetProfiling(bool on);
+bool BeginProfileTrace(const char* path);
+void EndProfileTrace();
+bool IsProfileTracing();
+
+void BeginProfileFrame();
+void EndProfileGpu();
+void EndProfileFrame();
+const ProfileFrame& LastProfileFrame();
+
+void RecordScopeBegin(const char* name);
+void RecordScopeEnd();
+
+//|____________________________________________________________________
+//|
+//| Function: BeginProfileScope
+//|
+//! \param name   [in] Scope name; must outlive the profiler (a literal).
+//! \return None.
+//!
+//! Opens a scope inside the current one; pair with EndProfileScope().
+//|____________________________________________________________________
+
+inline void BeginProfileScope(const char* name)
+{
+	if (profiling) {
+		RecordScopeBegin(name);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: EndProfileScope
+//|
+//! \param None.
+//! \return None.
+//!
+//! Closes the innermost open scope.
+//|____________________________________________________________________
+
+inline void EndProfileScope()
+{
+	if (profiling) {
+		RecordScopeEnd();
+	}
+}
@@ -0,0 +1,168 @@
+//|___________________________________________________________________
+//!
+//! \file gl_ext.cpp
+//!
+//! \brief OpenGL entry points beyond 1.1, loaded at runtime.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gl_ext.h"
+
+//|___________________
+//|
+//| Global Variables
+//|___________________
+
+bool has_vertex_buffers = false;
+bool has_shaders = false;
+bool has_instancing = false;
+bool has_core_shaders = false;
+bool is_core_profile = false;
+bool has_timer_queries = false;
+
+GenBuffersFunc ext_glGenBuffers = 0;
+DeleteBuffersFunc ext_glDeleteBuffers = 0;
+BindBufferFunc ext_glBindBuffer = 0;
+BufferDataFunc ext_glBufferData = 0;
+BufferSubDataFunc ext_glBufferSubData = 0;
+
+CreateShaderFunc ext_glCreateShader = 0;
+DeleteShaderFunc ext_glDeleteShader = 0;
+ShaderSourceFunc ext_glShaderSource = 0;
+CompileShaderFunc ext_glCompileShader = 0;
+GetShaderivFunc ext_glGetShaderiv = 0;
+GetShaderInfoLogFunc ext_glGetShaderInfoLog = 0;
+CreateProgramFunc ext_glCreateProgram = 0;
+AttachShaderFunc ext_glAttachShader = 0;
+BindAttribLocationFunc ext_glBindAttribLocation = 0;
+LinkProgramFunc ext_glLinkProgram = 0;
+GetProgramivFunc ext_glGetProgramiv = 0;
+GetProgramInfoLogFunc ext_glGetProgramInfoLog = 0;
+UseProgramFunc ext_glUseProgram = 0;
+GetUniformLocationFunc ext_glGetUniformLocation = 0;
+Uniform1fFunc ext_glUniform1f = 0;
+Uniform4fvFunc ext_glUniform4fv = 0;
+UniformMatrix4fvFunc ext_glUniformMatrix4fv = 0;
+EnableVertexAttribArrayFunc ext_glEnableVertexAttribArray = 0;
+DisableVertexAttribArrayFunc ext_glDisableVertexAttribArray = 0;
+VertexAttribPointerFunc ext_glVertexAttribPointer = 0;
+
+DrawArraysInstancedFunc ext_glDrawArraysInstanced = 0;
+VertexAttribDivisorFunc ext_glVertexAttribDivisor = 0;
+
+GenVertexArraysFunc ext_glGenVertexArrays = 0;
+DeleteVertexArraysFunc ext_glDeleteVertexArrays = 0;
+BindVertexArrayFunc ext_glBindVertexArray = 0;
+
+GenQueriesFunc ext_glGenQueries = 0;
+DeleteQueriesFunc ext_glDeleteQueries = 0;
+BeginQueryFunc ext_glBeginQuery = 0;
+EndQueryFunc ext_glEndQuery = 0;
+GetQueryObjectivFunc ext_glGetQueryObjectiv = 0;
+GetQueryObjectui64vFunc ext_glGetQueryObjectui64v = 0;
+
+//|____________________________________________________________________
+//|
+//| Function: LoadGLExtensions
+//|
+//! \param load   [in] Returns the address of a GL function, or null.
+//! \return True if buffer objects are available.
+//!
+//! Loads the entry points; a current GL context is required. Missing
+//! groups are reported through the has_* flags so callers can fall back.
+//|____________________________________________________________________
+
+bool LoadGLExtensions(GLProcLoader load)
+{
+	ext_glGenBuffers = (GenBuffersFunc)load("glGenBuffers");
+	ext_glDeleteBuffers = (DeleteBuffersFunc)load("glDeleteBuffers");
+	ext_glBindBuffer = (BindBufferFunc)load("glBindBuffer");
+	ext_glBufferData = (BufferDataFunc)load("glBufferData");
+	ext_glBufferSubData = (BufferSubDataFunc)load("glBufferSubData");
+
+	has_vertex_buffers = ext_glGenBuffers && ext_glDeleteBuffers && ext_glBindBuffer &&
+	                     ext_glBufferData && ext_glBufferSubData;
+
+	ext_glCreateShader = (CreateShaderFunc)load("glCreateShader");
+	ext_glDeleteShader = (DeleteShaderFunc)load("glDeleteShader");
+	ext_glShaderSource = (ShaderSourceFunc)load("glShaderSource");
+	ext_glCompileShader = (CompileShaderFunc)load("glCompileShader");
+	ext_glGetShaderiv = (GetShaderivFunc)load("glGetShaderiv");
+	ext_glGetShaderInfoLog = (GetShaderInfoLogFunc)load("glGetShaderInfoLog");
+	ext_glCreateProgram = (CreateProgramFunc)load("glCreateProgram");
+	ext_glAttachShader = (AttachShaderFunc)load("glAttachShader");
+	ext_glBindAttribLocation = (BindAttribLocationFunc)load("glBindAttribLocation");
+	ext_glLinkProgram = (LinkProgramFunc)load("glLinkProgram");
+	ext_glGetProgramiv = (GetProgramivFunc)load("glGetProgramiv");
+	ext_glGetProgramInfoLog = (GetProgramInfoLogFunc)load("glGetProgramInfoLog");
+	ext_glUseProgram = (UseProgramFunc)load("glUseProgram");
+	ext_glGetUniformLocation = (GetUniformLocationFunc)load("glGetUniformLocation");
+	ext_glUniform1f = (Uniform1fFunc)load("glUniform1f");
+	ext_glUniform4fv = (Uniform4fvFunc)load("glUniform4fv");
+	ext_glUniformMatrix4fv = (UniformMatrix4fvFunc)load("glUniformMatrix4fv");
+	ext_glEnableVertexAttribArray = (EnableVertexAttribArrayFunc)load("glEnableVertexAttribArray");
+	ext_glDisableVertexAttribArray = (DisableVertexAttribArrayFunc)load("glDisableVertexAttribArray");
+	ext_glVertexAttribPointer = (VertexAttribPointerFunc)load("glVertexAttribPointer");
+
+	has_shaders = ext_glCreateShader && ext_glDeleteShader && ext_glShaderSource && ext_glCompileShader &&
+	              ext_glGetShaderiv && ext_glGetShaderInfoLog && ext_glCreateProgram && ext_glAttachShader &&
+	              ext_glBindAttribLocation && ext_glLinkProgram && ext_glGetProgramiv && ext_glGetProgramInfoLog &&
+	              ext_glUseProgram && ext_glGetUniformLocation && ext_glUniform1f && ext_glUniform4fv && ext_glUniformMatrix4fv &&
+	              ext_glEnableVertexAttribArray && ext_glDisableVertexAttribArray && ext_glVertexAttribPointer;
+
+	// Core names first, then the ARB extension names of older drivers
+	ext_glDrawArraysInstanced = (DrawArraysInstancedFunc)load("glDrawArraysInstanced");
+	if (!ext_glDrawArraysInstanced) {
+		ext_glDrawArraysInstanced = (DrawArraysInstancedFunc)load("glDrawArraysInstancedARB");
+	}
+	ext_glVertexAttribDivisor = (VertexAttribDivisorFunc)load("glVertexAttribDivisor");
+	if (!ext_glVertexAttribDivisor) {
+		ext_glVertexAttribDivisor = (VertexAttribDivisorFunc)load("glVertexAttribDivisorARB");
+	}
+
+	has_instancing = has_vertex_buffers && has_shaders && ext_glDrawArraysInstanced && ext_glVertexAttribDivisor;
+
+	// Loaders return addresses for functions the driver lacks, so the version or extension decides
+	ext_glGenQueries = (GenQueriesFunc)load("glGenQueries");
+	ext_glDeleteQueries = (DeleteQueriesFunc)load("glDeleteQueries");
+	ext_glBeginQuery = (BeginQueryFunc)load("glBeginQuery");
+	ext_glEndQuery = (EndQueryFunc)load("glEndQuery");
+	ext_glGetQueryObjectiv = (GetQueryObjectivFunc)load("glGetQueryObjectiv");
+	ext_glGetQueryObjectui64v = (GetQueryObjectui64vFunc)load("glGetQueryObjectui64v");
+	if (!ext_glGetQueryObjectui64v) {
+		ext_glGetQueryObjectui64v = (GetQueryObjectui64vFunc)load("glGetQueryObjectui64vEXT");
+	}
+
+	ext_glGenVertexArrays = (GenVertexArraysFunc)load("glGenVertexArrays");
+	ext_glDeleteVertexArrays = (DeleteVertexArraysFunc)load("glDeleteVertexArrays");
+	ext_glBindVertexArray = (BindVertexArrayFunc)load("glBindVertexArray");
+
+	const char* version = (const char*)glGetString(GL_VERSION);
+	const char* glsl = (const char*)glGetString(GL_SHADING_LANGUAGE_VERSION);
+	double gl_version = version ? atof(version) : 0;
+	double glsl_version = glsl ? atof(glsl) : 0;
+
+	// Core profiles have no extension string (and no glBegin(), matrix stack or client arrays)
+	GLint profile = 0;
+	if (gl_version >= 3.2) {
+		glGetIntegerv(GL_CONTEXT_PROFILE_MASK, &profile);
+	}
+	is_core_profile = (profile & GL_CONTEXT_CORE_PROFILE_BIT) != 0;
+	const char* extensions = is_core_profile ? 0 : (const char*)glGetString(GL_EXTENSIONS);
+	bool timer_extension = extensions && (strstr(extensions, "GL_ARB_timer_query") || strstr(extensions, "GL_EXT_timer_query"));
+
+	has_timer_queries = (gl_version >= 3.3 || timer_extension) && ext_glGenQueries && ext_glDeleteQueries &&
+	                    ext_glBeginQuery && ext_glEndQuery && ext_glGetQueryObjectiv && ext_glGetQueryObjectui64v;
+
+	has_core_shaders = gl_version >= 3.3 && glsl_version >= 3.3 && has_instancing &&
+	                   ext_glGenVertexArrays && ext_glDeleteVertexArrays && ext_glBindVertexArray;
+
+	return has_vertex_buffers;
+}
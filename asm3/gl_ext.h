@@ -0,0 +1,232 @@
+//|___________________________________________________________________
+//!
+//! \file gl_ext.h
+//!
+//! \brief OpenGL entry points beyond 1.1, loaded at runtime.
+//!
+//! The Windows SDK headers stop at OpenGL 1.1, so newer functions are
+//! fetched through a loader (glutGetProcAddress in the GLUT app). Each
+//! entry point is a function pointer hidden behind a macro, so call sites
+//! read like plain OpenGL. Include this after the GL/GLUT headers.
+//|___________________________________________________________________
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <GL/glut.h>
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+//|___________________
+//|
+//| Types and enums missing from OpenGL 1.1 headers
+//|___________________
+
+#ifndef GL_VERSION_1_5
+typedef ptrdiff_t GLsizeiptr;
+typedef ptrdiff_t GLintptr;
+#endif
+#ifndef GL_VERSION_2_0
+typedef char GLchar;
+#endif
+#ifndef GL_VERSION_3_2
+typedef uint64_t GLuint64;
+#endif
+
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT     0x8866
+#endif
+#ifndef GL_QUERY_RESULT_AVAILABLE
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED     0x88BF
+#endif
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER     0x8892
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW      0x88E0
+#endif
+#ifndef GL_STATIC_DRAW
+#define GL_STATIC_DRAW      0x88E4
+#endif
+#ifndef GL_DYNAMIC_DRAW
+#define GL_DYNAMIC_DRAW     0x88E8
+#endif
+#ifndef GL_FRAGMENT_SHADER
+#define GL_FRAGMENT_SHADER  0x8B30
+#endif
+#ifndef GL_VERTEX_SHADER
+#define GL_VERTEX_SHADER    0x8B31
+#endif
+#ifndef GL_COMPILE_STATUS
+#define GL_COMPILE_STATUS   0x8B81
+#endif
+#ifndef GL_LINK_STATUS
+#define GL_LINK_STATUS      0x8B82
+#endif
+#ifndef GL_INFO_LOG_LENGTH
+#define GL_INFO_LOG_LENGTH  0x8B84
+#endif
+#ifndef GL_CONTEXT_PROFILE_MASK
+#define GL_CONTEXT_PROFILE_MASK 0x9126
+#define GL_CONTEXT_CORE_PROFILE_BIT 0x00000001
+#endif
+#ifndef GL_SHADING_LANGUAGE_VERSION
+#define GL_SHADING_LANGUAGE_VERSION 0x8B8C
+#endif
+
+//|___________________
+//|
+//| Loader
+//|___________________
+
+typedef void (*GLProc)(void);
+typedef GLProc (*GLProcLoader)(const char* name);
+
+bool LoadGLExtensions(GLProcLoader load);
+
+extern bool has_vertex_buffers;         // OpenGL 1.5 buffer objects
+extern bool has_shaders;                // OpenGL 2.0 GLSL programs
+extern bool has_instancing;             // OpenGL 3.3 (or ARB) instanced arrays
+extern bool has_core_shaders;           // OpenGL 3.3 with GLSL 3.30 programs and vertex array objects
+extern bool is_core_profile;            // Core profile context: no fixed-function pipeline
+extern bool has_timer_queries;          // OpenGL 3.3 (or ARB/EXT) GL_TIME_ELAPSED queries
+
+//|___________________
+//|
+//| Entry points
+//|___________________
+
+// OpenGL 1.5: buffer objects
+typedef void (APIENTRY *GenBuffersFunc)(GLsizei n, GLuint* buffers);
+typedef void (APIENTRY *DeleteBuffersFunc)(GLsizei n, const GLuint* buffers);
+typedef void (APIENTRY *BindBufferFunc)(GLenum target, GLuint buffer);
+typedef void (APIENTRY *BufferDataFunc)(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+typedef void (APIENTRY *BufferSubDataFunc)(GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+
+extern GenBuffersFunc ext_glGenBuffers;
+extern DeleteBuffersFunc ext_glDeleteBuffers;
+extern BindBufferFunc ext_glBindBuffer;
+extern BufferDataFunc ext_glBufferData;
+extern BufferSubDataFunc ext_glBufferSubData;
+
+#define glGenBuffers ext_glGenBuffers
+#define glDeleteBuffers ext_glDeleteBuffers
+#define glBindBuffer ext_glBindBuffer
+#define glBufferData ext_glBufferData
+#define glBufferSubData ext_glBufferSubData
+
+// OpenGL 2.0: GLSL programs and generic vertex attributes
+typedef GLuint (APIENTRY *CreateShaderFunc)(GLenum type);
+typedef void (APIENTRY *DeleteShaderFunc)(GLuint shader);
+typedef void (APIENTRY *ShaderSourceFunc)(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length);
+typedef void (APIENTRY *CompileShaderFunc)(GLuint shader);
+typedef void (APIENTRY *GetShaderivFunc)(GLuint shader, GLenum pname, GLint* params);
+typedef void (APIENTRY *GetShaderInfoLogFunc)(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog);
+typedef GLuint (APIENTRY *CreateProgramFunc)(void);
+typedef void (APIENTRY *AttachShaderFunc)(GLuint program, GLuint shader);
+typedef void (APIENTRY *BindAttribLocationFunc)(GLuint program, GLuint index, const GLchar* name);
+typedef void (APIENTRY *LinkProgramFunc)(GLuint program);
+typedef void (APIENTRY *GetProgramivFunc)(GLuint program, GLenum pname, GLint* params);
+typedef void (APIENTRY *GetProgramInfoLogFunc)(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog);
+typedef void (APIENTRY *UseProgramFunc)(GLuint program);
+typedef GLint (APIENTRY *GetUniformLocationFunc)(GLuint program, const GLchar* name);
+typedef void (APIENTRY *Uniform1fFunc)(GLint location, GLfloat v0);
+typedef void (APIENTRY *Uniform4fvFunc)(GLint location, GLsizei count, const GLfloat* value);
+typedef void (APIENTRY *UniformMatrix4fvFunc)(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+typedef void (APIENTRY *EnableVertexAttribArrayFunc)(GLuint index);
+typedef void (APIENTRY *DisableVertexAttribArrayFunc)(GLuint index);
+typedef void (APIENTRY *VertexAttribPointerFunc)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
+
+extern CreateShaderFunc ext_glCreateShader;
+extern DeleteShaderFunc ext_glDeleteShader;
+extern ShaderSourceFunc ext_glShaderSource;
+extern CompileShaderFunc ext_glCompileShader;
+extern GetShaderivFunc ext_glGetShaderiv;
+extern GetShaderInfoLogFunc ext_glGetShaderInfoLog;
+extern CreateProgramFunc ext_glCreateProgram;
+extern AttachShaderFunc ext_glAttachShader;
+extern BindAttribLocationFunc ext_glBindAttribLocation;
+extern LinkProgramFunc ext_glLinkProgram;
+extern GetProgramivFunc ext_glGetProgramiv;
+extern GetProgramInfoLogFunc ext_glGetProgramInfoLog;
+extern UseProgramFunc ext_glUseProgram;
+extern GetUniformLocationFunc ext_glGetUniformLocation;
+extern Uniform1fFunc ext_glUniform1f;
+extern Uniform4fvFunc ext_glUniform4fv;
+extern UniformMatrix4fvFunc ext_glUniformMatrix4fv;
+extern EnableVertexAttribArrayFunc ext_glEnableVertexAttribArray;
+extern DisableVertexAttribArrayFunc ext_glDisableVertexAttribArray;
+extern VertexAttribPointerFunc ext_glVertexAttribPointer;
+
+#define glCreateShader ext_glCreateShader
+#define glDeleteShader ext_glDeleteShader
+#define glShaderSource ext_glShaderSource
+#define glCompileShader ext_glCompileShader
+#define glGetShaderiv ext_glGetShaderiv
+#define glGetShaderInfoLog ext_glGetShaderInfoLog
+#define glCreateProgram ext_glCreateProgram
+#define glAttachShader ext_glAttachShader
+#define glBindAttribLocation ext_glBindAttribLocation
+#define glLinkProgram ext_glLinkProgram
+#define glGetProgramiv ext_glGetProgramiv
+#define glGetProgramInfoLog ext_glGetProgramInfoLog
+#define glUseProgram ext_glUseProgram
+#define glGetUniformLocation ext_glGetUniformLocation
+#define glUniform1f ext_glUniform1f
+#define glUniform4fv ext_glUniform4fv
+#define glUniformMatrix4fv ext_glUniformMatrix4fv
+#define glEnableVertexAttribArray ext_glEnableVertexAttribArray
+#define glDisableVertexAttribArray ext_glDisableVertexAttribArray
+#define glVertexAttribPointer ext_glVertexAttribPointer
+
+// OpenGL 3.1/3.3 (ARB_draw_instanced, ARB_instanced_arrays): instancing
+typedef void (APIENTRY *DrawArraysInstancedFunc)(GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+typedef void (APIENTRY *VertexAttribDivisorFunc)(GLuint index, GLuint divisor);
+
+extern DrawArraysInstancedFunc ext_glDrawArraysInstanced;
+extern VertexAttribDivisorFunc ext_glVertexAttribDivisor;
+
+#define glDrawArraysInstanced ext_glDrawArraysInstanced
+#define glVertexAttribDivisor ext_glVertexAttribDivisor
+
+// OpenGL 3.0 (ARB_vertex_array_object): vertex array objects, required by core profiles
+typedef void (APIENTRY *GenVertexArraysFunc)(GLsizei n, GLuint* arrays);
+typedef void (APIENTRY *DeleteVertexArraysFunc)(GLsizei n, const GLuint* arrays);
+typedef void (APIENTRY *BindVertexArrayFunc)(GLuint array);
+
+extern GenVertexArraysFunc ext_glGenVertexArrays;
+extern DeleteVertexArraysFunc ext_glDeleteVertexArrays;
+extern BindVertexArrayFunc ext_glBindVertexArray;
+
+#define glGenVertexArrays ext_glGenVertexArrays
+#define glDeleteVertexArrays ext_glDeleteVertexArrays
+#define glBindVertexArray ext_glBindVertexArray
+
+// OpenGL 1.5 queries, read back as 64 bits with OpenGL 3.3 (ARB_timer_query, EXT_timer_query)
+typedef void (APIENTRY *GenQueriesFunc)(GLsizei n, GLuint* ids);
+typedef void (APIENTRY *DeleteQueriesFunc)(GLsizei n, const GLuint* ids);
+typedef void (APIENTRY *BeginQueryFunc)(GLenum target, GLuint id);
+typedef void (APIENTRY *EndQueryFunc)(GLenum target);
+typedef void (APIENTRY *GetQueryObjectivFunc)(GLuint id, GLenum pname, GLint* params);
+typedef void (APIENTRY *GetQueryObjectui64vFunc)(GLuint id, GLenum pname, GLuint64* params);
+
+extern GenQueriesFunc ext_glGenQueries;
+extern DeleteQueriesFunc ext_glDeleteQueries;
+extern BeginQueryFunc ext_glBeginQuery;
+extern EndQueryFunc ext_glEndQuery;
+extern GetQueryObjectivFunc ext_glGetQueryObjectiv;
+extern GetQueryObjectui64vFunc ext_glGetQueryObjectui64v;
+
+#define glGenQueries ext_glGenQueries
+#define glDeleteQueries ext_glDeleteQueries
+#define glBeginQuery ext_glBeginQuery
+#define glEndQuery ext_glEndQuery
+#define glGetQueryObjectiv ext_glGetQueryObjectiv
+#define glGetQueryObjectui64v ext_glGetQueryObjectui64v
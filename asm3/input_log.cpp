@@ -0,0 +1,167 @@
+//|___________________________________________________________________
+//!
+//! \file input_log.cpp
+//!
+//! \brief Binary log of input events for recording and replaying sessions.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <stdio.h>
+#include <string.h>
+
+#include "input_log.h"
+
+//|___________________
+//|
+//| Global Variables
+//|___________________
+
+static FILE* record_file = NULL;        // Open while recording
+
+//|____________________________________________________________________
+//|
+//| Function: BeginInputRecording
+//|
+//! \param path     [in] Log file, overwritten.
+//! \param sim_rate [in] Simulation ticks per second.
+//! \return True if the log is open for recording.
+//|____________________________________________________________________
+
+bool BeginInputRecording(const char* path, uint32_t sim_rate)
+{
+	record_file = fopen(path, "wb");
+	if (!record_file) {
+		printf("Cannot create input log %s\n", path);
+		return false;
+	}
+
+	InputLogHeader header;
+	memcpy(header.magic, INPUT_LOG_MAGIC, sizeof(header.magic));
+	header.version = INPUT_LOG_VERSION;
+	header.sim_rate = sim_rate;
+	header.event_size = sizeof(InputEvent);
+	fwrite(&header, sizeof(header), 1, record_file);
+
+	return true;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: IsRecordingInput
+//|
+//! \param None.
+//! \return True between BeginInputRecording() and EndInputRecording().
+//|____________________________________________________________________
+
+bool IsRecordingInput()
+{
+	return record_file != NULL;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: RecordInputEvent
+//|
+//! \param time_ms   [in] Time since the recording started.
+//! \param tick      [in] Simulation ticks run so far.
+//! \param type      [in] Event type.
+//! \param code      [in] Key or mouse button.
+//! \param state     [in] Mouse button state.
+//! \param modifiers [in] Keyboard modifiers of a mouse event.
+//! \param x, y      [in] Mouse position.
+//! \return None; does nothing unless recording.
+//|____________________________________________________________________
+
+void RecordInputEvent(uint32_t time_ms, uint32_t tick, InputEventType type, int code, int state, int modifiers, int x, int y)
+{
+	if (!record_file) {
+		return;
+	}
+
+	InputEvent e;
+	e.time_ms = time_ms;
+	e.tick = tick;
+	e.type = (uint8_t)type;
+	e.code = (uint8_t)code;
+	e.state = (uint8_t)state;
+	e.modifiers = (uint8_t)modifiers;
+	e.x = x;
+	e.y = y;
+	fwrite(&e, sizeof(e), 1, record_file);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: EndInputRecording
+//|
+//! \param time_ms   [in] Time since the recording started.
+//! \param tick      [in] Simulation ticks run in total.
+//! \param checksum  [in] Checksum of the final state.
+//! \return None.
+//!
+//! Writes the INPUT_END record and closes the log.
+//|____________________________________________________________________
+
+void EndInputRecording(uint32_t time_ms, uint32_t tick, uint32_t checksum)
+{
+	if (!record_file) {
+		return;
+	}
+
+	RecordInputEvent(time_ms, tick, INPUT_END, 0, 0, 0, (int32_t)checksum, 0);
+	fclose(record_file);
+	record_file = NULL;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: LoadInputLog
+//|
+//! \param path     [in] Log file.
+//! \param sim_rate [in] Simulation ticks per second of this build.
+//! \param events   [out] Events in order, ending with INPUT_END.
+//! \return True if the log is complete and was recorded at sim_rate.
+//|____________________________________________________________________
+
+bool LoadInputLog(const char* path, uint32_t sim_rate, std::vector<InputEvent>& events)
+{
+	events.clear();
+
+	FILE* f = fopen(path, "rb");
+	if (!f) {
+		printf("Cannot open input log %s\n", path);
+		return false;
+	}
+
+	InputLogHeader header;
+	if (fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, INPUT_LOG_MAGIC, sizeof(header.magic)) != 0 ||
+	    header.version != INPUT_LOG_VERSION || header.event_size != sizeof(InputEvent)) {
+		printf("%s is not a version %u input log\n", path, INPUT_LOG_VERSION);
+		fclose(f);
+		return false;
+	}
+	if (header.sim_rate != sim_rate) {
+		printf("%s was recorded at %u ticks/s, this build runs %u\n", path, header.sim_rate, sim_rate);
+		fclose(f);
+		return false;
+	}
+
+	InputEvent e;
+	while (fread(&e, sizeof(e), 1, f) == 1) {
+		events.push_back(e);
+		if (e.type == INPUT_END) {
+			break;
+		}
+	}
+	fclose(f);
+
+	if (events.empty() || events.back().type != INPUT_END) {
+		printf("%s is truncated (no end record)\n", path);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,73 @@
+//|___________________________________________________________________
+//!
+//! \file input_log.h
+//!
+//! \brief Binary log of input events for recording and replaying sessions.
+//!
+//! Every keyboard and mouse event is stored with the time it arrived and
+//! the number of simulation ticks run before it. A replay that runs the
+//! same ticks between the same events reaches the same poses, however
+//! fast it runs, so the log ends with the final tick and a checksum of
+//! the final state to compare against.
+//!
+//! File layout (native byte order): InputLogHeader, InputEvent records,
+//! and a last INPUT_END record whose x field holds the state checksum.
+//|___________________________________________________________________
+
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const char INPUT_LOG_MAGIC[4] = { 'T', 'I', 'N', 'P' };
+const uint32_t INPUT_LOG_VERSION = 1;
+
+enum InputEventType {
+	INPUT_KEY_DOWN = 0,     // code = key
+	INPUT_KEY_UP,           // code = key
+	INPUT_MOUSE,            // code = button, state = GLUT_DOWN/GLUT_UP, modifiers = glutGetModifiers()
+	INPUT_MOTION,
+	INPUT_END               // x = checksum of the final state
+};
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+struct InputLogHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t sim_rate;          // Ticks per second of the recording
+	uint32_t event_size;        // sizeof(InputEvent)
+};
+
+struct InputEvent
+{
+	uint32_t time_ms;           // Since the recording started
+	uint32_t tick;              // Simulation ticks run before the event
+	uint8_t type;               // InputEventType
+	uint8_t code;
+	uint8_t state;
+	uint8_t modifiers;
+	int32_t x;
+	int32_t y;
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+bool BeginInputRecording(const char* path, uint32_t sim_rate);
+bool IsRecordingInput();
+void RecordInputEvent(uint32_t time_ms, uint32_t tick, InputEventType type, int code, int state, int modifiers, int x, int y);
+void EndInputRecording(uint32_t time_ms, uint32_t tick, uint32_t checksum);
+bool LoadInputLog(const char* path, uint32_t sim_rate, std::vector<InputEvent>& events);
@@ -0,0 +1,100 @@
+//|___________________________________________________________________
+//!
+//! \file input_queue.cpp
+//!
+//! \brief Timestamped input events queued until the next frame applies them.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <chrono>
+
+#include "input_queue.h"
+
+//|____________________________________________________________________
+//|
+//| Function: InitInputQueue
+//|
+//! \param queue  [out] Input queue, emptied.
+//! \return None.
+//|____________________________________________________________________
+
+void InitInputQueue(InputQueue& queue)
+{
+	queue.head.store(0, std::memory_order_relaxed);
+	queue.tail.store(0, std::memory_order_relaxed);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: PushInput
+//|
+//! \param queue  [in,out] Input queue (producer side).
+//! \param e      [in] Event.
+//! \return False if the ring is full; the event is not queued and the
+//!         caller decides (apply the pending events first, or wait).
+//|____________________________________________________________________
+
+bool PushInput(InputQueue& queue, const QueuedInput& e)
+{
+	uint32_t tail = queue.tail.load(std::memory_order_relaxed);
+	if (tail - queue.head.load(std::memory_order_acquire) == INPUT_QUEUE_CAPACITY) {
+		return false;
+	}
+
+	queue.events[tail & (INPUT_QUEUE_CAPACITY - 1)] = e;
+	queue.tail.store(tail + 1, std::memory_order_release);     // Publishes the entry
+	return true;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: PopInput
+//|
+//! \param queue  [in,out] Input queue (consumer side).
+//! \param e      [out] Oldest pending event.
+//! \return False if no event is pending.
+//|____________________________________________________________________
+
+bool PopInput(InputQueue& queue, QueuedInput& e)
+{
+	uint32_t head = queue.head.load(std::memory_order_relaxed);
+	if (head == queue.tail.load(std::memory_order_acquire)) {
+		return false;
+	}
+
+	e = queue.events[head & (INPUT_QUEUE_CAPACITY - 1)];
+	queue.head.store(head + 1, std::memory_order_release);     // Hands the entry back to the producer
+	return true;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: PendingInputs
+//|
+//! \param queue  [in] Input queue.
+//! \return Events pushed and not popped yet (a snapshot if the other
+//!         side is running).
+//|____________________________________________________________________
+
+uint32_t PendingInputs(const InputQueue& queue)
+{
+	return queue.tail.load(std::memory_order_acquire) - queue.head.load(std::memory_order_acquire);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: InputClockUs
+//|
+//! \param None.
+//! \return Monotonic time in microseconds, for event timestamps.
+//|____________________________________________________________________
+
+uint64_t InputClockUs()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,67 @@
+//|___________________________________________________________________
+//!
+//! \file input_queue.h
+//!
+//! \brief Timestamped input events queued until the next frame applies them.
+//!
+//! The GLUT callbacks only push their event, with the time it arrived,
+//! and ask for a redraw. The frame pops every pending event in arrival
+//! order, adds up the mouse motion into one camera change and then runs
+//! the simulation once. However fast the mouse reports, a frame costs one
+//! camera update and one pose update, and the camera shows all the motion
+//! that arrived before it.
+//!
+//! The queue is a fixed ring with a single producer and a single consumer
+//! that only meet through the two atomic indices: it never locks or
+//! allocates, so input could also be pushed from a thread of its own. A
+//! full ring refuses the event instead of overwriting one (see PushInput()).
+//|___________________________________________________________________
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "input_log.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const uint32_t INPUT_QUEUE_CAPACITY = 4096;     // Power of two; seconds of 1000 Hz motion
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+struct QueuedInput
+{
+	uint64_t time_us;           // Arrival, see InputClockUs()
+	uint8_t type;               // InputEventType
+	uint8_t code;
+	uint8_t state;
+	uint8_t modifiers;
+	int32_t x;
+	int32_t y;
+};
+
+struct InputQueue
+{
+	QueuedInput events[INPUT_QUEUE_CAPACITY];
+	std::atomic<uint32_t> head;     // Next event to pop, advanced by the consumer
+	std::atomic<uint32_t> tail;     // Next entry to fill, advanced by the producer
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void InitInputQueue(InputQueue& queue);
+bool PushInput(InputQueue& queue, const QueuedInput& e);
+bool PopInput(InputQueue& queue, QueuedInput& e);
+uint32_t PendingInputs(const InputQueue& queue);
+uint64_t InputClockUs();
@@ -11,7 +11,22 @@
 //!  Camera:
 //!		Select camera to control: b
 //!		Select camera to view: v
+//!
+//!  Rendering:
+//!		i	= toggles instanced rendering of all turtles (when supported)
+//!		j	= switches the instancing shaders between GLSL 3.30 core and GLSL 1.20 (when both are supported)
+//!		c	= toggles frustum culling of turtles and parts outside the view
+//!		l	= toggles level of detail (distant turtles drawn as shell+wings, then as a box)
+//!		p	= toggles the profiler HUD (CPU stage and GPU frame times, input lag, heap allocations per frame)
+//!		o	= toggles sorting of the per-node draws (by material, then front to back)
+//!		n	= toggles keyframe animation of the uncontrolled turtles (wings flap, cannons sweep)
+//!		m	= toggles split screen (viewed camera on the left, the other two on the right)
+//!		k	= toggles baking of the unanimated subtrees into one mesh per turtle (without instancing)
+//!		h	= toggles the multithreaded CPU rasterizer in place of OpenGL (see soft_raster.h)
 //!	 
+//!  Turtle and subpart keys act while held: turtles fly at 15 units/s and turn at 90 degs/s,
+//!  subparts rotate at 90 degs/s (simulated in fixed 60 Hz ticks, whatever the key-repeat rate)
+//!
 //!  plane2 (turtle2):
 //!		s	= moves the plane2 forward
 //!		f	= moves the plane2 backward
@@ -30,6 +45,8 @@
 //!		Y	= rotates cannon base to the left (subpart)
 //!		u	= rotates cannon to the right (subsubpart)
 //!		U	= rotates cannon to the left (subsubpart)
+//!		g	= fires the cannon, 10 shells/s while held
+//!		G	= every turtle fires its cannon, 10 shells/s each while held
 //! 
 //!	 plane1 (turtle1):
 //!		S	= moves the plane1 forward
@@ -48,6 +65,20 @@
 //!                                 Press SHIFT (and hold) before left button to restrict to elevation control only)   
 //!   Hold right button and drag = controls distance
 //!
+//! Command line: [turtles] [-scene file] [-trace file] [-publish name] [-software] [-stream file]
+//!               [-record log | -replay log | -replay-timed log]
+//!   -scene         takes the turtles, their model and hierarchy from a scene file (see scene_file.h)
+//!   -publish       publishes every tick's poses in shared memory for other processes (see pose_share.h),
+//!                  e.g. -publish /asm3_poses
+//!   -trace         writes every frame's CPU scopes and GPU time as a Chrome trace (see frame_profiler.h)
+//!   -software      starts with the CPU rasterizer instead of OpenGL
+//!   -stream        writes every CPU-rasterized frame to a file or named pipe as a binary PPM,
+//!                  e.g. to a fifo read by ffmpeg -f image2pipe
+//!   -record        writes every key and mouse event to an input log (see input_log.h)
+//!   -replay        replays a log headless, as fast as possible, and exits with 1 if the
+//!                  final poses differ from the recorded ones
+//!   -replay-timed  replays a log in the window at the recorded timing (live input is ignored)
+//!
 //! TODO: Extend the code to satisfy the requirements given in the assignment handout
 //!
 //! Note: Good programmer uses good comments! :)
@@ -58,166 +89,149 @@
 //| Includes
 //|___________________
 
+#include <ctype.h>
 #include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
 
 #include <gmtl/gmtl.h>
 
 #include <GL/glut.h>
+#include <GL/freeglut_ext.h>            // glutGetProcAddress
+
+#include "alloc_counter.h"
+#include "frame_profiler.h"
+#include "gl_ext.h"
+#include "input_log.h"
+#include "input_queue.h"
+#include "turtle_control.h"
+#include "turtle_scene.h"
 
 //|___________________
 //|
 //| Constants
 //|___________________
 
-// preset colours
-float colour_brown[3] = { 0.45f, 0.32f, 0.22f };
-float colour_lime_green[3] = { 0.10f, 0.35f, 0.47f };
-float colour_light_lime_green[3] = { 0.20f, 0.45f, 0.57f };
-float colour_dark_gray[3] = { 0.25f, 0.25f, 0.25f };
-float colour_darker_gray[3] = { 0.17f, 0.17f, 0.17f };
-float colour_light_pink[3] = { 0.87f, 0.66f, 0.66f };
-
-// Plane dimensions
-const float P_WIDTH = 3;
-const float P_LENGTH = 3;
-const float P_HEIGHT = 1.5f;
-
-// Plane transforms
-const gmtl::Vec3f PLANE_FORWARD(0, 0, 1.0f);            // Plane's forward translation vector (w.r.t. local frame)
-const float PLANE_ROTATION = 5.0f;                      // Plane rotated by 5 degs per input
-
-// Propeller dimensions (subpart)
-const float WING_WIDTH = 3.5;
-const float WING_WIDTH_SMALL = 2.0;
-const float WING_LENGTH = 1.5f;
-const float WING_HEIGHT = 0.7f;
-
-// Propeller transforms
-const gmtl::Point3f WING_POS(P_WIDTH*3/4, -P_HEIGHT*0.5, P_LENGTH/2.5);     // Propeller position on the plane (w.r.t. plane's frame)
-const float DELTA_ROTATION = 5.0f;                  // Propeller rotated by 5 degs per input
-
-// Camera's view frustum 
-const float CAM_FOV = 90.0f;                     // Field of view in degs
-
 // Keyboard modifiers
 enum KeyModifier { KM_SHIFT = 0, KM_CTRL, KM_ALT };
 
+// Profiler HUD
+const int HUD_LINE_HEIGHT = 15;         // Pixels, for GLUT_BITMAP_9_BY_15
+const int HUD_INDENT = 18;              // Pixels per nesting level
+
+// Input replay (see input_log.h)
+enum ReplayMode {
+	REPLAY_NONE = 0,
+	REPLAY_FAST,            // Headless, every tick and event back to back
+	REPLAY_TIMED            // In the window, at the recorded timing
+};
+
 //|___________________
 //|
 //| Global Variables
 //|___________________
 
-// Track window dimensions, initialized to 800x600
-int w_width = 800;
-int w_height = 600;
-
-// Plane pose (position-quaternion pair)
-gmtl::Point4f turtle_p2;      // Position for plane 2 (using explicit homogeneous form; see Quaternion example code)
-gmtl::Quatf plane_q2;        // Quaternion for plane 2
-
-gmtl::Point4f turtle_p1;      // Position for plane 1 (using explicit homogeneous form; see Quaternion example code)
-gmtl::Quatf plane_q1;        // Quaternion for plane 1
-
-// Quaternions to rotate plane
-gmtl::Quatf zrotp_q;        // Positive and negative Z rotations
-gmtl::Quatf zrotn_q;
-
-gmtl::Quatf xrotp_q;        // Positive and negative X rotations
-gmtl::Quatf xrotn_q;
-
-gmtl::Quatf yrotp_q;
-gmtl::Quatf yrotn_q;
-
-// Propeller rotation (subpart)
-float wing_angle_right = 0;         // Rotation angle
-float wing_angle_left = 0;	// Rotation angle for the left propeller (new)
-float cannon_angle_top = 0;	// top propeller
-float cannon_angle_subsubpart = 0; // subsub part propeller
-
 // Mouse & keyboard
 int mx_prev = 0, my_prev = 0;
 bool mbuttons[3] = { false, false, false };
 bool kmodifiers[3] = { false, false, false };
 
-// Cameras
-int cam_id = 0;                                // Selects which camera to view
-int camctrl_id = 0;                                // Selects which camera to control
-float distance[3] = { 20.0f,  20.0f,  20.0f };                 // Distance of the camera from world's origin.
-float elevation[3] = { -45.0f, -45.0f, -45.0f };                 // Elevation of the camera. (in degs)
-float azimuth[3] = { 15.0f,  15.0f,  15.0f };                 // Azimuth of the camera. (in degs)
+// Input queue: the callbacks push, each frame applies (see input_queue.h)
+InputQueue input_queue;
+int motion_azimuth[3] = { 0, 0, 0 };    // Mouse motion not applied yet, per camera
+int motion_elevation[3] = { 0, 0, 0 };
+int motion_distance[3] = { 0, 0, 0 };
+uint64_t frame_input_us = 0;            // Arrival of the oldest event the frame applied, 0 if none
+float input_lag_ms = 0;                 // Smoothed time from that arrival to the swap
+
+// Profiler HUD (see frame_profiler.h)
+bool show_hud = false;
+uint64_t frame_heap_allocations = 0;    // C++ heap allocations of the last frame (see alloc_counter.h)
+uint64_t frame_start_allocations = 0;   // HeapAllocationCount() when the current frame began
+
+// Frames of the CPU rasterizer written out as they are drawn (see soft_raster.h)
+FILE* stream_file = NULL;
+
+// Fixed-timestep animation (see turtle_control.h)
+bool animating = false;                 // Idle callback registered
+int last_update_ms = 0;                 // GLUT time of the last AdvanceControl()
+
+// Input recording and replay (see input_log.h)
+int record_start_ms = 0;                // GLUT time the recording started
+ReplayMode replay_mode = REPLAY_NONE;
+std::vector<InputEvent> replay_events;
+size_t replay_next = 0;                 // Next event to feed to the handlers
+int replay_start_ms = 0;                // GLUT time the timed replay started
+int replay_update_ms = 0;               // GLUT time of the last ReplayIdleFunc()
+float replay_sim_time = 0;              // Time not yet simulated by the timed replay
 
 //|___________________
 //|
 //| Function Prototypes
 //|___________________
 
-void InitTransforms();
 void InitGL(void);
 void DisplayFunc(void);
 void KeyboardFunc(unsigned char key, int x, int y);
+void KeyboardUpFunc(unsigned char key, int x, int y);
+void IdleFunc(void);
+void StartAnimation(void);
 void MouseFunc(int button, int state, int x, int y);
 void MotionFunc(int x, int y);
+void QueueInput(InputEventType type, int code, int state, int modifiers, int x, int y);
+void ApplyInputQueue(void);
+void ApplyKeyDown(unsigned char key, int x, int y);
+void ApplyKeyUp(unsigned char key, int x, int y);
+void ApplyMouse(int button, int state, int modifiers, int x, int y);
+void AccumulateMotion(int x, int y);
+void ApplyCameraMotion(void);
+void UpdateAnimation(void);
 void ReshapeFunc(int w, int h);
-void drawCube(const float width, const float length, const float height, const float colours[3]);
-void DrawCoordinateFrame(const float l);
-void DrawTurtleShell(const float width, const float length, const float height);
-void DrawWing(const float width, const float length, const float height, const bool isInverted);
-void DrawCannon(const float width, const float length, const float height, const bool isInverted);
+GLProc GetProcAddressGLUT(const char* name);
+void PostRedisplay(void);
+void RecordInput(InputEventType type, int code, int state, int modifiers, int x, int y);
+void FeedInput(const InputEvent& e);
+void FeedInputsUpTo(unsigned int tick);
+int ReplayFast(const char* path);
+void ReplayIdleFunc(void);
+void PrintFinalState(const char* mode, double ms);
+void DrawProfileHud(void);
 
 
 //|____________________________________________________________________
 //|
-//| Function: InitTransforms
+//| Function: InitGL
 //|
 //! \param None.
 //! \return None.
 //!
-//! Initializes all the transforms
+//! OpenGL initializations
 //|____________________________________________________________________
 
-void InitTransforms()
+void InitGL(void)
 {
-	const float COSTHETA_D2 = cos(gmtl::Math::deg2Rad(PLANE_ROTATION / 2));  // cos() and sin() expect radians 
-	const float SINTHETA_D2 = sin(gmtl::Math::deg2Rad(PLANE_ROTATION / 2));
-
-	// Inits plane 2 pose
-	turtle_p2.set(3.0f, -5.0f, 4.0f, 1.0f);
-	plane_q2.set(0, 0, 0, 1);
-
-	// Inits plane 1 pose
-	turtle_p1.set(-3.0f, 5.0f, 4.0f, 1.0f);
-	plane_q1.set(0, 0, 0, 1);
-
-	// Z rotations (roll)
-	zrotp_q.set(0, 0, SINTHETA_D2, COSTHETA_D2);      // +Z
-	zrotn_q = gmtl::makeConj(zrotp_q);                // -Z
-
-	// X rotation (pitch)
-	xrotp_q.set(SINTHETA_D2, 0, 0, COSTHETA_D2);      // +X
-	xrotn_q = gmtl::makeConj(xrotp_q);                // -X
-
-	// Y rotation (yaw)
-	yrotp_q.set(0, SINTHETA_D2, 0, COSTHETA_D2);      // +Y
-	yrotn_q = gmtl::makeConj(yrotp_q);                // -Y
-
-	// TODO: Initializes the remaining transforms
+	InitSceneGL(GetProcAddressGLUT);
+	InitSceneSoftware(0);
+	InitProfilerGL();
 }
 
 //|____________________________________________________________________
 //|
-//| Function: InitGL
+//| Function: GetProcAddressGLUT
 //|
-//! \param None.
-//! \return None.
+//! \param name   [in] GL function name.
+//! \return Function address, or null if unsupported.
 //!
-//! OpenGL initializations
+//! Adapts glutGetProcAddress() to the loader signature of gl_ext.h.
 //|____________________________________________________________________
 
-void InitGL(void)
+GLProc GetProcAddressGLUT(const char* name)
 {
-	glClearColor(0.7f, 0.7f, 0.7f, 1.0f);
-	glEnable(GL_DEPTH_TEST);
-	glShadeModel(GL_SMOOTH);
+	return (GLProc)glutGetProcAddress(name);
 }
 
 //|____________________________________________________________________
@@ -228,280 +242,297 @@ void InitGL(void)
 //! \return None.
 //!
 //! GLUT display callback function: called for every redraw event.
+//! A frame applies the input queued since the last one, runs the
+//! simulation ticks due, then draws.
 //|____________________________________________________________________
 
 void DisplayFunc(void)
 {
-	gmtl::AxisAnglef aa;    // Converts plane's quaternion to axis-angle form to be used by glRotatef()
-	gmtl::Vec3f axis;       // Axis component of axis-angle representation
-	float angle;            // Angle component of axis-angle representation
+	BeginProfileFrame();
+	uint64_t allocations = HeapAllocationCount();
+	if (frame_arenas.frame > 0) {
+		frame_heap_allocations = allocations - frame_start_allocations;
+	}
+	BeginArenaFrame(frame_arenas);
+	frame_start_allocations = HeapAllocationCount();          // After the arena reset's own growth
+
+	BeginProfileScope("input");
+	ApplyInputQueue();
+	EndProfileScope();
+
+	if (animating) {
+		BeginProfileScope("simulation");
+		UpdateAnimation();
+		EndProfileScope();
+	}
+
+	RenderScene();
+	if (use_software) {
+		BeginProfileScope("present");
+		PresentSoftFrame();
+		if (stream_file && !WriteSoftFramebufferPPM(soft_raster.framebuffer, stream_file)) {
+			printf("Frame stream closed\n");
+			fclose(stream_file);
+			stream_file = NULL;
+		}
+		EndProfileScope();
+	}
+	if (show_hud) {
+		BeginProfileScope("hud");
+		DrawProfileHud();
+		EndProfileScope();
+	}
+	EndProfileGpu();
+
+	BeginProfileScope("swap");
+	glutSwapBuffers();                          // Replaces glFlush() to use double buffering
+	EndProfileScope();
+
+	EndProfileFrame();
+
+	// Lag of the input this frame shows, measured once it is on screen
+	if (frame_input_us) {
+		float lag_ms = (InputClockUs() - frame_input_us) / 1000.0f;
+		input_lag_ms += (lag_ms - input_lag_ms) * PROFILE_SMOOTHING;
+		frame_input_us = 0;
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: DrawProfileHud
+//|
+//! \param None.
+//! \return None.
+//!
+//! Draws the smoothed times of the last profiled frame in the top-left
+//! corner: the frame, the GPU, the input lag, the heap allocations and
+//! arena bytes of the frame and each CPU scope indented by nesting.
+//|____________________________________________________________________
 
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+void DrawProfileHud(void)
+{
+	const ProfileFrame& f = LastProfileFrame();
+	char line[96];
+	int y = w_height - HUD_LINE_HEIGHT;
 
 	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
 	glLoadIdentity();
-	gluPerspective(CAM_FOV, (float)w_width / w_height, 0.1f, 1000.0f);     // Check MSDN: google "gluPerspective msdn"
-
+	gluOrtho2D(0, w_width, 0, w_height);
 	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
 	glLoadIdentity();
+	glDisable(GL_DEPTH_TEST);
+	glColor3f(0.0f, 0.0f, 0.0f);
 
-	//|____________________________________________________________________
-	//|
-	//| Setting up view transform by:
-	//| "move up to the world frame by composing all of the (inverse) transforms from the camera up to the world node"
-	//|____________________________________________________________________
-
-	switch (cam_id) {
-	case 0:
-		// For the world-relative camera
-		glTranslatef(0, 0, -distance[0]);
-		glRotatef(-elevation[0], 1, 0, 0);
-		glRotatef(-azimuth[0], 0, 1, 0);
-		break;
-
-	case 1:
-		// For plane1's camera
-		glTranslatef(0, 0, -distance[1]);
-		glRotatef(-elevation[1], 1, 0, 0);
-		glRotatef(-azimuth[1], 0, 1, 0);
-
-		gmtl::set(aa, plane_q1);                    // Converts plane's quaternion to axis-angle form to be used by glRotatef()
-		axis = aa.getAxis();
-		angle = aa.getAngle();
-		glRotatef(-gmtl::Math::rad2Deg(angle), axis[0], axis[1], axis[2]);
-		glTranslatef(-turtle_p1[0], -turtle_p1[1], -turtle_p1[2]);
-		break;
+	if (f.gpu_ms >= 0) {
+		snprintf(line, sizeof(line), "frame %7.3f ms   gpu %7.3f ms", f.average_ms, f.gpu_ms);
+	}
+	else {
+		snprintf(line, sizeof(line), "frame %7.3f ms   gpu n/a", f.average_ms);
+	}
+	glRasterPos2i(4, y);
+	glutBitmapString(GLUT_BITMAP_9_BY_15, (const unsigned char*)line);
+
+	y -= HUD_LINE_HEIGHT;
+	snprintf(line, sizeof(line), "input lag %7.3f ms", input_lag_ms);
+	glRasterPos2i(4, y);
+	glutBitmapString(GLUT_BITMAP_9_BY_15, (const unsigned char*)line);
+
+	y -= HUD_LINE_HEIGHT;
+	snprintf(line, sizeof(line), "heap allocs %llu   arena %zu KB", (unsigned long long)frame_heap_allocations,
+	         frame_arenas.arena_bytes / 1024);
+	glRasterPos2i(4, y);
+	glutBitmapString(GLUT_BITMAP_9_BY_15, (const unsigned char*)line);
+
+	if (use_software) {
+		y -= HUD_LINE_HEIGHT;
+		snprintf(line, sizeof(line), "cpu raster %d threads   %d tris   %d tile refs", WorkerCount(soft_raster.pool),
+		         soft_raster.stats.triangles, soft_raster.stats.tile_refs);
+		glRasterPos2i(4, y);
+		glutBitmapString(GLUT_BITMAP_9_BY_15, (const unsigned char*)line);
+	}
 
-		// TODO: Add case for the plane1's camera
-	case 2:
-		// For plane2's camera
-		glTranslatef(0, 0, -distance[2]);
-		glRotatef(-elevation[2], 1, 0, 0);
-		glRotatef(-azimuth[2], 0, 1, 0);
-
-		gmtl::set(aa, plane_q2);                    // Converts plane's quaternion to axis-angle form to be used by glRotatef()
-		axis = aa.getAxis();
-		angle = aa.getAngle();
-		glRotatef(-gmtl::Math::rad2Deg(angle), axis[0], axis[1], axis[2]);
-		glTranslatef(-turtle_p2[0], -turtle_p2[1], -turtle_p2[2]);
-		break;
+	for (int i = 0; i < f.scope_count; i++) {
+		y -= HUD_LINE_HEIGHT;
+		snprintf(line, sizeof(line), "%-20s %7.3f ms", f.scopes[i].name, f.scopes[i].average_ms);
+		glRasterPos2i(4 + HUD_INDENT * f.scopes[i].depth, y);
+		glutBitmapString(GLUT_BITMAP_9_BY_15, (const unsigned char*)line);
 	}
 
-	//|____________________________________________________________________
-	//|
-	//| Draw traversal begins, start from world (root) node
-	//|____________________________________________________________________
+	glEnable(GL_DEPTH_TEST);
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: KeyboardFunc
+//|
+//! \param key    [in] Key code.
+//! \param x      [in] X-coordinate of mouse when key is pressed.
+//! \param y      [in] Y-coordinate of mouse when key is pressed.
+//! \return None.
+//!
+//! GLUT keyboard callback function: called for every key press event.
+//! Queues the key for the next frame (see ApplyKeyDown).
+//|____________________________________________________________________
+
+void KeyboardFunc(unsigned char key, int x, int y)
+{
+	QueueInput(INPUT_KEY_DOWN, key, 0, 0, x, y);
+	PostRedisplay();                        // Asks GLUT to redraw the screen
+}
+
+//|____________________________________________________________________
+//|
+//| Function: KeyboardUpFunc
+//|
+//! \param key    [in] Key code.
+//! \param x      [in] X-coordinate of mouse when key is released.
+//! \param y      [in] Y-coordinate of mouse when key is released.
+//! \return None.
+//!
+//! GLUT keyboard-up callback function: called for every key release event.
+//|____________________________________________________________________
+
+void KeyboardUpFunc(unsigned char key, int x, int y)
+{
+	QueueInput(INPUT_KEY_UP, key, 0, 0, x, y);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: MouseFunc
+//|
+//! \param button     [in] one of GLUT_LEFT_BUTTON, GLUT_MIDDLE_BUTTON, or GLUT_RIGHT_BUTTON.
+//! \param state      [in] one of GLUT_UP (event is due to release) or GLUT_DOWN (press).
+//! \param x          [in] X-coordinate of mouse when an event occured.
+//! \param y          [in] Y-coordinate of mouse when an event occured.
+//! \return None.
+//!
+//! GLUT mouse-callback function: called for each mouse click. The
+//! modifiers can only be read here, so they are queued with the click.
+//|____________________________________________________________________
+
+void MouseFunc(int button, int state, int x, int y)
+{
+	QueueInput(INPUT_MOUSE, button, state, glutGetModifiers(), x, y);
+	PostRedisplay();                        // Applies the buttons before the drag's motion
+}
+
+//|____________________________________________________________________
+//|
+//| Function: MotionFunc
+//|
+//! \param x      [in] X-coordinate of mouse when an event occured.
+//! \param y      [in] Y-coordinate of mouse when an event occured.
+//! \return None.
+//!
+//! GLUT motion-callback function: called for each mouse motion. Every
+//! event is queued; the next frame applies their sum once.
+//|____________________________________________________________________
 
-	// World node: draws world coordinate frame
-	DrawCoordinateFrame(10);
+void MotionFunc(int x, int y)
+{
+	QueueInput(INPUT_MOTION, 0, 0, 0, x, y);
 
-	// World-relative camera:
-	if (cam_id != 0) {
-		glPushMatrix();
-			glRotatef(azimuth[0], 0, 1, 0);
-			glRotatef(elevation[0], 1, 0, 0);
-			glTranslatef(0, 0, distance[0]);
-			DrawCoordinateFrame(1);
-		glPopMatrix();
+	if (mbuttons[GLUT_LEFT_BUTTON] || mbuttons[GLUT_RIGHT_BUTTON]) {
+		PostRedisplay();          // Asks GLUT to redraw the screen
 	}
+}
 
-	// Turtle 2 body:
-	glPushMatrix();
-		gmtl::set(aa, plane_q2);                    // Converts plane's quaternion to axis-angle form to be used by glRotatef()
-		axis = aa.getAxis();
-		angle = aa.getAngle();
-		glTranslatef(turtle_p2[0], turtle_p2[1], turtle_p2[2]);
-		glRotatef(gmtl::Math::rad2Deg(angle), axis[0], axis[1], axis[2]);
-		DrawTurtleShell(P_WIDTH*1.5, P_LENGTH*1.5, P_HEIGHT*2); // turtle plane base
-		DrawCoordinateFrame(3);
-
-		// Turtle 2's camera:
-		if (cam_id != 2) {
-			glPushMatrix();
-				glRotatef(azimuth[2], 0, 1, 0);
-				glRotatef(elevation[2], 1, 0, 0);
-				glTranslatef(0, 0, distance[2]);
-				DrawCoordinateFrame(1);
-			glPopMatrix();
-		}
+//|____________________________________________________________________
+//|
+//| Function: QueueInput
+//|
+//! \param type       [in] Event type.
+//! \param code       [in] Key or mouse button.
+//! \param state      [in] Mouse button state.
+//! \param modifiers  [in] Keyboard modifiers of a mouse event.
+//! \param x, y       [in] Mouse position.
+//! \return None.
+//!
+//! Pushes an event with its arrival time. The callbacks run on the
+//! frame's thread, so a full queue is applied on the spot to make room:
+//! no event is ever dropped.
+//|____________________________________________________________________
 
-		//// head
-		glPushMatrix();
-			glTranslatef(0, -0.1f * P_HEIGHT, 0.7f * P_LENGTH);
-			drawCube(0.7f * P_WIDTH, 0.7f * P_LENGTH, 0.85f * P_HEIGHT, colour_lime_green);
-			
-			// left eye
-			glPushMatrix();
-				glTranslatef(-0.8f, -0.20f, 1.15f);
-				drawCube(0.11f * P_WIDTH, 0.06f * P_LENGTH, 0.11f * P_HEIGHT, colour_darker_gray);
-			glPopMatrix();
-
-			// right eye
-			glPushMatrix();
-				glTranslatef(0.8f, -0.20f, 1.15f);
-				drawCube(0.11f * P_WIDTH, 0.06f * P_LENGTH, 0.11f * P_HEIGHT, colour_darker_gray);
-			glPopMatrix();
-			
-		glPopMatrix();
-
-		// Right front wing (subpart A):
-		glPushMatrix();
-			glTranslatef(WING_POS[0], WING_POS[1], WING_POS[2]);     // Positions propeller on the plane
-			glRotatef(wing_angle_right, 0, 0, 1);                    // Rotates propeller
-			DrawWing(WING_WIDTH, WING_LENGTH, WING_HEIGHT, true);
-			DrawCoordinateFrame(1);
-		glPopMatrix();
-
-		// Left front wing (subpart B):
-		glPushMatrix();
-			glTranslatef(-WING_POS[0], WING_POS[1], WING_POS[2]);     // Positions propeller on the plane
-			glRotatef(wing_angle_left, 0, 0, 1);                      // Rotates propeller
-			DrawWing(WING_WIDTH, WING_LENGTH, WING_HEIGHT, false);
-			DrawCoordinateFrame(1);
-		glPopMatrix();
-
-		// Right back wing (subpart A):
-		glPushMatrix();
-			glTranslatef(WING_POS[0], WING_POS[1], -WING_POS[2]);     // Positions propeller on the plane
-			glRotatef(wing_angle_right, 0, 0, 1);                     // Rotates propeller
-			DrawWing(WING_WIDTH_SMALL, WING_LENGTH, WING_HEIGHT, true);
-			DrawCoordinateFrame(1);
-		glPopMatrix();
-
-		// Left back wing (subpart B):
-		glPushMatrix();
-			glTranslatef(-WING_POS[0], WING_POS[1], -WING_POS[2]);     // Positions propeller on the plane
-			glRotatef(wing_angle_left, 0, 0, 1);                      // Rotates propeller
-			DrawWing(WING_WIDTH_SMALL, WING_LENGTH, WING_HEIGHT, false);
-			DrawCoordinateFrame(1);
-		glPopMatrix();
-
-		// Cannon base (subpart C):
-		glPushMatrix();
-			glTranslatef(0, P_HEIGHT, 0);     // Positions propeller on the plane
-			glRotatef(cannon_angle_top, 0, 1, 0);         // Rotates propeller   
-			drawCube(P_WIDTH, P_LENGTH, P_HEIGHT, colour_dark_gray);
-			DrawCoordinateFrame(1);
-
-			// Cannon (subpart C):
-			glPushMatrix();
-				glTranslatef(0, WING_LENGTH, 0);     // Positions propeller at the top
-				glRotatef(cannon_angle_subsubpart, 0, 1, 0);         // Rotates propeller   
-				glRotatef(-90, 1, 0, 0);         // Rotates propeller   
-				DrawCannon(WING_WIDTH, WING_LENGTH, WING_HEIGHT, true);
-				DrawCoordinateFrame(1);
-			glPopMatrix();
-		glPopMatrix();
-	glPopMatrix();
+void QueueInput(InputEventType type, int code, int state, int modifiers, int x, int y)
+{
+	QueuedInput e;
+	e.time_us = InputClockUs();
+	e.type = (uint8_t)type;
+	e.code = (uint8_t)code;
+	e.state = (uint8_t)state;
+	e.modifiers = (uint8_t)modifiers;
+	e.x = x;
+	e.y = y;
+
+	if (!PushInput(input_queue, e)) {
+		ApplyInputQueue();
+		PushInput(input_queue, e);
+	}
+}
 
-	/////////////////////////////////////////////////////////////////////////
+//|____________________________________________________________________
+//|
+//| Function: ApplyInputQueue
+//|
+//! \param None.
+//! \return None.
+//!
+//! Applies every queued event in arrival order, then the camera motion
+//! they add up to in one update.
+//|____________________________________________________________________
 
-	// Turtle 1 body:
-	glPushMatrix();
-		// cam
-		gmtl::set(aa, plane_q1); // Converts plane's quaternion to axis-angle form to be used by glRotatef()
-		axis = aa.getAxis();
-		angle = aa.getAngle();
-		glTranslatef(turtle_p1[0], turtle_p1[1], turtle_p1[2]);
-		glRotatef(gmtl::Math::rad2Deg(angle), axis[0], axis[1], axis[2]);
-		DrawTurtleShell(P_WIDTH*1.5, P_LENGTH*1.5, P_HEIGHT*2);
-		DrawCoordinateFrame(3);
-
-		// Turtle 1's camera:
-		if (cam_id != 1) {
-			glPushMatrix();
-				glRotatef(azimuth[1], 0, 1, 0);
-				glRotatef(elevation[1], 1, 0, 0);
-				glTranslatef(0, 0, distance[1]);
-				DrawCoordinateFrame(1);
-			glPopMatrix();
+void ApplyInputQueue(void)
+{
+	QueuedInput e;
+	while (PopInput(input_queue, e)) {
+		if (!frame_input_us) {
+			frame_input_us = e.time_us;
 		}
 
-		//// head
-		glPushMatrix();
-			glTranslatef(0, -0.1f * P_HEIGHT, 0.7f * P_LENGTH);
-			drawCube(0.7f * P_WIDTH, 0.7f * P_LENGTH, 0.85f * P_HEIGHT, colour_lime_green);
-			
-			// left eye
-			glPushMatrix();
-				glTranslatef(-0.8f, -0.20f, 1.15f);
-				drawCube(0.11f * P_WIDTH, 0.06f * P_LENGTH, 0.11f * P_HEIGHT, colour_darker_gray);
-			glPopMatrix();
-
-			// right eye
-			glPushMatrix();
-				glTranslatef(0.8f, -0.20f, 1.15f);
-				drawCube(0.11f * P_WIDTH, 0.06f * P_LENGTH, 0.11f * P_HEIGHT, colour_darker_gray);
-			glPopMatrix();
-		glPopMatrix();
-
-		// Right front wing (subpart A):
-		glPushMatrix();
-			glTranslatef(WING_POS[0], WING_POS[1], WING_POS[2]);     // Positions propeller on the plane
-			glRotatef(-30, 0, 0, 1);                                           // Rotates propeller
-			DrawWing(WING_WIDTH, WING_LENGTH, WING_HEIGHT, true);
-			DrawCoordinateFrame(1);
-		glPopMatrix();
-
-		// Left front wing (subpart B):
-		glPushMatrix();
-			glTranslatef(-WING_POS[0], WING_POS[1], WING_POS[2]);     // Positions propeller on the plane
-			glRotatef(30, 0, 0, 1);                      // Rotates propeller
-			DrawWing(WING_WIDTH, WING_LENGTH, WING_HEIGHT, false);
-			DrawCoordinateFrame(1);
-		glPopMatrix();
-
-		// Right back wing (subpart A):
-		glPushMatrix();
-			glTranslatef(WING_POS[0], WING_POS[1], -WING_POS[2]);     // Positions propeller on the plane
-			glRotatef(-30, 0, 0, 1);                                           // Rotates propeller
-			DrawWing(WING_WIDTH_SMALL, WING_LENGTH, WING_HEIGHT, true);
-			DrawCoordinateFrame(1);
-		glPopMatrix();
-
-		// Left back wing (subpart B):
-		glPushMatrix();
-			glTranslatef(-WING_POS[0], WING_POS[1], -WING_POS[2]);     // Positions propeller on the plane
-			glRotatef(30, 0, 0, 1);                      // Rotates propeller
-			DrawWing(WING_WIDTH_SMALL, WING_LENGTH, WING_HEIGHT, false);
-			DrawCoordinateFrame(1);
-		glPopMatrix();
-
-		// Cannon base (subpart C):
-		glPushMatrix();
-			glTranslatef(0, P_HEIGHT, 0);     // Positions propeller on the plane
-			glRotatef(45, 0, 1, 0);         // Rotates propeller   
-			drawCube(P_WIDTH, P_LENGTH, P_HEIGHT, colour_dark_gray);
-			DrawCoordinateFrame(1);
-
-			// Cannon (subpart C):
-			glPushMatrix();
-				glTranslatef(0, WING_LENGTH, 0);     // Positions propeller at the top
-				glRotatef(-70, 0, 1, 0);         // Rotates propeller   
-				glRotatef(-90, 1, 0, 0);         // Rotates propeller   
-				DrawCannon(WING_WIDTH, WING_LENGTH, WING_HEIGHT, true);
-				DrawCoordinateFrame(1);
-			glPopMatrix();
-		glPopMatrix();
-	glPopMatrix();
+		switch (e.type) {
+		case INPUT_KEY_DOWN:
+			ApplyKeyDown(e.code, e.x, e.y);
+			break;
+		case INPUT_KEY_UP:
+			ApplyKeyUp(e.code, e.x, e.y);
+			break;
+		case INPUT_MOUSE:
+			ApplyMouse(e.code, e.state, e.modifiers, e.x, e.y);
+			break;
+		case INPUT_MOTION:
+			AccumulateMotion(e.x, e.y);
+			break;
+		}
+	}
 
-	glutSwapBuffers();                          // Replaces glFlush() to use double buffering
+	ApplyCameraMotion();
 }
 
 //|____________________________________________________________________
 //|
-//| Function: KeyboardFunc
+//| Function: ApplyKeyDown
 //|
 //! \param key    [in] Key code.
 //! \param x      [in] X-coordinate of mouse when key is pressed.
 //! \param y      [in] Y-coordinate of mouse when key is pressed.
 //! \return None.
 //!
-//! GLUT keyboard callback function: called for every key press event.
+//! Acts on a key press. Turtle and subpart keys only start being held;
+//! motion happens in fixed ticks while they stay down (see UpdateAnimation).
 //|____________________________________________________________________
 
-void KeyboardFunc(unsigned char key, int x, int y)
+void ApplyKeyDown(unsigned char key, int x, int y)
 {
+	RecordInput(INPUT_KEY_DOWN, key, 0, 0, x, y);
+
 	switch (key) {
 		//|____________________________________________________________________
 		//|
@@ -517,137 +548,162 @@ void KeyboardFunc(unsigned char key, int x, int y)
 		printf("Control camera = %d\n", camctrl_id);
 		break;
 
-		//|____________________________________________________________________
-		//|
-		//| Turtle 2 controls
-		//|____________________________________________________________________
-
-	case 's': { // Forward translation of the plane (+Z translation)  
-		gmtl::Quatf v_q = plane_q2 * gmtl::Quatf(PLANE_FORWARD[0], PLANE_FORWARD[1], PLANE_FORWARD[2], 0) * gmtl::makeConj(plane_q2);
-		turtle_p2 = turtle_p2 + v_q.mData;
-	} break;
-	case 'f': { // Backward translation of the plane (-Z translation)
-		gmtl::Quatf v_q = plane_q2 * gmtl::Quatf(-PLANE_FORWARD[0], -PLANE_FORWARD[1], -PLANE_FORWARD[2], 0) * gmtl::makeConj(plane_q2);
-		turtle_p2 = turtle_p2 + v_q.mData;
-	} break;
-
-	case 'e': // Rolls the plane (+Z rot)
-		plane_q2 = plane_q2 * zrotp_q;
+	case 'i': // Toggle instanced rendering
+		use_instancing = !use_instancing && instancing_supported;
+		printf("Instanced rendering %s\n", use_instancing ? "on" : "off");
 		break;
-	case 'q': // Rolls the plane (-Z rot)
-		plane_q2 = plane_q2 * zrotn_q;
+	case 'j': // Switch the instancing shaders
+		if (IsInstancingPathSupported(INSTANCING_GLSL120) && IsInstancingPathSupported(INSTANCING_GLSL330_CORE)) {
+			instancing_path = instancing_path == INSTANCING_GLSL120 ? INSTANCING_GLSL330_CORE : INSTANCING_GLSL120;
+		}
+		printf("Instancing shaders: %s\n", instancing_path == INSTANCING_GLSL330_CORE ? "GLSL 3.30 core" : "GLSL 1.20");
 		break;
-
-	case 'x': // Pitches the plane (+X rot)
-		plane_q2 = plane_q2 * xrotp_q;
+	case 'c': // Toggle frustum culling
+		use_culling = !use_culling;
+		printf("Frustum culling %s (last frame: %d turtles, %d nodes in view)\n",
+			use_culling ? "on" : "off", cull_stats.turtles_visible, cull_stats.nodes_visible);
 		break;
-	case 'w': // Pitches the plane (-X rot)
-		plane_q2 = plane_q2 * xrotn_q;
+	case 'l': // Toggle level of detail
+		use_lod = !use_lod;
+		printf("Level of detail %s (last frame: %d full, %d shell, %d box)\n", use_lod ? "on" : "off",
+			lod_stats.turtles[LOD_FULL], lod_stats.turtles[LOD_SHELL], lod_stats.turtles[LOD_BOX]);
 		break;
-
-	case 'a': // Yaws the plane (+Y rot)
-		plane_q2 = plane_q2 * yrotp_q;
+	case 'o': // Toggle draw sorting
+		use_sorting = !use_sorting;
+		printf("Draw sorting %s\n", use_sorting ? "on" : "off");
 		break;
-	case 'd': // Yaws the plane (-Y rot)
-		plane_q2 = plane_q2 * yrotn_q;
+	case 'k': // Toggle baking of the static subtrees
+		use_baking = !use_baking;
+		printf("Subtree baking %s (last frame: %d turtles baked, %d meshes, %d draws)\n", use_baking ? "on" : "off",
+			bake_stats.turtles_baked, bake_stats.meshes, queued_draws);
+		break;
+	case 'n': // Toggle keyframe animation
+		use_animation = !use_animation;
+		if (use_animation) {
+			StartAnimation();
+		}
+		printf("Keyframe animation %s\n", use_animation ? "on" : "off");
+		break;
+	case 'h': // Toggle the CPU rasterizer
+		use_software = !use_software;
+		printf("Rendering with %s\n", use_software ? "the CPU rasterizer" : "OpenGL");
+		break;
+	case 'm': // Toggle split screen
+		split_screen = !split_screen;
+		printf("Split screen %s\n", split_screen ? "on" : "off");
+		break;
+	case 'p': // Toggle profiler HUD
+		show_hud = !show_hud;
+		SetProfiling(show_hud || IsProfileTracing());
 		break;
-
 
 		//|____________________________________________________________________
 		//|
-		//| Turtle 1 controls
+		//| Turtle and subpart controls: held until the key is released
 		//|____________________________________________________________________
 
-	case 'S': { // Forward translation of the plane (+Z translation)  
-		gmtl::Quatf v_q = plane_q1 * gmtl::Quatf(PLANE_FORWARD[0], PLANE_FORWARD[1], PLANE_FORWARD[2], 0) * gmtl::makeConj(plane_q1);
-		turtle_p1 = turtle_p1 + v_q.mData;
-	} break;
-	case 'F': { // Backward translation of the plane (-Z translation)
-		gmtl::Quatf v_q = plane_q1 * gmtl::Quatf(-PLANE_FORWARD[0], -PLANE_FORWARD[1], -PLANE_FORWARD[2], 0) * gmtl::makeConj(plane_q1);
-		turtle_p1 = turtle_p1 + v_q.mData;
-	} break;
-
-	case 'E': // Rolls the plane (+Z rot)
-		plane_q1 = plane_q1 * zrotp_q;
-		break;
-	case 'Q': // Rolls the plane (-Z rot)
-		plane_q1 = plane_q1 * zrotn_q;
+	default:
+		if (IsControlKey(key)) {
+			SetKeyHeld(key, true);
+			StartAnimation();
+		}
 		break;
+	}
+}
 
-	case 'X': // Pitches the plane (+X rot)
-		plane_q1 = plane_q1 * xrotp_q;
-		break;
-	case 'W': // Pitches the plane (-X rot)
-		plane_q1 = plane_q1 * xrotn_q;
-		break;
+//|____________________________________________________________________
+//|
+//| Function: ApplyKeyUp
+//|
+//! \param key    [in] Key code.
+//! \param x      [in] X-coordinate of mouse when key is released.
+//! \param y      [in] Y-coordinate of mouse when key is released.
+//! \return None.
+//|____________________________________________________________________
 
-	case 'A': // Yaws the plane (+Y rot)
-		plane_q1 = plane_q1 * yrotp_q;
-		break;
-	case 'D': // Yaws the plane (-Y rot)
-		plane_q1 = plane_q1 * yrotn_q;
-		break;
+void ApplyKeyUp(unsigned char key, int x, int y)
+{
+	RecordInput(INPUT_KEY_UP, key, 0, 0, x, y);
 
-	//|____________________________________________________________________
-	//|
-	//| Wings and cannon controls (subpart)
-	//|____________________________________________________________________
+	// SHIFT may have changed since the key went down, so release both cases
+	SetKeyHeld((unsigned char)tolower(key), false);
+	SetKeyHeld((unsigned char)toupper(key), false);
+}
 
-	// TODO: Add the remaining controls/transforms
+//|____________________________________________________________________
+//|
+//| Function: StartAnimation
+//|
+//! \param None.
+//! \return None.
+//!
+//! Registers IdleFunc, which keeps frames coming until the turtles come
+//! to rest. A replay runs the ticks itself.
+//|____________________________________________________________________
 
-	// Rotates right wings (subpart)
-	case 'r':
-		wing_angle_right += DELTA_ROTATION;
-		break;
-	case 'R':
-		wing_angle_right -= DELTA_ROTATION;
-		break;
+void StartAnimation(void)
+{
+	if (!animating && replay_mode == REPLAY_NONE) {
+		animating = true;
+		last_update_ms = glutGet(GLUT_ELAPSED_TIME);
+		glutIdleFunc(IdleFunc);
+	}
+}
 
-	// Rotates left wings (subpart)
-	case 't':
-		wing_angle_left += DELTA_ROTATION;
-		break;
-	case 'T':
-		wing_angle_left -= DELTA_ROTATION;
-		break;
+//|____________________________________________________________________
+//|
+//| Function: IdleFunc
+//|
+//! \param None.
+//! \return None.
+//!
+//! GLUT idle callback function: asks for the next frame while the
+//! turtles move (each frame runs its ticks, see UpdateAnimation).
+//|____________________________________________________________________
 
-	// Rotates cannon base (subpart)
-	case 'y':
-		cannon_angle_top += DELTA_ROTATION;
-		break;
-	case 'Y':
-		cannon_angle_top -= DELTA_ROTATION;
-		break;
+void IdleFunc(void)
+{
+	glutPostRedisplay();                    // Asks GLUT to redraw the screen
+}
 
-	// Rotates cannon (subsubpart)
-	case 'u':
-		cannon_angle_subsubpart += DELTA_ROTATION;
-		break;
-	case 'U':
-		cannon_angle_subsubpart -= DELTA_ROTATION;
-		break;
-	}
+//|____________________________________________________________________
+//|
+//| Function: UpdateAnimation
+//|
+//! \param None.
+//! \return None.
+//!
+//! Runs the simulation ticks due since the last frame and blends the
+//! state to draw. Unregisters IdleFunc when nothing moves, so an idle
+//! program does not spin.
+//|____________________________________________________________________
 
-	glutPostRedisplay();                    // Asks GLUT to redraw the screen
+void UpdateAnimation(void)
+{
+	int now = glutGet(GLUT_ELAPSED_TIME);
+	bool moving = AdvanceControl((now - last_update_ms) / 1000.0f);
+	last_update_ms = now;
+
+	if (!moving) {
+		animating = false;
+		glutIdleFunc(NULL);
+	}
 }
 
 //|____________________________________________________________________
 //|
-//| Function: MouseFunc
+//| Function: ApplyMouse
 //|
 //! \param button     [in] one of GLUT_LEFT_BUTTON, GLUT_MIDDLE_BUTTON, or GLUT_RIGHT_BUTTON.
 //! \param state      [in] one of GLUT_UP (event is due to release) or GLUT_DOWN (press).
+//! \param modifiers  [in] glutGetModifiers() at the click.
 //! \param x          [in] X-coordinate of mouse when an event occured.
 //! \param y          [in] Y-coordinate of mouse when an event occured.
 //! \return None.
-//!
-//! GLUT mouse-callback function: called for each mouse click.
 //|____________________________________________________________________
 
-void MouseFunc(int button, int state, int x, int y)
+void ApplyMouse(int button, int state, int modifiers, int x, int y)
 {
-	int km_state;
-
 	// Updates button's sate and mouse coordinates
 	if (state == GLUT_DOWN) {
 		mbuttons[button] = true;
@@ -659,29 +715,30 @@ void MouseFunc(int button, int state, int x, int y)
 	}
 
 	// Updates keyboard modifiers
-	km_state = glutGetModifiers();
-	kmodifiers[KM_SHIFT] = km_state & GLUT_ACTIVE_SHIFT ? true : false;
-	kmodifiers[KM_CTRL] = km_state & GLUT_ACTIVE_CTRL ? true : false;
-	kmodifiers[KM_ALT] = km_state & GLUT_ACTIVE_ALT ? true : false;
-
-	//glutPostRedisplay();      // Asks GLUT to redraw the screen
+	RecordInput(INPUT_MOUSE, button, state, modifiers, x, y);
+	kmodifiers[KM_SHIFT] = modifiers & GLUT_ACTIVE_SHIFT ? true : false;
+	kmodifiers[KM_CTRL] = modifiers & GLUT_ACTIVE_CTRL ? true : false;
+	kmodifiers[KM_ALT] = modifiers & GLUT_ACTIVE_ALT ? true : false;
 }
 
 //|____________________________________________________________________
 //|
-//| Function: MotionFunc
+//| Function: AccumulateMotion
 //|
 //! \param x      [in] X-coordinate of mouse when an event occured.
 //! \param y      [in] Y-coordinate of mouse when an event occured.
 //! \return None.
 //!
-//! GLUT motion-callback function: called for each mouse motion.
+//! Adds one motion event to the controlled camera's pending motion
+//! (applied by ApplyCameraMotion).
 //|____________________________________________________________________
 
-void MotionFunc(int x, int y)
+void AccumulateMotion(int x, int y)
 {
 	int dx, dy, d;
 
+	RecordInput(INPUT_MOTION, 0, 0, 0, x, y);
+
 	if (mbuttons[GLUT_LEFT_BUTTON] || mbuttons[GLUT_RIGHT_BUTTON]) {
 		// Computes distances the mouse has moved
 		dx = x - mx_prev;
@@ -694,10 +751,10 @@ void MotionFunc(int x, int y)
 		// Hold left button to rotate camera
 		if (mbuttons[GLUT_LEFT_BUTTON]) {
 			if (!kmodifiers[KM_CTRL]) {
-				elevation[camctrl_id] += dy;            // Elevation update
+				motion_elevation[camctrl_id] += dy;     // Elevation update
 			}
 			if (!kmodifiers[KM_SHIFT]) {
-				azimuth[camctrl_id] += dx;             // Azimuth update
+				motion_azimuth[camctrl_id] += dx;       // Azimuth update
 			}
 		}
 
@@ -709,10 +766,28 @@ void MotionFunc(int x, int y)
 			else {
 				d = -dy;
 			}
-			distance[camctrl_id] += d;
+			motion_distance[camctrl_id] += d;
 		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: ApplyCameraMotion
+//|
+//! \param None.
+//! \return None.
+//!
+//! Moves each camera by its pending motion, in one update.
+//|____________________________________________________________________
 
-		glutPostRedisplay();      // Asks GLUT to redraw the screen
+void ApplyCameraMotion(void)
+{
+	for (int c = 0; c < 3; c++) {
+		elevation[c] += motion_elevation[c];
+		azimuth[c] += motion_azimuth[c];
+		distance[c] += motion_distance[c];
+		motion_elevation[c] = motion_azimuth[c] = motion_distance[c] = 0;
 	}
 }
 
@@ -736,174 +811,189 @@ void ReshapeFunc(int w, int h)
 
 //|____________________________________________________________________
 //|
-//| Function: DrawCoordinateFrame
+//| Function: PostRedisplay
 //|
-//! \param l      [in] length of the three axes.
+//! \param None.
 //! \return None.
 //!
-//! Draws coordinate frame consisting of the three principal axes.
+//! glutPostRedisplay(), except in a headless replay (no window).
 //|____________________________________________________________________
 
-void DrawCoordinateFrame(const float l)
+void PostRedisplay(void)
 {
-	glBegin(GL_LINES);
-	// X axis is red
-	glColor3f(1.0f, 0.0f, 0.0f);
-	glVertex3f(0.0f, 0.0f, 0.0f);
-	glVertex3f(l, 0.0f, 0.0f);
-
-	// Y axis is green
-	glColor3f(0.0f, 1.0f, 0.0f);
-	glVertex3f(0.0f, 0.0f, 0.0f);
-	glVertex3f(0.0f, l, 0.0f);
-
-	// Z axis is blue
-	glColor3f(0.0f, 0.0f, 1.0f);
-	glVertex3f(0.0f, 0.0f, 0.0f);
-	glVertex3f(0.0f, 0.0f, l);
-	glEnd();
+	if (replay_mode != REPLAY_FAST) {
+		glutPostRedisplay();
+	}
 }
 
 //|____________________________________________________________________
 //|
-//| Function: DrawPlaneBody
+//| Function: RecordInput
 //|
-//! \param width       [in] Width  of the plane.
-//! \param length      [in] Length of the plane.
-//! \param height      [in] Height of the plane.
+//! \param type       [in] Event type.
+//! \param code       [in] Key or mouse button.
+//! \param state      [in] Mouse button state.
+//! \param modifiers  [in] Keyboard modifiers of a mouse event.
+//! \param x, y       [in] Mouse position.
 //! \return None.
 //!
-//! Draws a plane body.
-//|____________________________________________________________________
-
-void drawCube(const float width, const float length, const float height, const float colours[3]) {
-	float w2 = width / 2;
-	float h2 = height / 2;
-	float l2 = length / 2;
-
-	// modify the copy only (arrays are passed by reference)
-	float colours_copy[3] = { colours[0], colours[1], colours[2] };
-
-	// for adding shadow, increase this to add contrast, vice versa
-	float c_delta = 0.05f;
-
-	glBegin(GL_QUADS);
-
-	// front face
-	glColor3f(colours_copy[0], colours_copy[1], colours_copy[2]);
-	glVertex3f(w2, h2, -l2);
-	glVertex3f(-w2, h2, -l2);
-	glVertex3f(-w2, -h2, -l2);
-	glVertex3f(w2, -h2, -l2);
-
-	// increase brightness
-	colours_copy[0] += c_delta;
-	colours_copy[1] += c_delta;
-	colours_copy[2] += c_delta;
-
-	// right face
-	glColor3f(colours_copy[0], colours_copy[1], colours_copy[2]);
-	glVertex3f(w2, h2, -l2);
-	glVertex3f(w2, h2, l2);
-	glVertex3f(w2, -h2, l2);
-	glVertex3f(w2, -h2, -l2);
-
-	// increase brightness
-	colours_copy[0] += c_delta;
-	colours_copy[1] += c_delta;
-	colours_copy[2] += c_delta;
-
-	// top face
-	glColor3f(colours_copy[0], colours_copy[1], colours_copy[2]);
-	glVertex3f(w2, h2, l2);
-	glVertex3f(-w2, h2, l2);
-	glVertex3f(-w2, h2, -l2);
-	glVertex3f(w2, h2, -l2);
-
-	// increase brightness
-	colours_copy[0] += c_delta;
-	colours_copy[1] += c_delta;
-	colours_copy[2] += c_delta;
-
-	// bottom face
-	glColor3f(colours_copy[0], colours_copy[1], colours_copy[2]);
-	glVertex3f(w2, -h2, -l2);
-	glVertex3f(-w2, -h2, -l2);
-	glVertex3f(-w2, -h2, l2);
-	glVertex3f(w2, -h2, l2);
-
-	// increase brightness
-	colours_copy[0] += c_delta;
-	colours_copy[1] += c_delta;
-	colours_copy[2] += c_delta;
-
-	// back face
-	glColor3f(colours_copy[0], colours_copy[1], colours_copy[2]);
-	glVertex3f(-w2, h2, l2);
-	glVertex3f(w2, h2, l2);
-	glVertex3f(w2, -h2, l2);
-	glVertex3f(-w2, -h2, l2);
-
-	// increase brightness
-	colours_copy[0] += c_delta;
-	colours_copy[1] += c_delta;
-	colours_copy[2] += c_delta;
-
-	// left face
-	glColor3f(colours_copy[0], colours_copy[1], colours_copy[2]);
-	glVertex3f(-w2, h2, -l2);
-	glVertex3f(-w2, h2, l2);
-	glVertex3f(-w2, -h2, l2);
-	glVertex3f(-w2, -h2, -l2);
-	glEnd();
+//! Logs an event with the time and the ticks run so far, if recording.
+//|____________________________________________________________________
+
+void RecordInput(InputEventType type, int code, int state, int modifiers, int x, int y)
+{
+	if (IsRecordingInput()) {
+		RecordInputEvent(glutGet(GLUT_ELAPSED_TIME) - record_start_ms, ControlTicks(), type, code, state, modifiers, x, y);
+	}
 }
 
-void DrawTurtleShell(const float width, const float length, const float height)
+//|____________________________________________________________________
+//|
+//| Function: FeedInput
+//|
+//! \param e      [in] Recorded event.
+//! \return None.
+//!
+//! Applies the event straight away, as the frame that first received
+//! it did (the ticks run in between are the recorded ones).
+//|____________________________________________________________________
+
+void FeedInput(const InputEvent& e)
 {
-	// shell
-	drawCube(width, length, height, colour_brown);
+	switch (e.type) {
+	case INPUT_KEY_DOWN:
+		ApplyKeyDown(e.code, e.x, e.y);
+		break;
+	case INPUT_KEY_UP:
+		ApplyKeyUp(e.code, e.x, e.y);
+		break;
+	case INPUT_MOUSE:
+		ApplyMouse(e.code, e.state, e.modifiers, e.x, e.y);
+		break;
+	case INPUT_MOTION:
+		AccumulateMotion(e.x, e.y);
+		ApplyCameraMotion();
+		break;
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: FeedInputsUpTo
+//|
+//! \param tick   [in] Last tick whose events are fed.
+//! \return None.
+//!
+//! Feeds the pending events recorded at or before the tick, each after
+//! running exactly the ticks that preceded it in the recording.
+//|____________________________________________________________________
+
+void FeedInputsUpTo(unsigned int tick)
+{
+	while (replay_next < replay_events.size() && replay_events[replay_next].tick <= tick) {
+		const InputEvent& e = replay_events[replay_next++];
+		while (ControlTicks() < e.tick) {
+			StepControl();
+		}
+		FeedInput(e);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: ReplayFast
+//|
+//! \param path   [in] Input log.
+//! \return 0 if the final state matches the recording, 1 otherwise.
+//!
+//! Replays a log without a window or GL, as fast as the ticks run.
+//|____________________________________________________________________
 
-	// black cannon strap
-	drawCube(width*1.1, length*0.2, height*1.1, colour_darker_gray);
+int ReplayFast(const char* path)
+{
+	if (!LoadInputLog(path, (uint32_t)SIM_RATE, replay_events)) {
+		return 1;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	FeedInputsUpTo(replay_events.back().tick);
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	PrintFinalState("replay", ms);
+	return ControlChecksum() == (uint32_t)replay_events.back().x ? 0 : 1;
 }
 
 //|____________________________________________________________________
 //|
-//| Function: DrawPropeller
+//| Function: ReplayIdleFunc
 //|
-//! \param width       [in] Width  of the propeller.
-//! \param length      [in] Length of the propeller.
+//! \param None.
 //! \return None.
 //!
-//! Draws a propeller.
+//! GLUT idle callback of a timed replay: feeds the events as their
+//! recorded time comes, runs ticks with the clock in between (never past
+//! the tick of the next event), and redraws.
 //|____________________________________________________________________
 
-void DrawCannon(const float width, const float length, const float height, const bool isInverted)
+void ReplayIdleFunc(void)
 {
-	drawCube(width, length, height, colour_dark_gray);
-	glPushMatrix();
-		// by default (without invert):
-		// would draw the wing extension on the left side
-		// otherwise if inverted, would draw the wing extension on the right side
-		int direction = (isInverted) ? 1 : -1;
-		glTranslatef(width*0.5*direction, 0, 0);
-		drawCube(width*0.8, length*0.8, height*0.8, colour_dark_gray);
-		drawCube(width*0.9, length*0.7, height*0.6, colour_darker_gray);
+	int now = glutGet(GLUT_ELAPSED_TIME);
+	replay_sim_time += (now - replay_update_ms) / 1000.0f;
+	replay_update_ms = now;
 
-	glPopMatrix();
+	while (replay_next < replay_events.size() && replay_events[replay_next].time_ms <= (uint32_t)(now - replay_start_ms)) {
+		FeedInputsUpTo(replay_events[replay_next].tick);
+	}
+
+	unsigned int limit = replay_next < replay_events.size() ? replay_events[replay_next].tick : ControlTicks();
+	while (replay_sim_time >= SIM_STEP && ControlTicks() < limit) {
+		StepControl();
+		replay_sim_time -= SIM_STEP;
+	}
+	if (ControlTicks() >= limit) {
+		replay_sim_time = 0;                // Waiting for the next event: no backlog
+	}
+	BlendControl(ControlTicks() < limit ? replay_sim_time / SIM_STEP : 1.0f);
+
+	glutPostRedisplay();
+
+	if (replay_next == replay_events.size()) {
+		PrintFinalState("replay_timed", now - replay_start_ms);
+		glutIdleFunc(NULL);
+	}
 }
 
-void DrawWing(const float width, const float length, const float height, const bool isInverted)
+//|____________________________________________________________________
+//|
+//| Function: PrintFinalState
+//|
+//! \param mode   [in] "record", "replay" or "replay_timed".
+//! \param ms     [in] Duration of the session.
+//! \return None.
+//!
+//! Prints the ticks run, the poses and angles at the latest tick and
+//! their checksum as one JSON line; a replay also prints whether the
+//! checksum matches the recording.
+//|____________________________________________________________________
+
+void PrintFinalState(const char* mode, double ms)
 {
-	drawCube(width, length, height, colour_lime_green);
-	glPushMatrix();
-		// by default (without invert):
-		// would draw the wing extension on the left side
-		// otherwise if inverted, would draw the wing extension on the right side
-		int direction = (isInverted) ? 1 : -1;
-		glTranslatef(width*0.5*direction, 0, 0);
-		drawCube(width*0.8, length*0.8, height*0.8, colour_lime_green);
-	glPopMatrix();
+	const ControlState& c = GetControlState();
+
+	printf("{\"mode\":\"%s\",\"ticks\":%u,\"ms\":%.3f,", mode, ControlTicks(), ms);
+	for (int i = 0; i < 2; i++) {
+		printf("\"turtle%d\":[%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g],", i + 1,
+			c.turtle_p[i][0], c.turtle_p[i][1], c.turtle_p[i][2],
+			c.turtle_q[i][0], c.turtle_q[i][1], c.turtle_q[i][2], c.turtle_q[i][3]);
+	}
+	printf("\"angles\":[%.9g,%.9g,%.9g,%.9g],\"checksum\":\"%08x\"",
+		c.wing_angle_right, c.wing_angle_left, c.cannon_angle_top, c.cannon_angle_subsubpart, ControlChecksum());
+	if (replay_mode != REPLAY_NONE) {
+		uint32_t recorded = (uint32_t)replay_events.back().x;
+		printf(",\"recorded_checksum\":\"%08x\",\"match\":%s", recorded, recorded == ControlChecksum() ? "true" : "false");
+	}
+	printf("}\n");
+	fflush(stdout);
 }
 
 //|____________________________________________________________________
@@ -918,9 +1008,87 @@ void DrawWing(const float width, const float length, const float height, const b
 
 int main(int argc, char** argv)
 {
+	const char* record_path = NULL;
+	const char* replay_path = NULL;
+	const char* scene_path = NULL;
+	const char* trace_path = NULL;
+	const char* publish_name = NULL;
+	const char* stream_path = NULL;
+
+	// A headless replay never opens a window
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-replay") == 0) {
+			replay_mode = REPLAY_FAST;
+		}
+	}
+	if (replay_mode != REPLAY_FAST) {
+		glutInit(&argc, argv);
+	}
+
+	// Optional arguments: number of extra turtles, scene file, trace, pose share, CPU rasterizer, input recording or replay
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-scene") == 0 && i + 1 < argc) {
+			scene_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "-trace") == 0 && i + 1 < argc) {
+			trace_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "-publish") == 0 && i + 1 < argc) {
+			publish_name = argv[++i];
+		}
+		else if (strcmp(argv[i], "-software") == 0) {
+			use_software = true;
+		}
+		else if (strcmp(argv[i], "-stream") == 0 && i + 1 < argc) {
+			stream_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "-record") == 0 && i + 1 < argc) {
+			record_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "-replay") == 0 && i + 1 < argc) {
+			replay_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "-replay-timed") == 0 && i + 1 < argc) {
+			replay_mode = REPLAY_TIMED;
+			replay_path = argv[++i];
+		}
+		else {
+			crowd_size = atoi(argv[i]);
+		}
+	}
+
+	// Turtles, model and hierarchy from a scene file instead of the built-in ones
+	if (scene_path) {
+		if (!MapSceneFile(scene_path, scene_file)) {
+			return 1;
+		}
+		ApplySceneFile(scene_file);
+	}
+
 	InitTransforms();
+	InitSceneThreads(0);
+	InitControl();
+	InitInputQueue(input_queue);
+
+	if (publish_name) {
+		if (!CreatePoseShare(publish_name, TurtleCount(scene), pose_share)) {
+			FreeSceneThreads();
+			return 1;
+		}
+		PublishTurtlePoses(ControlTicks());
+	}
 
-	glutInit(&argc, argv);
+	if (replay_mode == REPLAY_FAST) {
+		int result = replay_path ? ReplayFast(replay_path) : 1;
+		ClosePoseShare(pose_share);
+		FreeSceneThreads();
+		return result;
+	}
+	if (replay_mode == REPLAY_TIMED && !LoadInputLog(replay_path, (uint32_t)SIM_RATE, replay_events)) {
+		ClosePoseShare(pose_share);
+		FreeSceneThreads();
+		return 1;
+	}
 
 	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);     // Uses GLUT_DOUBLE to enable double buffering
 	glutInitWindowSize(w_width, w_height);
@@ -928,14 +1096,55 @@ int main(int argc, char** argv)
 	glutCreateWindow("Plane Episode 2");
 
 	glutDisplayFunc(DisplayFunc);
-	glutKeyboardFunc(KeyboardFunc);
-	glutMouseFunc(MouseFunc);
-	glutMotionFunc(MotionFunc);
 	glutReshapeFunc(ReshapeFunc);
+	glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);     // Lets a recording be closed
+
+	if (replay_mode == REPLAY_TIMED) {
+		// The log drives the session: live input would make it diverge
+		replay_start_ms = replay_update_ms = glutGet(GLUT_ELAPSED_TIME);
+		glutIdleFunc(ReplayIdleFunc);
+	}
+	else {
+		glutKeyboardFunc(KeyboardFunc);
+		glutKeyboardUpFunc(KeyboardUpFunc);
+		glutIgnoreKeyRepeat(1);                                 // Held keys are tracked, repeats would only add redraws
+		glutMouseFunc(MouseFunc);
+		glutMotionFunc(MotionFunc);
+	}
 
 	InitGL();
 
+	if (stream_path) {
+		stream_file = fopen(stream_path, "wb");
+		if (!stream_file) {
+			printf("Cannot write %s\n", stream_path);
+		}
+	}
+
+	if (trace_path && BeginProfileTrace(trace_path)) {
+		SetProfiling(true);
+	}
+
+	if (record_path && replay_mode == REPLAY_NONE && BeginInputRecording(record_path, (uint32_t)SIM_RATE)) {
+		record_start_ms = glutGet(GLUT_ELAPSED_TIME);
+	}
+
 	glutMainLoop();
 
+	EndProfileTrace();
+
+	if (IsRecordingInput()) {
+		int ms = glutGet(GLUT_ELAPSED_TIME) - record_start_ms;
+		EndInputRecording(ms, ControlTicks(), ControlChecksum());
+		PrintFinalState("record", ms);
+	}
+
+	ClosePoseShare(pose_share);
+	if (stream_file) {
+		fclose(stream_file);
+	}
+	FreeSoftRaster(soft_raster);
+	FreeSceneThreads();
+
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,110 @@
+//|___________________________________________________________________
+//!
+//! \file pose_math.cpp
+//!
+//! \brief Direct pose math: quaternion to matrix, vector rotation, and
+//!        compile-time step rotations.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <math.h>
+
+#include "pose_math.h"
+
+//|____________________________________________________________________
+//|
+//| Function: PoseMatrix
+//|
+//! \param p      [in] Position.
+//! \param q      [in] Unit quaternion.
+//! \param m      [out] T(p) * R(q), column-major for glMultMatrixf().
+//! \return None.
+//|____________________________________________________________________
+
+void PoseMatrix(const gmtl::Point4f& p, const gmtl::Quatf& q, float m[16])
+{
+	float x = q[0], y = q[1], z = q[2], w = q[3];
+
+	m[0] = 1 - 2 * (y * y + z * z);  m[4] = 2 * (x * y - w * z);      m[8] = 2 * (x * z + w * y);       m[12] = p[0];
+	m[1] = 2 * (x * y + w * z);      m[5] = 1 - 2 * (x * x + z * z);  m[9] = 2 * (y * z - w * x);       m[13] = p[1];
+	m[2] = 2 * (x * z - w * y);      m[6] = 2 * (y * z + w * x);      m[10] = 1 - 2 * (x * x + y * y);  m[14] = p[2];
+	m[3] = 0;                        m[7] = 0;                        m[11] = 0;                        m[15] = 1;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: PoseInverseMatrix
+//|
+//! \param p      [in] Position.
+//! \param q      [in] Unit quaternion.
+//! \param m      [out] (T(p) * R(q))^-1 = R(q)^T * T(-p), column-major.
+//! \return None.
+//!
+//! View transform of a camera attached to the pose: replaces
+//! glRotatef(-angle, axis) followed by glTranslatef(-p).
+//|____________________________________________________________________
+
+void PoseInverseMatrix(const gmtl::Point4f& p, const gmtl::Quatf& q, float m[16])
+{
+	float x = q[0], y = q[1], z = q[2], w = q[3];
+
+	// Transposed rotation
+	m[0] = 1 - 2 * (y * y + z * z);  m[4] = 2 * (x * y + w * z);      m[8] = 2 * (x * z - w * y);
+	m[1] = 2 * (x * y - w * z);      m[5] = 1 - 2 * (x * x + z * z);  m[9] = 2 * (y * z + w * x);
+	m[2] = 2 * (x * z + w * y);      m[6] = 2 * (y * z - w * x);      m[10] = 1 - 2 * (x * x + y * y);
+	m[3] = 0;                        m[7] = 0;                        m[11] = 0;
+
+	m[12] = -(m[0] * p[0] + m[4] * p[1] + m[8] * p[2]);
+	m[13] = -(m[1] * p[0] + m[5] * p[1] + m[9] * p[2]);
+	m[14] = -(m[2] * p[0] + m[6] * p[1] + m[10] * p[2]);
+	m[15] = 1;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: MultMatrix
+//|
+//! \param a      [in] Left matrix, column-major.
+//! \param b      [in] Right matrix, column-major.
+//! \param m      [out] a * b, column-major; must not alias a or b.
+//! \return None.
+//|____________________________________________________________________
+
+void MultMatrix(const float a[16], const float b[16], float m[16])
+{
+	for (int c = 0; c < 4; c++) {
+		for (int r = 0; r < 4; r++) {
+			m[c * 4 + r] = a[r] * b[c * 4] + a[4 + r] * b[c * 4 + 1] + a[8 + r] * b[c * 4 + 2] + a[12 + r] * b[c * 4 + 3];
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: PerspectiveMatrix
+//|
+//! \param fov    [in] Vertical field of view (degs).
+//! \param aspect [in] Width over height.
+//! \param near_z [in] Distances of the clipping planes.
+//! \param far_z  [in]
+//! \param m      [out] The matrix gluPerspective() multiplies by, column-major.
+//! \return None.
+//|____________________________________________________________________
+
+void PerspectiveMatrix(float fov, float aspect, float near_z, float far_z, float m[16])
+{
+	float f = 1.0f / tanf(DegToRad(fov) * 0.5f);
+
+	for (int i = 0; i < 16; i++) {
+		m[i] = 0;
+	}
+	m[0] = f / aspect;
+	m[5] = f;
+	m[10] = (far_z + near_z) / (near_z - far_z);
+	m[11] = -1;
+	m[14] = 2 * far_z * near_z / (near_z - far_z);
+}
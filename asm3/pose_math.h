@@ -0,0 +1,71 @@
+//|___________________________________________________________________
+//!
+//! \file pose_math.h
+//!
+//! \brief Direct pose math: quaternion to matrix, vector rotation, and
+//!        compile-time step rotations.
+//!
+//! A pose (position p, unit quaternion q) becomes an OpenGL matrix with a
+//! handful of multiplies, with no axis-angle detour and no trig. Rotating
+//! a vector by q uses the cross-product form of q * v * conj(q), which
+//! needs about half the multiplies of two full quaternion products.
+//|___________________________________________________________________
+
+#pragma once
+
+#include <gmtl/gmtl.h>
+
+//|___________________
+//|
+//| Compile-time trigonometry
+//|___________________
+
+constexpr float POSE_PI = 3.14159265358979f;
+
+constexpr float DegToRad(float degs) { return degs * (POSE_PI / 180.0f); }
+
+//! Taylor series of sin/cos, accurate to float precision for |x| <= pi/4
+//! (step rotations are a few degrees).
+constexpr float ConstSin(float x)
+{
+	return x * (1 - x * x / 6 * (1 - x * x / 20 * (1 - x * x / 42 * (1 - x * x / 72 * (1 - x * x / 110)))));
+}
+
+constexpr float ConstCos(float x)
+{
+	return 1 - x * x / 2 * (1 - x * x / 12 * (1 - x * x / 30 * (1 - x * x / 56 * (1 - x * x / 90))));
+}
+
+// Components of a quaternion rotating by degs about a principal axis
+constexpr float StepQuatSin(float degs) { return ConstSin(DegToRad(degs) / 2); }
+constexpr float StepQuatCos(float degs) { return ConstCos(DegToRad(degs) / 2); }
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void PoseMatrix(const gmtl::Point4f& p, const gmtl::Quatf& q, float m[16]);
+void PoseInverseMatrix(const gmtl::Point4f& p, const gmtl::Quatf& q, float m[16]);
+void MultMatrix(const float a[16], const float b[16], float m[16]);
+void PerspectiveMatrix(float fov, float aspect, float near_z, float far_z, float m[16]);
+
+//|____________________________________________________________________
+//|
+//| Function: RotateVector
+//|
+//! \param q      [in] Unit quaternion.
+//! \param v      [in] Vector.
+//! \return q * v * conj(q), as v + w t + u x t with t = 2 u x v.
+//|____________________________________________________________________
+
+inline gmtl::Vec3f RotateVector(const gmtl::Quatf& q, const gmtl::Vec3f& v)
+{
+	float tx = 2 * (q[1] * v[2] - q[2] * v[1]);
+	float ty = 2 * (q[2] * v[0] - q[0] * v[2]);
+	float tz = 2 * (q[0] * v[1] - q[1] * v[0]);
+
+	return gmtl::Vec3f(v[0] + q[3] * tx + (q[1] * tz - q[2] * ty),
+	                   v[1] + q[3] * ty + (q[2] * tx - q[0] * tz),
+	                   v[2] + q[3] * tz + (q[0] * ty - q[1] * tx));
+}
@@ -0,0 +1,317 @@
+//|___________________________________________________________________
+//!
+//! \file pose_share.cpp
+//!
+//! \brief Turtle poses published every tick in named shared memory.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "pose_share.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const size_t POSE_SHARE_ALIGN = 64;             // Slots start on their own cache lines
+
+//|___________________
+//|
+//| Local Functions
+//|___________________
+
+//|____________________________________________________________________
+//|
+//| Function: AlignUp
+//|
+//! \param size   [in] Byte count.
+//! \return size rounded up to POSE_SHARE_ALIGN.
+//|____________________________________________________________________
+
+static size_t AlignUp(size_t size)
+{
+	return (size + POSE_SHARE_ALIGN - 1) / POSE_SHARE_ALIGN * POSE_SHARE_ALIGN;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SlotAt
+//|
+//! \param share  [in] Mapped pose share.
+//! \param n      [in] Snapshot number.
+//! \return Slot holding snapshot n.
+//|____________________________________________________________________
+
+static PoseShareSlot* SlotAt(const PoseShare& share, uint64_t n)
+{
+	const PoseShareHeader* h = share.header;
+	char* slots = (char*)share.data + AlignUp(sizeof(PoseShareHeader));
+	return (PoseShareSlot*)(slots + (n % h->slot_count) * h->slot_size);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: MapPoseShare
+//|
+//! \param name    [in] Shared-memory object name.
+//! \param size    [in] Bytes to create, 0 to open an existing object read-only.
+//! \param share   [out] Mapping.
+//! \return True if the object is mapped.
+//|____________________________________________________________________
+
+static bool MapPoseShare(const char* name, size_t size, PoseShare& share)
+{
+	bool create = size > 0;
+
+	memset(&share, 0, sizeof(share));
+	strncpy(share.name, name, sizeof(share.name) - 1);
+	share.writer = create;
+
+#ifdef _WIN32
+	HANDLE mapping = create ? CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+	                                             (DWORD)((uint64_t)size >> 32), (DWORD)size, name)
+	                        : OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+	void* data = mapping ? MapViewOfFile(mapping, create ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size) : NULL;
+	if (!data) {
+		printf("Cannot map pose share %s\n", name);
+		if (mapping) {
+			CloseHandle(mapping);
+		}
+		return false;
+	}
+	if (!create) {
+		MEMORY_BASIC_INFORMATION info;
+		VirtualQuery(data, &info, sizeof(info));
+		size = info.RegionSize;
+	}
+	share.mapping_handle = mapping;
+#else
+	int fd = create ? shm_open(name, O_CREAT | O_RDWR, 0644) : shm_open(name, O_RDONLY, 0);
+	struct stat st;
+	if (fd < 0 || (create && ftruncate(fd, (off_t)size) != 0) || fstat(fd, &st) != 0 || st.st_size == 0) {
+		printf("Cannot open pose share %s\n", name);
+		if (fd >= 0) {
+			close(fd);
+		}
+		return false;
+	}
+	size = (size_t)st.st_size;
+	void* data = mmap(NULL, size, create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);                              // The mapping keeps the object open
+	if (data == MAP_FAILED) {
+		printf("Cannot map pose share %s\n", name);
+		return false;
+	}
+#endif
+
+	share.data = data;
+	share.size = size;
+	return true;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: CreatePoseShare
+//|
+//! \param name            [in] Object name ("/name" on POSIX).
+//! \param turtle_capacity [in] Turtles per snapshot.
+//! \param share           [out] Writable mapping.
+//! \return True if the object is created and mapped.
+//!
+//! Creates (or takes over) the object and lays out an empty ring.
+//! Readers accept the header once its magic is written, which is last.
+//|____________________________________________________________________
+
+bool CreatePoseShare(const char* name, uint64_t turtle_capacity, PoseShare& share)
+{
+	size_t slot_size = AlignUp(sizeof(PoseShareSlot) + (size_t)turtle_capacity * sizeof(SceneFileTurtle));
+	size_t size = AlignUp(sizeof(PoseShareHeader)) + POSE_SHARE_SLOTS * slot_size;
+
+	if (!MapPoseShare(name, size, share)) {
+		return false;
+	}
+
+	memset(share.data, 0, size);
+	PoseShareHeader* h = (PoseShareHeader*)share.data;
+	h->version = POSE_SHARE_VERSION;
+	h->header_size = sizeof(PoseShareHeader);
+	h->slot_count = POSE_SHARE_SLOTS;
+	h->slot_size = slot_size;
+	h->turtle_capacity = turtle_capacity;
+	h->latest.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(h->magic, POSE_SHARE_MAGIC, sizeof(h->magic));
+
+	share.header = h;
+	return true;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: OpenPoseShare
+//|
+//! \param name    [in] Object name, as given to CreatePoseShare().
+//! \param share   [out] Read-only mapping.
+//! \return True if the object is mapped and valid.
+//|____________________________________________________________________
+
+bool OpenPoseShare(const char* name, PoseShare& share)
+{
+	if (!MapPoseShare(name, 0, share)) {
+		return false;
+	}
+
+	const PoseShareHeader* h = (const PoseShareHeader*)share.data;
+	bool valid = share.size >= sizeof(PoseShareHeader) && memcmp(h->magic, POSE_SHARE_MAGIC, sizeof(h->magic)) == 0;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	valid = valid && h->version == POSE_SHARE_VERSION && h->header_size == sizeof(PoseShareHeader) && h->slot_count > 0 &&
+	        h->slot_size >= sizeof(PoseShareSlot) + h->turtle_capacity * sizeof(SceneFileTurtle) &&
+	        share.size >= AlignUp(sizeof(PoseShareHeader)) + h->slot_count * h->slot_size;
+	if (!valid) {
+		printf("Pose share %s: not a version %u pose share\n", name, POSE_SHARE_VERSION);
+		ClosePoseShare(share);
+		return false;
+	}
+
+	share.header = (PoseShareHeader*)h;
+	return true;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: ClosePoseShare
+//|
+//! \param share   [in,out] Mapping, cleared.
+//! \return None.
+//!
+//! Unmaps the object; the writer also removes its name, and the memory
+//! goes away once the last reader has closed it too.
+//|____________________________________________________________________
+
+void ClosePoseShare(PoseShare& share)
+{
+	if (share.data) {
+#ifdef _WIN32
+		UnmapViewOfFile(share.data);
+		CloseHandle(share.mapping_handle);
+#else
+		munmap(share.data, share.size);
+		if (share.writer) {
+			shm_unlink(share.name);
+		}
+#endif
+	}
+	memset(&share, 0, sizeof(share));
+}
+
+//|____________________________________________________________________
+//|
+//| Function: BeginPosePublish
+//|
+//! \param share         [in,out] Writable mapping.
+//! \param tick          [in] Simulation tick of the poses.
+//! \param turtle_count  [in] Turtles to publish, clamped to the capacity.
+//! \return Records of the next snapshot, to fill before EndPosePublish().
+//!
+//! Marks the next slot of the ring as being written; readers of that
+//! slot will see their snapshot invalidated.
+//|____________________________________________________________________
+
+SceneFileTurtle* BeginPosePublish(PoseShare& share, uint64_t tick, uint64_t turtle_count)
+{
+	PoseShareHeader* h = share.header;
+	uint64_t n = h->latest.load(std::memory_order_relaxed) + 1;
+	PoseShareSlot* slot = SlotAt(share, n);
+
+	uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+	slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot->snapshot = n;
+	slot->tick = tick;
+	slot->turtle_count = turtle_count < h->turtle_capacity ? turtle_count : h->turtle_capacity;
+	return (SceneFileTurtle*)(slot + 1);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: EndPosePublish
+//|
+//! \param share   [in,out] Writable mapping.
+//! \return None.
+//!
+//! Completes the slot of BeginPosePublish() and makes it the latest.
+//|____________________________________________________________________
+
+void EndPosePublish(PoseShare& share)
+{
+	PoseShareHeader* h = share.header;
+	uint64_t n = h->latest.load(std::memory_order_relaxed) + 1;
+	PoseShareSlot* slot = SlotAt(share, n);
+
+	slot->sequence.store(slot->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	h->latest.store(n, std::memory_order_release);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: BeginPoseRead
+//|
+//! \param share     [in] Mapping.
+//! \param sequence  [out] Slot sequence to hand to EndPoseRead().
+//! \return Slot of the latest complete snapshot, NULL before the first.
+//!
+//! The slot's records are read in place (PoseSlotTurtles()); nothing read
+//! may be trusted until EndPoseRead() confirms it.
+//|____________________________________________________________________
+
+const PoseShareSlot* BeginPoseRead(const PoseShare& share, uint64_t& sequence)
+{
+	for (;;) {
+		uint64_t n = share.header->latest.load(std::memory_order_acquire);
+		if (n == 0) {
+			return NULL;
+		}
+
+		const PoseShareSlot* slot = SlotAt(share, n);
+		sequence = slot->sequence.load(std::memory_order_acquire);
+		if (!(sequence & 1)) {
+			return slot;
+		}
+		// The writer lapped the ring onto this slot meanwhile: take the newer snapshot
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: EndPoseRead
+//|
+//! \param slot      [in] Slot from BeginPoseRead().
+//! \param sequence  [in] Sequence from BeginPoseRead().
+//! \return True if the slot was not rewritten while it was read, i.e.
+//!         everything read from it is one consistent snapshot.
+//|____________________________________________________________________
+
+bool EndPoseRead(const PoseShareSlot* slot, uint64_t sequence)
+{
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return slot->sequence.load(std::memory_order_relaxed) == sequence;
+}
@@ -0,0 +1,100 @@
+//|___________________________________________________________________
+//!
+//! \file pose_share.h
+//!
+//! \brief Turtle poses published every tick in named shared memory.
+//!
+//! The simulation is the only writer. Each tick it writes the poses and
+//! joint angles of every turtle into the next slot of a ring in a named
+//! shared-memory object (shm_open() on POSIX, a page-file mapping on
+//! Windows). Any number of local processes map the object read-only and
+//! read the records in place.
+//!
+//! Each slot is a seqlock. Its sequence number is odd while the writer
+//! fills the slot and is advanced again once the slot is complete. The
+//! writer never waits for readers. A reader checks that the sequence was
+//! even and unchanged around its reads (BeginPoseRead(), EndPoseRead()).
+//! Otherwise the slot was overwritten and the reader retries with the
+//! latest one. With POSE_SHARE_SLOTS slots, a reader has that many ticks
+//! to finish with a snapshot before it is overwritten.
+//!
+//! Layout: PoseShareHeader | slot_count x (PoseShareSlot |
+//!         SceneFileTurtle[turtle_capacity]), slot_size bytes apart
+//|___________________________________________________________________
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "scene_file.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const char POSE_SHARE_MAGIC[4] = { 'T', 'P', 'O', 'S' };
+const uint32_t POSE_SHARE_VERSION = 1;
+const uint32_t POSE_SHARE_SLOTS = 8;            // Ticks a reader can hold a snapshot
+const char* const DEFAULT_POSE_SHARE_NAME = "/asm3_poses";
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+// Atomics must be lock-free to be shared between processes
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "64-bit atomics must be lock-free");
+
+struct PoseShareHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t header_size;               // sizeof(PoseShareHeader)
+	uint32_t slot_count;
+	uint64_t slot_size;                 // Bytes from one slot to the next
+	uint64_t turtle_capacity;           // Records per slot
+	std::atomic<uint64_t> latest;       // Number of the newest complete snapshot, 0 before the first
+};
+
+struct PoseShareSlot
+{
+	std::atomic<uint64_t> sequence;     // Seqlock: odd while the writer fills the slot
+	uint64_t snapshot;                  // Snapshot number n (the slot is n % slot_count)
+	uint64_t tick;                      // Simulation tick of the poses
+	uint64_t turtle_count;              // Valid records
+};
+
+// A mapped pose share, writable for the simulation or read-only for a reader
+struct PoseShare
+{
+	PoseShareHeader* header;            // NULL when nothing is mapped
+	void* data;
+	size_t size;
+	bool writer;                        // Created the object (and removes its name when closed)
+	char name[64];
+#ifdef _WIN32
+	void* mapping_handle;
+#endif
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+bool CreatePoseShare(const char* name, uint64_t turtle_capacity, PoseShare& share);
+bool OpenPoseShare(const char* name, PoseShare& share);
+void ClosePoseShare(PoseShare& share);
+SceneFileTurtle* BeginPosePublish(PoseShare& share, uint64_t tick, uint64_t turtle_count);
+void EndPosePublish(PoseShare& share);
+const PoseShareSlot* BeginPoseRead(const PoseShare& share, uint64_t& sequence);
+bool EndPoseRead(const PoseShareSlot* slot, uint64_t sequence);
+
+inline const SceneFileTurtle* PoseSlotTurtles(const PoseShareSlot* slot)
+{
+	return (const SceneFileTurtle*)(slot + 1);
+}
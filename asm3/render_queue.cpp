@@ -0,0 +1,244 @@
+//|___________________________________________________________________
+//!
+//! \file render_queue.cpp
+//!
+//! \brief Queue of mesh draws sorted by material and depth before submission.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <string.h>
+
+#include "pose_math.h"
+#include "render_queue.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const int RADIX_BITS = 8;                   // Key bits sorted per pass
+const int RADIX_BUCKETS = 1 << RADIX_BITS;
+
+//|____________________________________________________________________
+//|
+//| Function: MeshMaterial
+//|
+//! \param range  [in] Vertex range of a mesh.
+//! \return Material the mesh is drawn with.
+//|____________________________________________________________________
+
+RenderMaterial MeshMaterial(const MeshRange& range)
+{
+	return range.mode == GL_LINES ? MATERIAL_LINES : MATERIAL_SOLID;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: BeginRenderQueue
+//|
+//! \param queue     [out] Render queue, emptied for a new view.
+//! \param arena     [in,out] Arena of the current frame.
+//! \param capacity  [in] Most items the view will push.
+//! \return None.
+//|____________________________________________________________________
+
+void BeginRenderQueue(RenderQueue& queue, FrameArena& arena, int capacity)
+{
+	queue.count = 0;
+	queue.capacity = capacity;
+	queue.items = ArenaArray<DrawItem>(arena, capacity);
+	queue.order = ArenaArray<uint32_t>(arena, capacity);
+	queue.keys = ArenaArray<uint32_t>(arena, capacity);
+	queue.sort_keys = ArenaArray<uint32_t>(arena, capacity);
+	queue.sort_order = ArenaArray<uint32_t>(arena, capacity);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: PushDrawItem
+//|
+//! \param queue      [in,out] Render queue.
+//! \param mesh       [in] Mesh to draw.
+//! \param world      [in] World matrix; must stay valid until the queue is submitted.
+//! \param scale      [in] Uniform scale after the world matrix.
+//! \param view       [in] World to camera transform, column-major.
+//! \param near_plane [in] Depth range mapped onto the depth bits; items
+//! \param far_plane  [in] outside it share the first or last bucket.
+//! \return None.
+//!
+//! Appends a draw; the item keeps its push position until SortRenderQueue().
+//|____________________________________________________________________
+
+void PushDrawItem(RenderQueue& queue, MeshId mesh, const gmtl::Matrix44f& world, float scale, const float view[16],
+                  float near_plane, float far_plane)
+{
+	PushDrawRange(queue, GetMeshRange(mesh), (uint32_t)mesh, world, scale, view, near_plane, far_plane);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: PushDrawRange
+//|
+//! \param queue      [in,out] Render queue.
+//! \param range      [in] Vertices to draw from the shared mesh buffer.
+//! \param id         [in] Tie-break of the key, below 2^QUEUE_MESH_BITS: the
+//!                        mesh id, or MESH_COUNT and up for baked meshes.
+//! \param world      [in] World matrix; must stay valid until the queue is submitted.
+//! \param scale      [in] Uniform scale after the world matrix.
+//! \param view       [in] World to camera transform, column-major.
+//! \param near_plane [in] Depth range mapped onto the depth bits.
+//! \param far_plane  [in]
+//! \return None.
+//!
+//! A full queue drops the draw.
+//|____________________________________________________________________
+
+void PushDrawRange(RenderQueue& queue, const MeshRange& range, uint32_t id, const gmtl::Matrix44f& world, float scale,
+                   const float view[16], float near_plane, float far_plane)
+{
+	if (queue.count == queue.capacity) {
+		return;
+	}
+	const float* m = world.getData();
+	DrawItem item = { m, range, scale };
+
+	// Depth of the item's origin in front of the camera (the camera looks down -Z)
+	float depth = -(view[2] * m[12] + view[6] * m[13] + view[10] * m[14] + view[14]);
+	float t = (depth - near_plane) / (far_plane - near_plane);
+	if (t < 0) {
+		t = 0;
+	}
+	if (t > 1) {
+		t = 1;
+	}
+	uint32_t bucket = (uint32_t)(t * ((1u << QUEUE_DEPTH_BITS) - 1));
+	uint32_t key = ((uint32_t)MeshMaterial(range) << (QUEUE_DEPTH_BITS + QUEUE_MESH_BITS)) | (bucket << QUEUE_MESH_BITS) |
+	               (id & ((1u << QUEUE_MESH_BITS) - 1));
+
+	queue.order[queue.count] = (uint32_t)queue.count;
+	queue.items[queue.count] = item;
+	queue.keys[queue.count] = key;
+	queue.count++;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SortRenderQueue
+//|
+//! \param queue  [in,out] Render queue.
+//! \return None.
+//!
+//! Orders the items by key with a least-significant-digit radix sort, one
+//! pass per byte. The sort is stable, so equal keys keep their push
+//! order, and a pass whose byte is the same in every key is skipped.
+//|____________________________________________________________________
+
+void SortRenderQueue(RenderQueue& queue)
+{
+	size_t n = queue.count;
+	if (n < 2) {
+		return;
+	}
+
+	uint32_t* keys = queue.keys;
+	uint32_t* order = queue.order;
+	uint32_t* keys_out = queue.sort_keys;
+	uint32_t* order_out = queue.sort_order;
+
+	for (int shift = 0; shift < 32; shift += RADIX_BITS) {
+		size_t counts[RADIX_BUCKETS];
+		memset(counts, 0, sizeof(counts));
+		for (size_t i = 0; i < n; i++) {
+			counts[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+		}
+		if (counts[(keys[0] >> shift) & (RADIX_BUCKETS - 1)] == n) {
+			continue;
+		}
+
+		size_t offset = 0;
+		for (int b = 0; b < RADIX_BUCKETS; b++) {
+			size_t count = counts[b];
+			counts[b] = offset;
+			offset += count;
+		}
+		for (size_t i = 0; i < n; i++) {
+			size_t dest = counts[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+			keys_out[dest] = keys[i];
+			order_out[dest] = order[i];
+		}
+
+		uint32_t* swap = keys;
+		keys = keys_out;
+		keys_out = swap;
+		swap = order;
+		order = order_out;
+		order_out = swap;
+	}
+
+	// An odd number of passes leaves the result in the scratch arrays
+	if (keys != queue.keys) {
+		queue.sort_keys = queue.keys;
+		queue.sort_order = queue.order;
+		queue.keys = keys;
+		queue.order = order;
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SubmitRenderQueue
+//|
+//! \param queue  [in] Render queue.
+//! \return None.
+//!
+//! Draws the items in queue order on top of the current modelview
+//! (the view transform); BindMeshes() must be active.
+//|____________________________________________________________________
+
+void SubmitRenderQueue(const RenderQueue& queue)
+{
+	for (int k = 0; k < queue.count; k++) {
+		const DrawItem& item = queue.items[queue.order[k]];
+		glPushMatrix();
+			glMultMatrixf(item.world);
+			if (item.scale != 1.0f) {
+				glScalef(item.scale, item.scale, item.scale);
+			}
+			glDrawArrays(item.range.mode, item.range.first, item.range.count);
+		glPopMatrix();
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SubmitSoftRenderQueue
+//|
+//! \param queue           [in] Queue, sorted or in push order.
+//! \param raster          [in,out] CPU rasterizer in a pass (see soft_raster.h).
+//! \param view_projection [in] World to clip transform, column-major.
+//! \return None.
+//!
+//! Sets up every queued draw on the CPU rasterizer, in the same order
+//! SubmitRenderQueue() draws them.
+//|____________________________________________________________________
+
+void SubmitSoftRenderQueue(const RenderQueue& queue, SoftRaster& raster, const float view_projection[16])
+{
+	const MeshVertex* vertices = GetMeshVertices();
+
+	for (int k = 0; k < queue.count; k++) {
+		const DrawItem& item = queue.items[queue.order[k]];
+		float mvp[16];
+		MultMatrix(view_projection, item.world, mvp);
+		if (item.scale != 1.0f) {
+			for (int i = 0; i < 12; i++) {
+				mvp[i] *= item.scale;
+			}
+		}
+		SoftDrawArrays(raster, mvp, vertices, item.range);
+	}
+}
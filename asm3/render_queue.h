@@ -0,0 +1,86 @@
+//|___________________________________________________________________
+//!
+//! \file render_queue.h
+//!
+//! \brief Queue of mesh draws sorted by material and depth before submission.
+//!
+//! The traversal pushes one draw item per mesh it wants drawn: the mesh,
+//! the world matrix it is drawn with and its view depth. Each item gets a
+//! 32-bit key, from the most significant bits down: material, quantized
+//! depth, mesh. A radix sort on the keys groups the draws by material and
+//! orders each group front to back, so the depth test rejects hidden
+//! fragments before they are shaded, which is most of the cost of a
+//! software rasterizer.
+//!
+//! All part meshes share one vertex buffer with baked vertex colours, so a
+//! material here is the GL state a draw needs (filled triangles or line
+//! coordinate frames), not a colour. Baked meshes (see turtle_baking.h)
+//! live in the same buffer and are queued by vertex range.
+//!
+//! The queue's arrays live in the frame arena (see frame_arena.h), sized
+//! once per view for every draw the view can queue.
+//|___________________________________________________________________
+
+#pragma once
+
+#include <stdint.h>
+
+#include <gmtl/gmtl.h>
+
+#include "frame_arena.h"
+#include "soft_raster.h"
+#include "turtle_mesh.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+enum RenderMaterial {
+	MATERIAL_SOLID = 0,             // GL_TRIANGLES meshes
+	MATERIAL_LINES,                 // GL_LINES meshes (coordinate frames)
+	MATERIAL_COUNT
+};
+
+const int QUEUE_DEPTH_BITS = 22;    // Depth buckets between the near and far planes
+const int QUEUE_MESH_BITS = 8;      // Mesh ids (then baked meshes), ties within a depth bucket
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+struct DrawItem
+{
+	const float* world;             // Column-major world matrix, e.g. a scene graph node's
+	MeshRange range;                // Vertices drawn from the shared mesh buffer
+	float scale;                    // Uniform scale applied after the world matrix
+};
+
+struct RenderQueue
+{
+	int count;                      // Items queued
+	int capacity;                   // Items the arrays hold; further pushes are dropped
+	DrawItem* items;                // In push order
+	uint32_t* order;                // Item indices in submission order
+	uint32_t* keys;                 // Sort key of each entry of order
+
+	// Scratch of the sort
+	uint32_t* sort_keys;
+	uint32_t* sort_order;
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void BeginRenderQueue(RenderQueue& queue, FrameArena& arena, int capacity);
+void PushDrawItem(RenderQueue& queue, MeshId mesh, const gmtl::Matrix44f& world, float scale, const float view[16],
+                  float near_plane, float far_plane);
+void PushDrawRange(RenderQueue& queue, const MeshRange& range, uint32_t id, const gmtl::Matrix44f& world, float scale,
+                   const float view[16], float near_plane, float far_plane);
+void SortRenderQueue(RenderQueue& queue);
+void SubmitRenderQueue(const RenderQueue& queue);
+void SubmitSoftRenderQueue(const RenderQueue& queue, SoftRaster& raster, const float view_projection[16]);
+RenderMaterial MeshMaterial(const MeshRange& range);
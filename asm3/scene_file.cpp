@@ -0,0 +1,491 @@
+//|___________________________________________________________________
+//!
+//! \file scene_file.cpp
+//!
+//! \brief Versioned binary scene files, memory-mapped and used in place.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "scene_file.h"
+#include "turtle_mesh.h"
+
+//|___________________
+//|
+//| Local Functions
+//|___________________
+
+//|____________________________________________________________________
+//|
+//| Function: SectionFits
+//|
+//! \param file    [in] Mapped file.
+//! \param offset  [in] Section offset.
+//! \param count   [in] Number of records.
+//! \param size    [in] Record size.
+//! \return True if the section lies within the file and is 4-byte aligned.
+//|____________________________________________________________________
+
+static bool SectionFits(const SceneFile& file, uint64_t offset, uint64_t count, size_t size)
+{
+	if (offset % 4 != 0 || offset > file.size) {
+		return false;
+	}
+	return count <= (file.size - offset) / size;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: FindGraphSections
+//|
+//! \param file    [in,out] Mapped file with a checked version 2 header and
+//!                 node table; the graph array pointers are set if the
+//!                 arrays are usable.
+//! \return None.
+//!
+//! The graph is used in place, so besides the section bounds its parents
+//! must be those of the node table (UpdateWorldTransforms() indexes by
+//! them) and its flags must be clear (a dirty node is never marked again,
+//! so its world matrix would go stale). One pass over the mapped arrays.
+//|____________________________________________________________________
+
+static void FindGraphSections(SceneFile& file)
+{
+	const SceneFileHeader* h = file.header;
+	uint64_t nodes = h->turtle_count * TN_COUNT;
+
+	if (h->matrix_size != sizeof(gmtl::Matrix44f) || h->point_size != sizeof(gmtl::Point4f) ||
+	    h->quat_size != sizeof(gmtl::Quatf) || h->parent_offset == 0 ||
+	    !SectionFits(file, h->parent_offset, nodes, sizeof(int32_t)) ||
+	    !SectionFits(file, h->local_offset, nodes, sizeof(gmtl::Matrix44f)) ||
+	    !SectionFits(file, h->world_offset, nodes, sizeof(gmtl::Matrix44f)) ||
+	    !SectionFits(file, h->position_offset, h->turtle_count, sizeof(gmtl::Point4f)) ||
+	    !SectionFits(file, h->orientation_offset, h->turtle_count, sizeof(gmtl::Quatf)) ||
+	    !SectionFits(file, h->joints_offset, h->turtle_count * JOINT_COUNT, sizeof(float)) ||
+	    !SectionFits(file, h->dirty_offset, nodes, 1) ||
+	    !SectionFits(file, h->joint_changes_offset, h->turtle_count, 1) ||
+	    nodes > INT_MAX) {
+		return;
+	}
+
+	unsigned char* base = (unsigned char*)file.data;
+	const int32_t* parent = (const int32_t*)(base + h->parent_offset);
+	const unsigned char* dirty = base + h->dirty_offset;
+	const unsigned char* joint_changes = base + h->joint_changes_offset;
+	for (uint64_t t = 0; t < h->turtle_count; t++) {
+		int32_t root = (int32_t)(t * TN_COUNT);
+		for (int n = 0; n < TN_COUNT; n++) {
+			int desc_parent = file.nodes[n].parent;
+			if (parent[root + n] != (desc_parent < 0 ? -1 : root + desc_parent) || dirty[root + n] != 0) {
+				return;
+			}
+		}
+		if (joint_changes[t] != 0) {
+			return;
+		}
+	}
+
+	file.parent = (int*)(base + h->parent_offset);
+	file.local = (gmtl::Matrix44f*)(base + h->local_offset);
+	file.world = (gmtl::Matrix44f*)(base + h->world_offset);
+	file.position = (gmtl::Point4f*)(base + h->position_offset);
+	file.orientation = (gmtl::Quatf*)(base + h->orientation_offset);
+	file.joints = (float*)(base + h->joints_offset);
+	file.dirty = base + h->dirty_offset;
+	file.joint_changes = base + h->joint_changes_offset;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: WriteSection
+//|
+//! \param f       [in] File being written.
+//! \param data    [in] Section data, NULL for zeros.
+//! \param bytes   [in] Section size.
+//! \param offset  [in,out] File offset, advanced past the section and the
+//!                 padding to the next SCENE_FILE_ALIGNMENT boundary.
+//! \return True on success.
+//|____________________________________________________________________
+
+static bool WriteSection(FILE* f, const void* data, size_t bytes, uint64_t& offset)
+{
+	static const unsigned char zeros[64 * 1024] = { 0 };
+
+	if (data) {
+		if (bytes > 0 && fwrite(data, 1, bytes, f) != bytes) {
+			return false;
+		}
+	}
+	else {
+		for (size_t done = 0; done < bytes; ) {
+			size_t n = bytes - done < sizeof(zeros) ? bytes - done : sizeof(zeros);
+			if (fwrite(zeros, 1, n, f) != n) {
+				return false;
+			}
+			done += n;
+		}
+	}
+	offset += bytes;
+	size_t pad = (size_t)((SCENE_FILE_ALIGNMENT - offset % SCENE_FILE_ALIGNMENT) % SCENE_FILE_ALIGNMENT);
+	offset += pad;
+	return pad == 0 || fwrite(zeros, 1, pad, f) == pad;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: CheckSceneFile
+//|
+//! \param file    [in,out] Mapped file; the section pointers are set.
+//! \param path    [in] File name for the messages.
+//! \return True if the file is a complete scene of this version whose
+//!         node table has the TurtleNode layout.
+//|____________________________________________________________________
+
+static bool CheckSceneFile(SceneFile& file, const char* path)
+{
+	const SceneFileHeader* h = (const SceneFileHeader*)file.data;
+
+	if (file.size < SCENE_FILE_V1_HEADER_SIZE || memcmp(h->magic, SCENE_FILE_MAGIC, sizeof(h->magic)) != 0) {
+		printf("%s is not a scene file\n", path);
+		return false;
+	}
+	bool v1 = h->version == 1 && h->header_size == SCENE_FILE_V1_HEADER_SIZE;
+	bool v2 = h->version == SCENE_FILE_VERSION && h->header_size == sizeof(SceneFileHeader) &&
+	          file.size >= sizeof(SceneFileHeader);
+	if (!v1 && !v2) {
+		printf("%s is scene file version %u, expected 1 or %u\n", path, h->version, SCENE_FILE_VERSION);
+		return false;
+	}
+	if (h->node_count != TN_COUNT || h->turtle_count < 2 ||
+	    !SectionFits(file, h->model_offset, 1, sizeof(TurtleModel)) ||
+	    !SectionFits(file, h->nodes_offset, h->node_count, sizeof(SceneFileNode)) ||
+	    !SectionFits(file, h->turtles_offset, h->turtle_count, sizeof(SceneFileTurtle))) {
+		printf("%s is truncated or has bad section sizes\n", path);
+		return false;
+	}
+
+	const unsigned char* base = (const unsigned char*)file.data;
+	file.header = h;
+	file.model = (const TurtleModel*)(base + h->model_offset);
+	file.nodes = (const SceneFileNode*)(base + h->nodes_offset);
+	file.turtles = (const SceneFileTurtle*)(base + h->turtles_offset);
+
+	// Culling, LOD and instancing are built around the TurtleNode hierarchy
+	for (int n = 0; n < TN_COUNT; n++) {
+		const SceneFileNode& node = file.nodes[n];
+		const TurtleNodeDesc& desc = GetTurtleNodeDesc((TurtleNode)n);
+		if (node.parent != desc.parent || node.subtree_size != desc.subtree_size ||
+		    node.joint < JOINT_NONE || node.joint >= JOINT_COUNT) {
+			printf("%s: node %d does not match the turtle hierarchy\n", path, n);
+			file.header = NULL;
+			return false;
+		}
+	}
+
+	if (v2) {
+		FindGraphSections(file);
+	}
+	return true;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: MapSceneFile
+//|
+//! \param path    [in] Scene file.
+//! \param file    [out] Mapping and its sections.
+//! \return True if the file is mapped and valid.
+//!
+//! Maps the file copy-on-write: a scene graph viewing it may change its
+//! pages, but the file is never written. It stays mapped until
+//! UnmapSceneFile().
+//|____________________________________________________________________
+
+bool MapSceneFile(const char* path, SceneFile& file)
+{
+	memset(&file, 0, sizeof(file));
+
+#ifdef _WIN32
+	HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	LARGE_INTEGER size;
+	if (f == INVALID_HANDLE_VALUE || !GetFileSizeEx(f, &size) || size.QuadPart == 0) {
+		printf("Cannot open scene file %s\n", path);
+		if (f != INVALID_HANDLE_VALUE) {
+			CloseHandle(f);
+		}
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(f, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0) : NULL;
+	if (!data) {
+		printf("Cannot map scene file %s\n", path);
+		if (mapping) {
+			CloseHandle(mapping);
+		}
+		CloseHandle(f);
+		return false;
+	}
+	file.file_handle = f;
+	file.mapping_handle = mapping;
+	file.size = (size_t)size.QuadPart;
+#else
+	int fd = open(path, O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+		printf("Cannot open scene file %s\n", path);
+		if (fd >= 0) {
+			close(fd);
+		}
+		return false;
+	}
+	void* data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);                              // The mapping keeps the file open
+	if (data == MAP_FAILED) {
+		printf("Cannot map scene file %s\n", path);
+		return false;
+	}
+	file.size = (size_t)st.st_size;
+#endif
+	file.data = data;
+
+	if (!CheckSceneFile(file, path)) {
+		UnmapSceneFile(file);
+		return false;
+	}
+	return true;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: UnmapSceneFile
+//|
+//! \param file    [in,out] Mapped file, cleared.
+//! \return None.
+//|____________________________________________________________________
+
+void UnmapSceneFile(SceneFile& file)
+{
+	if (file.data) {
+#ifdef _WIN32
+		UnmapViewOfFile(file.data);
+		CloseHandle(file.mapping_handle);
+		CloseHandle(file.file_handle);
+#else
+		munmap(file.data, file.size);
+#endif
+	}
+	memset(&file, 0, sizeof(file));
+}
+
+//|____________________________________________________________________
+//|
+//| Function: ApplySceneFile
+//|
+//! \param file    [in] Mapped file.
+//! \return None.
+//!
+//! Makes the file's model and node table current. Call before the scene
+//! graph and the meshes are built.
+//|____________________________________________________________________
+
+void ApplySceneFile(const SceneFile& file)
+{
+	SetTurtleModel(*file.model);
+
+	for (int n = 0; n < TN_COUNT; n++) {
+		const SceneFileNode& node = file.nodes[n];
+		TurtleNodeDesc desc;
+		desc.parent = node.parent;
+		desc.subtree_size = node.subtree_size;
+		desc.offset.set(node.offset[0], node.offset[1], node.offset[2]);
+		desc.joint = node.joint;
+		desc.axis.set(node.axis[0], node.axis[1], node.axis[2]);
+		desc.tilt = node.tilt;
+		SetTurtleNodeDesc((TurtleNode)n, desc);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: ViewSceneFileGraph
+//|
+//! \param file    [in] Mapped file.
+//! \param scene   [out] Scene graph of the file's turtles, viewing its arrays.
+//! \return False if the file has no usable graph arrays (scene untouched).
+//!
+//! Takes the scene in place: all of its arrays point into the mapping,
+//! whose world matrices are current and whose flags are clear, so no node
+//! is dirty and nothing is allocated, copied or computed per turtle. The file must stay mapped
+//! while the scene uses it.
+//|____________________________________________________________________
+
+bool ViewSceneFileGraph(const SceneFile& file, SceneGraph& scene)
+{
+	if (!file.parent) {
+		return false;
+	}
+
+	size_t count = (size_t)file.header->turtle_count;
+	size_t nodes = count * TN_COUNT;
+
+	scene = SceneGraph();
+	scene.parent.View(file.parent, nodes);
+	scene.local.View(file.local, nodes);
+	scene.world.View(file.world, nodes);
+	scene.position.View(file.position, count);
+	scene.orientation.View(file.orientation, count);
+	scene.joints.View(file.joints, count * JOINT_COUNT);
+	scene.dirty.View(file.dirty, nodes);
+	scene.joint_changes.View(file.joint_changes, count);
+	return true;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: PackSceneFileTurtles
+//|
+//! \param scene   [in] Scene graph.
+//! \param turtles [out] Pose and joint angles of every turtle, in order.
+//! \return None.
+//|____________________________________________________________________
+
+void PackSceneFileTurtles(const SceneGraph& scene, std::vector<SceneFileTurtle>& turtles)
+{
+	turtles.resize(TurtleCount(scene));
+	if (!turtles.empty()) {
+		PackSceneFileTurtles(scene, &turtles[0], (int)turtles.size());
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: PackSceneFileTurtles
+//|
+//! \param scene   [in] Scene graph.
+//! \param turtles [out] Pose and joint angles of the first count turtles
+//!                       (e.g. straight into a pose share slot).
+//! \param count   [in] Turtles to pack, at most TurtleCount(scene).
+//! \return None.
+//|____________________________________________________________________
+
+void PackSceneFileTurtles(const SceneGraph& scene, SceneFileTurtle* turtles, int count)
+{
+	for (int t = 0; t < count; t++) {
+		SceneFileTurtle& record = turtles[t];
+		for (int i = 0; i < 3; i++) {
+			record.position[i] = scene.position[t][i];
+		}
+		for (int i = 0; i < 4; i++) {
+			record.orientation[i] = scene.orientation[t][i];
+		}
+		for (int j = 0; j < JOINT_COUNT; j++) {
+			record.joints[j] = scene.joints[t * JOINT_COUNT + j];
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: WriteSceneFile
+//|
+//! \param path    [in] Scene file, overwritten.
+//! \param model   [in] Dimensions and colours.
+//! \param scene   [in] Scene graph with current world matrices (see
+//!                 UpdateWorldTransforms()); the first two turtles are the
+//!                 controllable ones.
+//! \return True on success.
+//!
+//! Writes the current node table (GetTurtleNodeDesc()) with the model,
+//! the turtles' records and the graph arrays; the dirty and joint change
+//! flags are written cleared.
+//|____________________________________________________________________
+
+bool WriteSceneFile(const char* path, const TurtleModel& model, const SceneGraph& scene)
+{
+	FILE* f = fopen(path, "wb");
+	if (!f) {
+		printf("Cannot create scene file %s\n", path);
+		return false;
+	}
+
+	SceneFileNode nodes[TN_COUNT];
+	for (int n = 0; n < TN_COUNT; n++) {
+		const TurtleNodeDesc& desc = GetTurtleNodeDesc((TurtleNode)n);
+		nodes[n].parent = desc.parent;
+		nodes[n].subtree_size = desc.subtree_size;
+		nodes[n].joint = desc.joint;
+		nodes[n].tilt = desc.tilt;
+		for (int i = 0; i < 3; i++) {
+			nodes[n].offset[i] = desc.offset[i];
+			nodes[n].axis[i] = desc.axis[i];
+		}
+	}
+
+	std::vector<SceneFileTurtle> turtles;
+	PackSceneFileTurtles(scene, turtles);
+	size_t count = turtles.size();
+	size_t node_count = scene.world.size();
+
+	// Sections in file order, each offset known before it is written
+	SceneFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SCENE_FILE_MAGIC, sizeof(header.magic));
+	header.version = SCENE_FILE_VERSION;
+	header.header_size = sizeof(SceneFileHeader);
+	header.node_count = TN_COUNT;
+	header.turtle_count = count;
+	header.matrix_size = sizeof(gmtl::Matrix44f);
+	header.point_size = sizeof(gmtl::Point4f);
+	header.quat_size = sizeof(gmtl::Quatf);
+
+	const void* data[] = { &header, &model, nodes, turtles.empty() ? NULL : &turtles[0],
+	                       scene.parent.begin(), scene.local.begin(), scene.world.begin(),
+	                       scene.position.begin(), scene.orientation.begin(), scene.joints.begin(), NULL, NULL };
+	size_t bytes[] = { sizeof(header), sizeof(model), sizeof(nodes), count * sizeof(SceneFileTurtle),
+	                   node_count * sizeof(int), node_count * sizeof(gmtl::Matrix44f), node_count * sizeof(gmtl::Matrix44f),
+	                   count * sizeof(gmtl::Point4f), count * sizeof(gmtl::Quatf), count * JOINT_COUNT * sizeof(float),
+	                   node_count, count };
+	uint64_t* offsets[] = { NULL, &header.model_offset, &header.nodes_offset, &header.turtles_offset,
+	                        &header.parent_offset, &header.local_offset, &header.world_offset,
+	                        &header.position_offset, &header.orientation_offset, &header.joints_offset,
+	                        &header.dirty_offset, &header.joint_changes_offset };
+	const int sections = sizeof(bytes) / sizeof(bytes[0]);
+
+	uint64_t offset = 0;
+	for (int i = 0; i < sections; i++) {
+		if (offsets[i]) {
+			*offsets[i] = offset;
+		}
+		offset += bytes[i];
+		offset += (SCENE_FILE_ALIGNMENT - offset % SCENE_FILE_ALIGNMENT) % SCENE_FILE_ALIGNMENT;
+	}
+
+	bool ok = true;
+	offset = 0;
+	for (int i = 0; i < sections && ok; i++) {
+		ok = WriteSection(f, data[i], bytes[i], offset);
+	}
+	ok = fclose(f) == 0 && ok;
+	if (!ok) {
+		printf("Cannot write scene file %s\n", path);
+	}
+	return ok;
+}
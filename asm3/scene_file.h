@@ -0,0 +1,137 @@
+//|___________________________________________________________________
+//!
+//! \file scene_file.h
+//!
+//! \brief Versioned binary scene files, memory-mapped and used in place.
+//!
+//! A scene file holds the turtle model (dimensions and colours), the node
+//! table of the turtle hierarchy and the initial pose and joint angles of
+//! every turtle; the first two turtles are the controllable ones. All
+//! records are fixed-size plain data in native byte order, at offsets
+//! given by the header, so loading is one mmap() and a few bounds checks:
+//! nothing is parsed or copied until the scene is built from it.
+//!
+//! Version 2 also stores the scene graph itself: its node and pose arrays
+//! (parents, local and world matrices, positions, orientations, joint
+//! angles, and the cleared dirty and joint change flags) in the SceneGraph
+//! layout, 64-byte aligned. ViewSceneFileGraph()
+//! points the graph at them, so even a million turtles start without a
+//! copy: pages are read as they are first touched, and the mapping is
+//! private, so the scene's changes never reach the file. The arrays hold
+//! gmtl types, so they are only used when the reader's type sizes match
+//! the writer's, and only when their parents follow the node table and
+//! their flags are clear; otherwise the scene is built from the turtle
+//! records, as for a version 1 file.
+//!
+//! Layout: SceneFileHeader | TurtleModel | SceneFileNode[node_count] |
+//!         SceneFileTurtle[turtle_count] | graph arrays (version 2)
+//|___________________________________________________________________
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "scene_graph.h"
+#include "turtle_model.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const char SCENE_FILE_MAGIC[4] = { 'T', 'S', 'C', 'N' };
+const uint32_t SCENE_FILE_VERSION = 2;
+const uint64_t SCENE_FILE_ALIGNMENT = 64;     // Of the graph arrays (version 2)
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+struct SceneFileHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t header_size;       // sizeof(SceneFileHeader), lets later versions append fields
+	uint32_t node_count;        // Nodes per turtle (TN_COUNT)
+	uint64_t turtle_count;
+	uint64_t model_offset;      // Byte offsets from the start of the file
+	uint64_t nodes_offset;
+	uint64_t turtles_offset;
+
+	// Version 2: the scene graph's arrays, 0 offsets if absent
+	uint32_t matrix_size;       // sizeof(gmtl::Matrix44f) of the writer
+	uint32_t point_size;        // sizeof(gmtl::Point4f)
+	uint32_t quat_size;         // sizeof(gmtl::Quatf)
+	uint32_t reserved;
+	uint64_t parent_offset;     // int32_t per node
+	uint64_t local_offset;      // gmtl::Matrix44f per node
+	uint64_t world_offset;      // gmtl::Matrix44f per node, up to date
+	uint64_t position_offset;   // gmtl::Point4f per turtle
+	uint64_t orientation_offset; // gmtl::Quatf per turtle
+	uint64_t joints_offset;     // JOINT_COUNT floats per turtle
+	uint64_t dirty_offset;      // Zero byte per node
+	uint64_t joint_changes_offset;  // Zero byte per turtle
+};
+
+const uint32_t SCENE_FILE_V1_HEADER_SIZE = offsetof(SceneFileHeader, matrix_size);
+
+// TurtleNodeDesc without gmtl types
+struct SceneFileNode
+{
+	int32_t parent;
+	int32_t subtree_size;
+	float offset[3];
+	int32_t joint;
+	float axis[3];
+	float tilt;
+};
+
+struct SceneFileTurtle
+{
+	float position[3];
+	float orientation[4];       // Quaternion (x, y, z, w)
+	float joints[JOINT_COUNT];  // Joint angles (degs), see TurtleJoint
+};
+
+// A mapped scene file; the pointers address the mapping directly
+struct SceneFile
+{
+	const SceneFileHeader* header;      // NULL when no file is mapped
+	const TurtleModel* model;
+	const SceneFileNode* nodes;
+	const SceneFileTurtle* turtles;
+
+	// Scene graph arrays (version 2), NULL when absent, not of this build's layout or not consistent
+	int* parent;
+	gmtl::Matrix44f* local;
+	gmtl::Matrix44f* world;
+	gmtl::Point4f* position;
+	gmtl::Quatf* orientation;
+	float* joints;
+	unsigned char* dirty;
+	unsigned char* joint_changes;
+
+	void* data;
+	size_t size;
+#ifdef _WIN32
+	void* file_handle;
+	void* mapping_handle;
+#endif
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+bool MapSceneFile(const char* path, SceneFile& file);
+void UnmapSceneFile(SceneFile& file);
+void ApplySceneFile(const SceneFile& file);
+bool ViewSceneFileGraph(const SceneFile& file, SceneGraph& scene);
+void PackSceneFileTurtles(const SceneGraph& scene, std::vector<SceneFileTurtle>& turtles);
+void PackSceneFileTurtles(const SceneGraph& scene, SceneFileTurtle* turtles, int count);
+bool WriteSceneFile(const char* path, const TurtleModel& model, const SceneGraph& scene);
@@ -0,0 +1,362 @@
+//|___________________________________________________________________
+//!
+//! \file scene_graph.cpp
+//!
+//! \brief Retained turtle hierarchy with cached world matrices.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include "scene_graph.h"
+#include "turtle_model.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+// Defaults from turtle_model.h; a scene file may replace them (SetTurtleNodeDesc())
+static TurtleNodeDesc turtle_nodes[TN_COUNT] = {
+	// TN_BODY: posed directly by SetTurtlePose()
+	{ -1,             TN_COUNT, gmtl::Vec3f(0, 0, 0),                              JOINT_NONE,        gmtl::Vec3f(0, 0, 1), 0 },
+	// TN_HEAD, TN_LEFT_EYE, TN_RIGHT_EYE
+	{ TN_BODY,        3,        HEAD_POS,                                          JOINT_NONE,        gmtl::Vec3f(0, 0, 1), 0 },
+	{ TN_HEAD,        1,        gmtl::Vec3f(-EYE_POS[0], EYE_POS[1], EYE_POS[2]),  JOINT_NONE,        gmtl::Vec3f(0, 0, 1), 0 },
+	{ TN_HEAD,        1,        EYE_POS,                                           JOINT_NONE,        gmtl::Vec3f(0, 0, 1), 0 },
+	// TN_WING_RF, TN_WING_LF, TN_WING_RB, TN_WING_LB
+	{ TN_BODY,        1,        gmtl::Vec3f(WING_POS[0], WING_POS[1], WING_POS[2]),   JOINT_WING_RIGHT, gmtl::Vec3f(0, 0, 1), 0 },
+	{ TN_BODY,        1,        gmtl::Vec3f(-WING_POS[0], WING_POS[1], WING_POS[2]),  JOINT_WING_LEFT,  gmtl::Vec3f(0, 0, 1), 0 },
+	{ TN_BODY,        1,        gmtl::Vec3f(WING_POS[0], WING_POS[1], -WING_POS[2]),  JOINT_WING_RIGHT, gmtl::Vec3f(0, 0, 1), 0 },
+	{ TN_BODY,        1,        gmtl::Vec3f(-WING_POS[0], WING_POS[1], -WING_POS[2]), JOINT_WING_LEFT,  gmtl::Vec3f(0, 0, 1), 0 },
+	// TN_CANNON_BASE, TN_CANNON
+	{ TN_BODY,        2,        CANNON_BASE_POS,                                   JOINT_CANNON_BASE, gmtl::Vec3f(0, 1, 0), 0 },
+	{ TN_CANNON_BASE, 1,        CANNON_POS,                                        JOINT_CANNON,      gmtl::Vec3f(0, 1, 0), CANNON_TILT },
+};
+
+//|___________________
+//|
+//| Global Variables
+//|___________________
+
+static gmtl::Matrix44f rest_local[TN_COUNT];    // Local transform of each node with its joint at 0 degs
+static bool rest_local_valid = false;
+
+//|___________________
+//|
+//| Local Functions
+//|___________________
+
+//|____________________________________________________________________
+//|
+//| Function: MarkDirty
+//|
+//! \param scene   [in,out] Scene graph.
+//! \param node    [in] Node whose subtree needs new world matrices.
+//! \return None.
+//!
+//! Queues a node for the next UpdateWorldTransforms().
+//|____________________________________________________________________
+
+static void MarkDirty(SceneGraph& scene, int node)
+{
+	if (!scene.dirty[node]) {
+		scene.dirty[node] = 1;
+		scene.dirty_nodes.push_back(node);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: ComposeBodyLocal
+//|
+//! \param scene   [in,out] Scene graph.
+//! \param turtle  [in] Turtle index.
+//! \return None.
+//!
+//! Rebuilds a body's local (= world) transform from the turtle's pose.
+//|____________________________________________________________________
+
+static void ComposeBodyLocal(SceneGraph& scene, int turtle)
+{
+	const gmtl::Point4f& p = scene.position[turtle];
+	int body = TurtleNodeId(turtle, TN_BODY);
+
+	scene.local[body] = gmtl::makeTrans<gmtl::Matrix44f>(gmtl::Vec3f(p[0], p[1], p[2])) *
+	                    gmtl::makeRot<gmtl::Matrix44f>(scene.orientation[turtle]);
+	MarkDirty(scene, body);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: AddTurtle
+//|
+//! \param scene   [in,out] Scene graph.
+//! \param p       [in] Initial position.
+//! \param q       [in] Initial orientation.
+//! \return Index of the new turtle.
+//!
+//! Appends a turtle hierarchy with all joints at 0 degs. The parts'
+//! local transforms at rest are computed once and copied.
+//|____________________________________________________________________
+
+int AddTurtle(SceneGraph& scene, const gmtl::Point4f& p, const gmtl::Quatf& q)
+{
+	int turtle = TurtleCount(scene);
+	int first = TurtleNodeId(turtle, TN_BODY);
+
+	if (!rest_local_valid) {
+		for (int i = TN_BODY + 1; i < TN_COUNT; i++) {
+			rest_local[i] = JointLocal((TurtleNode)i, 0.0f);
+		}
+		rest_local_valid = true;
+	}
+
+	scene.position.push_back(p);
+	scene.orientation.push_back(q);
+	scene.joints.resize(scene.joints.size() + JOINT_COUNT, 0.0f);
+	scene.joint_changes.push_back(0);
+
+	scene.local.resize(first + TN_COUNT);
+	scene.world.resize(first + TN_COUNT);
+	scene.dirty.resize(first + TN_COUNT, 0);
+	for (int i = 0; i < TN_COUNT; i++) {
+		int parent = turtle_nodes[i].parent;
+		scene.parent.push_back(parent < 0 ? -1 : first + parent);
+	}
+
+	ComposeBodyLocal(scene, turtle);
+	for (int i = TN_BODY + 1; i < TN_COUNT; i++) {
+		scene.local[first + i] = rest_local[i];
+		MarkDirty(scene, first + i);
+	}
+
+	return turtle;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: ReserveTurtles
+//|
+//! \param scene   [in,out] Scene graph.
+//! \param count   [in] Total number of turtles about to be held.
+//! \return None.
+//!
+//! Allocates the arrays once before a large batch of AddTurtle() calls.
+//|____________________________________________________________________
+
+void ReserveTurtles(SceneGraph& scene, int count)
+{
+	size_t nodes = (size_t)count * TN_COUNT;
+
+	scene.parent.reserve(nodes);
+	scene.local.reserve(nodes);
+	scene.world.reserve(nodes);
+	scene.dirty.reserve(nodes);
+	scene.dirty_nodes.reserve(nodes);
+	scene.position.reserve(count);
+	scene.orientation.reserve(count);
+	scene.joints.reserve((size_t)count * JOINT_COUNT);
+	scene.joint_changes.reserve(count);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: GetTurtleNodeDesc
+//|
+//! \param node   [in] Node type.
+//! \return Fixed placement of the node w.r.t. its parent.
+//|____________________________________________________________________
+
+const TurtleNodeDesc& GetTurtleNodeDesc(TurtleNode node)
+{
+	return turtle_nodes[node];
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SetTurtleNodeDesc
+//|
+//! \param node   [in] Node type.
+//! \param desc   [in] New placement; parent and subtree size must keep
+//!                    the TurtleNode layout.
+//! \return None.
+//!
+//! Applies to turtles added afterwards; call before building the scene.
+//|____________________________________________________________________
+
+void SetTurtleNodeDesc(TurtleNode node, const TurtleNodeDesc& desc)
+{
+	turtle_nodes[node] = desc;
+	rest_local_valid = false;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: JointLocal
+//|
+//! \param type    [in] Non-body node type.
+//! \param angle   [in] Angle of the node's joint (degs), ignored if rigid.
+//! \return Local transform of the node.
+//|____________________________________________________________________
+
+gmtl::Matrix44f JointLocal(TurtleNode type, float angle)
+{
+	const TurtleNodeDesc& desc = turtle_nodes[type];
+
+	gmtl::Matrix44f m = gmtl::makeTrans<gmtl::Matrix44f>(desc.offset);
+	if (desc.joint != JOINT_NONE) {
+		m = m * gmtl::makeRot<gmtl::Matrix44f>(gmtl::AxisAnglef(gmtl::Math::deg2Rad(angle), desc.axis));
+	}
+	if (desc.tilt != 0) {
+		m = m * gmtl::makeRot<gmtl::Matrix44f>(gmtl::AxisAnglef(gmtl::Math::deg2Rad(desc.tilt), 1.0f, 0.0f, 0.0f));
+	}
+	return m;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SetTurtlePose
+//|
+//! \param scene   [in,out] Scene graph.
+//! \param turtle  [in] Turtle index.
+//! \param p       [in] New position.
+//! \param q       [in] New orientation.
+//! \return None.
+//!
+//! Updates a turtle's pose; the whole turtle is dirtied only if the pose changed.
+//|____________________________________________________________________
+
+void SetTurtlePose(SceneGraph& scene, int turtle, const gmtl::Point4f& p, const gmtl::Quatf& q)
+{
+	const gmtl::Point4f& p_old = scene.position[turtle];
+	const gmtl::Quatf& q_old = scene.orientation[turtle];
+
+	if (p_old[0] == p[0] && p_old[1] == p[1] && p_old[2] == p[2] &&
+	    q_old[0] == q[0] && q_old[1] == q[1] && q_old[2] == q[2] && q_old[3] == q[3]) {
+		return;
+	}
+
+	scene.position[turtle] = p;
+	scene.orientation[turtle] = q;
+	ComposeBodyLocal(scene, turtle);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SetTurtleJoint
+//|
+//! \param scene   [in,out] Scene graph.
+//! \param turtle  [in] Turtle index.
+//! \param joint   [in] Joint to set.
+//! \param angle   [in] New joint angle (degs).
+//! \return None.
+//!
+//! Updates a joint angle; only the subtrees driven by that joint are
+//! dirtied, and the change is recorded in the turtle's joint_changes.
+//|____________________________________________________________________
+
+void SetTurtleJoint(SceneGraph& scene, int turtle, TurtleJoint joint, float angle)
+{
+	if (StageTurtleJoint(scene, turtle, joint, angle)) {
+		CommitTurtleJoints(scene, turtle, 1u << joint);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: StageTurtleJoint
+//|
+//! \param scene   [in,out] Scene graph.
+//! \param turtle  [in] Turtle index.
+//! \param joint   [in] Joint to set.
+//! \param angle   [in] New joint angle (degs).
+//! \return True if the angle changed; the change must then be committed.
+//!
+//! First half of SetTurtleJoint(): sets the angle and rebuilds the local
+//! transforms it drives. Writes only the turtle's own entries, so
+//! different turtles can be staged on different threads.
+//|____________________________________________________________________
+
+bool StageTurtleJoint(SceneGraph& scene, int turtle, TurtleJoint joint, float angle)
+{
+	float& current = scene.joints[turtle * JOINT_COUNT + joint];
+
+	if (current == angle) {
+		return false;
+	}
+	current = angle;
+
+	for (int i = TN_BODY + 1; i < TN_COUNT; i++) {
+		if (turtle_nodes[i].joint == joint) {
+			int node = TurtleNodeId(turtle, (TurtleNode)i);
+			scene.local[node] = JointLocal((TurtleNode)i, angle);
+		}
+	}
+	return true;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: CommitTurtleJoints
+//|
+//! \param scene   [in,out] Scene graph.
+//! \param turtle  [in] Turtle index.
+//! \param joints  [in] Bit per joint staged by StageTurtleJoint().
+//! \return None.
+//!
+//! Second half of SetTurtleJoint(): dirties the subtrees of the staged
+//! joints and records them in joint_changes. Appends to the scene's
+//! lists, so commits run on one thread.
+//|____________________________________________________________________
+
+void CommitTurtleJoints(SceneGraph& scene, int turtle, unsigned int joints)
+{
+	if (!scene.joint_changes[turtle]) {
+		scene.changed_turtles.push_back(turtle);
+	}
+	scene.joint_changes[turtle] |= (unsigned char)joints;
+
+	for (int i = TN_BODY + 1; i < TN_COUNT; i++) {
+		int joint = turtle_nodes[i].joint;
+		if (joint != JOINT_NONE && (joints & (1u << joint))) {
+			MarkDirty(scene, TurtleNodeId(turtle, (TurtleNode)i));
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: UpdateWorldTransforms
+//|
+//! \param scene   [in,out] Scene graph.
+//! \return None.
+//!
+//! Recomputes the world matrices of every dirty subtree. Nodes whose
+//! ancestors and selves are clean keep their cached matrices, so the
+//! cost follows the number of changed nodes rather than the scene size.
+//|____________________________________________________________________
+
+void UpdateWorldTransforms(SceneGraph& scene)
+{
+	for (size_t k = 0; k < scene.dirty_nodes.size(); k++) {
+		int root = scene.dirty_nodes[k];
+
+		// Already refreshed as part of an ancestor's subtree
+		if (!scene.dirty[root]) {
+			continue;
+		}
+
+		// Preorder storage: parents are always refreshed before their children
+		int end = root + turtle_nodes[NodeType(root)].subtree_size;
+		for (int i = root; i < end; i++) {
+			int parent = scene.parent[i];
+			scene.world[i] = (parent < 0) ? scene.local[i] : scene.world[parent] * scene.local[i];
+			scene.dirty[i] = 0;
+		}
+	}
+
+	scene.dirty_nodes.clear();
+}
@@ -0,0 +1,198 @@
+//|___________________________________________________________________
+//!
+//! \file scene_graph.h
+//!
+//! \brief Retained turtle hierarchy with cached world matrices.
+//!
+//! Every turtle owns TN_COUNT consecutive nodes stored in preorder, so a
+//! node's subtree is the contiguous range [node, node + subtree size).
+//! Nodes are kept in flat, parent-indexed arrays. Changing a pose or a
+//! joint angle only marks the affected node dirty; UpdateWorldTransforms()
+//! then recomputes the dirty subtrees and nothing else. Joint changes are
+//! also recorded per turtle for consumers of the joint angles that cache
+//! work of their own (see turtle_baking.h).
+//!
+//! The node and pose arrays can also view memory the graph does not own,
+//! such as a mapped scene file (see scene_file.h): a large scene is then
+//! used in place rather than built. Writes go straight to that memory;
+//! only growing an array copies it out first.
+//|___________________________________________________________________
+
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include <gmtl/gmtl.h>
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+// Nodes of one turtle, in preorder (body -> head/eyes, four wings, cannon base -> cannon)
+enum TurtleNode {
+	TN_BODY = 0,
+	TN_HEAD,
+	TN_LEFT_EYE,
+	TN_RIGHT_EYE,
+	TN_WING_RF,             // Right front wing
+	TN_WING_LF,             // Left front wing
+	TN_WING_RB,             // Right back wing
+	TN_WING_LB,             // Left back wing
+	TN_CANNON_BASE,
+	TN_CANNON,
+	TN_COUNT
+};
+
+// Animated joints of one turtle (angles in degs)
+enum TurtleJoint {
+	JOINT_WING_RIGHT = 0,   // Both right wings, about local Z
+	JOINT_WING_LEFT,        // Both left wings, about local Z
+	JOINT_CANNON_BASE,      // Cannon base, about local Y
+	JOINT_CANNON,           // Cannon, about local Y
+	JOINT_COUNT
+};
+
+const int JOINT_NONE = -1;
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+// Array of a scene graph. Owns growable storage like a std::vector, or
+// views memory of someone else until it is first grown.
+template <typename T>
+struct SceneArray
+{
+	std::vector<T> owned;
+	T* items;                   // owned's data, or the viewed memory
+	size_t count;
+	bool viewing;
+
+	SceneArray() : items(NULL), count(0), viewing(false) {}
+	SceneArray(const SceneArray& other) : owned(other.begin(), other.end()), viewing(false) { Sync(); }
+	SceneArray& operator=(const SceneArray& other)
+	{
+		if (this != &other) {
+			owned.assign(other.begin(), other.end());
+			viewing = false;
+			Sync();
+		}
+		return *this;
+	}
+	SceneArray(SceneArray&& other) : items(NULL), count(0), viewing(false) { *this = std::move(other); }
+	SceneArray& operator=(SceneArray&& other)
+	{
+		if (this != &other) {
+			owned = std::move(other.owned);
+			items = other.items;
+			count = other.count;
+			viewing = other.viewing;
+			other.owned.clear();
+			other.viewing = false;
+			other.Sync();
+		}
+		return *this;
+	}
+
+	// Points the array at count elements it does not own (they must outlive it)
+	void View(T* data, size_t n)
+	{
+		owned.clear();
+		owned.shrink_to_fit();
+		items = data;
+		count = n;
+		viewing = true;
+	}
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	T& operator[](size_t i) { return items[i]; }
+	const T& operator[](size_t i) const { return items[i]; }
+	T* begin() { return items; }
+	T* end() { return items + count; }
+	const T* begin() const { return items; }
+	const T* end() const { return items + count; }
+
+	void push_back(const T& value) { Own(); owned.push_back(value); Sync(); }
+	void resize(size_t n) { Own(); owned.resize(n); Sync(); }
+	void resize(size_t n, const T& value) { Own(); owned.resize(n, value); Sync(); }
+	void assign(size_t n, const T& value) { viewing = false; owned.assign(n, value); Sync(); }
+	void clear() { viewing = false; owned.clear(); Sync(); }
+	void reserve(size_t n)
+	{
+		if (n > count) {
+			Own();
+			owned.reserve(n);
+			Sync();
+		}
+	}
+
+	// Copies viewed elements into owned storage, before it grows
+	void Own()
+	{
+		if (viewing) {
+			owned.assign(items, items + count);
+			viewing = false;
+		}
+	}
+	void Sync()
+	{
+		items = owned.empty() ? NULL : &owned[0];
+		count = owned.size();
+	}
+};
+
+// Fixed part of a node's local transform: local = T(offset) * R(axis, joint angle) * Rx(tilt)
+struct TurtleNodeDesc
+{
+	int parent;             // Parent node within the turtle, -1 for the body
+	int subtree_size;       // Node itself plus all of its descendants
+	gmtl::Vec3f offset;     // Position w.r.t. the parent's frame
+	int joint;              // Joint driving the rotation, JOINT_NONE if rigid
+	gmtl::Vec3f axis;       // Joint rotation axis
+	float tilt;             // Fixed rotation about X after the joint (degs)
+};
+
+struct SceneGraph
+{
+	// Per node (flat arrays indexed by node id)
+	SceneArray<int> parent;                     // Parent node id, -1 for a turtle's body
+	SceneArray<gmtl::Matrix44f> local;          // Transform w.r.t. the parent
+	SceneArray<gmtl::Matrix44f> world;          // Cached transform w.r.t. the world
+	SceneArray<unsigned char> dirty;            // Set when world needs recomputing
+
+	// Per turtle
+	SceneArray<gmtl::Point4f> position;
+	SceneArray<gmtl::Quatf> orientation;
+	SceneArray<float> joints;                   // JOINT_COUNT angles per turtle
+	SceneArray<unsigned char> joint_changes;    // Bit per joint changed since the consumer last cleared it
+
+	// Turtles with joint changes pending (listed once, while joint_changes is non-zero)
+	std::vector<int> changed_turtles;
+
+	// Nodes whose subtree must be recomputed by the next update
+	std::vector<int> dirty_nodes;
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+int AddTurtle(SceneGraph& scene, const gmtl::Point4f& p, const gmtl::Quatf& q);
+void ReserveTurtles(SceneGraph& scene, int count);
+void SetTurtlePose(SceneGraph& scene, int turtle, const gmtl::Point4f& p, const gmtl::Quatf& q);
+void SetTurtleJoint(SceneGraph& scene, int turtle, TurtleJoint joint, float angle);
+bool StageTurtleJoint(SceneGraph& scene, int turtle, TurtleJoint joint, float angle);
+void CommitTurtleJoints(SceneGraph& scene, int turtle, unsigned int joints);
+void UpdateWorldTransforms(SceneGraph& scene);
+gmtl::Matrix44f JointLocal(TurtleNode type, float angle);
+const TurtleNodeDesc& GetTurtleNodeDesc(TurtleNode node);
+void SetTurtleNodeDesc(TurtleNode node, const TurtleNodeDesc& desc);
+
+inline int TurtleCount(const SceneGraph& scene) { return (int)scene.position.size(); }
+inline int TurtleNodeId(int turtle, TurtleNode node) { return turtle * TN_COUNT + node; }
+inline TurtleNode NodeType(int node) { return (TurtleNode)(node % TN_COUNT); }
@@ -0,0 +1,1614 @@
+//|___________________________________________________________________
+//!
+//! \file soft_raster.cpp
+//!
+//! \brief Tile-based, multithreaded CPU rasterizer for the turtle meshes.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <math.h>
+#include <string.h>
+
+#include <mutex>
+
+#include "soft_raster.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFT_RASTER_SSE2 1
+#include <emmintrin.h>
+#else
+#define SOFT_RASTER_SSE2 0
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SOFT_RASTER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define SOFT_RASTER_X86 0
+#endif
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const int CLIP_MAX_VERTICES = 8;            // A triangle clipped by the near plane and the four guard planes
+const int CLIP_PLANES = 5;
+const int TILE_STRIDE = SOFT_TILE_SIZE + 8; // Pixels per row of a tile's buffers: 8 from its last pixel stay in the row
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+struct ClipVertex
+{
+	float c[4];                             // Clip coordinates x, y, z, w
+};
+
+// Window-space vertex of a primitive being set up
+struct WindowVertex
+{
+	float x, y, z;
+};
+
+// Buffers of the tile being rasterized, rows bottom-up like the framebuffer's
+struct SoftTile
+{
+	float depth[SOFT_TILE_SIZE * TILE_STRIDE];
+	uint32_t colour[SOFT_TILE_SIZE * TILE_STRIDE];
+	int rect[4];                            // Its pixels in the framebuffer (x0, y0, x1, y1 inclusive)
+};
+
+// A triangle over one tile, in pixels relative to the tile's first one
+struct TileTriangle
+{
+	int x0, y0, x1, y1;                     // Pixels it can cover
+	float a[3], b[3];                       // Edge function of each edge: E = e0 + b dy + a dx
+	float e0[3];                            // Exact at the first pixel centre
+	bool inclusive[3];                      // Top-left edge: a pixel centre on it is inside
+	float z0, dzdx, dzdy;                   // Depth plane, z0 at the first pixel centre
+};
+
+// What the blocks and tiles of a pass need
+struct PassContext
+{
+	SoftRaster* raster;
+	SoftBlock** blocks;                     // In submission order
+	int tile_x0, tile_y0;                   // First tile of the pass
+	int tiles_x;                            // Tiles per row of the pass
+	int tiles;
+	const int* offsets;                     // First bin entry of each tile, and the end
+	const SoftPrimitive** bins;
+};
+
+//|___________________
+//|
+//| Global Variables
+//|___________________
+
+static std::mutex page_mutex;               // Guards the frame arena while blocks are set up on the pool
+
+//|___________________
+//|
+//| Local Functions
+//|___________________
+
+//|____________________________________________________________________
+//|
+//| Function: MinInt, MaxInt
+//|____________________________________________________________________
+
+static inline int MinInt(int a, int b) { return a < b ? a : b; }
+static inline int MaxInt(int a, int b) { return a > b ? a : b; }
+
+//|____________________________________________________________________
+//|
+//| Function: FloorInt, CeilInt
+//|
+//! \param v      [in] Value within the range of int.
+//! \return floorf(v) or ceilf(v) as an int, without a libm call.
+//|____________________________________________________________________
+
+static inline int FloorInt(float v)
+{
+	int i = (int)v;
+	return i - (v < (float)i);
+}
+
+static inline int CeilInt(float v)
+{
+	int i = (int)v;
+	return i + (v > (float)i);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: CpuHasAvx2
+//|
+//! \param None.
+//! \return True if the CPU and the OS support AVX2.
+//|____________________________________________________________________
+
+static bool CpuHasAvx2()
+{
+#if SOFT_RASTER_X86 && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {      // OS saves the YMM registers
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#elif SOFT_RASTER_X86
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#else
+	return false;
+#endif
+}
+
+//|____________________________________________________________________
+//|
+//| Function: Snap
+//|
+//! \param v      [in] Window coordinate (pixels).
+//! \return v rounded to the subpixel grid.
+//|____________________________________________________________________
+
+static inline float Snap(float v)
+{
+	return (float)FloorInt(v * SOFT_SUBPIXELS + 0.5f) * (1.0f / SOFT_SUBPIXELS);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: TransformVertex
+//|
+//! \param m      [in] Column-major matrix.
+//! \param p      [in] Position (w = 1).
+//! \param out    [out] m * p.
+//! \return None.
+//|____________________________________________________________________
+
+static inline void TransformVertex(const float m[16], const float p[3], ClipVertex& out)
+{
+	for (int r = 0; r < 4; r++) {
+		out.c[r] = m[r] * p[0] + m[4 + r] * p[1] + m[8 + r] * p[2] + m[12 + r];
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: OutCode
+//|
+//! \param v      [in] Clip-space vertex.
+//! \return Bit per frustum plane the vertex lies outside of: left,
+//!         right, bottom, top, near, far.
+//|____________________________________________________________________
+
+static inline int OutCode(const ClipVertex& v)
+{
+	float w = v.c[3];
+	return (v.c[0] < -w) | (v.c[0] > w) << 1 | (v.c[1] < -w) << 2 | (v.c[1] > w) << 3 |
+	       (v.c[2] < -w) << 4 | (v.c[2] > w) << 5;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: PlaneDistance
+//|
+//! \param v      [in] Clip-space vertex.
+//! \param plane  [in] 0 = near, 1-4 = guard band left, right, bottom, top.
+//! \param guard  [in] Guard band as multiples of w, along x and y.
+//! \return Signed distance, negative outside.
+//|____________________________________________________________________
+
+static inline float PlaneDistance(const ClipVertex& v, int plane, const float guard[2])
+{
+	switch (plane) {
+	case 0:  return v.c[2] + v.c[3];
+	case 1:  return guard[0] * v.c[3] + v.c[0];
+	case 2:  return guard[0] * v.c[3] - v.c[0];
+	case 3:  return guard[1] * v.c[3] + v.c[1];
+	default: return guard[1] * v.c[3] - v.c[1];
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: LerpVertex
+//|
+//! \param a, b   [in] Clip-space vertices.
+//! \param t      [in] Fraction from a to b.
+//! \return Vertex between them.
+//|____________________________________________________________________
+
+static inline ClipVertex LerpVertex(const ClipVertex& a, const ClipVertex& b, float t)
+{
+	ClipVertex v;
+	for (int i = 0; i < 4; i++) {
+		v.c[i] = a.c[i] + (b.c[i] - a.c[i]) * t;
+	}
+	return v;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: ToWindow
+//|
+//! \param raster [in] Rasterizer with the pass's viewport.
+//! \param v      [in] Clip-space vertex, w > 0.
+//! \return Window coordinates, x and y snapped, z in [0, 1].
+//|____________________________________________________________________
+
+static inline WindowVertex ToWindow(const SoftRaster& raster, const ClipVertex& v)
+{
+	const int* vp = raster.viewport;
+	float inv_w = 1.0f / v.c[3];
+	WindowVertex out;
+	out.x = Snap(vp[0] + (v.c[0] * inv_w + 1.0f) * 0.5f * vp[2]);
+	out.y = Snap(vp[1] + (v.c[1] * inv_w + 1.0f) * 0.5f * vp[3]);
+	out.z = (v.c[2] * inv_w + 1.0f) * 0.5f;
+	return out;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: GuardBand
+//|
+//! \param raster [in] Rasterizer with the pass's viewport.
+//! \param guard  [out] Clip-space extent, as multiples of w, that maps to
+//!                     SOFT_GUARD_BAND pixels past the viewport.
+//! \return None.
+//|____________________________________________________________________
+
+static inline void GuardBand(const SoftRaster& raster, float guard[2])
+{
+	guard[0] = 1.0f + 2.0f * SOFT_GUARD_BAND / raster.viewport[2];
+	guard[1] = 1.0f + 2.0f * SOFT_GUARD_BAND / raster.viewport[3];
+}
+
+//|____________________________________________________________________
+//|
+//| Function: AddStats
+//|
+//! \param total  [in,out] Statistics to add to.
+//! \param stats  [in] Statistics of a block.
+//! \return None.
+//|____________________________________________________________________
+
+static inline void AddStats(SoftStats& total, const SoftStats& stats)
+{
+	total.triangles += stats.triangles;
+	total.lines += stats.lines;
+	total.points += stats.points;
+	total.tile_refs += stats.tile_refs;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: FillPixels
+//|
+//! \param pixels [out] First pixel.
+//! \param count  [in] Pixels.
+//! \param value  [in] Colour or depth.
+//! \return None.
+//!
+//! Stores 4 pixels at a time with SSE2: std::fill() of a row of unknown
+//! length is left a scalar loop at -O2, which made clears a large part
+//! of a sparse frame.
+//|____________________________________________________________________
+
+static inline void FillPixels(uint32_t* pixels, int count, uint32_t value)
+{
+	int i = 0;
+#if SOFT_RASTER_SSE2
+	__m128i value4 = _mm_set1_epi32((int)value);
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_si128((__m128i*)(pixels + i), value4);
+	}
+#endif
+	for (; i < count; i++) {
+		pixels[i] = value;
+	}
+}
+
+static inline void FillPixels(float* pixels, int count, float value)
+{
+	int i = 0;
+#if SOFT_RASTER_SSE2
+	__m128 value4 = _mm_set1_ps(value);
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(pixels + i, value4);
+	}
+#endif
+	for (; i < count; i++) {
+		pixels[i] = value;
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: NewBlock
+//|
+//! \param raster [in,out] Rasterizer in a pass.
+//! \return Empty block at the end of the pass's list.
+//|____________________________________________________________________
+
+static SoftBlock* NewBlock(SoftRaster& raster)
+{
+	SoftBlock* block = ArenaArray<SoftBlock>(*raster.arena, 1);
+	block->next = NULL;
+	block->draw_count = 0;
+	block->primitive_count = 0;
+	if (raster.last) {
+		raster.last->next = block;
+	}
+	else {
+		raster.first = block;
+	}
+	raster.last = block;
+	raster.block_count++;
+	return block;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: RecordDraw
+//|
+//! \param raster [in,out] Rasterizer in a pass.
+//! \param draw   [in] Draw to record.
+//! \return None.
+//!
+//! Appends the draw to the pass's last block, splitting it where a block
+//! fills up.
+//|____________________________________________________________________
+
+static void RecordDraw(SoftRaster& raster, SoftDraw draw)
+{
+	while (draw.count > 0) {
+		SoftBlock* block = raster.last;
+		if (!block || block->draw_count == SOFT_BLOCK_DRAWS || block->primitive_count == SOFT_BLOCK_PRIMITIVES) {
+			block = NewBlock(raster);
+		}
+
+		SoftDraw& part = block->draws[block->draw_count++];
+		part = draw;
+		part.count = MinInt(draw.count, SOFT_BLOCK_PRIMITIVES - block->primitive_count);
+		block->primitive_count += part.count;
+
+		draw.count -= part.count;
+		if (draw.type == SOFT_POINT) {
+			draw.positions += 3 * part.count;
+		}
+		else {
+			draw.vertices += (draw.type == SOFT_TRIANGLE ? 3 : 2) * part.count;
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: NewPrimitive
+//|
+//! \param raster [in,out] Rasterizer in a pass.
+//! \param block  [in,out] Block being set up.
+//! \return Uninitialized primitive at the end of the block's pages.
+//!
+//! A block's first page holds as many primitives as it was submitted;
+//! only triangles split by clipping can make it take another one from
+//! the frame arena, which the blocks share.
+//|____________________________________________________________________
+
+static SoftPrimitive& NewPrimitive(SoftRaster& raster, SoftBlock& block)
+{
+	SoftPage* page = block.last_page;
+	if (page->count == SOFT_BLOCK_PRIMITIVES) {
+		std::lock_guard<std::mutex> lock(page_mutex);
+		page->next = ArenaArray<SoftPage>(*raster.arena, 1);
+		page = page->next;
+		page->next = NULL;
+		page->count = 0;
+		block.last_page = page;
+	}
+	return page->primitives[page->count++];
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SetupTriangle
+//|
+//! \param raster [in,out] Rasterizer in a pass.
+//! \param block  [in,out] Block being set up.
+//! \param v      [in] Window-space vertices, snapped.
+//! \param colour [in] Packed colour.
+//! \return None.
+//!
+//! Adds the triangle unless it has no area or covers no pixel centre of
+//! the viewport; clockwise triangles are turned counter-clockwise.
+//|____________________________________________________________________
+
+static void SetupTriangle(SoftRaster& raster, SoftBlock& block, const WindowVertex v[3], uint32_t colour)
+{
+	double area = (double)(v[1].x - v[0].x) * (v[2].y - v[0].y) - (double)(v[2].x - v[0].x) * (v[1].y - v[0].y);
+	if (area == 0) {
+		return;
+	}
+	int i1 = area > 0 ? 1 : 2;
+	int i2 = area > 0 ? 2 : 1;
+	const WindowVertex* p[3] = { &v[0], &v[i1], &v[i2] };
+	area = fabs(area);
+
+	// Pixels whose centre lies in the bounding box
+	const int* vp = raster.viewport;
+	float min_x = fminf(v[0].x, fminf(v[1].x, v[2].x));
+	float max_x = fmaxf(v[0].x, fmaxf(v[1].x, v[2].x));
+	float min_y = fminf(v[0].y, fminf(v[1].y, v[2].y));
+	float max_y = fmaxf(v[0].y, fmaxf(v[1].y, v[2].y));
+	int x0 = MaxInt(CeilInt(min_x - 0.5f), vp[0]);
+	int x1 = MinInt(FloorInt(max_x - 0.5f), vp[0] + vp[2] - 1);
+	int y0 = MaxInt(CeilInt(min_y - 0.5f), vp[1]);
+	int y1 = MinInt(FloorInt(max_y - 0.5f), vp[1] + vp[3] - 1);
+	if (x0 > x1 || y0 > y1) {
+		return;
+	}
+
+	SoftPrimitive& t = NewPrimitive(raster, block);
+	for (int i = 0; i < 3; i++) {
+		t.x[i] = p[i]->x;
+		t.y[i] = p[i]->y;
+		t.z[i] = p[i]->z;
+	}
+	double ex1 = (double)t.x[1] - t.x[0], ey1 = (double)t.y[1] - t.y[0], ez1 = (double)t.z[1] - t.z[0];
+	double ex2 = (double)t.x[2] - t.x[0], ey2 = (double)t.y[2] - t.y[0], ez2 = (double)t.z[2] - t.z[0];
+	t.dzdx = (float)((ez1 * ey2 - ez2 * ey1) / area);
+	t.dzdy = (float)((ex1 * ez2 - ex2 * ez1) / area);
+	t.min_x = x0;
+	t.max_x = x1;
+	t.min_y = y0;
+	t.max_y = y1;
+	t.colour = colour;
+	t.type = SOFT_TRIANGLE;
+	t.size = 0;
+	block.stats.triangles++;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: ClipTriangle
+//|
+//! \param raster [in,out] Rasterizer in a pass.
+//! \param block  [in,out] Block being set up.
+//! \param tri    [in] Clip-space vertices.
+//! \param colour [in] Packed colour.
+//! \return None.
+//!
+//! Rejects a triangle outside one frustum plane, clips one crossing the
+//! near plane or the guard band (Sutherland-Hodgman) and sets up the
+//! triangle fan of what is left. A triangle inside the frustum, as most
+//! are, is set up straight away.
+//|____________________________________________________________________
+
+static void ClipTriangle(SoftRaster& raster, SoftBlock& block, const ClipVertex tri[3], uint32_t colour)
+{
+	int out0 = OutCode(tri[0]), out1 = OutCode(tri[1]), out2 = OutCode(tri[2]);
+	if (out0 & out1 & out2) {
+		return;
+	}
+
+	WindowVertex w[3];
+	if (!(out0 | out1 | out2)) {
+		for (int i = 0; i < 3; i++) {
+			w[i] = ToWindow(raster, tri[i]);
+		}
+		SetupTriangle(raster, block, w, colour);
+		return;
+	}
+
+	float guard[2];
+	GuardBand(raster, guard);
+	int planes = 0;                 // Planes some vertex lies outside of
+	for (int i = 0; i < 3; i++) {
+		for (int p = 0; p < CLIP_PLANES; p++) {
+			if (PlaneDistance(tri[i], p, guard) < 0) {
+				planes |= 1 << p;
+			}
+		}
+	}
+
+	if (!planes) {
+		for (int i = 0; i < 3; i++) {
+			w[i] = ToWindow(raster, tri[i]);
+		}
+		SetupTriangle(raster, block, w, colour);
+		return;
+	}
+
+	ClipVertex buffers[2][CLIP_MAX_VERTICES];
+	ClipVertex* in = buffers[0];
+	ClipVertex* out = buffers[1];
+	int count = 3;
+	for (int i = 0; i < 3; i++) {
+		in[i] = tri[i];
+	}
+
+	for (int p = 0; p < CLIP_PLANES && count >= 3; p++) {
+		if (!(planes & (1 << p))) {
+			continue;
+		}
+		int n = 0;
+		for (int i = 0; i < count; i++) {
+			const ClipVertex& a = in[i];
+			const ClipVertex& b = in[(i + 1) % count];
+			float da = PlaneDistance(a, p, guard);
+			float db = PlaneDistance(b, p, guard);
+			if (da >= 0) {
+				out[n++] = a;
+			}
+			if ((da >= 0) != (db >= 0)) {
+				out[n++] = LerpVertex(a, b, da / (da - db));
+			}
+		}
+		count = n;
+		ClipVertex* swap = in;
+		in = out;
+		out = swap;
+	}
+
+	if (count < 3) {
+		return;
+	}
+	w[0] = ToWindow(raster, in[0]);
+	for (int i = 1; i + 1 < count; i++) {
+		w[1] = ToWindow(raster, in[i]);
+		w[2] = ToWindow(raster, in[i + 1]);
+		SetupTriangle(raster, block, w, colour);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: ClipLine
+//|
+//! \param raster [in,out] Rasterizer in a pass.
+//! \param block  [in,out] Block being set up.
+//! \param a, b   [in] Clip-space end points.
+//! \param colour [in] Packed colour.
+//! \return None.
+//!
+//! Clips a segment to the near plane and the guard band and adds what
+//! is left of it.
+//|____________________________________________________________________
+
+static void ClipLine(SoftRaster& raster, SoftBlock& block, const ClipVertex& a, const ClipVertex& b, uint32_t colour)
+{
+	if (OutCode(a) & OutCode(b)) {
+		return;
+	}
+
+	float guard[2];
+	GuardBand(raster, guard);
+	float t0 = 0.0f, t1 = 1.0f;
+	for (int p = 0; p < CLIP_PLANES; p++) {
+		float da = PlaneDistance(a, p, guard);
+		float db = PlaneDistance(b, p, guard);
+		if (da < 0 && db < 0) {
+			return;
+		}
+		if (da < 0) {
+			t0 = fmaxf(t0, da / (da - db));
+		}
+		else if (db < 0) {
+			t1 = fminf(t1, da / (da - db));
+		}
+	}
+	if (t0 >= t1) {
+		return;
+	}
+
+	WindowVertex w0 = ToWindow(raster, t0 > 0 ? LerpVertex(a, b, t0) : a);
+	WindowVertex w1 = ToWindow(raster, t1 < 1 ? LerpVertex(a, b, t1) : b);
+	if (w0.x == w1.x && w0.y == w1.y) {
+		return;
+	}
+
+	const int* vp = raster.viewport;
+	int x0 = MaxInt(FloorInt(fminf(w0.x, w1.x)), vp[0]);
+	int x1 = MinInt(FloorInt(fmaxf(w0.x, w1.x)), vp[0] + vp[2] - 1);
+	int y0 = MaxInt(FloorInt(fminf(w0.y, w1.y)), vp[1]);
+	int y1 = MinInt(FloorInt(fmaxf(w0.y, w1.y)), vp[1] + vp[3] - 1);
+	if (x0 > x1 || y0 > y1) {
+		return;
+	}
+
+	SoftPrimitive& l = NewPrimitive(raster, block);
+	l.x[0] = w0.x;
+	l.y[0] = w0.y;
+	l.z[0] = w0.z;
+	l.x[1] = w1.x;
+	l.y[1] = w1.y;
+	l.z[1] = w1.z;
+	l.min_x = x0;
+	l.max_x = x1;
+	l.min_y = y0;
+	l.max_y = y1;
+	l.colour = colour;
+	l.type = SOFT_LINE;
+	l.size = 1;
+	block.stats.lines++;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SetupPoints
+//|
+//! \param raster [in,out] Rasterizer in a pass.
+//! \param block  [in,out] Block being set up.
+//! \param d      [in] Draw of points.
+//! \return None.
+//!
+//! A point is dropped when its centre is outside the view volume, as
+//! OpenGL does.
+//|____________________________________________________________________
+
+static void SetupPoints(SoftRaster& raster, SoftBlock& block, const SoftDraw& d)
+{
+	const int* vp = raster.viewport;
+	int pixels = d.size;
+
+	for (int i = 0; i < d.count; i++) {
+		ClipVertex c;
+		TransformVertex(d.mvp, d.positions + 3 * i, c);
+		if (OutCode(c) || c.c[3] <= 0) {
+			continue;
+		}
+		WindowVertex w = ToWindow(raster, c);
+
+		// Pixels whose centre lies in the square
+		int x0 = CeilInt(w.x - pixels * 0.5f - 0.5f);
+		int y0 = CeilInt(w.y - pixels * 0.5f - 0.5f);
+		int min_x = MaxInt(x0, vp[0]), max_x = MinInt(x0 + pixels - 1, vp[0] + vp[2] - 1);
+		int min_y = MaxInt(y0, vp[1]), max_y = MinInt(y0 + pixels - 1, vp[1] + vp[3] - 1);
+		if (min_x > max_x || min_y > max_y) {
+			continue;
+		}
+
+		SoftPrimitive& p = NewPrimitive(raster, block);
+		p.x[0] = w.x;
+		p.y[0] = w.y;
+		p.z[0] = w.z;
+		p.min_x = min_x;
+		p.max_x = max_x;
+		p.min_y = min_y;
+		p.max_y = max_y;
+		p.colour = d.colour;
+		p.type = SOFT_POINT;
+		p.size = d.size;
+		block.stats.points++;
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SetupDraw
+//|
+//! \param raster [in,out] Rasterizer in a pass.
+//! \param block  [in,out] Block being set up.
+//! \param d      [in] One of the block's draws.
+//! \return None.
+//|____________________________________________________________________
+
+static void SetupDraw(SoftRaster& raster, SoftBlock& block, const SoftDraw& d)
+{
+	const MeshVertex* v = d.vertices;
+
+	switch (d.type) {
+	case SOFT_TRIANGLE:
+		for (int i = 0; i < d.count; i++, v += 3) {
+			ClipVertex tri[3];
+			for (int k = 0; k < 3; k++) {
+				TransformVertex(d.mvp, v[k].position, tri[k]);
+			}
+			ClipTriangle(raster, block, tri, PackSoftColour(v[2].colour));
+		}
+		break;
+	case SOFT_LINE:
+		for (int i = 0; i < d.count; i++, v += 2) {
+			ClipVertex a, b;
+			TransformVertex(d.mvp, v[0].position, a);
+			TransformVertex(d.mvp, v[1].position, b);
+			ClipLine(raster, block, a, b, PackSoftColour(v[1].colour));
+		}
+		break;
+	default:
+		SetupPoints(raster, block, d);
+		break;
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SetupBlocks
+//|
+//! \param begin   [in] First block of the chunk.
+//! \param end     [in] One past the last block.
+//! \param context [in] PassContext.
+//! \return None.
+//!
+//! Sets up the draws of each block and counts the block's entries in
+//! every tile's bin.
+//|____________________________________________________________________
+
+static void SetupBlocks(int begin, int end, void* context)
+{
+	const PassContext* c = (const PassContext*)context;
+
+	for (int b = begin; b < end; b++) {
+		SoftBlock& block = *c->blocks[b];
+		for (int d = 0; d < block.draw_count; d++) {
+			SetupDraw(*c->raster, block, block.draws[d]);
+		}
+
+		int* counts = block.bin_starts;
+		memset(counts, 0, c->tiles * sizeof(int));
+		for (const SoftPage* page = block.first_page; page; page = page->next) {
+			for (int k = 0; k < page->count; k++) {
+				const SoftPrimitive& p = page->primitives[k];
+				int tx0 = p.min_x / SOFT_TILE_SIZE - c->tile_x0, tx1 = p.max_x / SOFT_TILE_SIZE - c->tile_x0;
+				int ty0 = p.min_y / SOFT_TILE_SIZE - c->tile_y0, ty1 = p.max_y / SOFT_TILE_SIZE - c->tile_y0;
+				for (int ty = ty0; ty <= ty1; ty++) {
+					for (int tx = tx0; tx <= tx1; tx++) {
+						counts[ty * c->tiles_x + tx]++;
+					}
+				}
+			}
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: BinBlocks
+//|
+//! \param begin   [in] First block of the chunk.
+//! \param end     [in] One past the last block.
+//! \param context [in] PassContext.
+//! \return None.
+//!
+//! Lists the primitives of each block in the bins, from where the block's
+//! entries start in each (see EndSoftPass()).
+//|____________________________________________________________________
+
+static void BinBlocks(int begin, int end, void* context)
+{
+	const PassContext* c = (const PassContext*)context;
+
+	for (int b = begin; b < end; b++) {
+		SoftBlock& block = *c->blocks[b];
+		int* cursor = block.bin_starts;
+		for (const SoftPage* page = block.first_page; page; page = page->next) {
+			for (int k = 0; k < page->count; k++) {
+				const SoftPrimitive& p = page->primitives[k];
+				int tx0 = p.min_x / SOFT_TILE_SIZE - c->tile_x0, tx1 = p.max_x / SOFT_TILE_SIZE - c->tile_x0;
+				int ty0 = p.min_y / SOFT_TILE_SIZE - c->tile_y0, ty1 = p.max_y / SOFT_TILE_SIZE - c->tile_y0;
+				for (int ty = ty0; ty <= ty1; ty++) {
+					for (int tx = tx0; tx <= tx1; tx++) {
+						c->bins[cursor[ty * c->tiles_x + tx]++] = &p;
+					}
+				}
+			}
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: ForEachBlock
+//|
+//! \param c      [in] Pass.
+//! \param count  [in] Number of blocks.
+//! \param func   [in] SetupBlocks() or BinBlocks().
+//! \return None.
+//!
+//! Runs func over the blocks on the thread pool, or on the calling thread
+//! when there are too few blocks to share.
+//|____________________________________________________________________
+
+static void ForEachBlock(PassContext& c, int count, ParallelForFunc func)
+{
+	if (c.raster->pool && count >= SOFT_PARALLEL_BLOCKS) {
+		ParallelFor(c.raster->pool, count, 1, func, &c);
+	}
+	else {
+		func(0, count, &c);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: DepthTest
+//|
+//! \param tile   [in,out] Tile being rasterized.
+//! \param x, y   [in] Pixel in the framebuffer, within the tile.
+//! \param z      [in] Fragment depth.
+//! \param colour [in] Packed colour.
+//! \return None.
+//!
+//! Writes one fragment if it is nearer than the pixel (GL_LESS).
+//|____________________________________________________________________
+
+static inline void DepthTest(SoftTile& tile, int x, int y, float z, uint32_t colour)
+{
+	int index = (y - tile.rect[1]) * TILE_STRIDE + x - tile.rect[0];
+	if (z < tile.depth[index]) {
+		tile.depth[index] = z;
+		tile.colour[index] = colour;
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SetupTileTriangle
+//|
+//! \param t      [in] Triangle.
+//! \param rect   [in] Pixels of the tile (x0, y0, x1, y1 inclusive).
+//! \param e      [out] The triangle over the tile.
+//! \return False if the triangle's bounding box misses the tile.
+//!
+//! Edge functions E = a x + b y + c of each edge are exact at the tile's
+//! first pixel centre (in double) and stepped from there in float. As
+//! every triangle of the tile starts from that centre, an edge shared by
+//! two triangles gives them values of opposite sign, bit for bit, and a
+//! pixel centre on the edge goes to the triangle for which it is a
+//! top-left edge (a > 0, or a = 0 and b < 0).
+//|____________________________________________________________________
+
+static inline bool SetupTileTriangle(const SoftPrimitive& t, const int rect[4], TileTriangle& e)
+{
+	e.x0 = MaxInt(t.min_x, rect[0]) - rect[0];
+	e.x1 = MinInt(t.max_x, rect[2]) - rect[0];
+	e.y0 = MaxInt(t.min_y, rect[1]) - rect[1];
+	e.y1 = MinInt(t.max_y, rect[3]) - rect[1];
+	if (e.x0 > e.x1 || e.y0 > e.y1) {
+		return false;
+	}
+
+	double cx = rect[0] + 0.5, cy = rect[1] + 0.5;
+	for (int i = 0; i < 3; i++) {
+		int j = (i + 1) % 3;
+		e.a[i] = t.y[i] - t.y[j];
+		e.b[i] = t.x[j] - t.x[i];
+		double c = (double)t.x[i] * t.y[j] - (double)t.x[j] * t.y[i];
+		e.e0[i] = (float)(e.a[i] * cx + e.b[i] * cy + c);
+		e.inclusive[i] = e.a[i] > 0 || (e.a[i] == 0 && e.b[i] < 0);
+	}
+	e.z0 = (float)(t.z[0] + t.dzdx * (cx - t.x[0]) + t.dzdy * (cy - t.y[0]));
+	e.dzdx = t.dzdx;
+	e.dzdy = t.dzdy;
+	return true;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: RowSpan
+//|
+//! \param e      [in] Triangle over a tile.
+//! \param row    [in] Each edge function at the row's first pixel.
+//! \param span   [out] First and last pixel of the row each edge allows,
+//!                     with a pixel to spare, then first and last pixel a
+//!                     pixel or more inside every edge, which need no
+//!                     edge test.
+//! \return False if no pixel of the row is inside.
+//|____________________________________________________________________
+
+static inline bool RowSpan(const TileTriangle& e, const float row[3], int span[4])
+{
+	span[0] = span[2] = e.x0;
+	span[1] = span[3] = e.x1;
+	for (int i = 0; i < 3; i++) {
+		if (e.a[i] == 0) {
+			if (row[i] < 0 || (row[i] == 0 && !e.inclusive[i])) {
+				return false;
+			}
+			continue;
+		}
+		float cross = -row[i] / e.a[i];             // Where E = 0 on this row
+		if (cross < (float)e.x0 - 2) {
+			cross = (float)e.x0 - 2;
+		}
+		if (cross > (float)e.x1 + 2) {
+			cross = (float)e.x1 + 2;
+		}
+		if (e.a[i] > 0) {
+			span[0] = MaxInt(span[0], FloorInt(cross) - 1);
+			span[2] = MaxInt(span[2], CeilInt(cross) + 1);
+		}
+		else {
+			span[1] = MinInt(span[1], CeilInt(cross) + 1);
+			span[3] = MinInt(span[3], FloorInt(cross) - 1);
+		}
+	}
+	return span[0] <= span[1];
+}
+
+//|____________________________________________________________________
+//|
+//| Function: RasterTriangle
+//|
+//! \param tile   [in,out] Tile being rasterized.
+//! \param t      [in] Triangle.
+//! \return None.
+//!
+//! Each row only visits the span between its edge crossings, 4 pixels
+//! at a time with SSE2 (the last step masked to the span), and skips the
+//! edge test a pixel or more inside them. A triangle two steps wide or
+//! less in the tile tests its whole bounding box instead, which costs
+//! less than finding the spans.
+//|____________________________________________________________________
+
+static void RasterTriangle(SoftTile& tile, const SoftPrimitive& t)
+{
+	TileTriangle e;
+	if (!SetupTileTriangle(t, tile.rect, e)) {
+		return;
+	}
+
+#if SOFT_RASTER_SSE2
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 all = _mm_castsi128_ps(_mm_set1_epi32(-1));
+	const __m128 lanes = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+	const __m128 pixel_colour = _mm_castsi128_ps(_mm_set1_epi32((int)t.colour));
+	__m128 va[3], vinclusive[3];
+	for (int i = 0; i < 3; i++) {
+		va[i] = _mm_set1_ps(e.a[i]);
+		vinclusive[i] = e.inclusive[i] ? all : zero;
+	}
+	const __m128 vdzdx = _mm_set1_ps(e.dzdx);
+#endif
+
+	bool narrow = SOFT_RASTER_SSE2 && e.x1 - e.x0 < 8;
+	for (int y = e.y0; y <= e.y1; y++) {
+		float dy = (float)y;
+		float row[3];
+		for (int i = 0; i < 3; i++) {
+			row[i] = e.e0[i] + e.b[i] * dy;
+		}
+		int span[4] = { e.x0, e.x1, e.x1 + 1, e.x0 - 1 };
+		if (!narrow && !RowSpan(e, row, span)) {
+			continue;
+		}
+		float zrow = e.z0 + e.dzdy * dy;
+		float* depth = tile.depth + y * TILE_STRIDE;
+		uint32_t* colour = tile.colour + y * TILE_STRIDE;
+
+#if SOFT_RASTER_SSE2
+		__m128 vrow[3];
+		for (int i = 0; i < 3; i++) {
+			vrow[i] = _mm_set1_ps(row[i]);
+		}
+		__m128 vzrow = _mm_set1_ps(zrow);
+		__m128 vlast = _mm_set1_ps((float)span[1]);
+
+		for (int x = span[0]; x <= span[1]; x += 4) {
+			__m128 dx = _mm_add_ps(_mm_set1_ps((float)x), lanes);
+			__m128 inside = _mm_cmple_ps(dx, vlast);
+			if (x < span[2] || x + 3 > span[3]) {
+				for (int i = 0; i < 3; i++) {
+					__m128 ev = _mm_add_ps(vrow[i], _mm_mul_ps(va[i], dx));
+					__m128 edge = _mm_or_ps(_mm_cmpgt_ps(ev, zero), _mm_and_ps(_mm_cmpeq_ps(ev, zero), vinclusive[i]));
+					inside = _mm_and_ps(inside, edge);
+				}
+				if (!_mm_movemask_ps(inside)) {
+					continue;
+				}
+			}
+
+			__m128 z = _mm_add_ps(vzrow, _mm_mul_ps(vdzdx, dx));
+			__m128 d = _mm_loadu_ps(depth + x);
+			__m128 pass = _mm_and_ps(inside, _mm_cmplt_ps(z, d));
+			if (!_mm_movemask_ps(pass)) {
+				continue;
+			}
+			_mm_storeu_ps(depth + x, _mm_or_ps(_mm_and_ps(pass, z), _mm_andnot_ps(pass, d)));
+			__m128 c = _mm_loadu_ps((const float*)(colour + x));
+			_mm_storeu_ps((float*)(colour + x), _mm_or_ps(_mm_and_ps(pass, pixel_colour), _mm_andnot_ps(pass, c)));
+		}
+#else
+		for (int x = span[0]; x <= span[1]; x++) {
+			float dx = (float)x;
+			bool inside = true;
+			for (int i = 0; i < 3; i++) {
+				float ev = row[i] + e.a[i] * dx;
+				inside = inside && (ev > 0 || (ev == 0 && e.inclusive[i]));
+			}
+			float z = zrow + e.dzdx * dx;
+			if (inside && z < depth[x]) {
+				depth[x] = z;
+				colour[x] = t.colour;
+			}
+		}
+#endif
+	}
+}
+
+#if SOFT_RASTER_X86
+
+//|____________________________________________________________________
+//|
+//| Function: DepthTestAVX2
+//|
+//! \param depth  [in,out] Depth of 8 pixels of a tile row.
+//! \param colour [in,out] Their colour.
+//! \param inside [in] Lanes inside the triangle.
+//! \param z      [in] Fragment depths.
+//! \param pixel  [in] Packed colour in every lane.
+//! \return None.
+//|____________________________________________________________________
+
+TARGET_AVX2 static inline void DepthTestAVX2(float* depth, uint32_t* colour, __m256 inside, __m256 z, __m256 pixel)
+{
+	__m256 d = _mm256_loadu_ps(depth);
+	__m256 pass = _mm256_and_ps(inside, _mm256_cmp_ps(z, d, _CMP_LT_OQ));
+	if (!_mm256_movemask_ps(pass)) {
+		return;
+	}
+	_mm256_storeu_ps(depth, _mm256_blendv_ps(d, z, pass));
+	__m256 c = _mm256_loadu_ps((const float*)colour);
+	_mm256_storeu_ps((float*)colour, _mm256_blendv_ps(c, pixel, pass));
+}
+
+//|____________________________________________________________________
+//|
+//| Function: RasterTriangleAVX2
+//|
+//! \param tile   [in,out] Tile being rasterized.
+//! \param t      [in] Triangle.
+//! \return None.
+//!
+//! RasterTriangle() 8 pixels at a time, with the same arithmetic, so the
+//! image is the same. A triangle at most 8 pixels wide in the tile, as
+//! most are, takes one step per row with the column terms computed once.
+//|____________________________________________________________________
+
+TARGET_AVX2 static void RasterTriangleAVX2(SoftTile& tile, const SoftPrimitive& t)
+{
+	TileTriangle e;
+	if (!SetupTileTriangle(t, tile.rect, e)) {
+		return;
+	}
+
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 all = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+	const __m256 lanes = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+	const __m256 pixel_colour = _mm256_castsi256_ps(_mm256_set1_epi32((int)t.colour));
+	__m256 va[3], vinclusive[3];
+	for (int i = 0; i < 3; i++) {
+		va[i] = _mm256_set1_ps(e.a[i]);
+		vinclusive[i] = e.inclusive[i] ? all : zero;
+	}
+	const __m256 vdzdx = _mm256_set1_ps(e.dzdx);
+
+	if (e.x1 - e.x0 < 8) {
+		__m256 dx = _mm256_add_ps(_mm256_set1_ps((float)e.x0), lanes);
+		__m256 columns = _mm256_cmp_ps(dx, _mm256_set1_ps((float)e.x1), _CMP_LE_OQ);
+		__m256 adx[3];
+		for (int i = 0; i < 3; i++) {
+			adx[i] = _mm256_mul_ps(va[i], dx);
+		}
+		__m256 zdx = _mm256_mul_ps(vdzdx, dx);
+
+		for (int y = e.y0; y <= e.y1; y++) {
+			float dy = (float)y;
+			__m256 inside = columns;
+			for (int i = 0; i < 3; i++) {
+				__m256 ev = _mm256_add_ps(_mm256_set1_ps(e.e0[i] + e.b[i] * dy), adx[i]);
+				__m256 edge = _mm256_or_ps(_mm256_cmp_ps(ev, zero, _CMP_GT_OQ),
+				                           _mm256_and_ps(_mm256_cmp_ps(ev, zero, _CMP_EQ_OQ), vinclusive[i]));
+				inside = _mm256_and_ps(inside, edge);
+			}
+			if (!_mm256_movemask_ps(inside)) {
+				continue;
+			}
+			__m256 z = _mm256_add_ps(_mm256_set1_ps(e.z0 + e.dzdy * dy), zdx);
+			int index = y * TILE_STRIDE + e.x0;
+			DepthTestAVX2(tile.depth + index, tile.colour + index, inside, z, pixel_colour);
+		}
+		return;
+	}
+
+	bool narrow = e.x1 - e.x0 < 16;
+	for (int y = e.y0; y <= e.y1; y++) {
+		float dy = (float)y;
+		float row[3];
+		for (int i = 0; i < 3; i++) {
+			row[i] = e.e0[i] + e.b[i] * dy;
+		}
+		int span[4] = { e.x0, e.x1, e.x1 + 1, e.x0 - 1 };
+		if (!narrow && !RowSpan(e, row, span)) {
+			continue;
+		}
+		__m256 vrow[3];
+		for (int i = 0; i < 3; i++) {
+			vrow[i] = _mm256_set1_ps(row[i]);
+		}
+		__m256 vzrow = _mm256_set1_ps(e.z0 + e.dzdy * dy);
+		__m256 vlast = _mm256_set1_ps((float)span[1]);
+		float* depth = tile.depth + y * TILE_STRIDE;
+		uint32_t* colour = tile.colour + y * TILE_STRIDE;
+
+		for (int x = span[0]; x <= span[1]; x += 8) {
+			__m256 dx = _mm256_add_ps(_mm256_set1_ps((float)x), lanes);
+			__m256 inside = _mm256_cmp_ps(dx, vlast, _CMP_LE_OQ);
+			if (x < span[2] || x + 7 > span[3]) {
+				for (int i = 0; i < 3; i++) {
+					__m256 ev = _mm256_add_ps(vrow[i], _mm256_mul_ps(va[i], dx));
+					__m256 edge = _mm256_or_ps(_mm256_cmp_ps(ev, zero, _CMP_GT_OQ),
+					                           _mm256_and_ps(_mm256_cmp_ps(ev, zero, _CMP_EQ_OQ), vinclusive[i]));
+					inside = _mm256_and_ps(inside, edge);
+				}
+				if (!_mm256_movemask_ps(inside)) {
+					continue;
+				}
+			}
+			__m256 z = _mm256_add_ps(vzrow, _mm256_mul_ps(vdzdx, dx));
+			DepthTestAVX2(depth + x, colour + x, inside, z, pixel_colour);
+		}
+	}
+}
+
+#endif
+
+//|____________________________________________________________________
+//|
+//| Function: RasterLine
+//|
+//! \param tile   [in,out] Tile being rasterized.
+//! \param l      [in] Line.
+//! \return None.
+//!
+//! One pixel per column (or per row, for a steep line) whose centre the
+//! segment crosses, at the row the segment has there.
+//|____________________________________________________________________
+
+static void RasterLine(SoftTile& tile, const SoftPrimitive& l)
+{
+	const int* rect = tile.rect;
+	int x0 = MaxInt(l.min_x, rect[0]), x1 = MinInt(l.max_x, rect[2]);
+	int y0 = MaxInt(l.min_y, rect[1]), y1 = MinInt(l.max_y, rect[3]);
+	if (x0 > x1 || y0 > y1) {
+		return;
+	}
+
+	float dx = l.x[1] - l.x[0];
+	float dy = l.y[1] - l.y[0];
+	bool x_major = fabsf(dx) >= fabsf(dy);
+	float major0 = x_major ? l.x[0] : l.y[0];
+	float major_delta = x_major ? dx : dy;
+	float minor0 = x_major ? l.y[0] : l.x[0];
+	float minor_delta = x_major ? dy : dx;
+
+	// Major-axis pixels whose centre lies on the segment, within the tile
+	float lo = fminf(major0, major0 + major_delta);
+	float hi = fmaxf(major0, major0 + major_delta);
+	int first = MaxInt(CeilInt(lo - 0.5f), x_major ? x0 : y0);
+	int last = MinInt(CeilInt(hi - 0.5f) - 1, x_major ? x1 : y1);
+	int minor_lo = x_major ? y0 : x0;
+	int minor_hi = x_major ? y1 : x1;
+
+	for (int m = first; m <= last; m++) {
+		float s = (m + 0.5f - major0) / major_delta;
+		int n = FloorInt(minor0 + minor_delta * s);
+		if (n < minor_lo || n > minor_hi) {
+			continue;
+		}
+		float z = l.z[0] + (l.z[1] - l.z[0]) * s;
+		if (x_major) {
+			DepthTest(tile, m, n, z, l.colour);
+		}
+		else {
+			DepthTest(tile, n, m, z, l.colour);
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: RasterPoint
+//|
+//! \param tile   [in,out] Tile being rasterized.
+//! \param p      [in] Point.
+//! \return None.
+//|____________________________________________________________________
+
+static void RasterPoint(SoftTile& tile, const SoftPrimitive& p)
+{
+	const int* rect = tile.rect;
+	int x0 = MaxInt(p.min_x, rect[0]), x1 = MinInt(p.max_x, rect[2]);
+	int y0 = MaxInt(p.min_y, rect[1]), y1 = MinInt(p.max_y, rect[3]);
+
+	for (int y = y0; y <= y1; y++) {
+		for (int x = x0; x <= x1; x++) {
+			DepthTest(tile, x, y, p.z[0], p.colour);
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: RasterTiles
+//|
+//! \param begin   [in] First tile of the chunk (index within the pass).
+//! \param end     [in] One past the last tile.
+//! \param context [in] PassContext.
+//! \return None.
+//!
+//! Draws each tile's bin in the tile's own buffers, cleared first, and
+//! copies the tile's pixels within the viewport to the framebuffer. A
+//! tile with an empty bin is only cleared, in the framebuffer.
+//|____________________________________________________________________
+
+static void RasterTiles(int begin, int end, void* context)
+{
+	const PassContext* c = (const PassContext*)context;
+	const SoftRaster& raster = *c->raster;
+	SoftFramebuffer& fb = c->raster->framebuffer;
+	const int* vp = raster.viewport;
+	SoftTile tile;
+	int* rect = tile.rect;
+
+	for (int k = begin; k < end; k++) {
+		int tx = c->tile_x0 + k % c->tiles_x;
+		int ty = c->tile_y0 + k / c->tiles_x;
+		rect[0] = MaxInt(tx * SOFT_TILE_SIZE, vp[0]);
+		rect[1] = MaxInt(ty * SOFT_TILE_SIZE, vp[1]);
+		rect[2] = MinInt((tx + 1) * SOFT_TILE_SIZE, vp[0] + vp[2]) - 1;
+		rect[3] = MinInt((ty + 1) * SOFT_TILE_SIZE, vp[1] + vp[3]) - 1;
+		int width = rect[2] - rect[0] + 1;
+		int height = rect[3] - rect[1] + 1;
+
+		if (c->offsets[k] == c->offsets[k + 1]) {
+			for (int y = rect[1]; y <= rect[3]; y++) {
+				FillPixels(&fb.colour[y * fb.width + rect[0]], width, raster.clear_colour);
+			}
+			continue;
+		}
+
+		FillPixels(tile.colour, height * TILE_STRIDE, raster.clear_colour);
+		FillPixels(tile.depth, height * TILE_STRIDE, 1.0f);
+		for (int i = c->offsets[k]; i < c->offsets[k + 1]; i++) {
+			const SoftPrimitive& p = *c->bins[i];
+			switch (p.type) {
+			case SOFT_TRIANGLE:
+#if SOFT_RASTER_X86
+				if (raster.avx2) {
+					RasterTriangleAVX2(tile, p);
+					break;
+				}
+#endif
+				RasterTriangle(tile, p);
+				break;
+			case SOFT_LINE:
+				RasterLine(tile, p);
+				break;
+			default:
+				RasterPoint(tile, p);
+				break;
+			}
+		}
+
+		for (int y = 0; y < height; y++) {
+			memcpy(&fb.colour[(rect[1] + y) * fb.width + rect[0]], tile.colour + y * TILE_STRIDE, width * sizeof(uint32_t));
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: InitSoftRaster
+//|
+//! \param raster  [out] Rasterizer with an empty framebuffer.
+//! \param threads [in] Threads that set up blocks and rasterize tiles; 0
+//!                     or less uses every hardware thread.
+//! \return None.
+//|____________________________________________________________________
+
+void InitSoftRaster(SoftRaster& raster, int threads)
+{
+	FreeSoftRaster(raster);
+	raster.pool = CreateThreadPool(threads);
+	raster.avx2 = CpuHasAvx2();
+}
+
+//|____________________________________________________________________
+//|
+//| Function: FreeSoftRaster
+//|
+//! \param raster  [in,out] Rasterizer; its threads and framebuffer are freed.
+//! \return None.
+//|____________________________________________________________________
+
+void FreeSoftRaster(SoftRaster& raster)
+{
+	DestroyThreadPool(raster.pool);
+	raster = SoftRaster();
+}
+
+//|____________________________________________________________________
+//|
+//| Function: BeginSoftFrame
+//|
+//! \param raster [in,out] Rasterizer.
+//! \param width  [in] Framebuffer size (pixels).
+//! \param height [in]
+//! \return None.
+//!
+//! Resizes the framebuffer if needed (its contents are undefined until
+//! the passes clear them) and resets the frame's statistics.
+//|____________________________________________________________________
+
+void BeginSoftFrame(SoftRaster& raster, int width, int height)
+{
+	SoftFramebuffer& fb = raster.framebuffer;
+	if (fb.width != width || fb.height != height) {
+		fb.width = width;
+		fb.height = height;
+		fb.colour.assign((size_t)width * height, 0);
+	}
+	raster.stats = SoftStats();
+}
+
+//|____________________________________________________________________
+//|
+//| Function: BeginSoftPass
+//|
+//! \param raster [in,out] Rasterizer.
+//! \param arena  [in,out] Frame arena for the draws, primitives and bins.
+//! \param x, y   [in] Lower left corner of the viewport (pixels).
+//! \param width  [in] Viewport size (pixels), within the framebuffer.
+//! \param height [in]
+//! \param clear  [in] Colour the viewport is cleared to.
+//! \return None.
+//|____________________________________________________________________
+
+void BeginSoftPass(SoftRaster& raster, FrameArena& arena, int x, int y, int width, int height, const float clear[3])
+{
+	raster.arena = &arena;
+	raster.viewport[0] = x;
+	raster.viewport[1] = y;
+	raster.viewport[2] = width;
+	raster.viewport[3] = height;
+	raster.clear_colour = PackSoftColour(clear);
+	raster.first = NULL;
+	raster.last = NULL;
+	raster.block_count = 0;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SoftDrawArrays
+//|
+//! \param raster   [in,out] Rasterizer in a pass.
+//! \param mvp      [in] Object to clip transform, column-major.
+//! \param vertices [in] Shared vertex array, unchanged until EndSoftPass().
+//! \param range    [in] GL_TRIANGLES or GL_LINES vertices to draw.
+//! \return None.
+//!
+//! Records the draw, like glDrawArrays(); nothing is set up or drawn
+//! before EndSoftPass().
+//|____________________________________________________________________
+
+void SoftDrawArrays(SoftRaster& raster, const float mvp[16], const MeshVertex* vertices, const MeshRange& range)
+{
+	bool lines = range.mode == GL_LINES;
+	SoftDraw draw;
+	memcpy(draw.mvp, mvp, sizeof(draw.mvp));
+	draw.vertices = vertices + range.first;
+	draw.positions = NULL;
+	draw.count = lines ? range.count / 2 : range.count / 3;
+	draw.colour = 0;
+	draw.type = lines ? SOFT_LINE : SOFT_TRIANGLE;
+	draw.size = 0;
+	RecordDraw(raster, draw);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SoftDrawPoints
+//|
+//! \param raster    [in,out] Rasterizer in a pass.
+//! \param mvp       [in] Object to clip transform, column-major.
+//! \param positions [in] x, y, z of each point, unchanged until EndSoftPass().
+//! \param count     [in] Number of points.
+//! \param size      [in] Point size (pixels), as glPointSize().
+//! \param colour    [in] Colour of every point.
+//! \return None.
+//!
+//! Records the draw; see SetupPoints().
+//|____________________________________________________________________
+
+void SoftDrawPoints(SoftRaster& raster, const float mvp[16], const float* positions, int count, float size,
+                    const float colour[3])
+{
+	SoftDraw draw;
+	memcpy(draw.mvp, mvp, sizeof(draw.mvp));
+	draw.vertices = NULL;
+	draw.positions = positions;
+	draw.count = count;
+	draw.colour = PackSoftColour(colour);
+	draw.type = SOFT_POINT;
+	draw.size = (uint8_t)MaxInt((int)(size + 0.5f), 1);
+	RecordDraw(raster, draw);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: EndSoftPass
+//|
+//! \param raster [in,out] Rasterizer in a pass.
+//! \return None, once the viewport holds the pass's image.
+//!
+//! Sets up the blocks and counts each block's entries per tile, on the
+//! thread pool. The counts are then turned into where each block's
+//! entries start in each bin, tile by tile and block by block, so every
+//! bin lists its primitives in submission order; the blocks fill the
+//! bins and the tiles of the viewport are rasterized, again on the pool.
+//|____________________________________________________________________
+
+void EndSoftPass(SoftRaster& raster)
+{
+	FrameArena& arena = *raster.arena;
+	const int* vp = raster.viewport;
+	if (vp[2] <= 0 || vp[3] <= 0) {
+		return;
+	}
+
+	PassContext c;
+	c.raster = &raster;
+	c.tile_x0 = vp[0] / SOFT_TILE_SIZE;
+	c.tile_y0 = vp[1] / SOFT_TILE_SIZE;
+	c.tiles_x = (vp[0] + vp[2] - 1) / SOFT_TILE_SIZE - c.tile_x0 + 1;
+	int tiles_y = (vp[1] + vp[3] - 1) / SOFT_TILE_SIZE - c.tile_y0 + 1;
+	c.tiles = c.tiles_x * tiles_y;
+
+	// The blocks' first pages and bin counts come from the arena before the threads share it
+	int blocks = raster.block_count;
+	c.blocks = ArenaArray<SoftBlock*>(arena, blocks);
+	int b = 0;
+	for (SoftBlock* block = raster.first; block; block = block->next) {
+		SoftPage* page = ArenaArray<SoftPage>(arena, 1);
+		page->next = NULL;
+		page->count = 0;
+		block->first_page = page;
+		block->last_page = page;
+		block->stats = SoftStats();
+		block->bin_starts = ArenaArray<int>(arena, c.tiles);
+		c.blocks[b++] = block;
+	}
+	ForEachBlock(c, blocks, SetupBlocks);
+
+	// Bins follow each other in tile order; within a bin, blocks in submission order
+	int* offsets = ArenaArray<int>(arena, c.tiles + 1);
+	int entries = 0;
+	for (int t = 0; t < c.tiles; t++) {
+		offsets[t] = entries;
+		for (b = 0; b < blocks; b++) {
+			int count = c.blocks[b]->bin_starts[t];
+			c.blocks[b]->bin_starts[t] = entries;
+			entries += count;
+		}
+	}
+	offsets[c.tiles] = entries;
+	for (b = 0; b < blocks; b++) {
+		AddStats(raster.stats, c.blocks[b]->stats);
+	}
+	raster.stats.tile_refs += entries;
+
+	c.offsets = offsets;
+	c.bins = ArenaArray<const SoftPrimitive*>(arena, entries);
+	ForEachBlock(c, blocks, BinBlocks);
+
+	if (raster.pool) {
+		ParallelFor(raster.pool, c.tiles, SOFT_TILE_GRAIN, RasterTiles, &c);
+	}
+	else {
+		RasterTiles(0, c.tiles, &c);
+	}
+
+	raster.first = NULL;
+	raster.last = NULL;
+	raster.block_count = 0;
+}
+//|____________________________________________________________________
+//|
+//| Function: FillSoftRect
+//|
+//! \param framebuffer [in,out] Framebuffer.
+//! \param x, y        [in] Lower left corner (pixels), clipped to the framebuffer.
+//! \param width       [in] Size (pixels).
+//! \param height      [in]
+//! \param colour      [in] Fill colour; depth is left alone.
+//! \return None.
+//|____________________________________________________________________
+
+void FillSoftRect(SoftFramebuffer& framebuffer, int x, int y, int width, int height, const float colour[3])
+{
+	uint32_t packed = PackSoftColour(colour);
+	int x0 = MaxInt(x, 0), x1 = MinInt(x + width, framebuffer.width);
+	int y0 = MaxInt(y, 0), y1 = MinInt(y + height, framebuffer.height);
+
+	for (int row = y0; row < y1; row++) {
+		for (int col = x0; col < x1; col++) {
+			framebuffer.colour[row * framebuffer.width + col] = packed;
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: WriteSoftFramebufferPPM
+//|
+//! \param framebuffer [in] Framebuffer.
+//! \param file        [in] Open binary file or pipe; several frames may
+//!                         follow each other (e.g. for ffmpeg -f image2pipe).
+//! \return True if the whole frame was written.
+//!
+//! Writes the colour buffer as a binary PPM, top row first.
+//|____________________________________________________________________
+
+bool WriteSoftFramebufferPPM(const SoftFramebuffer& framebuffer, FILE* file)
+{
+	int width = framebuffer.width;
+	int height = framebuffer.height;
+	if (fprintf(file, "P6\n%d %d\n255\n", width, height) < 0) {
+		return false;
+	}
+
+	std::vector<unsigned char> row(width * 3);
+	for (int y = height - 1; y >= 0; y--) {
+		const uint32_t* src = &framebuffer.colour[y * width];
+		for (int x = 0; x < width; x++) {
+			row[3 * x] = (unsigned char)(src[x] & 0xff);
+			row[3 * x + 1] = (unsigned char)((src[x] >> 8) & 0xff);
+			row[3 * x + 2] = (unsigned char)((src[x] >> 16) & 0xff);
+		}
+		if (fwrite(&row[0], 1, row.size(), file) != row.size()) {
+			return false;
+		}
+	}
+	return fflush(file) == 0;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: PackSoftColour
+//|
+//! \param colour [in] RGB in [0, 1].
+//! \return Opaque RGBA8, R in the lowest byte.
+//|____________________________________________________________________
+
+uint32_t PackSoftColour(const float colour[3])
+{
+	uint32_t packed = 0xff000000u;
+	for (int i = 0; i < 3; i++) {
+		float c = colour[i] < 0 ? 0 : colour[i] > 1 ? 1 : colour[i];
+		packed |= (uint32_t)(c * 255.0f + 0.5f) << (8 * i);
+	}
+	return packed;
+}
@@ -0,0 +1,166 @@
+//|___________________________________________________________________
+//!
+//! \file soft_raster.h
+//!
+//! \brief Tile-based, multithreaded CPU rasterizer for the turtle meshes.
+//!
+//! Stands in for OpenGL on machines without a GPU. Draw calls are only
+//! recorded, into blocks of up to SOFT_BLOCK_PRIMITIVES primitives in
+//! submission order; EndSoftPass() then draws the pass into a viewport of
+//! a CPU framebuffer in three stages, each spread over a thread pool:
+//!
+//!   setup   per block, the draws' vertices go to clip space, triangles
+//!           and lines are clipped to the near plane (and a guard band far
+//!           outside the viewport) and become window-space primitives,
+//!           snapped to 1/SOFT_SUBPIXELS of a pixel
+//!   binning per block, each primitive is listed in every SOFT_TILE_SIZE
+//!           square tile its bounding box touches; the blocks' counts are
+//!           merged in block order first, so every bin keeps submission
+//!           order
+//!   raster  per tile: the tile is cleared and drawn in colour and depth
+//!           buffers of its own, which stay in the L1 cache, and copied to
+//!           the framebuffer; edge functions and depth test run 8 pixels
+//!           at a time with AVX2 when the CPU has it, 4 with SSE2 otherwise
+//!
+//! Blocks and tiles never share output, so the threads need no locks and
+//! the image does not depend on the number of threads, nor on the SIMD
+//! width. Edge functions are evaluated exactly from the snapped vertices
+//! with a top-left fill rule, so triangles sharing an edge neither overlap
+//! nor leave cracks. The depth test is GL_LESS against depth cleared to 1,
+//! which also drops what lies past the far plane. Every mesh face and axis
+//! has one colour (see turtle_mesh.h), so primitives are flat shaded.
+//!
+//! The framebuffer is RGBA8 with rows bottom-up, as glReadPixels() returns
+//! them and glDrawPixels() takes them. Per-pass draws, primitives and bins
+//! live in the frame arena (see frame_arena.h).
+//|___________________________________________________________________
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include "frame_arena.h"
+#include "thread_pool.h"
+#include "turtle_mesh.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const int SOFT_TILE_SIZE = 64;              // Pixels per tile side
+const float SOFT_SUBPIXELS = 256.0f;        // Vertex positions snap to 1/256 pixel
+const float SOFT_GUARD_BAND = 8192.0f;      // Pixels past the viewport before geometry is clipped
+const int SOFT_BLOCK_PRIMITIVES = 1024;     // Primitives submitted per block, and set up per arena page
+const int SOFT_BLOCK_DRAWS = 256;           // Draws per block
+const int SOFT_TILE_GRAIN = 1;              // Tiles per ParallelFor() chunk
+const int SOFT_PARALLEL_BLOCKS = 2;         // Fewer blocks are set up and binned on the calling thread
+
+enum SoftPrimitiveType {
+	SOFT_TRIANGLE = 0,
+	SOFT_LINE,
+	SOFT_POINT                              // Square of SoftPrimitive::size pixels
+};
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+struct SoftFramebuffer
+{
+	int width;
+	int height;
+	std::vector<uint32_t> colour;           // RGBA8 (R in the lowest byte), rows bottom-up
+};
+
+// One recorded draw call, or the part of one that fits in a block
+struct SoftDraw
+{
+	float mvp[16];                          // Object to clip transform, column-major
+	const MeshVertex* vertices;             // Triangles and lines: vertex of the first one
+	const float* positions;                 // Points: x, y, z of the first one
+	int count;                              // Primitives
+	uint32_t colour;                        // Of every point
+	uint8_t type;                           // SoftPrimitiveType
+	uint8_t size;                           // Point size (pixels)
+};
+
+// One primitive in window coordinates of the framebuffer
+struct SoftPrimitive
+{
+	float x[3], y[3];                       // Snapped vertices: 3 of a triangle (counter-clockwise), 2 of a line, 1 of a point
+	float z[3];                             // Window depth of each vertex
+	float dzdx, dzdy;                       // Depth plane of a triangle
+	int min_x, min_y, max_x, max_y;         // Pixels it can cover, inside the viewport
+	uint32_t colour;
+	uint8_t type;                           // SoftPrimitiveType
+	uint8_t size;                           // Point size (pixels)
+};
+
+// Primitives a block's setup made; clipping may need more than one page
+struct SoftPage
+{
+	SoftPage* next;
+	int count;
+	SoftPrimitive primitives[SOFT_BLOCK_PRIMITIVES];
+};
+
+struct SoftStats
+{
+	int triangles;                          // Primitives set up in the last frame, after clipping
+	int lines;
+	int points;
+	int tile_refs;                          // Primitive entries in all tile bins
+};
+
+// Consecutive draws, set up and binned by one thread
+struct SoftBlock
+{
+	SoftBlock* next;
+	int draw_count;
+	int primitive_count;                    // Submitted primitives of the draws
+	SoftDraw draws[SOFT_BLOCK_DRAWS];
+
+	// Setup and binning
+	SoftPage* first_page;
+	SoftPage* last_page;
+	SoftStats stats;
+	int* bin_starts;                        // Per tile: the block's entries, then where they start in the bin
+};
+
+struct SoftRaster
+{
+	SoftFramebuffer framebuffer;
+	ThreadPool* pool;
+	bool avx2;                              // 8 pixels per step; InitSoftRaster() sets it if the CPU has AVX2
+	SoftStats stats;                        // Of the frame since BeginSoftFrame()
+
+	// Current pass
+	FrameArena* arena;
+	int viewport[4];                        // x, y, width, height
+	uint32_t clear_colour;
+	SoftBlock* first;                       // Draws in submission order
+	SoftBlock* last;
+	int block_count;
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void InitSoftRaster(SoftRaster& raster, int threads);
+void FreeSoftRaster(SoftRaster& raster);
+void BeginSoftFrame(SoftRaster& raster, int width, int height);
+void BeginSoftPass(SoftRaster& raster, FrameArena& arena, int x, int y, int width, int height, const float clear[3]);
+void SoftDrawArrays(SoftRaster& raster, const float mvp[16], const MeshVertex* vertices, const MeshRange& range);
+void SoftDrawPoints(SoftRaster& raster, const float mvp[16], const float* positions, int count, float size,
+                    const float colour[3]);
+void EndSoftPass(SoftRaster& raster);
+void FillSoftRect(SoftFramebuffer& framebuffer, int x, int y, int width, int height, const float colour[3]);
+bool WriteSoftFramebufferPPM(const SoftFramebuffer& framebuffer, FILE* file);
+uint32_t PackSoftColour(const float colour[3]);
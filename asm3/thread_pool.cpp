@@ -0,0 +1,199 @@
+//|___________________________________________________________________
+//!
+//! \file thread_pool.cpp
+//!
+//! \brief Work-stealing thread pool for data-parallel loops.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include "thread_pool.h"
+
+//|___________________
+//|
+//| Local Functions
+//|___________________
+
+//|____________________________________________________________________
+//|
+//| Function: RunChunks
+//|
+//! \param pool    [in,out] Thread pool.
+//! \param worker  [in] Index of the calling worker.
+//! \return None.
+//!
+//! Runs chunks of the current loop, own run first, then the others'
+//! runs in order, until every run is empty.
+//|____________________________________________________________________
+
+static void RunChunks(ThreadPool* pool, int worker)
+{
+	int workers = WorkerCount(pool);
+
+	for (int k = 0; k < workers; k++) {
+		WorkerQueue& queue = pool->queues[(worker + k) % workers];
+		int chunk;
+		while ((chunk = queue.next.fetch_add(1, std::memory_order_relaxed)) < queue.end) {
+			int begin = chunk * pool->grain;
+			int end = begin + pool->grain < pool->count ? begin + pool->grain : pool->count;
+			pool->func(begin, end, pool->context);
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: WorkerMain
+//|
+//! \param pool    [in,out] Thread pool.
+//! \param worker  [in] Index of this worker (1..n-1).
+//! \return None.
+//!
+//! Sleeps until a loop starts, helps finish it, and reports back.
+//|____________________________________________________________________
+
+static void WorkerMain(ThreadPool* pool, int worker)
+{
+	unsigned int seen = 0;
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(pool->mutex);
+			pool->wake.wait(lock, [&] { return pool->quit || pool->generation != seen; });
+			if (pool->quit) {
+				return;
+			}
+			seen = pool->generation;
+			pool->active++;
+		}
+
+		RunChunks(pool, worker);
+
+		{
+			std::lock_guard<std::mutex> lock(pool->mutex);
+			if (--pool->active == 0) {
+				pool->done.notify_all();
+			}
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: CreateThreadPool
+//|
+//! \param workers [in] Total number of workers, including the caller of
+//!                     ParallelFor(); 0 or less uses every hardware thread.
+//! \return New thread pool.
+//|____________________________________________________________________
+
+ThreadPool* CreateThreadPool(int workers)
+{
+	if (workers <= 0) {
+		workers = (int)std::thread::hardware_concurrency();
+		if (workers <= 0) {
+			workers = 1;
+		}
+	}
+
+	ThreadPool* pool = new ThreadPool;
+	pool->queues = new WorkerQueue[workers];
+	for (int i = 0; i < workers; i++) {
+		pool->queues[i].next.store(0);
+		pool->queues[i].end = 0;
+	}
+	pool->generation = 0;
+	pool->active = 0;
+	pool->quit = false;
+	pool->func = NULL;
+	pool->context = NULL;
+	pool->count = 0;
+	pool->grain = 1;
+
+	for (int i = 1; i < workers; i++) {
+		pool->threads.push_back(std::thread(WorkerMain, pool, i));
+	}
+	return pool;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: DestroyThreadPool
+//|
+//! \param pool    [in] Thread pool, may be NULL.
+//! \return None.
+//|____________________________________________________________________
+
+void DestroyThreadPool(ThreadPool* pool)
+{
+	if (!pool) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(pool->mutex);
+		pool->quit = true;
+	}
+	pool->wake.notify_all();
+	for (size_t i = 0; i < pool->threads.size(); i++) {
+		pool->threads[i].join();
+	}
+
+	delete[] pool->queues;
+	delete pool;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: ParallelFor
+//|
+//! \param pool    [in,out] Thread pool.
+//! \param count   [in] Number of items.
+//! \param grain   [in] Items per chunk.
+//! \param func    [in] Called as func(begin, end, context) for every chunk.
+//! \param context [in] Passed through to func.
+//! \return None, once every chunk has run.
+//|____________________________________________________________________
+
+void ParallelFor(ThreadPool* pool, int count, int grain, ParallelForFunc func, void* context)
+{
+	if (count <= 0) {
+		return;
+	}
+	if (grain <= 0) {
+		grain = 1;
+	}
+
+	int workers = WorkerCount(pool);
+	int chunks = (count + grain - 1) / grain;
+
+	{
+		std::unique_lock<std::mutex> lock(pool->mutex);
+
+		// A worker that woke late for the previous loop may still be scanning the queues
+		pool->done.wait(lock, [&] { return pool->active == 0; });
+
+		pool->func = func;
+		pool->context = context;
+		pool->count = count;
+		pool->grain = grain;
+		for (int i = 0; i < workers; i++) {
+			pool->queues[i].next.store(chunks * i / workers, std::memory_order_relaxed);
+			pool->queues[i].end = chunks * (i + 1) / workers;
+		}
+
+		pool->active = 1;                       // The caller
+		pool->generation++;
+	}
+	pool->wake.notify_all();
+
+	RunChunks(pool, 0);
+
+	std::unique_lock<std::mutex> lock(pool->mutex);
+	if (--pool->active > 0) {
+		pool->done.wait(lock, [&] { return pool->active == 0; });
+	}
+}
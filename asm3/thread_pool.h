@@ -0,0 +1,67 @@
+//|___________________________________________________________________
+//!
+//! \file thread_pool.h
+//!
+//! \brief Work-stealing thread pool for data-parallel loops.
+//!
+//! ParallelFor() cuts [0, count) into fixed-size chunks and deals each
+//! worker a contiguous run of them. A worker first drains its own run and
+//! then steals chunks from the other runs, so uneven chunks or a descheduled
+//! thread do not stall the loop. The calling thread works as worker 0.
+//! Chunk boundaries depend only on count and grain, never on the number of
+//! threads, so a loop whose chunks are independent gives identical results
+//! with any pool size.
+//|___________________________________________________________________
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+typedef void (*ParallelForFunc)(int begin, int end, void* context);
+
+// Chunks dealt to one worker; the owner and thieves both take from 'next'
+struct WorkerQueue
+{
+	std::atomic<int> next;
+	int end;
+	char pad[64 - sizeof(std::atomic<int>) - sizeof(int)];     // One cache line per queue
+};
+
+struct ThreadPool
+{
+	std::vector<std::thread> threads;           // Workers 1..n-1 (the caller is worker 0)
+	WorkerQueue* queues;                        // One per worker
+
+	std::mutex mutex;
+	std::condition_variable wake;               // Signals a new loop (or shutdown) to the workers
+	std::condition_variable done;               // Signals the caller that all workers left the loop
+	unsigned int generation;                    // Incremented for every loop
+	int active;                                 // Workers currently inside a loop
+	bool quit;
+
+	// Current loop
+	ParallelForFunc func;
+	void* context;
+	int count;
+	int grain;
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+ThreadPool* CreateThreadPool(int workers);
+void DestroyThreadPool(ThreadPool* pool);
+void ParallelFor(ThreadPool* pool, int count, int grain, ParallelForFunc func, void* context);
+
+inline int WorkerCount(const ThreadPool* pool) { return (int)pool->threads.size() + 1; }
@@ -0,0 +1,343 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_animation.cpp
+//!
+//! \brief Keyframe tracks for the subpart joints, played per turtle.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <math.h>
+#include <stdio.h>
+
+#include "turtle_animation.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const float TWO_PI = 6.28318531f;
+
+//|___________________
+//|
+//| Local Functions
+//|___________________
+
+//|____________________________________________________________________
+//|
+//| Function: KeyAngle
+//|
+//! \param key    [in] Keyframe.
+//! \return Joint angle of the key (degs).
+//|____________________________________________________________________
+
+static inline float KeyAngle(const AnimKey& key)
+{
+	return key.angle * (1.0f / ANIM_ANGLE_SCALE);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: LerpKeys
+//|
+//! \param a      [in] Key starting the segment.
+//! \param b      [in] Key ending it.
+//! \param time   [in] Ticks into the track, within [a.tick, b.tick].
+//! \return Joint angle at time (degs).
+//|____________________________________________________________________
+
+static inline float LerpKeys(const AnimKey& a, const AnimKey& b, float time)
+{
+	float a0 = KeyAngle(a);
+	return a0 + (KeyAngle(b) - a0) * ((time - a.tick) / (float)(b.tick - a.tick));
+}
+
+//|____________________________________________________________________
+//|
+//| Function: AddWaveTrack
+//|
+//! \param lib            [in,out] Animation library.
+//! \param length         [in] Ticks per loop.
+//! \param cycles         [in] Sine periods per loop.
+//! \param keys_per_cycle [in] Keys per period.
+//! \param center         [in] Mean angle (degs).
+//! \param amplitude      [in] Swing either side of center (degs), signed.
+//! \return Track index.
+//|____________________________________________________________________
+
+static int AddWaveTrack(AnimLibrary& lib, int length, int cycles, int keys_per_cycle, float center, float amplitude)
+{
+	int count = cycles * keys_per_cycle + 1;
+	std::vector<int> ticks(count);
+	std::vector<float> angles(count);
+
+	for (int i = 0; i < count; i++) {
+		ticks[i] = i * length / (count - 1);
+		angles[i] = center + amplitude * sinf(TWO_PI * i / keys_per_cycle);
+	}
+	angles[count - 1] = angles[0];              // Closes the loop exactly
+
+	return AddAnimTrack(lib, &ticks[0], &angles[0], count);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: AddAnimTrack
+//|
+//! \param lib     [in,out] Animation library.
+//! \param ticks   [in] Key times: 0 first, strictly increasing; the
+//!                     last is the track's length (at most 65535).
+//! \param angles  [in] Key angles (degs), quantized to 1 / ANIM_ANGLE_SCALE.
+//! \param count   [in] Number of keys, at least 2.
+//! \return Track index, ANIM_NO_TRACK if the keys are invalid.
+//|____________________________________________________________________
+
+int AddAnimTrack(AnimLibrary& lib, const int* ticks, const float* angles, int count)
+{
+	bool valid = count >= 2 && count <= 0xffff && ticks[0] == 0 && ticks[count - 1] <= 0xffff;
+	for (int i = 0; i < count && valid; i++) {
+		valid = (i == 0 || ticks[i] > ticks[i - 1]) && fabsf(angles[i] * ANIM_ANGLE_SCALE) <= 32767.0f;
+	}
+	if (!valid) {
+		printf("Invalid animation track (%d keys)\n", count);
+		return ANIM_NO_TRACK;
+	}
+
+	AnimTrack track;
+	track.first_key = (uint32_t)lib.keys.size();
+	track.key_count = (uint16_t)count;
+	track.length = (uint16_t)ticks[count - 1];
+
+	for (int i = 0; i < count; i++) {
+		AnimKey key;
+		key.tick = (uint16_t)ticks[i];
+		key.angle = (int16_t)lrintf(angles[i] * ANIM_ANGLE_SCALE);
+		lib.keys.push_back(key);
+	}
+	lib.tracks.push_back(track);
+	return (int)lib.tracks.size() - 1;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: AddAnimClip
+//|
+//! \param lib     [in,out] Animation library.
+//! \param tracks  [in] Track per joint, ANIM_NO_TRACK to leave it alone.
+//! \return Clip index, ANIM_NO_CLIP if the tracks differ in length or
+//!         there are none.
+//|____________________________________________________________________
+
+int AddAnimClip(AnimLibrary& lib, const int tracks[JOINT_COUNT])
+{
+	AnimClip clip;
+	clip.length = 0;
+
+	for (int j = 0; j < JOINT_COUNT; j++) {
+		clip.tracks[j] = (int16_t)tracks[j];
+		if (tracks[j] == ANIM_NO_TRACK) {
+			continue;
+		}
+		uint16_t length = lib.tracks[tracks[j]].length;
+		if (clip.length != 0 && length != clip.length) {
+			printf("Animation clip tracks differ in length (%u, %u ticks)\n", clip.length, length);
+			return ANIM_NO_CLIP;
+		}
+		clip.length = length;
+	}
+	if (clip.length == 0) {
+		return ANIM_NO_CLIP;
+	}
+
+	lib.clips.push_back(clip);
+	return (int)lib.clips.size() - 1;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: BuildDefaultClips
+//|
+//! \param lib     [out] Animation library holding the DefaultClip clips.
+//! \return None.
+//!
+//! Wing beats mirror each other (right wings negative), and the flap and
+//! sweep clip reuses the sweep's cannon tracks.
+//|____________________________________________________________________
+
+void BuildDefaultClips(AnimLibrary& lib)
+{
+	lib = AnimLibrary();
+
+	int flap[JOINT_COUNT] = { AddWaveTrack(lib, 40, 1, 8, 0.0f, -30.0f), AddWaveTrack(lib, 40, 1, 8, 0.0f, 30.0f),
+	                          ANIM_NO_TRACK, ANIM_NO_TRACK };
+	int glide[JOINT_COUNT] = { AddWaveTrack(lib, 80, 1, 8, -5.0f, -12.0f), AddWaveTrack(lib, 80, 1, 8, 5.0f, 12.0f),
+	                           ANIM_NO_TRACK, ANIM_NO_TRACK };
+	int sweep[JOINT_COUNT] = { ANIM_NO_TRACK, ANIM_NO_TRACK,
+	                           AddWaveTrack(lib, 240, 1, 12, 0.0f, 60.0f), AddWaveTrack(lib, 240, 2, 8, 0.0f, 25.0f) };
+	int flap_sweep[JOINT_COUNT] = { AddWaveTrack(lib, 240, 6, 8, 0.0f, -30.0f), AddWaveTrack(lib, 240, 6, 8, 0.0f, 30.0f),
+	                                sweep[JOINT_CANNON_BASE], sweep[JOINT_CANNON] };
+
+	AddAnimClip(lib, flap);
+	AddAnimClip(lib, glide);
+	AddAnimClip(lib, sweep);
+	AddAnimClip(lib, flap_sweep);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SampleAnimTrack
+//|
+//! \param lib     [in] Animation library.
+//! \param track   [in] Track index.
+//! \param time    [in] Ticks into the track, in [0, length].
+//! \return Joint angle at time (degs).
+//!
+//! Binary search for the segment, for one-off samples; StepAnimations()
+//! gives the same angles from its cursors.
+//|____________________________________________________________________
+
+float SampleAnimTrack(const AnimLibrary& lib, int track, float time)
+{
+	const AnimTrack& t = lib.tracks[track];
+	const AnimKey* keys = &lib.keys[t.first_key];
+
+	// Last key at or before time, short of the final one
+	int lo = 0, hi = t.key_count - 2;
+	while (lo < hi) {
+		int mid = (lo + hi + 1) / 2;
+		if (keys[mid].tick <= time) {
+			lo = mid;
+		}
+		else {
+			hi = mid - 1;
+		}
+	}
+	return LerpKeys(keys[lo], keys[lo + 1], time);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: ResizeAnimations
+//|
+//! \param anim    [in,out] Playback clocks.
+//! \param count   [in] Number of turtles; new ones play nothing.
+//! \return None.
+//|____________________________________________________________________
+
+void ResizeAnimations(TurtleAnimations& anim, int count)
+{
+	anim.clip.resize(count, (int16_t)ANIM_NO_CLIP);
+	anim.time.resize(count, 0.0f);
+	anim.speed.resize(count, 1.0f);
+	anim.cursor.resize(count * JOINT_COUNT, 0);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: PlayAnimation
+//|
+//! \param anim    [in,out] Playback clocks.
+//! \param lib     [in] Animation library.
+//! \param turtle  [in] Turtle index.
+//! \param clip    [in] Clip to loop.
+//! \param phase   [in] Starting time into the clip (ticks, wrapped).
+//! \param speed   [in] Clip ticks per simulation tick, kept below the
+//!                     clip's length.
+//! \return None.
+//|____________________________________________________________________
+
+void PlayAnimation(TurtleAnimations& anim, const AnimLibrary& lib, int turtle, int clip, float phase, float speed)
+{
+	float length = lib.clips[clip].length;
+
+	anim.clip[turtle] = (int16_t)clip;
+	anim.time[turtle] = fmodf(fmodf(phase, length) + length, length);
+	if (speed <= 0.0f) {
+		speed = 1.0f;
+	}
+	if (speed > length * 0.5f) {
+		speed = length * 0.5f;
+	}
+	anim.speed[turtle] = speed;
+	for (int j = 0; j < JOINT_COUNT; j++) {
+		anim.cursor[turtle * JOINT_COUNT + j] = 0;  // Catches up on the first step
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: StopAnimation
+//|
+//! \param anim    [in,out] Playback clocks.
+//! \param turtle  [in] Turtle index; its joints keep their last angles.
+//! \return None.
+//|____________________________________________________________________
+
+void StopAnimation(TurtleAnimations& anim, int turtle)
+{
+	anim.clip[turtle] = (int16_t)ANIM_NO_CLIP;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: StepAnimations
+//|
+//! \param anim    [in,out] Playback clocks.
+//! \param lib     [in] Animation library.
+//! \param joints  [in,out] JOINT_COUNT angles per turtle; only the joints
+//!                         of each turtle's clip are written.
+//! \param begin   [in] First turtle.
+//! \param end     [in] One past the last turtle.
+//! \return None.
+//!
+//! Advances the clocks of [begin, end) by one simulation tick and samples
+//! their clips. A range only touches its own turtles' data.
+//|____________________________________________________________________
+
+void StepAnimations(TurtleAnimations& anim, const AnimLibrary& lib, float* joints, int begin, int end)
+{
+	if (lib.clips.empty()) {
+		return;
+	}
+
+	const AnimKey* keys = &lib.keys[0];
+	const AnimTrack* tracks = &lib.tracks[0];
+	const AnimClip* clips = &lib.clips[0];
+
+	for (int t = begin; t < end; t++) {
+		int c = anim.clip[t];
+		if (c == ANIM_NO_CLIP) {
+			continue;
+		}
+		const AnimClip& clip = clips[c];
+		uint16_t* cursor = &anim.cursor[t * JOINT_COUNT];
+
+		float time = anim.time[t] + anim.speed[t];
+		if (time >= clip.length) {
+			time -= clip.length;
+			for (int j = 0; j < JOINT_COUNT; j++) {
+				cursor[j] = 0;
+			}
+		}
+		anim.time[t] = time;
+
+		for (int j = 0; j < JOINT_COUNT; j++) {
+			if (clip.tracks[j] == ANIM_NO_TRACK) {
+				continue;
+			}
+			const AnimTrack& track = tracks[clip.tracks[j]];
+			const AnimKey* k = keys + track.first_key;
+
+			int i = cursor[j];
+			while (i + 2 < track.key_count && k[i + 1].tick <= time) {
+				i++;
+			}
+			cursor[j] = (uint16_t)i;
+			joints[t * JOINT_COUNT + j] = LerpKeys(k[i], k[i + 1], time);
+		}
+	}
+}
@@ -0,0 +1,106 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_animation.h
+//!
+//! \brief Keyframe tracks for the subpart joints, played per turtle.
+//!
+//! A track is a looping curve of one joint angle: keys of a tick and a
+//! quantized angle (4 bytes each), linearly interpolated. A clip groups
+//! one track per joint (or none) over a common length. Tracks and clips
+//! live once in an AnimLibrary and are shared by every turtle playing
+//! them.
+//!
+//! Each turtle only has a playback clock: its clip, time, speed and a
+//! cursor per joint on the segment it last sampled. The clocks are stored
+//! one field per array. StepAnimations() advances a range of turtles by
+//! one tick and writes their joint angles into an array laid out as
+//! SceneGraph::joints. Time only moves forward (a loop restarts the
+//! cursors at the first key), so each cursor steps forward over the keys
+//! it passed since the last tick, with no binary search; a fast clip may
+//! pass several keys in a tick. Turtles are independent, so ranges can
+//! be stepped in parallel.
+//|___________________________________________________________________
+
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "scene_graph.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const float ANIM_ANGLE_SCALE = 64.0f;       // Quantization steps per deg (range +-512 degs)
+const int ANIM_NO_TRACK = -1;
+const int ANIM_NO_CLIP = -1;
+
+// Clips of BuildDefaultClips(), in library order
+enum DefaultClip {
+	ANIM_CLIP_FLAP = 0,         // Wings flap, 40 ticks
+	ANIM_CLIP_GLIDE,            // Slow, shallow wing beat, 80 ticks
+	ANIM_CLIP_SWEEP,            // Cannon base sweeps side to side while the cannon swings, 240 ticks
+	ANIM_CLIP_FLAP_SWEEP,       // Both at once, 240 ticks
+	ANIM_DEFAULT_CLIP_COUNT
+};
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+struct AnimKey
+{
+	uint16_t tick;              // Time in ticks from the start of the track
+	int16_t angle;              // Joint angle times ANIM_ANGLE_SCALE
+};
+
+struct AnimTrack
+{
+	uint32_t first_key;         // Into AnimLibrary::keys
+	uint16_t key_count;         // At least 2: the first at tick 0, the last at the track's length
+	uint16_t length;            // Ticks per loop
+};
+
+struct AnimClip
+{
+	int16_t tracks[JOINT_COUNT];    // Per joint, ANIM_NO_TRACK if the clip leaves it alone
+	uint16_t length;                // Ticks per loop, shared by its tracks
+};
+
+// Shared by every turtle
+struct AnimLibrary
+{
+	std::vector<AnimKey> keys;
+	std::vector<AnimTrack> tracks;
+	std::vector<AnimClip> clips;
+};
+
+// Playback clock of every turtle, one field per array
+struct TurtleAnimations
+{
+	std::vector<int16_t> clip;          // ANIM_NO_CLIP when not playing
+	std::vector<float> time;            // Ticks into the clip, in [0, length)
+	std::vector<float> speed;           // Clip ticks per simulation tick, in (0, length)
+	std::vector<uint16_t> cursor;       // JOINT_COUNT per turtle: key starting the sampled segment
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+int AddAnimTrack(AnimLibrary& lib, const int* ticks, const float* angles, int count);
+int AddAnimClip(AnimLibrary& lib, const int tracks[JOINT_COUNT]);
+void BuildDefaultClips(AnimLibrary& lib);
+float SampleAnimTrack(const AnimLibrary& lib, int track, float time);
+
+void ResizeAnimations(TurtleAnimations& anim, int count);
+void PlayAnimation(TurtleAnimations& anim, const AnimLibrary& lib, int turtle, int clip, float phase, float speed);
+void StopAnimation(TurtleAnimations& anim, int turtle);
+void StepAnimations(TurtleAnimations& anim, const AnimLibrary& lib, float* joints, int begin, int end);
+
+inline int AnimationCount(const TurtleAnimations& anim) { return (int)anim.clip.size(); }
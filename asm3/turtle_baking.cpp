@@ -0,0 +1,309 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_baking.cpp
+//!
+//! \brief Static subtrees of the turtles merged into pre-transformed meshes.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include "turtle_baking.h"
+
+//|___________________
+//|
+//| Local Functions
+//|___________________
+
+//|____________________________________________________________________
+//|
+//| Function: AppendTransformed
+//|
+//! \param vertices   [in,out] Vertex array.
+//! \param parts      [in] Part meshes at the origin.
+//! \param range      [in] Mesh to append.
+//! \param m          [in] Transform of the mesh.
+//! \param scale      [in] Uniform scale before the transform.
+//! \return None.
+//|____________________________________________________________________
+
+static void AppendTransformed(std::vector<MeshVertex>& vertices, const std::vector<MeshVertex>& parts, const MeshRange& range,
+                              const gmtl::Matrix44f& m, float scale)
+{
+	for (int i = range.first; i < range.first + range.count; i++) {
+		MeshVertex v = parts[i];
+		float x = v.position[0] * scale, y = v.position[1] * scale, z = v.position[2] * scale;
+		for (int k = 0; k < 3; k++) {
+			v.position[k] = m(k, 0) * x + m(k, 1) * y + m(k, 2) * z + m(k, 3);
+		}
+		vertices.push_back(v);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: BuildBakedMesh
+//|
+//! \param baking  [in] Baking state holding the part meshes.
+//! \param mesh    [in,out] Baked mesh whose key is set.
+//! \return None.
+//!
+//! Merges every node whose path from the body crosses no joint of the
+//! mask, each transformed into the body's frame.
+//|____________________________________________________________________
+
+static void BuildBakedMesh(const TurtleBaking& baking, BakedMesh& mesh)
+{
+	gmtl::Matrix44f body[TN_COUNT];         // Node to body transforms
+
+	// Preorder: a parent is decided before its children
+	mesh.nodes = 1u << TN_BODY;
+	for (int n = TN_BODY + 1; n < TN_COUNT; n++) {
+		const TurtleNodeDesc& desc = GetTurtleNodeDesc((TurtleNode)n);
+		if (!((mesh.nodes >> desc.parent) & 1)) {
+			continue;
+		}
+		if (desc.joint != JOINT_NONE && ((mesh.joint_mask >> desc.joint) & 1)) {
+			continue;
+		}
+		body[n] = body[desc.parent] * JointLocal((TurtleNode)n, desc.joint == JOINT_NONE ? 0.0f : mesh.joints[desc.joint]);
+		mesh.nodes |= 1u << n;
+	}
+
+	mesh.vertices.clear();
+	for (int n = 0; n < TN_COUNT; n++) {
+		if ((mesh.nodes >> n) & 1) {
+			AppendTransformed(mesh.vertices, baking.parts, baking.part_ranges[TurtlePartMesh((TurtleNode)n)], body[n], 1.0f);
+		}
+	}
+	mesh.solid_count = (GLsizei)mesh.vertices.size();
+	for (int n = 0; n < TN_COUNT; n++) {
+		if (((mesh.nodes >> n) & 1) && TurtlePartFrame((TurtleNode)n) > 0) {
+			AppendTransformed(mesh.vertices, baking.parts, baking.part_ranges[MESH_FRAME], body[n], TurtlePartFrame((TurtleNode)n));
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: AcquireBake
+//|
+//! \param baking  [in,out] Baking state.
+//! \param scene   [in] Scene graph holding the turtle's joints.
+//! \param turtle  [in] Turtle index.
+//! \return None.
+//!
+//! Points the turtle at the baked mesh of its current key (joints left
+//! out and angles), building it in a free slot if no mesh matches.
+//|____________________________________________________________________
+
+static void AcquireBake(TurtleBaking& baking, const SceneGraph& scene, int turtle)
+{
+	unsigned int mask = baking.animated[turtle];
+	float joints[JOINT_COUNT];
+	for (int j = 0; j < JOINT_COUNT; j++) {
+		joints[j] = ((mask >> j) & 1) ? 0.0f : scene.joints[turtle * JOINT_COUNT + j];
+	}
+
+	int old = baking.bake[turtle];
+	int found = BAKE_NONE;
+	for (int b = 0; b < (int)baking.meshes.size() && found == BAKE_NONE; b++) {
+		const BakedMesh& mesh = baking.meshes[b];
+		bool match = mesh.joint_mask == mask;
+		for (int j = 0; j < JOINT_COUNT && match; j++) {
+			match = mesh.joints[j] == joints[j];
+		}
+		if (match) {
+			found = b;
+		}
+	}
+
+	if (old != BAKE_NONE) {
+		baking.meshes[old].users--;
+	}
+	baking.bake[turtle] = BAKE_NONE;
+
+	if (found == BAKE_NONE) {
+		for (int b = 0; b < (int)baking.meshes.size() && found == BAKE_NONE; b++) {
+			if (baking.meshes[b].users == 0) {
+				found = b;
+			}
+		}
+		if (found == BAKE_NONE) {
+			if ((int)baking.meshes.size() == BAKE_CAPACITY) {
+				return;
+			}
+			found = (int)baking.meshes.size();
+			baking.meshes.push_back(BakedMesh());
+			baking.meshes[found].users = 0;
+		}
+
+		BakedMesh& mesh = baking.meshes[found];
+		mesh.joint_mask = mask;
+		for (int j = 0; j < JOINT_COUNT; j++) {
+			mesh.joints[j] = joints[j];
+		}
+		BuildBakedMesh(baking, mesh);
+		baking.dirty = true;
+		baking.stats.rebuilds++;
+	}
+
+	baking.meshes[found].users++;
+	baking.bake[turtle] = found;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: InitTurtleBaking
+//|
+//! \param baking  [out] Baking state.
+//! \return None.
+//!
+//! Builds the part meshes the bakes are made from (current model, no GL
+//! calls) and drops every baked mesh.
+//|____________________________________________________________________
+
+void InitTurtleBaking(TurtleBaking& baking)
+{
+	BuildTurtleMeshes(baking.parts, baking.part_ranges);
+	baking.meshes.clear();
+	baking.stats = BakeStats();
+	baking.frame = 0;
+	baking.dirty = false;
+	ClearTurtleBakes(baking);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: ClearTurtleBakes
+//|
+//! \param baking  [in,out] Baking state.
+//! \return None.
+//!
+//! Forgets the turtles (e.g. for a rebuilt scene graph); the baked meshes
+//! stay cached for the turtles of the next update.
+//|____________________________________________________________________
+
+void ClearTurtleBakes(TurtleBaking& baking)
+{
+	for (size_t b = 0; b < baking.meshes.size(); b++) {
+		baking.meshes[b].users = 0;
+	}
+	baking.bake.clear();
+	baking.animated.clear();
+	baking.last_change.clear();
+	baking.settling.clear();
+}
+
+//|____________________________________________________________________
+//|
+//| Function: UpdateTurtleBakes
+//|
+//! \param baking  [in,out] Baking state.
+//! \param scene   [in,out] Scene graph; its pending joint changes are consumed.
+//! \return None.
+//!
+//! Bakes the new turtles whole, leaves the moved joints out of their
+//! turtles' bakes and bakes the settled turtles whole again. The cost
+//! follows the number of turtles whose joints changed.
+//|____________________________________________________________________
+
+void UpdateTurtleBakes(TurtleBaking& baking, SceneGraph& scene)
+{
+	int count = TurtleCount(scene);
+	if (count < (int)baking.bake.size()) {
+		ClearTurtleBakes(baking);
+	}
+	int first_new = (int)baking.bake.size();
+
+	baking.frame++;
+
+	// New turtles are baked with the joints they were added with
+	baking.bake.resize(count, BAKE_NONE);
+	baking.animated.resize(count, 0);
+	baking.last_change.resize(count, 0);
+	for (int t = first_new; t < count; t++) {
+		AcquireBake(baking, scene, t);
+	}
+
+	for (size_t k = 0; k < scene.changed_turtles.size(); k++) {
+		int t = scene.changed_turtles[k];
+		unsigned char changes = scene.joint_changes[t];
+		scene.joint_changes[t] = 0;
+		if (t >= first_new) {
+			continue;
+		}
+
+		if (!baking.animated[t]) {
+			baking.settling.push_back(t);
+		}
+		baking.last_change[t] = baking.frame;
+		if (changes & ~baking.animated[t]) {
+			baking.animated[t] |= changes;
+			AcquireBake(baking, scene, t);
+		}
+	}
+	scene.changed_turtles.clear();
+
+	// Turtles whose joints have all been still long enough are baked whole
+	for (size_t k = 0; k < baking.settling.size(); ) {
+		int t = baking.settling[k];
+		if (baking.frame - baking.last_change[t] < (unsigned int)BAKE_SETTLE_FRAMES) {
+			k++;
+			continue;
+		}
+		baking.animated[t] = 0;
+		AcquireBake(baking, scene, t);
+		baking.settling[k] = baking.settling.back();
+		baking.settling.pop_back();
+	}
+
+	baking.stats.turtles_baked = 0;
+	baking.stats.meshes = 0;
+	for (size_t b = 0; b < baking.meshes.size(); b++) {
+		baking.stats.turtles_baked += baking.meshes[b].users;
+		baking.stats.meshes += baking.meshes[b].users > 0;
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: UploadTurtleBakes
+//|
+//! \param baking  [in,out] Baking state.
+//! \return None.
+//!
+//! Copies the baked meshes after the static ones in the shared mesh
+//! buffer if any was built since the last upload, and sets their ranges.
+//! Call outside BindMeshes()/UnbindMeshes().
+//|____________________________________________________________________
+
+void UploadTurtleBakes(TurtleBaking& baking)
+{
+	if (!baking.dirty) {
+		return;
+	}
+
+	baking.upload.clear();
+	for (size_t b = 0; b < baking.meshes.size(); b++) {
+		BakedMesh& mesh = baking.meshes[b];
+		GLint first = (GLint)baking.upload.size();
+		baking.upload.insert(baking.upload.end(), mesh.vertices.begin(), mesh.vertices.end());
+
+		mesh.solid.mode = GL_TRIANGLES;
+		mesh.solid.first = first;
+		mesh.solid.count = mesh.solid_count;
+		mesh.lines.mode = GL_LINES;
+		mesh.lines.first = first + mesh.solid_count;
+		mesh.lines.count = (GLsizei)mesh.vertices.size() - mesh.solid_count;
+	}
+
+	GLint base = SetBakedVertices(baking.upload);
+	for (size_t b = 0; b < baking.meshes.size(); b++) {
+		baking.meshes[b].solid.first += base;
+		baking.meshes[b].lines.first += base;
+	}
+	baking.dirty = false;
+}
@@ -0,0 +1,97 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_baking.h
+//!
+//! \brief Static subtrees of the turtles merged into pre-transformed meshes.
+//!
+//! Most joints never move: turtle 1 is posed once, the crowd and scene
+//! file turtles are not animated, and no joint drives the head and eyes.
+//! For each turtle, the nodes whose path from the body crosses no
+//! animated joint are merged, in the body's frame, into one baked mesh
+//! drawn with the body's world matrix: one draw for the parts and one for
+//! their coordinate frames. The other nodes are drawn one by one.
+//!
+//! A baked mesh is keyed by the joints it leaves out and the angles it
+//! bakes in, so turtles posed alike share it (the whole crowd uses one).
+//! A turtle's moved joints count as animated until none of its joints has
+//! moved for BAKE_SETTLE_FRAMES updates. Moving an animated joint leaves
+//! the bake alone; moving a baked one switches the turtle to the bake
+//! that leaves it out; a settled turtle is baked whole again at its new
+//! angles. When every slot is in use the turtle is drawn node by node.
+//|___________________________________________________________________
+
+#pragma once
+
+#include <vector>
+
+#include "scene_graph.h"
+#include "turtle_mesh.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const int BAKE_CAPACITY = 64;               // Baked meshes kept at once (fits the render queue's mesh bits)
+const int BAKE_SETTLE_FRAMES = 30;          // Updates a joint must stay still before it is baked in
+const int BAKE_NONE = -1;
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+struct BakedMesh
+{
+	unsigned int joint_mask;                // Bit per joint left out
+	float joints[JOINT_COUNT];              // Angles baked in (0 for the joints left out)
+	unsigned int nodes;                     // Bit per TurtleNode merged in
+	std::vector<MeshVertex> vertices;       // Body frame: parts (triangles), then frames (lines)
+	GLsizei solid_count;                    // Triangle vertices at the front of vertices
+	MeshRange solid;                        // Ranges in the shared mesh buffer (UploadTurtleBakes())
+	MeshRange lines;
+	int users;                              // Turtles drawn with it; 0 = free, kept for reuse
+};
+
+struct BakeStats
+{
+	int turtles_baked;                      // Turtles with a baked mesh
+	int meshes;                             // Baked meshes in use
+	unsigned int rebuilds;                  // Meshes built since InitTurtleBaking()
+};
+
+struct TurtleBaking
+{
+	std::vector<BakedMesh> meshes;          // At most BAKE_CAPACITY
+
+	// Per turtle
+	std::vector<int> bake;                  // Baked mesh, BAKE_NONE if drawn node by node
+	std::vector<unsigned char> animated;    // Bit per joint left out of the bake
+	std::vector<unsigned int> last_change;  // Update of the last joint change
+
+	std::vector<int> settling;              // Turtles with animated joints
+	unsigned int frame;                     // Updates so far
+	bool dirty;                             // Meshes built since the last upload
+	BakeStats stats;
+
+	// Part meshes at the origin, and scratch of the upload
+	std::vector<MeshVertex> parts;
+	MeshRange part_ranges[MESH_COUNT];
+	std::vector<MeshVertex> upload;
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void InitTurtleBaking(TurtleBaking& baking);
+void ClearTurtleBakes(TurtleBaking& baking);
+void UpdateTurtleBakes(TurtleBaking& baking, SceneGraph& scene);
+void UploadTurtleBakes(TurtleBaking& baking);
+
+inline bool IsNodeBaked(const TurtleBaking& baking, int node)
+{
+	int b = baking.bake[node / TN_COUNT];
+	return b != BAKE_NONE && ((baking.meshes[b].nodes >> NodeType(node)) & 1);
+}
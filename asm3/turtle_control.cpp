@@ -0,0 +1,327 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_control.cpp
+//!
+//! \brief Fixed-timestep turtle controls driven by held keys.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <string.h>
+
+#include "pose_math.h"
+#include "turtle_control.h"
+#include "turtle_scene.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+static const char CONTROL_KEYS[] = "sfeqxwadSFEQXWADrRtTyYuUgG";
+
+//|___________________
+//|
+//| Global Variables
+//|___________________
+
+static ControlState sim_prev;           // State at the previous tick
+static ControlState sim_curr;           // State at the latest tick
+static bool keys_held[256];
+static float sim_time = 0;              // Time not yet simulated (< SIM_STEP after an update)
+static unsigned int sim_ticks = 0;      // Ticks run since InitControl()
+static int reload_ticks = 0;            // Ticks before turtle 2's cannon can fire again
+
+//|___________________
+//|
+//| Local Functions
+//|___________________
+
+//|____________________________________________________________________
+//|
+//| Function: StepTurtle
+//|
+//! \param p      [in,out] Turtle position.
+//! \param q      [in,out] Turtle orientation.
+//! \param keys   [in] Keys for forward, backward, +Z, -Z, +X, -X, +Y, -Y.
+//! \return None.
+//!
+//! One tick of motion for every held key of a turtle.
+//|____________________________________________________________________
+
+static void StepTurtle(gmtl::Point4f& p, gmtl::Quatf& q, const char keys[8])
+{
+	bool forward = keys_held[(unsigned char)keys[0]];     // +Z translation
+	bool backward = keys_held[(unsigned char)keys[1]];    // -Z translation
+	if (forward != backward) {
+		gmtl::Vec3f v = RotateVector(q, PLANE_FORWARD);
+		float sign = forward ? 1.0f : -1.0f;
+		p.set(p[0] + sign * v[0], p[1] + sign * v[1], p[2] + sign * v[2], p[3]);
+	}
+
+	if (keys_held[(unsigned char)keys[2]]) q = q * zrotp_q;      // Roll
+	if (keys_held[(unsigned char)keys[3]]) q = q * zrotn_q;
+	if (keys_held[(unsigned char)keys[4]]) q = q * xrotp_q;      // Pitch
+	if (keys_held[(unsigned char)keys[5]]) q = q * xrotn_q;
+	if (keys_held[(unsigned char)keys[6]]) q = q * yrotp_q;      // Yaw
+	if (keys_held[(unsigned char)keys[7]]) q = q * yrotn_q;
+
+	gmtl::normalize(q);                     // Many small steps per second: keep q a unit quaternion
+}
+
+//|____________________________________________________________________
+//|
+//| Function: StepAngle
+//|
+//! \param angle  [in,out] Subpart angle (degs).
+//! \param up     [in] Key that increases the angle.
+//! \param down   [in] Key that decreases the angle.
+//! \return None.
+//|____________________________________________________________________
+
+static void StepAngle(float& angle, unsigned char up, unsigned char down)
+{
+	if (keys_held[up]) {
+		angle += DELTA_ROTATION;
+	}
+	if (keys_held[down]) {
+		angle -= DELTA_ROTATION;
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: Settled
+//|
+//! \param None.
+//! \return True if the last tick changed nothing.
+//|____________________________________________________________________
+
+static bool Settled()
+{
+	return memcmp(&sim_prev, &sim_curr, sizeof(ControlState)) == 0;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: InitControl
+//|
+//! \param None.
+//! \return None.
+//!
+//! Starts the simulation from the scene's current poses and angles.
+//|____________________________________________________________________
+
+void InitControl()
+{
+	sim_curr.turtle_p[0] = turtle_p1;
+	sim_curr.turtle_q[0] = plane_q1;
+	sim_curr.turtle_p[1] = turtle_p2;
+	sim_curr.turtle_q[1] = plane_q2;
+	sim_curr.wing_angle_right = wing_angle_right;
+	sim_curr.wing_angle_left = wing_angle_left;
+	sim_curr.cannon_angle_top = cannon_angle_top;
+	sim_curr.cannon_angle_subsubpart = cannon_angle_subsubpart;
+	sim_prev = sim_curr;
+
+	memset(keys_held, 0, sizeof(keys_held));
+	sim_time = 0;
+	sim_ticks = 0;
+	reload_ticks = 0;
+	ClearShells(shells);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: IsControlKey
+//|
+//! \param key    [in] Key code.
+//! \return True if holding the key moves a turtle or a subpart.
+//|____________________________________________________________________
+
+bool IsControlKey(unsigned char key)
+{
+	return key != 0 && strchr(CONTROL_KEYS, key) != NULL;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SetKeyHeld
+//|
+//! \param key    [in] Key code.
+//! \param held   [in] True on key down, false on key up.
+//! \return None.
+//|____________________________________________________________________
+
+void SetKeyHeld(unsigned char key, bool held)
+{
+	keys_held[key] = held;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: StepControl
+//|
+//! \param None.
+//! \return None.
+//!
+//! Advances the simulation by one tick (SIM_STEP seconds). The crowd's
+//! animation step runs in parallel chunks on tick_pool.
+//|____________________________________________________________________
+
+void StepControl()
+{
+	sim_prev = sim_curr;
+	sim_ticks++;
+
+	StepTurtle(sim_curr.turtle_p[1], sim_curr.turtle_q[1], "sfeqxwad");
+	StepTurtle(sim_curr.turtle_p[0], sim_curr.turtle_q[0], "SFEQXWAD");
+
+	StepAngle(sim_curr.wing_angle_right, 'r', 'R');
+	StepAngle(sim_curr.wing_angle_left, 't', 'T');
+	StepAngle(sim_curr.cannon_angle_top, 'y', 'Y');
+	StepAngle(sim_curr.cannon_angle_subsubpart, 'u', 'U');
+
+	// Shells in flight move, then the cannons fire from this tick's poses and joints
+	StepShells(shells, SIM_STEP);
+	if (use_animation) {
+		StepTurtleAnimations();
+	}
+
+	if (reload_ticks > 0) {
+		reload_ticks--;
+	}
+	bool fire = keys_held['g'] && reload_ticks == 0;
+	bool volley = keys_held['G'];
+	bool publish = pose_share.header != NULL;
+	if (fire || volley || publish) {
+		BlendControl(1.0f);                 // The drawn state is blended again after the ticks
+	}
+	if (fire || volley) {
+		FireTurtleCannons(fire, volley, sim_ticks);
+	}
+	if (fire) {
+		reload_ticks = SHELL_FIRE_INTERVAL;
+	}
+
+	// External readers get every tick's poses (see pose_share.h)
+	if (publish) {
+		PublishTurtlePoses(sim_ticks);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: BlendControl
+//|
+//! \param alpha  [in] Position between the previous (0) and latest (1) tick.
+//! \return None.
+//!
+//! Sets the drawn poses and angles between the last two tick states and
+//! pushes them into the scene graph.
+//|____________________________________________________________________
+
+void BlendControl(float alpha)
+{
+	gmtl::Point4f* p[2] = { &turtle_p1, &turtle_p2 };
+	gmtl::Quatf* q[2] = { &plane_q1, &plane_q2 };
+
+	for (int i = 0; i < 2; i++) {
+		*p[i] = sim_prev.turtle_p[i] + (sim_curr.turtle_p[i] - sim_prev.turtle_p[i]) * alpha;
+		gmtl::slerp(*q[i], alpha, sim_prev.turtle_q[i], sim_curr.turtle_q[i]);
+	}
+
+	wing_angle_right = sim_prev.wing_angle_right + (sim_curr.wing_angle_right - sim_prev.wing_angle_right) * alpha;
+	wing_angle_left = sim_prev.wing_angle_left + (sim_curr.wing_angle_left - sim_prev.wing_angle_left) * alpha;
+	cannon_angle_top = sim_prev.cannon_angle_top + (sim_curr.cannon_angle_top - sim_prev.cannon_angle_top) * alpha;
+	cannon_angle_subsubpart = sim_prev.cannon_angle_subsubpart + (sim_curr.cannon_angle_subsubpart - sim_prev.cannon_angle_subsubpart) * alpha;
+
+	SyncSceneGraph();
+}
+
+//|____________________________________________________________________
+//|
+//| Function: AdvanceControl
+//|
+//! \param seconds [in] Real time elapsed since the last call.
+//! \return True while turtles are moving (keys held, the last tick
+//!         still being blended in or animations playing) or shells are
+//!         in flight, false once everything is at rest.
+//!
+//! Runs the whole ticks that fit in the elapsed time, then blends the
+//! drawn state by the fraction of a tick left over.
+//|____________________________________________________________________
+
+bool AdvanceControl(float seconds)
+{
+	sim_time += seconds;
+	if (sim_time > MAX_TICKS_PER_UPDATE * SIM_STEP) {
+		sim_time = MAX_TICKS_PER_UPDATE * SIM_STEP;
+	}
+
+	while (sim_time >= SIM_STEP) {
+		StepControl();
+		sim_time -= SIM_STEP;
+	}
+
+	BlendControl(sim_time / SIM_STEP);
+
+	for (int i = 0; i < 256; i++) {
+		if (keys_held[i]) {
+			return true;
+		}
+	}
+	if (!Settled() || shells.count > 0 || use_animation) {
+		return true;
+	}
+	sim_time = 0;
+	return false;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: ControlTicks
+//|
+//! \param None.
+//! \return Ticks run since InitControl().
+//|____________________________________________________________________
+
+unsigned int ControlTicks()
+{
+	return sim_ticks;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: GetControlState
+//|
+//! \param None.
+//! \return State at the latest tick.
+//|____________________________________________________________________
+
+const ControlState& GetControlState()
+{
+	return sim_curr;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: ControlChecksum
+//|
+//! \param None.
+//! \return FNV-1a hash of the state at the latest tick, bit for bit.
+//|____________________________________________________________________
+
+unsigned int ControlChecksum()
+{
+	const unsigned char* bytes = (const unsigned char*)&sim_curr;
+	unsigned int hash = 2166136261u;
+
+	for (size_t i = 0; i < sizeof(ControlState); i++) {
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	return hash;
+}
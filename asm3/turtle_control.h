@@ -0,0 +1,54 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_control.h
+//!
+//! \brief Fixed-timestep turtle controls driven by held keys.
+//!
+//! Key presses only mark keys as held. The simulation advances in fixed
+//! ticks of SIM_STEP seconds, and every tick applies one step of motion
+//! for each held key, so speeds no longer depend on the key-repeat rate.
+//! Rendering happens between ticks: the drawn pose blends the last two
+//! tick states (slerp for orientations, lerp for positions and angles).
+//|___________________________________________________________________
+
+#pragma once
+
+#include <gmtl/gmtl.h>
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const int MAX_TICKS_PER_UPDATE = 8;     // Caps catch-up after a stall; the rest of the backlog is dropped
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+// Simulated state of the two controllable turtles at one tick
+struct ControlState
+{
+	gmtl::Point4f turtle_p[2];          // Turtle 1, turtle 2
+	gmtl::Quatf turtle_q[2];
+	float wing_angle_right;             // Turtle 2's subparts
+	float wing_angle_left;
+	float cannon_angle_top;
+	float cannon_angle_subsubpart;
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void InitControl();
+bool IsControlKey(unsigned char key);
+void SetKeyHeld(unsigned char key, bool held);
+void StepControl();
+void BlendControl(float alpha);
+bool AdvanceControl(float seconds);
+unsigned int ControlTicks();
+const ControlState& GetControlState();
+unsigned int ControlChecksum();
@@ -0,0 +1,184 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_culling.cpp
+//!
+//! \brief Hierarchical view-frustum culling of the turtle scene graph.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <math.h>
+
+#include "pose_math.h"
+#include "turtle_culling.h"
+#include "turtle_mesh.h"
+
+//|___________________
+//|
+//| Global Variables
+//|___________________
+
+static float node_radius[TN_COUNT];     // Bound of each part about its node's origin
+static float turtle_radius = 0;         // Bound of a whole turtle about its body's origin
+
+//|____________________________________________________________________
+//|
+//| Function: InitTurtleBounds
+//|
+//! \param None.
+//! \return None.
+//!
+//! Measures the part meshes (built from the turtle_model.h dimensions)
+//! and the frame lengths, then bounds each turtle by walking the offsets
+//! from every node up to the body. Joints only rotate children about
+//! their parent's origin, so the sum of offset lengths along the chain
+//! bounds a node's distance from the body whatever the joint angles.
+//|____________________________________________________________________
+
+void InitTurtleBounds()
+{
+	std::vector<MeshVertex> vertices;
+	MeshRange ranges[MESH_COUNT];
+	BuildTurtleMeshes(vertices, ranges);
+
+	turtle_radius = 0;
+	for (int n = 0; n < TN_COUNT; n++) {
+		const MeshRange& range = ranges[TurtlePartMesh((TurtleNode)n)];
+
+		float r2 = 0;
+		for (int i = range.first; i < range.first + range.count; i++) {
+			const float* v = vertices[i].position;
+			float d2 = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+			r2 = d2 > r2 ? d2 : r2;
+		}
+		node_radius[n] = sqrtf(r2);
+		if (TurtlePartFrame((TurtleNode)n) > node_radius[n]) {
+			node_radius[n] = TurtlePartFrame((TurtleNode)n);
+		}
+
+		float chain = 0;
+		for (int k = n; GetTurtleNodeDesc((TurtleNode)k).parent >= 0; k = GetTurtleNodeDesc((TurtleNode)k).parent) {
+			chain += gmtl::length(GetTurtleNodeDesc((TurtleNode)k).offset);
+		}
+		if (chain + node_radius[n] > turtle_radius) {
+			turtle_radius = chain + node_radius[n];
+		}
+	}
+}
+
+float TurtleNodeRadius(TurtleNode node)
+{
+	return node_radius[node];
+}
+
+float TurtleRadius()
+{
+	return turtle_radius;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: BuildFrustum
+//|
+//! \param frustum [out] World-space frustum.
+//! \param view    [in] View matrix (world to eye), column-major.
+//! \param fov     [in] Vertical field of view (degs), as for gluPerspective().
+//! \param aspect  [in] Width / height.
+//! \param near_z  [in] Near plane distance.
+//! \param far_z   [in] Far plane distance.
+//! \return None.
+//!
+//! Sets up the planes in eye space (camera looking down -Z) and moves them
+//! to world space: a plane P of eye space is the plane view^T * P of the
+//! world. The view is rigid, so the plane normals stay unit length.
+//|____________________________________________________________________
+
+void BuildFrustum(Frustum& frustum, const float view[16], float fov, float aspect, float near_z, float far_z)
+{
+	float ty = tanf(DegToRad(fov) / 2);
+	float tx = ty * aspect;
+	float ny = 1 / sqrtf(1 + ty * ty);
+	float nx = 1 / sqrtf(1 + tx * tx);
+
+	const float eye[6][4] = {
+		{  nx,  0, -tx * nx, 0 },       // Left
+		{ -nx,  0, -tx * nx, 0 },       // Right
+		{  0,  ny, -ty * ny, 0 },       // Bottom
+		{  0, -ny, -ty * ny, 0 },       // Top
+		{  0,   0, -1, -near_z },       // Near
+		{  0,   0,  1,  far_z },        // Far
+	};
+
+	for (int p = 0; p < 6; p++) {
+		for (int j = 0; j < 4; j++) {
+			frustum.planes[p][j] = view[j * 4 + 0] * eye[p][0] + view[j * 4 + 1] * eye[p][1] +
+			                       view[j * 4 + 2] * eye[p][2] + view[j * 4 + 3] * eye[p][3];
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: TestSphere
+//|
+//! \param frustum [in] World-space frustum.
+//! \param center  [in] Sphere center (world).
+//! \param radius  [in] Sphere radius.
+//! \return Whether the sphere is outside, crossing or inside the frustum.
+//|____________________________________________________________________
+
+CullResult TestSphere(const Frustum& frustum, const float center[3], float radius)
+{
+	CullResult result = CULL_INSIDE;
+
+	for (int p = 0; p < 6; p++) {
+		const float* plane = frustum.planes[p];
+		float d = plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3];
+		if (d < -radius) {
+			return CULL_OUTSIDE;
+		}
+		if (d < radius) {
+			result = CULL_INTERSECT;
+		}
+	}
+	return result;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: CullScene
+//|
+//! \param scene           [in] Scene graph with up-to-date world matrices.
+//! \param frustum         [in] World-space frustum.
+//! \param visible_turtles [out] Turtles at least partly in view; room for
+//!                             every turtle.
+//! \param visible_nodes   [out] Nodes in view, in scene order; room for
+//!                             every node.
+//! \return Counts of the visible turtles and nodes.
+//|____________________________________________________________________
+
+CullStats CullScene(const SceneGraph& scene, const Frustum& frustum, int* visible_turtles, int* visible_nodes)
+{
+	CullStats stats = { 0, 0 };
+
+	for (int t = 0; t < TurtleCount(scene); t++) {
+		int body = TurtleNodeId(t, TN_BODY);
+		CullResult result = TestSphere(frustum, &scene.world[body].getData()[12], turtle_radius);
+		if (result == CULL_OUTSIDE) {
+			continue;                           // Whole subtree rejected
+		}
+
+		visible_turtles[stats.turtles_visible++] = t;
+		for (int n = 0; n < TN_COUNT; n++) {
+			const float* center = &scene.world[body + n].getData()[12];
+			if (result == CULL_INSIDE || TestSphere(frustum, center, node_radius[n]) != CULL_OUTSIDE) {
+				visible_nodes[stats.nodes_visible++] = body + n;
+			}
+		}
+	}
+
+	return stats;
+}
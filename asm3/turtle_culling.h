@@ -0,0 +1,62 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_culling.h
+//!
+//! \brief Hierarchical view-frustum culling of the turtle scene graph.
+//!
+//! Every node type has a bounding sphere about its own origin that holds
+//! its mesh and its coordinate frame; every turtle has one about its body
+//! origin that holds all of its parts at any joint angles. A turtle whose
+//! sphere is outside the frustum is dropped with all its nodes, one fully
+//! inside keeps all its nodes untested, and only the turtles crossing the
+//! frustum boundary have their nodes tested one by one.
+//|___________________________________________________________________
+
+#pragma once
+
+#include <vector>
+
+#include <gmtl/gmtl.h>
+
+#include "scene_graph.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+enum CullResult {
+	CULL_OUTSIDE = 0,
+	CULL_INTERSECT,
+	CULL_INSIDE
+};
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+// Six planes (a, b, c, d) in world coordinates with normals pointing inwards
+struct Frustum
+{
+	float planes[6][4];
+};
+
+struct CullStats
+{
+	int turtles_visible;
+	int nodes_visible;
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void InitTurtleBounds();
+float TurtleNodeRadius(TurtleNode node);
+float TurtleRadius();
+
+void BuildFrustum(Frustum& frustum, const float view[16], float fov, float aspect, float near_z, float far_z);
+CullResult TestSphere(const Frustum& frustum, const float center[3], float radius);
+CullStats CullScene(const SceneGraph& scene, const Frustum& frustum, int* visible_turtles, int* visible_nodes);
@@ -0,0 +1,608 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_grid.cpp
+//!
+//! \brief Uniform hash grid over turtle positions for proximity queries.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <math.h>
+#include <string.h>
+
+#include "turtle_grid.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+static const int CELL_COORD_BITS = 21;                          // Per axis in a cell key
+static const int CELL_COORD_BIAS = 1 << (CELL_COORD_BITS - 1);  // Coordinates are stored biased to be unsigned
+static const uint64_t HASH_MULTIPLIER = 0x9E3779B97F4A7C15ull;  // 2^64 / golden ratio
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+struct UpdateContext
+{
+	TurtleGrid* grid;
+	const TurtlePoses* poses;
+	int listed;                                 // Turtles already in the grid before the update
+};
+
+struct BatchContext
+{
+	const TurtleGrid* grid;
+	const GridQuery* queries;
+	GridResults* results;
+};
+
+//|___________________
+//|
+//| Local Functions
+//|___________________
+
+//|____________________________________________________________________
+//|
+//| Function: CellCoord
+//|
+//! \param v         [in] Position along one axis.
+//! \param inv_size  [in] 1 / cell size.
+//! \return Cell coordinate along the axis, clamped to the key range.
+//|____________________________________________________________________
+
+static inline int CellCoord(float v, float inv_size)
+{
+	float c = floorf(v * inv_size);
+	if (c < (float)-CELL_COORD_BIAS) {
+		return -CELL_COORD_BIAS;
+	}
+	if (c > (float)(CELL_COORD_BIAS - 1)) {
+		return CELL_COORD_BIAS - 1;
+	}
+	return (int)c;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: CellKey
+//|
+//! \param x, y, z   [in] Cell coordinates.
+//! \return The coordinates packed into 63 bits.
+//|____________________________________________________________________
+
+static inline uint64_t CellKey(int x, int y, int z)
+{
+	return ((uint64_t)(x + CELL_COORD_BIAS) << (2 * CELL_COORD_BITS)) |
+	       ((uint64_t)(y + CELL_COORD_BIAS) << CELL_COORD_BITS) |
+	       (uint64_t)(z + CELL_COORD_BIAS);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: FindCell
+//|
+//! \param grid    [in] Grid.
+//! \param key     [in] Cell key.
+//! \return Index into grid.cells, or -1 if the cell was never occupied.
+//|____________________________________________________________________
+
+static inline int FindCell(const TurtleGrid& grid, uint64_t key)
+{
+	size_t mask = grid.slots.size() - 1;
+	size_t slot = (size_t)((key * HASH_MULTIPLIER) >> 32) & mask;
+
+	while (grid.slots[slot].cell >= 0) {
+		if (grid.slots[slot].key == key) {
+			return grid.slots[slot].cell;
+		}
+		slot = (slot + 1) & mask;
+	}
+	return -1;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: AddSlot
+//|
+//! \param grid    [in,out] Grid with a free slot.
+//! \param key     [in] Cell key, not in the table.
+//! \param cell    [in] Index into grid.cells.
+//! \return None.
+//|____________________________________________________________________
+
+static void AddSlot(TurtleGrid& grid, uint64_t key, int cell)
+{
+	size_t mask = grid.slots.size() - 1;
+	size_t slot = (size_t)((key * HASH_MULTIPLIER) >> 32) & mask;
+
+	while (grid.slots[slot].cell >= 0) {
+		slot = (slot + 1) & mask;
+	}
+	grid.slots[slot].key = key;
+	grid.slots[slot].cell = cell;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: Rehash
+//|
+//! \param grid    [in,out] Grid.
+//! \return None.
+//!
+//! Drops the empty cells, renumbering the others, and rebuilds the hash
+//! table at most a quarter full (it grows once half full).
+//|____________________________________________________________________
+
+static void Rehash(TurtleGrid& grid)
+{
+	size_t kept = 0;
+	for (size_t c = 0; c < grid.cells.size(); c++) {
+		std::vector<GridEntry>& entries = grid.cells[c].entries;
+		if (entries.empty()) {
+			continue;
+		}
+		for (size_t k = 0; k < entries.size(); k++) {
+			grid.turtle_cells[entries[k].turtle] = (int)kept;
+		}
+		if (kept != c) {
+			grid.cells[kept].key = grid.cells[c].key;
+			grid.cells[kept].entries.swap(entries);
+		}
+		kept++;
+	}
+	grid.cells.resize(kept);
+	grid.empty_cells = 0;
+
+	size_t slots = GRID_MIN_SLOTS;
+	while (slots < 4 * kept) {
+		slots *= 2;
+	}
+	GridSlot free_slot = { 0, -1 };
+	grid.slots.assign(slots, free_slot);
+	for (size_t c = 0; c < kept; c++) {
+		AddSlot(grid, grid.cells[c].key, (int)c);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: InsertCell
+//|
+//! \param grid    [in,out] Grid.
+//! \param key     [in] Cell key.
+//! \return Index into grid.cells of the cell, created empty if new.
+//|____________________________________________________________________
+
+static int InsertCell(TurtleGrid& grid, uint64_t key)
+{
+	int cell = FindCell(grid, key);
+	if (cell >= 0) {
+		return cell;
+	}
+
+	if (2 * (grid.cells.size() + 1) > grid.slots.size()) {
+		Rehash(grid);
+	}
+
+	cell = (int)grid.cells.size();
+	grid.cells.push_back(GridCell());
+	grid.cells[cell].key = key;
+	AddSlot(grid, key, cell);
+	grid.empty_cells++;
+	return cell;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: ListTurtle
+//|
+//! \param grid    [in,out] Grid.
+//! \param poses   [in] Positions.
+//! \param turtle  [in] Turtle not listed in any cell.
+//! \param key     [in] Cell to list it in.
+//! \return None.
+//|____________________________________________________________________
+
+static void ListTurtle(TurtleGrid& grid, const TurtlePoses& poses, int turtle, uint64_t key)
+{
+	int cell = InsertCell(grid, key);
+	std::vector<GridEntry>& entries = grid.cells[cell].entries;
+	if (entries.empty()) {
+		grid.empty_cells--;
+	}
+
+	GridEntry entry = { poses.px[turtle], poses.py[turtle], poses.pz[turtle], turtle };
+	grid.turtle_keys[turtle] = key;
+	grid.turtle_cells[turtle] = cell;
+	grid.turtle_entries[turtle] = (int)entries.size();
+	entries.push_back(entry);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: UnlistTurtle
+//|
+//! \param grid    [in,out] Grid.
+//! \param turtle  [in] Listed turtle.
+//! \return None.
+//!
+//! Removes the turtle from its cell's list, moving the last entry of the
+//! list into its place.
+//|____________________________________________________________________
+
+static void UnlistTurtle(TurtleGrid& grid, int turtle)
+{
+	std::vector<GridEntry>& entries = grid.cells[grid.turtle_cells[turtle]].entries;
+	int index = grid.turtle_entries[turtle];
+
+	entries[index] = entries.back();
+	grid.turtle_entries[entries[index].turtle] = index;
+	entries.pop_back();
+	if (entries.empty()) {
+		grid.empty_cells++;
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: FindMovesChunk
+//|
+//! \param begin   [in] First turtle.
+//! \param end     [in] One past the last turtle.
+//! \param context [in,out] UpdateContext.
+//! \return None.
+//!
+//! Computes each turtle's cell, refreshes the entries of the turtles that
+//! stayed in their cell and collects, in order, the turtles that are new
+//! or in another cell. Writes only the range's keys and entries and the
+//! chunk's own move list.
+//|____________________________________________________________________
+
+static void FindMovesChunk(int begin, int end, void* context)
+{
+	UpdateContext& u = *(UpdateContext*)context;
+	TurtleGrid& grid = *u.grid;
+	const TurtlePoses& poses = *u.poses;
+	float inv_size = 1.0f / grid.cell_size;
+	std::vector<int>& moves = grid.chunk_moves[begin / GRID_GRAIN];
+
+	moves.clear();
+	for (int i = begin; i < end; i++) {
+		uint64_t key = CellKey(CellCoord(poses.px[i], inv_size), CellCoord(poses.py[i], inv_size), CellCoord(poses.pz[i], inv_size));
+		grid.new_keys[i] = key;
+		if (i >= u.listed || key != grid.turtle_keys[i]) {
+			moves.push_back(i);
+		}
+		else {
+			GridEntry& entry = grid.cells[grid.turtle_cells[i]].entries[grid.turtle_entries[i]];
+			entry.x = poses.px[i];
+			entry.y = poses.py[i];
+			entry.z = poses.pz[i];
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: GatherCell
+//|
+//! \param grid    [in] Grid.
+//! \param query   [in] Radius or box query.
+//! \param cell    [in] Index into grid.cells.
+//! \param turtles [in,out] Turtles of the cell matching the query are appended.
+//! \return None.
+//|____________________________________________________________________
+
+static inline void GatherCell(const TurtleGrid& grid, const GridQuery& query, int cell, std::vector<int>& turtles)
+{
+	const std::vector<GridEntry>& entries = grid.cells[cell].entries;
+	size_t count = entries.size();
+	size_t found = turtles.size();
+
+	// Every entry is written and kept only if it matches: no branch to mispredict
+	turtles.resize(found + count);
+	int* out = turtles.data();
+
+	if (query.type == GRID_QUERY_RADIUS) {
+		float r2 = query.radius * query.radius;
+		for (size_t k = 0; k < count; k++) {
+			const GridEntry& e = entries[k];
+			float dx = e.x - query.center[0];
+			float dy = e.y - query.center[1];
+			float dz = e.z - query.center[2];
+			out[found] = e.turtle;
+			found += (dx * dx + dy * dy + dz * dz <= r2) & (e.turtle != query.exclude);
+		}
+	}
+	else {
+		for (size_t k = 0; k < count; k++) {
+			const GridEntry& e = entries[k];
+			out[found] = e.turtle;
+			found += (e.x >= query.min[0]) & (e.x <= query.max[0]) &
+			         (e.y >= query.min[1]) & (e.y <= query.max[1]) &
+			         (e.z >= query.min[2]) & (e.z <= query.max[2]) & (e.turtle != query.exclude);
+		}
+	}
+	turtles.resize(found);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: AppendQuery
+//|
+//! \param grid    [in] Grid.
+//! \param query   [in] Radius or box query.
+//! \param turtles [in,out] Matching turtles are appended.
+//! \return None.
+//!
+//! Visits the cells overlapping the query's bounds, or every occupied
+//! cell when the bounds cover more cells than are occupied.
+//|____________________________________________________________________
+
+static void AppendQuery(const TurtleGrid& grid, const GridQuery& query, std::vector<int>& turtles)
+{
+	float lo[3], hi[3];
+	for (int i = 0; i < 3; i++) {
+		lo[i] = query.type == GRID_QUERY_RADIUS ? query.center[i] - query.radius : query.min[i];
+		hi[i] = query.type == GRID_QUERY_RADIUS ? query.center[i] + query.radius : query.max[i];
+	}
+
+	float inv_size = 1.0f / grid.cell_size;
+	int c0[3], c1[3];
+	double range = 1;
+	for (int i = 0; i < 3; i++) {
+		c0[i] = CellCoord(lo[i], inv_size);
+		c1[i] = CellCoord(hi[i], inv_size);
+		range *= (double)(c1[i] - c0[i] + 1);
+	}
+
+	if (range > (double)grid.cells.size()) {
+		for (size_t c = 0; c < grid.cells.size(); c++) {
+			GatherCell(grid, query, (int)c, turtles);
+		}
+		return;
+	}
+
+	for (int x = c0[0]; x <= c1[0]; x++) {
+		for (int y = c0[1]; y <= c1[1]; y++) {
+			for (int z = c0[2]; z <= c1[2]; z++) {
+				int cell = FindCell(grid, CellKey(x, y, z));
+				if (cell >= 0) {
+					GatherCell(grid, query, cell, turtles);
+				}
+			}
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: BatchChunk
+//|
+//! \param begin   [in] First query.
+//! \param end     [in] One past the last query.
+//! \param context [in,out] BatchContext.
+//! \return None.
+//!
+//! Runs a range of queries into the chunk's own count and turtle lists.
+//|____________________________________________________________________
+
+static void BatchChunk(int begin, int end, void* context)
+{
+	BatchContext& b = *(BatchContext*)context;
+	int chunk = begin / GRID_GRAIN;
+	std::vector<int>& counts = b.results->chunk_counts[chunk];
+	std::vector<int>& turtles = b.results->chunk_turtles[chunk];
+
+	counts.clear();
+	turtles.clear();
+	for (int q = begin; q < end; q++) {
+		size_t before = turtles.size();
+		AppendQuery(*b.grid, b.queries[q], turtles);
+		counts.push_back((int)(turtles.size() - before));
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: InitTurtleGrid
+//|
+//! \param grid      [out] Grid, emptied.
+//! \param cell_size [in] Edge of a cell; about twice the usual query radius,
+//!                  so most radius queries overlap 2x2x2 cells.
+//! \return None.
+//|____________________________________________________________________
+
+void InitTurtleGrid(TurtleGrid& grid, float cell_size)
+{
+	grid = TurtleGrid();
+	grid.cell_size = cell_size;
+	grid.empty_cells = 0;
+	grid.moved = 0;
+	Rehash(grid);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: UpdateTurtleGrid
+//|
+//! \param grid    [in,out] Grid.
+//! \param poses   [in] Current positions; turtles added since the last
+//!                update are listed, none may have been removed.
+//! \param pool    [in,out] Thread pool, or NULL to run on the calling thread.
+//! \return None.
+//!
+//! Relists the turtles that moved to another cell. Call after the poses
+//! change and before querying.
+//|____________________________________________________________________
+
+void UpdateTurtleGrid(TurtleGrid& grid, const TurtlePoses& poses, ThreadPool* pool)
+{
+	int count = PoseCount(poses);
+	int listed = (int)grid.turtle_keys.size();
+	if (count < listed) {
+		InitTurtleGrid(grid, grid.cell_size);         // Turtles were removed: start over
+		listed = 0;
+	}
+
+	grid.turtle_keys.resize(count);
+	grid.turtle_cells.resize(count);
+	grid.turtle_entries.resize(count);
+	grid.new_keys.resize(count);
+	grid.chunk_moves.resize((count + GRID_GRAIN - 1) / GRID_GRAIN);
+
+	// Cells and entries of all turtles in parallel; the moves found are few at simulation speeds
+	UpdateContext context = { &grid, &poses, listed };
+	if (pool) {
+		ParallelFor(pool, count, GRID_GRAIN, FindMovesChunk, &context);
+	}
+	else {
+		for (int begin = 0; begin < count; begin += GRID_GRAIN) {
+			FindMovesChunk(begin, begin + GRID_GRAIN < count ? begin + GRID_GRAIN : count, &context);
+		}
+	}
+
+	// Relisting in turtle order keeps every list's order independent of the threads
+	grid.moved = 0;
+	for (size_t chunk = 0; chunk < grid.chunk_moves.size(); chunk++) {
+		const std::vector<int>& moves = grid.chunk_moves[chunk];
+		for (size_t k = 0; k < moves.size(); k++) {
+			int t = moves[k];
+			if (t < listed) {
+				UnlistTurtle(grid, t);
+			}
+			ListTurtle(grid, poses, t, grid.new_keys[t]);
+		}
+		grid.moved += (int)moves.size();
+	}
+
+	if (grid.empty_cells > GRID_MIN_SLOTS && 2 * grid.empty_cells > (int)grid.cells.size()) {
+		Rehash(grid);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: QueryTurtleGridRadius
+//|
+//! \param grid    [in] Grid.
+//! \param center  [in] Center of the sphere.
+//! \param radius  [in] Radius of the sphere.
+//! \param exclude [in] Turtle left out, or -1.
+//! \param turtles [out] Turtles within radius of center.
+//! \return None.
+//|____________________________________________________________________
+
+void QueryTurtleGridRadius(const TurtleGrid& grid, const float center[3], float radius, int exclude, std::vector<int>& turtles)
+{
+	GridQuery query;
+	query.type = GRID_QUERY_RADIUS;
+	memcpy(query.center, center, sizeof(query.center));
+	query.radius = radius;
+	query.exclude = exclude;
+
+	turtles.clear();
+	AppendQuery(grid, query, turtles);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: QueryTurtleGridBox
+//|
+//! \param grid    [in] Grid.
+//! \param min     [in] Lower corner of the box.
+//! \param max     [in] Upper corner of the box.
+//! \param exclude [in] Turtle left out, or -1.
+//! \param turtles [out] Turtles inside the box (bounds included).
+//! \return None.
+//|____________________________________________________________________
+
+void QueryTurtleGridBox(const TurtleGrid& grid, const float min[3], const float max[3], int exclude, std::vector<int>& turtles)
+{
+	GridQuery query;
+	query.type = GRID_QUERY_BOX;
+	memcpy(query.min, min, sizeof(query.min));
+	memcpy(query.max, max, sizeof(query.max));
+	query.exclude = exclude;
+
+	turtles.clear();
+	AppendQuery(grid, query, turtles);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: QueryTurtleGrid
+//|
+//! \param grid    [in] Grid.
+//! \param query   [in] Radius or box query.
+//! \param turtles [out] Matching turtles.
+//! \return None.
+//|____________________________________________________________________
+
+void QueryTurtleGrid(const TurtleGrid& grid, const GridQuery& query, std::vector<int>& turtles)
+{
+	turtles.clear();
+	AppendQuery(grid, query, turtles);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: QueryTurtleGridBatch
+//|
+//! \param grid    [in] Grid.
+//! \param queries [in] Radius and box queries.
+//! \param count   [in] Number of queries.
+//! \param results [out] Matching turtles of every query, in query order.
+//! \param pool    [in,out] Thread pool, or NULL to run on the calling thread.
+//! \return None.
+//!
+//! Chunks of queries run in parallel into per-chunk lists that are then
+//! joined in order. Reuse the same results to avoid reallocating them.
+//|____________________________________________________________________
+
+void QueryTurtleGridBatch(const TurtleGrid& grid, const GridQuery* queries, int count, GridResults& results, ThreadPool* pool)
+{
+	int chunks = (count + GRID_GRAIN - 1) / GRID_GRAIN;
+	results.chunk_counts.resize(chunks);
+	results.chunk_turtles.resize(chunks);
+
+	BatchContext context = { &grid, queries, &results };
+	if (pool) {
+		ParallelFor(pool, count, GRID_GRAIN, BatchChunk, &context);
+	}
+	else {
+		for (int begin = 0; begin < count; begin += GRID_GRAIN) {
+			BatchChunk(begin, begin + GRID_GRAIN < count ? begin + GRID_GRAIN : count, &context);
+		}
+	}
+
+	// Join the chunks in query order
+	results.offsets.resize(count + 1);
+	results.offsets[0] = 0;
+	size_t total = 0;
+	int q = 0;
+	for (int c = 0; c < chunks; c++) {
+		const std::vector<int>& counts = results.chunk_counts[c];
+		for (size_t k = 0; k < counts.size(); k++, q++) {
+			results.offsets[q + 1] = results.offsets[q] + counts[k];
+		}
+		total += results.chunk_turtles[c].size();
+	}
+
+	results.turtles.resize(total);
+	size_t at = 0;
+	for (int c = 0; c < chunks; c++) {
+		const std::vector<int>& turtles = results.chunk_turtles[c];
+		if (!turtles.empty()) {
+			memcpy(&results.turtles[at], &turtles[0], turtles.size() * sizeof(int));
+			at += turtles.size();
+		}
+	}
+}
@@ -0,0 +1,120 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_grid.h
+//!
+//! \brief Uniform hash grid over turtle positions for proximity queries.
+//!
+//! Space is cut into cubic cells of a fixed size; only occupied cells are
+//! stored, in an open-addressing hash table keyed on the cell coordinates,
+//! so the world needs no bounds. Each cell lists the turtles inside it
+//! with a copy of their positions, so a query reads contiguous entries
+//! instead of gathering from the pose arrays.
+//!
+//! UpdateTurtleGrid() follows the turtles as they move: the cell of every
+//! turtle is recomputed and its entry refreshed in parallel chunks, and
+//! only the turtles that crossed into another cell are moved between
+//! lists. Radius and box queries visit the cells overlapping the query and
+//! test the entries' positions exactly, as of the last update.
+//!
+//! Queries only read the grid, so any number of threads may query at once
+//! between updates. QueryTurtleGridBatch() runs a batch on a ThreadPool;
+//! its results do not depend on the number of threads.
+//|___________________________________________________________________
+
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "thread_pool.h"
+#include "turtle_poses.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const int GRID_GRAIN = 1024;                    // Turtles or queries per chunk
+const int GRID_MIN_SLOTS = 1024;                // Smallest hash table
+
+enum GridQueryType {
+	GRID_QUERY_RADIUS = 0,                      // Turtles within radius of center
+	GRID_QUERY_BOX                              // Turtles inside [min, max]
+};
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+struct GridEntry
+{
+	float x, y, z;                              // Position at the last update
+	int turtle;
+};
+
+// Turtles of one occupied cell
+struct GridCell
+{
+	uint64_t key;                               // Packed cell coordinates
+	std::vector<GridEntry> entries;
+};
+
+// Hash table slot
+struct GridSlot
+{
+	uint64_t key;
+	int cell;                                   // Index into TurtleGrid::cells, -1 if free
+};
+
+struct TurtleGrid
+{
+	float cell_size;
+
+	std::vector<GridSlot> slots;                // Hash table from cell key to cell (size is a power of 2)
+	std::vector<GridCell> cells;                // Cells empty after moves stay until the next rehash
+	int empty_cells;
+
+	// Per turtle
+	std::vector<uint64_t> turtle_keys;          // Cell the turtle is listed in
+	std::vector<int> turtle_cells;              // Index of that cell
+	std::vector<int> turtle_entries;            // Index within that cell's entries
+	std::vector<uint64_t> new_keys;             // Cell of the current position (scratch of the update)
+
+	std::vector<std::vector<int> > chunk_moves; // Turtles that changed cell, per update chunk
+	int moved;                                  // Turtles that changed cell in the last update
+};
+
+struct GridQuery
+{
+	GridQueryType type;
+	float center[3];                            // GRID_QUERY_RADIUS
+	float radius;
+	float min[3];                               // GRID_QUERY_BOX
+	float max[3];
+	int exclude;                                // Turtle left out of the results (e.g. the querying one), or -1
+};
+
+// Results of a batch: turtles of query q are turtles[offsets[q]] .. turtles[offsets[q + 1] - 1]
+struct GridResults
+{
+	std::vector<int> offsets;
+	std::vector<int> turtles;
+
+	std::vector<std::vector<int> > chunk_counts;     // Scratch, per chunk of queries
+	std::vector<std::vector<int> > chunk_turtles;
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void InitTurtleGrid(TurtleGrid& grid, float cell_size);
+void UpdateTurtleGrid(TurtleGrid& grid, const TurtlePoses& poses, ThreadPool* pool);
+
+void QueryTurtleGridRadius(const TurtleGrid& grid, const float center[3], float radius, int exclude, std::vector<int>& turtles);
+void QueryTurtleGridBox(const TurtleGrid& grid, const float min[3], const float max[3], int exclude, std::vector<int>& turtles);
+void QueryTurtleGrid(const TurtleGrid& grid, const GridQuery& query, std::vector<int>& turtles);
+void QueryTurtleGridBatch(const TurtleGrid& grid, const GridQuery* queries, int count, GridResults& results, ThreadPool* pool);
@@ -0,0 +1,461 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_instancing.cpp
+//!
+//! \brief Instanced rendering of whole turtle populations.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <stdio.h>
+
+#include "turtle_instancing.h"
+#include "turtle_mesh.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+// Vertex attribute slots
+enum InstanceAttrib {
+	ATTRIB_POSITION = 0,
+	ATTRIB_COLOUR,
+	ATTRIB_TURTLE_POSITION,
+	ATTRIB_TURTLE_ORIENTATION,
+	ATTRIB_TURTLE_JOINTS
+};
+
+// Parts sit at most two nodes below the body (head -> eye, cannon base -> cannon)
+const int MAX_PART_DEPTH = 2;
+
+// Inputs and outputs of each language version; the locations are InstanceAttrib's
+static const char* VERTEX_HEADER[INSTANCING_PATH_COUNT] = {
+	"#version 120\n"
+	"attribute vec3 a_position;\n"
+	"attribute vec3 a_colour;\n"
+	"attribute vec3 a_turtle_position;\n"
+	"attribute vec4 a_turtle_orientation;\n"
+	"attribute vec4 a_turtle_joints;\n"
+	"varying vec3 v_colour;\n",
+
+	"#version 330 core\n"
+	"layout(location = 0) in vec3 a_position;\n"
+	"layout(location = 1) in vec3 a_colour;\n"
+	"layout(location = 2) in vec3 a_turtle_position;\n"
+	"layout(location = 3) in vec4 a_turtle_orientation;\n"
+	"layout(location = 4) in vec4 a_turtle_joints;\n"
+	"out vec3 v_colour;\n"
+};
+
+// Level i of a part is: p = offset[i] + R(axis[i].xyz, joints . joint[i]) * Rx(axis[i].w) * p,
+// applied from the deepest level up; unused levels are identities.
+static const char* VERTEX_BODY =
+	"uniform mat4 u_view_projection;\n"
+	"uniform vec4 u_offset[2];\n"
+	"uniform vec4 u_axis[2];\n"
+	"uniform vec4 u_joint[2];\n"
+	"uniform float u_scale;\n"
+	"vec3 RotateAxis(vec3 p, vec3 axis, float deg)\n"
+	"{\n"
+	"	float a = radians(deg);\n"
+	"	float c = cos(a);\n"
+	"	return p * c + cross(axis, p) * sin(a) + axis * dot(axis, p) * (1.0 - c);\n"
+	"}\n"
+	"vec3 RotateQuat(vec3 p, vec4 q)\n"
+	"{\n"
+	"	vec3 t = 2.0 * cross(q.xyz, p);\n"
+	"	return p + q.w * t + cross(q.xyz, t);\n"
+	"}\n"
+	"void main()\n"
+	"{\n"
+	"	vec3 p = a_position * u_scale;\n"
+	"	for (int i = 1; i >= 0; i--) {\n"
+	"		p = RotateAxis(p, vec3(1.0, 0.0, 0.0), u_axis[i].w);\n"
+	"		p = RotateAxis(p, u_axis[i].xyz, dot(a_turtle_joints, u_joint[i]));\n"
+	"		p = p + u_offset[i].xyz;\n"
+	"	}\n"
+	"	p = RotateQuat(p, a_turtle_orientation) + a_turtle_position;\n"
+	"	gl_Position = u_view_projection * vec4(p, 1.0);\n"
+	"	v_colour = a_colour;\n"
+	"}\n";
+
+static const char* FRAGMENT_SHADER[INSTANCING_PATH_COUNT] = {
+	"#version 120\n"
+	"varying vec3 v_colour;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = vec4(v_colour, 1.0);\n"
+	"}\n",
+
+	"#version 330 core\n"
+	"in vec3 v_colour;\n"
+	"out vec4 frag_colour;\n"
+	"void main()\n"
+	"{\n"
+	"	frag_colour = vec4(v_colour, 1.0);\n"
+	"}\n"
+};
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+// Uniform values placing one part type w.r.t. the body
+struct PartChain
+{
+	float offset[MAX_PART_DEPTH][4];
+	float axis[MAX_PART_DEPTH][4];
+	float joint[MAX_PART_DEPTH][4];
+};
+
+// Program of one path and its uniforms
+struct InstancingProgram
+{
+	GLuint program;
+	GLint u_view_projection;
+	GLint u_offset;
+	GLint u_axis;
+	GLint u_joint;
+	GLint u_scale;
+};
+
+//|___________________
+//|
+//| Global Variables
+//|___________________
+
+static InstancingProgram programs[INSTANCING_PATH_COUNT];
+static GLuint instance_vbo = 0;
+static GLuint core_vao = 0;                 // Every attribute of the core path, set up once
+static PartChain part_chains[TN_COUNT];
+
+//|____________________________________________________________________
+//|
+//| Function: CompileShader
+//|
+//! \param type     [in] GL_VERTEX_SHADER or GL_FRAGMENT_SHADER.
+//! \param count    [in] Number of source strings.
+//! \param sources  [in] GLSL source, concatenated in order.
+//! \return Shader object, 0 on failure (the log is printed).
+//|____________________________________________________________________
+
+static GLuint CompileShader(GLenum type, GLsizei count, const char* const* sources)
+{
+	GLuint shader = glCreateShader(type);
+	GLint ok = 0;
+
+	glShaderSource(shader, count, sources, 0);
+	glCompileShader(shader);
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+	if (!ok) {
+		char log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), 0, log);
+		printf("Shader compile error: %s\n", log);
+		glDeleteShader(shader);
+		return 0;
+	}
+
+	return shader;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: BuildProgram
+//|
+//! \param path     [in] Language version to build.
+//! \param program  [out] Program and its uniform locations; program is 0 on failure.
+//! \return True on success.
+//|____________________________________________________________________
+
+static bool BuildProgram(InstancingPath path, InstancingProgram& program)
+{
+	program.program = 0;
+
+	const char* vertex[2] = { VERTEX_HEADER[path], VERTEX_BODY };
+	GLuint vs = CompileShader(GL_VERTEX_SHADER, 2, vertex);
+	GLuint fs = CompileShader(GL_FRAGMENT_SHADER, 1, &FRAGMENT_SHADER[path]);
+	if (!vs || !fs) {
+		return false;
+	}
+
+	GLuint p = glCreateProgram();
+	glAttachShader(p, vs);
+	glAttachShader(p, fs);
+	if (path == INSTANCING_GLSL120) {
+		glBindAttribLocation(p, ATTRIB_POSITION, "a_position");
+		glBindAttribLocation(p, ATTRIB_COLOUR, "a_colour");
+		glBindAttribLocation(p, ATTRIB_TURTLE_POSITION, "a_turtle_position");
+		glBindAttribLocation(p, ATTRIB_TURTLE_ORIENTATION, "a_turtle_orientation");
+		glBindAttribLocation(p, ATTRIB_TURTLE_JOINTS, "a_turtle_joints");
+	}
+	glLinkProgram(p);
+	glDeleteShader(vs);
+	glDeleteShader(fs);
+
+	GLint ok = 0;
+	glGetProgramiv(p, GL_LINK_STATUS, &ok);
+	if (!ok) {
+		char log[1024];
+		glGetProgramInfoLog(p, sizeof(log), 0, log);
+		printf("Program link error: %s\n", log);
+		return false;
+	}
+
+	program.program = p;
+	program.u_view_projection = glGetUniformLocation(p, "u_view_projection");
+	program.u_offset = glGetUniformLocation(p, "u_offset");
+	program.u_axis = glGetUniformLocation(p, "u_axis");
+	program.u_joint = glGetUniformLocation(p, "u_joint");
+	program.u_scale = glGetUniformLocation(p, "u_scale");
+	return true;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SetInstanceAttributes
+//|
+//! \param None.
+//! \return None.
+//!
+//! Points the attributes at the shared mesh buffer (per vertex) and the
+//! instance buffer (per instance) in the bound vertex array. Leaves the
+//! instance buffer bound.
+//|____________________________________________________________________
+
+static void SetInstanceAttributes()
+{
+	const GLsizei stride = sizeof(TurtleInstance);
+
+	glBindBuffer(GL_ARRAY_BUFFER, GetMeshBuffer());
+	glEnableVertexAttribArray(ATTRIB_POSITION);
+	glEnableVertexAttribArray(ATTRIB_COLOUR);
+	glVertexAttribPointer(ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (const void*)offsetof(MeshVertex, position));
+	glVertexAttribPointer(ATTRIB_COLOUR, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (const void*)offsetof(MeshVertex, colour));
+
+	glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+	glEnableVertexAttribArray(ATTRIB_TURTLE_POSITION);
+	glEnableVertexAttribArray(ATTRIB_TURTLE_ORIENTATION);
+	glEnableVertexAttribArray(ATTRIB_TURTLE_JOINTS);
+	glVertexAttribPointer(ATTRIB_TURTLE_POSITION, 3, GL_FLOAT, GL_FALSE, stride, (const void*)offsetof(TurtleInstance, position));
+	glVertexAttribPointer(ATTRIB_TURTLE_ORIENTATION, 4, GL_FLOAT, GL_FALSE, stride, (const void*)offsetof(TurtleInstance, orientation));
+	glVertexAttribPointer(ATTRIB_TURTLE_JOINTS, 4, GL_FLOAT, GL_FALSE, stride, (const void*)offsetof(TurtleInstance, joints));
+	glVertexAttribDivisor(ATTRIB_TURTLE_POSITION, 1);
+	glVertexAttribDivisor(ATTRIB_TURTLE_ORIENTATION, 1);
+	glVertexAttribDivisor(ATTRIB_TURTLE_JOINTS, 1);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: BuildPartChain
+//|
+//! \param node    [in] Part type.
+//! \param chain   [out] Uniform values of the part.
+//! \return None.
+//!
+//! Flattens the node's path below the body into shader levels.
+//|____________________________________________________________________
+
+static void BuildPartChain(TurtleNode node, PartChain& chain)
+{
+	// Path from the part up to (excluding) the body; level 0 is nearest to the body
+	TurtleNode path[MAX_PART_DEPTH];
+	int depth = 0;
+	for (int n = node; n != TN_BODY && n >= 0; n = GetTurtleNodeDesc((TurtleNode)n).parent) {
+		path[depth++] = (TurtleNode)n;
+	}
+
+	for (int level = 0; level < MAX_PART_DEPTH; level++) {
+		float* offset = chain.offset[level];
+		float* axis = chain.axis[level];
+		float* joint = chain.joint[level];
+
+		offset[0] = offset[1] = offset[2] = offset[3] = 0;
+		axis[0] = 1; axis[1] = axis[2] = axis[3] = 0;
+		joint[0] = joint[1] = joint[2] = joint[3] = 0;
+
+		if (level < depth) {
+			const TurtleNodeDesc& desc = GetTurtleNodeDesc(path[depth - 1 - level]);
+			for (int i = 0; i < 3; i++) {
+				offset[i] = desc.offset[i];
+				axis[i] = desc.axis[i];
+			}
+			axis[3] = desc.tilt;
+			if (desc.joint != JOINT_NONE) {
+				joint[desc.joint] = 1;
+			}
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: InitTurtleInstancing
+//|
+//! \param None.
+//! \return True if at least one instanced path is usable.
+//!
+//! Builds the GLSL 1.20 program (not in a core profile) and the GLSL 3.30
+//! core program when the driver has them, and creates the instance
+//! buffer. Requires LoadGLExtensions() and InitMeshes().
+//|____________________________________________________________________
+
+bool InitTurtleInstancing()
+{
+	if (!has_instancing || !GetMeshBuffer()) {
+		return false;
+	}
+
+	if (!is_core_profile) {
+		BuildProgram(INSTANCING_GLSL120, programs[INSTANCING_GLSL120]);
+	}
+	if (has_core_shaders) {
+		BuildProgram(INSTANCING_GLSL330_CORE, programs[INSTANCING_GLSL330_CORE]);
+	}
+	if (!programs[INSTANCING_GLSL120].program && !programs[INSTANCING_GLSL330_CORE].program) {
+		return false;
+	}
+
+	for (int i = 0; i < TN_COUNT; i++) {
+		BuildPartChain((TurtleNode)i, part_chains[i]);
+	}
+
+	glGenBuffers(1, &instance_vbo);
+
+	// The core path keeps its attribute setup in a vertex array object; buffer
+	// contents may change later (baked meshes, instances), the bindings do not
+	if (programs[INSTANCING_GLSL330_CORE].program) {
+		glGenVertexArrays(1, &core_vao);
+		glBindVertexArray(core_vao);
+		SetInstanceAttributes();
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	return true;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: IsInstancingPathSupported
+//|
+//! \param path   [in] Language version.
+//! \return True if InitTurtleInstancing() built the path's program.
+//|____________________________________________________________________
+
+bool IsInstancingPathSupported(InstancingPath path)
+{
+	return programs[path].program != 0;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: PackTurtleInstances
+//|
+//! \param scene       [in] Scene graph holding the turtles' poses and joints.
+//! \param turtles     [in] Turtles to draw (e.g. the ones in view).
+//! \param count       [in] Number of turtles listed.
+//! \param instances   [out] One instance record per listed turtle.
+//! \return None.
+//|____________________________________________________________________
+
+void PackTurtleInstances(const SceneGraph& scene, const int* turtles, int count, TurtleInstance* instances)
+{
+	for (int k = 0; k < count; k++) {
+		int t = turtles[k];
+		TurtleInstance& inst = instances[k];
+		const gmtl::Point4f& p = scene.position[t];
+		const gmtl::Quatf& q = scene.orientation[t];
+
+		for (int i = 0; i < 3; i++) {
+			inst.position[i] = p[i];
+		}
+		for (int i = 0; i < 4; i++) {
+			inst.orientation[i] = q[i];
+		}
+		for (int j = 0; j < JOINT_COUNT; j++) {
+			inst.joints[j] = scene.joints[t * JOINT_COUNT + j];
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: DrawTurtlesInstanced
+//|
+//! \param instances       [in] Instance records.
+//! \param count           [in] Number of turtles.
+//! \param lod             [in] Level of detail of all the turtles.
+//! \param view_projection [in] World to clip transform, column-major.
+//! \param path            [in] Program to draw with (IsInstancingPathSupported()).
+//! \return None.
+//!
+//! At LOD_FULL, draws every part type (and its coordinate frame) once for
+//! all turtles; at the coarser levels, draws the level's merged mesh once
+//! at every body. Only the instance records are uploaded: the parts are
+//! placed by the vertex shader. The core path uses no fixed-function
+//! state, so it also runs in a core profile context.
+//|____________________________________________________________________
+
+void DrawTurtlesInstanced(const TurtleInstance* instances, int count, TurtleLod lod, const float view_projection[16],
+                          InstancingPath path)
+{
+	if (count <= 0) {
+		return;
+	}
+
+	const InstancingProgram& program = programs[path];
+	const MeshRange& frame = GetMeshRange(MESH_FRAME);
+
+	glUseProgram(program.program);
+	glUniformMatrix4fv(program.u_view_projection, 1, GL_FALSE, view_projection);
+
+	// Per-instance attributes, re-specified every frame (the old storage is orphaned)
+	if (path == INSTANCING_GLSL330_CORE) {
+		glBindVertexArray(core_vao);
+		glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+	}
+	else {
+		SetInstanceAttributes();
+	}
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)count * sizeof(TurtleInstance), instances, GL_STREAM_DRAW);
+
+	// Merged meshes are drawn as the body part: its chain has no offset and no joint
+	int parts = lod == LOD_FULL ? TN_COUNT : 1;
+	for (int i = 0; i < parts; i++) {
+		const PartChain& chain = part_chains[i];
+		const MeshRange& mesh = GetMeshRange(lod == LOD_FULL ? TurtlePartMesh((TurtleNode)i) : TurtleLodMesh(lod));
+
+		glUniform4fv(program.u_offset, MAX_PART_DEPTH, &chain.offset[0][0]);
+		glUniform4fv(program.u_axis, MAX_PART_DEPTH, &chain.axis[0][0]);
+		glUniform4fv(program.u_joint, MAX_PART_DEPTH, &chain.joint[0][0]);
+
+		glUniform1f(program.u_scale, 1.0f);
+		glDrawArraysInstanced(mesh.mode, mesh.first, mesh.count, count);
+
+		if (lod == LOD_FULL && TurtlePartFrame((TurtleNode)i) > 0) {
+			glUniform1f(program.u_scale, TurtlePartFrame((TurtleNode)i));
+			glDrawArraysInstanced(frame.mode, frame.first, frame.count, count);
+		}
+	}
+
+	if (path == INSTANCING_GLSL330_CORE) {
+		glBindVertexArray(0);
+	}
+	else {
+		glVertexAttribDivisor(ATTRIB_TURTLE_POSITION, 0);
+		glVertexAttribDivisor(ATTRIB_TURTLE_ORIENTATION, 0);
+		glVertexAttribDivisor(ATTRIB_TURTLE_JOINTS, 0);
+		glDisableVertexAttribArray(ATTRIB_POSITION);
+		glDisableVertexAttribArray(ATTRIB_COLOUR);
+		glDisableVertexAttribArray(ATTRIB_TURTLE_POSITION);
+		glDisableVertexAttribArray(ATTRIB_TURTLE_ORIENTATION);
+		glDisableVertexAttribArray(ATTRIB_TURTLE_JOINTS);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glUseProgram(0);
+}
@@ -0,0 +1,58 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_instancing.h
+//!
+//! \brief Instanced rendering of whole turtle populations.
+//!
+//! Each turtle is one instance record (position, quaternion and joint
+//! angles) in a per-frame instance buffer. Every part type is drawn once
+//! for all turtles; the vertex shader places the part by composing its
+//! fixed offsets with the instance's joint angles and body pose. The draw
+//! call count depends on the number of part types, not on the turtles.
+//!
+//! Two programs share the vertex shader body: GLSL 1.20 for compatibility
+//! contexts, and GLSL 3.30 core, which keeps its attributes in a vertex
+//! array object and takes the view from a uniform, so it runs in core
+//! profile contexts (Mesa's llvmpipe included) as well.
+//|___________________________________________________________________
+
+#pragma once
+
+#include <vector>
+
+#include "scene_graph.h"
+#include "turtle_lod.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+enum InstancingPath {
+	INSTANCING_GLSL120 = 0,         // Compatibility profile, attributes set up at every draw
+	INSTANCING_GLSL330_CORE,        // Core profile, attributes in a vertex array object
+	INSTANCING_PATH_COUNT
+};
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+struct TurtleInstance
+{
+	float position[3];
+	float orientation[4];           // Quaternion (x, y, z, w)
+	float joints[JOINT_COUNT];      // Joint angles (degs), see TurtleJoint
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+bool InitTurtleInstancing();
+bool IsInstancingPathSupported(InstancingPath path);
+void PackTurtleInstances(const SceneGraph& scene, const int* turtles, int count, TurtleInstance* instances);
+void DrawTurtlesInstanced(const TurtleInstance* instances, int count, TurtleLod lod, const float view_projection[16],
+                          InstancingPath path);
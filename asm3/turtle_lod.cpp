@@ -0,0 +1,157 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_lod.cpp
+//!
+//! \brief Distance-based level of detail of whole turtles.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <math.h>
+
+#include "pose_math.h"
+#include "turtle_culling.h"
+#include "turtle_lod.h"
+#include "turtle_mesh.h"
+
+//|___________________
+//|
+//| Global Variables
+//|___________________
+
+static float lod_error[LOD_COUNT];      // Geometric error of each level (world units)
+
+//|____________________________________________________________________
+//|
+//| Function: InitTurtleLod
+//|
+//! \param None.
+//! \return None.
+//!
+//! Derives the error of each level from the part bounds, so requires
+//! InitTurtleBounds(). The shell level drops the head, eyes and cannon
+//! with their frames, and the frames of the shell and wings; its error is
+//! the largest of these. The box level stands in for the whole turtle,
+//! so its error is the turtle's bounding radius.
+//|____________________________________________________________________
+
+void InitTurtleLod()
+{
+	lod_error[LOD_FULL] = 0;
+
+	lod_error[LOD_SHELL] = 0;
+	for (int n = 0; n < TN_COUNT; n++) {
+		TurtleNode node = (TurtleNode)n;
+		bool kept = node == TN_BODY || (node >= TN_WING_RF && node <= TN_WING_LB);
+		float error = kept ? TurtlePartFrame(node) : TurtleNodeRadius(node);
+		if (error > lod_error[LOD_SHELL]) {
+			lod_error[LOD_SHELL] = error;
+		}
+	}
+
+	lod_error[LOD_BOX] = TurtleRadius();
+}
+
+//|____________________________________________________________________
+//|
+//| Function: TurtleLodError
+//|
+//! \param lod    [in] Level of detail.
+//! \return Geometric error of the level (world units).
+//|____________________________________________________________________
+
+float TurtleLodError(TurtleLod lod)
+{
+	return lod_error[lod];
+}
+
+//|____________________________________________________________________
+//|
+//| Function: TurtleLodMesh
+//|
+//! \param lod    [in] LOD_SHELL or LOD_BOX.
+//! \return Merged mesh drawn in the body's frame for the level.
+//|____________________________________________________________________
+
+MeshId TurtleLodMesh(TurtleLod lod)
+{
+	return lod == LOD_BOX ? MESH_LOD_BOX : MESH_LOD_SHELL;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: LodPixelScale
+//|
+//! \param fov    [in] Vertical field of view (degs).
+//! \param height [in] Viewport height (pixels).
+//! \return Pixels covered by one world unit at unit distance.
+//|____________________________________________________________________
+
+float LodPixelScale(float fov, int height)
+{
+	return height * 0.5f / tanf(DegToRad(fov) / 2);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SelectTurtleLods
+//|
+//! \param scene       [in] Scene graph with up-to-date world matrices.
+//! \param turtles     [in] Turtles to update (e.g. the ones in view).
+//! \param count       [in] Number of turtles listed.
+//! \param view        [in] View matrix (world to eye), column-major.
+//! \param pixel_scale [in] See LodPixelScale().
+//! \param lods        [in,out] Level of every turtle in the scene, kept
+//!                             from frame to frame; new turtles start at
+//!                             LOD_FULL.
+//! \return Number of the listed turtles at each level.
+//!
+//! The error of a level projects to error * pixel_scale / distance
+//! pixels, with the distance taken to the near side of the turtle's
+//! bounding sphere. A turtle refines as soon as its level exceeds the
+//! tolerance and coarsens only when the next level is under
+//! LOD_HYSTERESIS times the tolerance; in between it keeps its level.
+//|____________________________________________________________________
+
+LodStats SelectTurtleLods(const SceneGraph& scene, const int* turtles, int count, const float view[16],
+                          float pixel_scale, std::vector<unsigned char>& lods)
+{
+	LodStats stats = { { 0 } };
+
+	// Eye position: view = [R | t], so eye = -R^T * t
+	float eye[3];
+	for (int j = 0; j < 3; j++) {
+		eye[j] = -(view[j * 4 + 0] * view[12] + view[j * 4 + 1] * view[13] + view[j * 4 + 2] * view[14]);
+	}
+
+	lods.resize(TurtleCount(scene), LOD_FULL);
+
+	for (int k = 0; k < count; k++) {
+		int t = turtles[k];
+		const float* center = &scene.world[TurtleNodeId(t, TN_BODY)].getData()[12];
+		float dx = center[0] - eye[0];
+		float dy = center[1] - eye[1];
+		float dz = center[2] - eye[2];
+
+		float d = sqrtf(dx * dx + dy * dy + dz * dz) - TurtleRadius();
+		if (d < 1e-3f) {
+			d = 1e-3f;                              // Camera inside the bound: full detail
+		}
+		float scale = pixel_scale / d;
+
+		int lod = lods[t];
+		while (lod < LOD_BOX && lod_error[lod + 1] * scale <= LOD_PIXEL_ERROR * LOD_HYSTERESIS) {
+			lod++;
+		}
+		while (lod > LOD_FULL && lod_error[lod] * scale > LOD_PIXEL_ERROR) {
+			lod--;
+		}
+		lods[t] = (unsigned char)lod;
+		stats.turtles[lod]++;
+	}
+
+	return stats;
+}
@@ -0,0 +1,57 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_lod.h
+//!
+//! \brief Distance-based level of detail of whole turtles.
+//!
+//! A turtle is drawn as its full hierarchy, as one merged shell+wings mesh,
+//! or as a single box. Each level has a geometric error: the size of the
+//! largest detail it leaves out. A turtle takes the coarsest level whose
+//! error, projected onto the screen, stays under a pixel tolerance. It
+//! only coarsens once the error is clearly under the tolerance, so turtles
+//! sitting at a threshold distance do not flicker between two levels.
+//|___________________________________________________________________
+
+#pragma once
+
+#include <vector>
+
+#include "scene_graph.h"
+#include "turtle_mesh.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+enum TurtleLod {
+	LOD_FULL = 0,           // Every part, joint and coordinate frame
+	LOD_SHELL,              // Shell and wings at rest, one mesh
+	LOD_BOX,                // One box around the shell and wings
+	LOD_COUNT
+};
+
+const float LOD_PIXEL_ERROR = 4.0f;         // Largest tolerated error (pixels)
+const float LOD_HYSTERESIS = 0.75f;         // Coarsen only below this fraction of the tolerance
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+struct LodStats
+{
+	int turtles[LOD_COUNT];                 // Visible turtles drawn at each level
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void InitTurtleLod();
+float TurtleLodError(TurtleLod lod);
+MeshId TurtleLodMesh(TurtleLod lod);
+float LodPixelScale(float fov, int height);
+LodStats SelectTurtleLods(const SceneGraph& scene, const int* turtles, int count, const float view[16],
+                          float pixel_scale, std::vector<unsigned char>& lods);
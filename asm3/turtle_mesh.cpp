@@ -0,0 +1,562 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_mesh.cpp
+//!
+//! \brief GPU-resident meshes of the turtle parts and the coordinate frame.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include "turtle_mesh.h"
+#include "turtle_model.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+// Mesh and coordinate frame length (0 = none) of each turtle node
+const MeshId PART_MESH[TN_COUNT] = {
+	MESH_SHELL, MESH_HEAD, MESH_EYE, MESH_EYE,
+	MESH_WING_RIGHT, MESH_WING_LEFT, MESH_WING_SMALL_RIGHT, MESH_WING_SMALL_LEFT,
+	MESH_CANNON_BASE, MESH_CANNON
+};
+const float PART_FRAME[TN_COUNT] = { 3, 0, 0, 0, 1, 1, 1, 1, 1, 1 };
+
+//|___________________
+//|
+//| Global Variables
+//|___________________
+
+static std::vector<MeshVertex> mesh_vertices;      // Kept for the client-array fallback and the CPU rasterizer
+static MeshRange mesh_ranges[MESH_COUNT];
+static size_t static_vertex_count = 0;              // Vertices of mesh_ranges, before the baked ones
+static GLuint mesh_vbo = 0;
+static TurtleModel model = DEFAULT_TURTLE_MODEL;    // Dimensions and colours of the next build
+
+//|____________________________________________________________________
+//|
+//| Function: AppendVertex
+//|
+//! \param vertices   [in,out] Vertex array.
+//! \param x, y, z    [in] Vertex position.
+//! \param colour     [in] Vertex colour.
+//! \return None.
+//|____________________________________________________________________
+
+static void AppendVertex(std::vector<MeshVertex>& vertices, float x, float y, float z, const float colour[3])
+{
+	MeshVertex v = { { x, y, z }, { colour[0], colour[1], colour[2] } };
+	vertices.push_back(v);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: AppendQuad
+//|
+//! \param vertices   [in,out] Vertex array.
+//! \param q          [in] Four corners (xyz each) in quad order.
+//! \param colour     [in] Face colour.
+//! \return None.
+//!
+//! Appends a quad as two triangles.
+//|____________________________________________________________________
+
+static void AppendQuad(std::vector<MeshVertex>& vertices, const float q[4][3], const float colour[3])
+{
+	static const int TRIANGLES[6] = { 0, 1, 2, 0, 2, 3 };
+
+	for (int i = 0; i < 6; i++) {
+		const float* c = q[TRIANGLES[i]];
+		AppendVertex(vertices, c[0], c[1], c[2], colour);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: AppendCube
+//|
+//! \param vertices    [in,out] Vertex array.
+//! \param width       [in] Size along X.
+//! \param length      [in] Size along Z.
+//! \param height      [in] Size along Y.
+//! \param colours     [in] Colour of the first face.
+//! \param ox          [in] Offset of the cube centre along X.
+//! \return None.
+//!
+//! Appends a shaded cube; each face is c_delta brighter than the previous one.
+//|____________________________________________________________________
+
+static void AppendCube(std::vector<MeshVertex>& vertices, const float width, const float length, const float height,
+                       const float colours[3], const float ox = 0)
+{
+	float w2 = width / 2;
+	float h2 = height / 2;
+	float l2 = length / 2;
+
+	// modify the copy only (arrays are passed by reference)
+	float colours_copy[3] = { colours[0], colours[1], colours[2] };
+
+	// for adding shadow, increase this to add contrast, vice versa
+	float c_delta = 0.05f;
+
+	const float faces[6][4][3] = {
+		{ { w2, h2, -l2 }, { -w2, h2, -l2 }, { -w2, -h2, -l2 }, { w2, -h2, -l2 } },    // front face
+		{ { w2, h2, -l2 }, { w2, h2, l2 }, { w2, -h2, l2 }, { w2, -h2, -l2 } },         // right face
+		{ { w2, h2, l2 }, { -w2, h2, l2 }, { -w2, h2, -l2 }, { w2, h2, -l2 } },         // top face
+		{ { w2, -h2, -l2 }, { -w2, -h2, -l2 }, { -w2, -h2, l2 }, { w2, -h2, l2 } },     // bottom face
+		{ { -w2, h2, l2 }, { w2, h2, l2 }, { w2, -h2, l2 }, { -w2, -h2, l2 } },         // back face
+		{ { -w2, h2, -l2 }, { -w2, h2, l2 }, { -w2, -h2, l2 }, { -w2, -h2, -l2 } },     // left face
+	};
+
+	for (int f = 0; f < 6; f++) {
+		float q[4][3];
+		for (int i = 0; i < 4; i++) {
+			q[i][0] = faces[f][i][0] + ox;
+			q[i][1] = faces[f][i][1];
+			q[i][2] = faces[f][i][2];
+		}
+		AppendQuad(vertices, q, colours_copy);
+
+		// increase brightness
+		colours_copy[0] += c_delta;
+		colours_copy[1] += c_delta;
+		colours_copy[2] += c_delta;
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: AppendTurtleShell
+//|
+//! \param vertices    [in,out] Vertex array.
+//! \param width       [in] Width  of the shell.
+//! \param length      [in] Length of the shell.
+//! \param height      [in] Height of the shell.
+//! \return None.
+//|____________________________________________________________________
+
+static void AppendTurtleShell(std::vector<MeshVertex>& vertices, const float width, const float length, const float height)
+{
+	// shell
+	AppendCube(vertices, width, length, height, model.colours[COLOUR_BROWN]);
+
+	// black cannon strap
+	AppendCube(vertices, width*1.1f, length*0.2f, height*1.1f, model.colours[COLOUR_DARKER_GRAY]);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: AppendCannon
+//|
+//! \param vertices    [in,out] Vertex array.
+//! \param width       [in] Width  of the cannon.
+//! \param length      [in] Length of the cannon.
+//! \param height      [in] Height of the cannon.
+//! \param isInverted  [in] Barrel on the right (true) or left (false) side.
+//! \return None.
+//|____________________________________________________________________
+
+static void AppendCannon(std::vector<MeshVertex>& vertices, const float width, const float length, const float height, const bool isInverted)
+{
+	AppendCube(vertices, width, length, height, model.colours[COLOUR_DARK_GRAY]);
+
+	// by default (without invert):
+	// would draw the wing extension on the left side
+	// otherwise if inverted, would draw the wing extension on the right side
+	int direction = (isInverted) ? 1 : -1;
+	AppendCube(vertices, width*0.8f, length*0.8f, height*0.8f, model.colours[COLOUR_DARK_GRAY], width*0.5f*direction);
+	AppendCube(vertices, width*0.9f, length*0.7f, height*0.6f, model.colours[COLOUR_DARKER_GRAY], width*0.5f*direction);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: AppendWing
+//|
+//! \param vertices    [in,out] Vertex array.
+//! \param width       [in] Width  of the wing.
+//! \param length      [in] Length of the wing.
+//! \param height      [in] Height of the wing.
+//! \param isInverted  [in] Extension on the right (true) or left (false) side.
+//! \return None.
+//|____________________________________________________________________
+
+static void AppendWing(std::vector<MeshVertex>& vertices, const float width, const float length, const float height, const bool isInverted)
+{
+	AppendCube(vertices, width, length, height, model.colours[COLOUR_LIME_GREEN]);
+
+	// by default (without invert):
+	// would draw the wing extension on the left side
+	// otherwise if inverted, would draw the wing extension on the right side
+	int direction = (isInverted) ? 1 : -1;
+	AppendCube(vertices, width*0.8f, length*0.8f, height*0.8f, model.colours[COLOUR_LIME_GREEN], width*0.5f*direction);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: OffsetVertices
+//|
+//! \param vertices    [in,out] Vertex array.
+//! \param first       [in] First vertex to move.
+//! \param offset      [in] Translation.
+//! \return None.
+//|____________________________________________________________________
+
+static void OffsetVertices(std::vector<MeshVertex>& vertices, size_t first, const gmtl::Vec3f& offset)
+{
+	for (size_t i = first; i < vertices.size(); i++) {
+		for (int k = 0; k < 3; k++) {
+			vertices[i].position[k] += offset[k];
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: AppendLodShell
+//|
+//! \param vertices    [in,out] Vertex array.
+//! \return None.
+//!
+//! Appends the shell and the four wings at their rest pose, in the body's
+//! frame; the wings sit at their scene graph offsets.
+//|____________________________________________________________________
+
+static void AppendLodShell(std::vector<MeshVertex>& vertices)
+{
+	AppendTurtleShell(vertices, model.p_width*1.5f, model.p_length*1.5f, model.p_height*2);
+
+	for (int n = TN_WING_RF; n <= TN_WING_LB; n++) {
+		size_t first = vertices.size();
+		bool right = (n == TN_WING_RF || n == TN_WING_RB);
+		float width = (n == TN_WING_RF || n == TN_WING_LF) ? model.wing_width : model.wing_width_small;
+		AppendWing(vertices, width, model.wing_length, model.wing_height, right);
+		OffsetVertices(vertices, first, GetTurtleNodeDesc((TurtleNode)n).offset);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: AppendLodBox
+//|
+//! \param vertices    [in,out] Vertex array.
+//! \param shell       [in] Range of the merged shell mesh to enclose.
+//! \return None.
+//|____________________________________________________________________
+
+static void AppendLodBox(std::vector<MeshVertex>& vertices, const MeshRange& shell)
+{
+	float lo[3] = { 0, 0, 0 };
+	float hi[3] = { 0, 0, 0 };
+	for (int i = shell.first; i < shell.first + shell.count; i++) {
+		for (int k = 0; k < 3; k++) {
+			lo[k] = vertices[i].position[k] < lo[k] ? vertices[i].position[k] : lo[k];
+			hi[k] = vertices[i].position[k] > hi[k] ? vertices[i].position[k] : hi[k];
+		}
+	}
+
+	size_t first = vertices.size();
+	AppendCube(vertices, hi[0] - lo[0], hi[2] - lo[2], hi[1] - lo[1], model.colours[COLOUR_BROWN]);
+	OffsetVertices(vertices, first, gmtl::Vec3f((lo[0] + hi[0]) / 2, (lo[1] + hi[1]) / 2, (lo[2] + hi[2]) / 2));
+}
+
+//|____________________________________________________________________
+//|
+//| Function: AppendCoordinateFrame
+//|
+//! \param vertices    [in,out] Vertex array.
+//! \return None.
+//!
+//! Appends the three unit principal axes as line segments.
+//|____________________________________________________________________
+
+static void AppendCoordinateFrame(std::vector<MeshVertex>& vertices)
+{
+	const float red[3] = { 1.0f, 0.0f, 0.0f };
+	const float green[3] = { 0.0f, 1.0f, 0.0f };
+	const float blue[3] = { 0.0f, 0.0f, 1.0f };
+
+	// X axis is red
+	AppendVertex(vertices, 0.0f, 0.0f, 0.0f, red);
+	AppendVertex(vertices, 1.0f, 0.0f, 0.0f, red);
+
+	// Y axis is green
+	AppendVertex(vertices, 0.0f, 0.0f, 0.0f, green);
+	AppendVertex(vertices, 0.0f, 1.0f, 0.0f, green);
+
+	// Z axis is blue
+	AppendVertex(vertices, 0.0f, 0.0f, 0.0f, blue);
+	AppendVertex(vertices, 0.0f, 0.0f, 1.0f, blue);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: BuildTurtleMeshes
+//|
+//! \param vertices   [out] Vertices of all meshes, back to back.
+//! \param ranges     [out] Vertex range and primitive of each mesh.
+//! \return None.
+//!
+//! Builds every mesh on the CPU (no GL calls) from the current model.
+//|____________________________________________________________________
+
+void BuildTurtleMeshes(std::vector<MeshVertex>& vertices, MeshRange ranges[MESH_COUNT])
+{
+	vertices.clear();
+
+	for (int id = 0; id < MESH_COUNT; id++) {
+		GLint first = (GLint)vertices.size();
+
+		switch (id) {
+		case MESH_SHELL:
+			AppendTurtleShell(vertices, model.p_width*1.5f, model.p_length*1.5f, model.p_height*2);
+			break;
+		case MESH_HEAD:
+			AppendCube(vertices, 0.7f * model.p_width, 0.7f * model.p_length, 0.85f * model.p_height, model.colours[COLOUR_LIME_GREEN]);
+			break;
+		case MESH_EYE:
+			AppendCube(vertices, 0.11f * model.p_width, 0.06f * model.p_length, 0.11f * model.p_height, model.colours[COLOUR_DARKER_GRAY]);
+			break;
+		case MESH_WING_RIGHT:
+			AppendWing(vertices, model.wing_width, model.wing_length, model.wing_height, true);
+			break;
+		case MESH_WING_LEFT:
+			AppendWing(vertices, model.wing_width, model.wing_length, model.wing_height, false);
+			break;
+		case MESH_WING_SMALL_RIGHT:
+			AppendWing(vertices, model.wing_width_small, model.wing_length, model.wing_height, true);
+			break;
+		case MESH_WING_SMALL_LEFT:
+			AppendWing(vertices, model.wing_width_small, model.wing_length, model.wing_height, false);
+			break;
+		case MESH_CANNON_BASE:
+			AppendCube(vertices, model.p_width, model.p_length, model.p_height, model.colours[COLOUR_DARK_GRAY]);
+			break;
+		case MESH_CANNON:
+			AppendCannon(vertices, model.wing_width, model.wing_length, model.wing_height, true);
+			break;
+		case MESH_LOD_SHELL:
+			AppendLodShell(vertices);
+			break;
+		case MESH_LOD_BOX:
+			AppendLodBox(vertices, ranges[MESH_LOD_SHELL]);
+			break;
+		case MESH_FRAME:
+			AppendCoordinateFrame(vertices);
+			break;
+		}
+
+		ranges[id].mode = (id == MESH_FRAME) ? GL_LINES : GL_TRIANGLES;
+		ranges[id].first = first;
+		ranges[id].count = (GLsizei)vertices.size() - first;
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: InitMeshes
+//|
+//! \param None.
+//! \return None.
+//!
+//! Builds the meshes and uploads them into a static vertex buffer.
+//! Requires a current context and LoadGLExtensions().
+//|____________________________________________________________________
+
+void InitMeshes()
+{
+	BuildTurtleMeshes(mesh_vertices, mesh_ranges);
+	static_vertex_count = mesh_vertices.size();
+
+	if (has_vertex_buffers) {
+		glGenBuffers(1, &mesh_vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, mesh_vbo);
+		glBufferData(GL_ARRAY_BUFFER, mesh_vertices.size() * sizeof(MeshVertex), &mesh_vertices[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: BindMeshes
+//|
+//! \param None.
+//! \return None.
+//!
+//! Sets up the vertex arrays once before a batch of DrawMesh() calls.
+//|____________________________________________________________________
+
+void BindMeshes()
+{
+	const char* base = 0;
+
+	if (mesh_vbo) {
+		glBindBuffer(GL_ARRAY_BUFFER, mesh_vbo);
+	}
+	else {
+		base = (const char*)&mesh_vertices[0];
+	}
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(3, GL_FLOAT, sizeof(MeshVertex), base + offsetof(MeshVertex, position));
+	glColorPointer(3, GL_FLOAT, sizeof(MeshVertex), base + offsetof(MeshVertex, colour));
+}
+
+//|____________________________________________________________________
+//|
+//| Function: UnbindMeshes
+//|
+//! \param None.
+//! \return None.
+//|____________________________________________________________________
+
+void UnbindMeshes()
+{
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_COLOR_ARRAY);
+
+	if (mesh_vbo) {
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: DrawMesh
+//|
+//! \param mesh   [in] Mesh to draw in the current modelview frame.
+//! \return None.
+//!
+//! Draws one mesh with a single call; BindMeshes() must be active.
+//|____________________________________________________________________
+
+void DrawMesh(MeshId mesh)
+{
+	const MeshRange& r = mesh_ranges[mesh];
+	glDrawArrays(r.mode, r.first, r.count);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SetBakedVertices
+//|
+//! \param vertices   [in] Vertices of the meshes built at run time.
+//! \return Index of their first vertex in the shared buffer.
+//!
+//! Replaces the vertices that follow the static meshes and re-uploads
+//! the buffer; the static meshes keep their ranges. Must not be called
+//! between BindMeshes() and UnbindMeshes() when drawing from client memory.
+//|____________________________________________________________________
+
+GLint SetBakedVertices(const std::vector<MeshVertex>& vertices)
+{
+	mesh_vertices.resize(static_vertex_count);
+	mesh_vertices.insert(mesh_vertices.end(), vertices.begin(), vertices.end());
+
+	if (mesh_vbo) {
+		glBindBuffer(GL_ARRAY_BUFFER, mesh_vbo);
+		glBufferData(GL_ARRAY_BUFFER, mesh_vertices.size() * sizeof(MeshVertex), &mesh_vertices[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	return (GLint)static_vertex_count;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: GetMeshRange
+//|
+//! \param mesh   [in] Mesh id.
+//! \return Vertex range of the mesh within the shared buffer.
+//|____________________________________________________________________
+
+const MeshRange& GetMeshRange(MeshId mesh)
+{
+	return mesh_ranges[mesh];
+}
+
+//|____________________________________________________________________
+//|
+//| Function: GetMeshBuffer
+//|
+//! \param None.
+//! \return Vertex buffer holding every mesh, 0 if drawing from client memory.
+//|____________________________________________________________________
+
+GLuint GetMeshBuffer()
+{
+	return mesh_vbo;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: GetMeshVertices
+//|
+//! \param None.
+//! \return CPU copy of the shared vertex array (static and baked meshes),
+//!         valid until the baked vertices change.
+//|____________________________________________________________________
+
+const MeshVertex* GetMeshVertices()
+{
+	return &mesh_vertices[0];
+}
+
+//|____________________________________________________________________
+//|
+//| Function: TurtlePartMesh
+//|
+//! \param node   [in] Node type within a turtle hierarchy.
+//! \return Mesh drawn at the node.
+//|____________________________________________________________________
+
+MeshId TurtlePartMesh(TurtleNode node)
+{
+	return PART_MESH[node];
+}
+
+//|____________________________________________________________________
+//|
+//| Function: TurtlePartFrame
+//|
+//! \param node   [in] Node type within a turtle hierarchy.
+//! \return Length of the node's coordinate frame, 0 if it has none.
+//|____________________________________________________________________
+
+float TurtlePartFrame(TurtleNode node)
+{
+	return PART_FRAME[node];
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SetTurtleModel
+//|
+//! \param m      [in] Dimensions and colours.
+//! \return None.
+//!
+//! Replaces the model the meshes are built from; call before
+//! InitMeshes() and InitTurtleBounds().
+//|____________________________________________________________________
+
+void SetTurtleModel(const TurtleModel& m)
+{
+	model = m;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: GetTurtleModel
+//|
+//! \param None.
+//! \return Dimensions and colours the meshes are built from.
+//|____________________________________________________________________
+
+const TurtleModel& GetTurtleModel()
+{
+	return model;
+}
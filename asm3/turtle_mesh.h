@@ -0,0 +1,79 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_mesh.h
+//!
+//! \brief GPU-resident meshes of the turtle parts and the coordinate frame.
+//!
+//! Every part is built once from shaded cubes (the per-face c_delta
+//! brightening is baked into the vertex colours) and packed into one
+//! vertex buffer, so drawing a part is a single glDrawArrays() call.
+//! Without buffer objects the same arrays are drawn from client memory.
+//! Meshes built at run time (see turtle_baking.h) follow the static ones
+//! in the same buffer.
+//|___________________________________________________________________
+
+#pragma once
+
+#include <vector>
+
+#include "gl_ext.h"
+#include "scene_graph.h"
+#include "turtle_model.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+enum MeshId {
+	MESH_SHELL = 0,         // Shell and cannon strap
+	MESH_HEAD,
+	MESH_EYE,
+	MESH_WING_RIGHT,        // Front wings, extension on the right/left side
+	MESH_WING_LEFT,
+	MESH_WING_SMALL_RIGHT,  // Back wings
+	MESH_WING_SMALL_LEFT,
+	MESH_CANNON_BASE,
+	MESH_CANNON,
+	MESH_LOD_SHELL,         // Shell and wings at rest merged into one mesh (see turtle_lod.h)
+	MESH_LOD_BOX,           // One box around MESH_LOD_SHELL
+	MESH_FRAME,             // Unit coordinate frame (GL_LINES), scale to the wanted length
+	MESH_COUNT
+};
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+struct MeshVertex
+{
+	float position[3];
+	float colour[3];
+};
+
+struct MeshRange
+{
+	GLenum mode;            // GL_TRIANGLES or GL_LINES
+	GLint first;            // First vertex in the shared vertex array
+	GLsizei count;          // Number of vertices
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void BuildTurtleMeshes(std::vector<MeshVertex>& vertices, MeshRange ranges[MESH_COUNT]);
+void InitMeshes();
+void BindMeshes();
+void UnbindMeshes();
+void DrawMesh(MeshId mesh);
+GLint SetBakedVertices(const std::vector<MeshVertex>& vertices);
+const MeshRange& GetMeshRange(MeshId mesh);
+GLuint GetMeshBuffer();
+const MeshVertex* GetMeshVertices();
+MeshId TurtlePartMesh(TurtleNode node);
+float TurtlePartFrame(TurtleNode node);
+void SetTurtleModel(const TurtleModel& m);
+const TurtleModel& GetTurtleModel();
@@ -0,0 +1,81 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_model.h
+//!
+//! \brief Dimensions and part placements of the turtle model.
+//!
+//! Shared by the draw code and the scene graph so that the hierarchy
+//! and the geometry are built from the same numbers. These are the
+//! defaults; a scene file (see scene_file.h) may replace them.
+//|___________________________________________________________________
+
+#pragma once
+
+#include <gmtl/gmtl.h>
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+// Plane dimensions
+const float P_WIDTH = 3;
+const float P_LENGTH = 3;
+const float P_HEIGHT = 1.5f;
+
+// Propeller dimensions (subpart)
+const float WING_WIDTH = 3.5;
+const float WING_WIDTH_SMALL = 2.0;
+const float WING_LENGTH = 1.5f;
+const float WING_HEIGHT = 0.7f;
+
+// Propeller transforms
+const gmtl::Point3f WING_POS(P_WIDTH*3/4, -P_HEIGHT*0.5, P_LENGTH/2.5);     // Propeller position on the plane (w.r.t. plane's frame)
+
+// Head and eyes (w.r.t. plane's frame and head's frame respectively)
+const gmtl::Vec3f HEAD_POS(0, -0.1f * P_HEIGHT, 0.7f * P_LENGTH);
+const gmtl::Vec3f EYE_POS(0.8f, -0.20f, 1.15f);                          // Right eye; the left eye mirrors X
+
+// Cannon base on top of the shell, cannon on top of the base
+const gmtl::Vec3f CANNON_BASE_POS(0, P_HEIGHT, 0);
+const gmtl::Vec3f CANNON_POS(0, WING_LENGTH, 0);
+const float CANNON_TILT = -90.0f;                   // Fixed pitch that lays the cannon barrel flat (degs)
+const float CANNON_MUZZLE = 0.95f;                  // End of the barrel along the cannon's +X axis, in cannon widths
+
+// Colours of the part meshes
+enum ModelColour {
+	COLOUR_BROWN = 0,       // Shell
+	COLOUR_LIME_GREEN,      // Head and wings
+	COLOUR_DARK_GRAY,       // Cannon base and cannon
+	COLOUR_DARKER_GRAY,     // Eyes, cannon strap and barrel
+	COLOUR_COUNT
+};
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+// Dimensions and colours the part meshes are built from (plain floats, stored as is in scene files)
+struct TurtleModel
+{
+	float p_width;
+	float p_length;
+	float p_height;
+	float wing_width;
+	float wing_width_small;
+	float wing_length;
+	float wing_height;
+	float colours[COLOUR_COUNT][3];
+};
+
+const TurtleModel DEFAULT_TURTLE_MODEL = {
+	P_WIDTH, P_LENGTH, P_HEIGHT,
+	WING_WIDTH, WING_WIDTH_SMALL, WING_LENGTH, WING_HEIGHT,
+	{
+		{ 0.45f, 0.32f, 0.22f },        // Brown
+		{ 0.10f, 0.35f, 0.47f },        // Lime green
+		{ 0.25f, 0.25f, 0.25f },        // Dark gray
+		{ 0.17f, 0.17f, 0.17f },        // Darker gray
+	}
+};
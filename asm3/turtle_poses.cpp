@@ -0,0 +1,468 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_poses.cpp
+//!
+//! \brief Batched pose updates over structure-of-arrays turtle state.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <math.h>
+
+#include "turtle_poses.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define POSES_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_SSE
+#define TARGET_AVX2
+#else
+#define TARGET_SSE __attribute__((target("sse")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define POSES_X86 0
+#endif
+
+//|___________________
+//|
+//| Local Functions
+//|___________________
+
+//|____________________________________________________________________
+//|
+//| Function: CpuHasAvx2
+//|
+//! \param None.
+//! \return True if the CPU and the OS support AVX2.
+//|____________________________________________________________________
+
+static bool CpuHasAvx2()
+{
+#if POSES_X86 && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {      // OS saves the YMM registers
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#elif POSES_X86
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#else
+	return false;
+#endif
+}
+
+//|____________________________________________________________________
+//|
+//| Function: BestPoseKernel
+//|
+//! \param None.
+//! \return Widest kernel the machine runs.
+//|____________________________________________________________________
+
+static PoseKernel BestPoseKernel()
+{
+	if (CpuHasAvx2()) {
+		return POSE_KERNEL_AVX2;
+	}
+	return POSES_X86 ? POSE_KERNEL_SSE : POSE_KERNEL_SCALAR;
+}
+
+//|___________________
+//|
+//| Global Variables
+//|___________________
+
+static PoseKernel pose_kernel = BestPoseKernel();
+
+//|___________________
+//|
+//| Scalar kernels (reference, and tails of the SIMD kernels)
+//|___________________
+
+//|____________________________________________________________________
+//|
+//| Function: RotatePosesScalar
+//|
+//! \param poses   [in,out] Turtle poses.
+//! \param step    [in] Rotation applied in each turtle's local frame.
+//! \param begin   [in] First turtle.
+//! \param end     [in] One past the last turtle.
+//! \return None.
+//!
+//! q = q * step, term for term as gmtl's quaternion product.
+//|____________________________________________________________________
+
+static void RotatePosesScalar(TurtlePoses& poses, const gmtl::Quatf& step, int begin, int end)
+{
+	const float sx = step[0], sy = step[1], sz = step[2], sw = step[3];
+
+	for (int i = begin; i < end; i++) {
+		float x = poses.qx[i], y = poses.qy[i], z = poses.qz[i], w = poses.qw[i];
+		poses.qx[i] = w * sx + x * sw + y * sz - z * sy;
+		poses.qy[i] = w * sy + y * sw + z * sx - x * sz;
+		poses.qz[i] = w * sz + z * sw + x * sy - y * sx;
+		poses.qw[i] = w * sw - x * sx - y * sy - z * sz;
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: MovePosesForwardScalar
+//|
+//! \param poses    [in,out] Turtle poses.
+//! \param distance [in] Distance along each turtle's local +Z.
+//! \param begin    [in] First turtle.
+//! \param end      [in] One past the last turtle.
+//! \return None.
+//!
+//! p += q * (0, 0, distance) * conj(q), expanded: only the rotated Z axis
+//! is needed, so the two quaternion products reduce to a few multiplies.
+//|____________________________________________________________________
+
+static void MovePosesForwardScalar(TurtlePoses& poses, float distance, int begin, int end)
+{
+	const float d2 = 2.0f * distance;
+
+	for (int i = begin; i < end; i++) {
+		float x = poses.qx[i], y = poses.qy[i], z = poses.qz[i], w = poses.qw[i];
+		poses.px[i] += d2 * (x * z + w * y);
+		poses.py[i] += d2 * (y * z - w * x);
+		poses.pz[i] += distance * (w * w + z * z - x * x - y * y);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: NormalizePosesScalar
+//|
+//! \param poses   [in,out] Turtle poses.
+//! \param begin   [in] First turtle.
+//! \param end     [in] One past the last turtle.
+//! \return None.
+//!
+//! Rescales quaternions to unit length, removing the drift that repeated
+//! rotation steps accumulate.
+//|____________________________________________________________________
+
+static void NormalizePosesScalar(TurtlePoses& poses, int begin, int end)
+{
+	for (int i = begin; i < end; i++) {
+		float x = poses.qx[i], y = poses.qy[i], z = poses.qz[i], w = poses.qw[i];
+		float l = sqrtf(x * x + y * y + z * z + w * w);
+		poses.qx[i] = x / l;
+		poses.qy[i] = y / l;
+		poses.qz[i] = z / l;
+		poses.qw[i] = w / l;
+	}
+}
+
+#if POSES_X86
+
+//|___________________
+//|
+//| SSE kernels: 4 turtles per iteration, return where the scalar tail starts
+//|___________________
+
+TARGET_SSE static int RotatePosesSSE(TurtlePoses& poses, const gmtl::Quatf& step, int begin, int end)
+{
+	const __m128 sx = _mm_set1_ps(step[0]), sy = _mm_set1_ps(step[1]);
+	const __m128 sz = _mm_set1_ps(step[2]), sw = _mm_set1_ps(step[3]);
+
+	int i = begin;
+	for (; i + 4 <= end; i += 4) {
+		__m128 x = _mm_loadu_ps(&poses.qx[i]), y = _mm_loadu_ps(&poses.qy[i]);
+		__m128 z = _mm_loadu_ps(&poses.qz[i]), w = _mm_loadu_ps(&poses.qw[i]);
+
+		__m128 nx = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(w, sx), _mm_mul_ps(x, sw)), _mm_mul_ps(y, sz)), _mm_mul_ps(z, sy));
+		__m128 ny = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(w, sy), _mm_mul_ps(y, sw)), _mm_mul_ps(z, sx)), _mm_mul_ps(x, sz));
+		__m128 nz = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(w, sz), _mm_mul_ps(z, sw)), _mm_mul_ps(x, sy)), _mm_mul_ps(y, sx));
+		__m128 nw = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(w, sw), _mm_mul_ps(x, sx)), _mm_mul_ps(y, sy)), _mm_mul_ps(z, sz));
+
+		_mm_storeu_ps(&poses.qx[i], nx);
+		_mm_storeu_ps(&poses.qy[i], ny);
+		_mm_storeu_ps(&poses.qz[i], nz);
+		_mm_storeu_ps(&poses.qw[i], nw);
+	}
+	return i;
+}
+
+TARGET_SSE static int MovePosesForwardSSE(TurtlePoses& poses, float distance, int begin, int end)
+{
+	const __m128 d = _mm_set1_ps(distance), d2 = _mm_set1_ps(2.0f * distance);
+
+	int i = begin;
+	for (; i + 4 <= end; i += 4) {
+		__m128 x = _mm_loadu_ps(&poses.qx[i]), y = _mm_loadu_ps(&poses.qy[i]);
+		__m128 z = _mm_loadu_ps(&poses.qz[i]), w = _mm_loadu_ps(&poses.qw[i]);
+
+		__m128 fx = _mm_mul_ps(d2, _mm_add_ps(_mm_mul_ps(x, z), _mm_mul_ps(w, y)));
+		__m128 fy = _mm_mul_ps(d2, _mm_sub_ps(_mm_mul_ps(y, z), _mm_mul_ps(w, x)));
+		__m128 fz = _mm_mul_ps(d, _mm_sub_ps(_mm_sub_ps(_mm_add_ps(_mm_mul_ps(w, w), _mm_mul_ps(z, z)), _mm_mul_ps(x, x)), _mm_mul_ps(y, y)));
+
+		_mm_storeu_ps(&poses.px[i], _mm_add_ps(_mm_loadu_ps(&poses.px[i]), fx));
+		_mm_storeu_ps(&poses.py[i], _mm_add_ps(_mm_loadu_ps(&poses.py[i]), fy));
+		_mm_storeu_ps(&poses.pz[i], _mm_add_ps(_mm_loadu_ps(&poses.pz[i]), fz));
+	}
+	return i;
+}
+
+TARGET_SSE static int NormalizePosesSSE(TurtlePoses& poses, int begin, int end)
+{
+	int i = begin;
+	for (; i + 4 <= end; i += 4) {
+		__m128 x = _mm_loadu_ps(&poses.qx[i]), y = _mm_loadu_ps(&poses.qy[i]);
+		__m128 z = _mm_loadu_ps(&poses.qz[i]), w = _mm_loadu_ps(&poses.qw[i]);
+
+		// Full-precision sqrt and divide (not rsqrt) so results match the scalar path
+		__m128 l = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), _mm_mul_ps(w, w)));
+
+		_mm_storeu_ps(&poses.qx[i], _mm_div_ps(x, l));
+		_mm_storeu_ps(&poses.qy[i], _mm_div_ps(y, l));
+		_mm_storeu_ps(&poses.qz[i], _mm_div_ps(z, l));
+		_mm_storeu_ps(&poses.qw[i], _mm_div_ps(w, l));
+	}
+	return i;
+}
+
+//|___________________
+//|
+//| AVX2 kernels: 8 turtles per iteration, same arithmetic as SSE
+//|___________________
+
+TARGET_AVX2 static int RotatePosesAVX2(TurtlePoses& poses, const gmtl::Quatf& step, int begin, int end)
+{
+	const __m256 sx = _mm256_set1_ps(step[0]), sy = _mm256_set1_ps(step[1]);
+	const __m256 sz = _mm256_set1_ps(step[2]), sw = _mm256_set1_ps(step[3]);
+
+	int i = begin;
+	for (; i + 8 <= end; i += 8) {
+		__m256 x = _mm256_loadu_ps(&poses.qx[i]), y = _mm256_loadu_ps(&poses.qy[i]);
+		__m256 z = _mm256_loadu_ps(&poses.qz[i]), w = _mm256_loadu_ps(&poses.qw[i]);
+
+		__m256 nx = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(w, sx), _mm256_mul_ps(x, sw)), _mm256_mul_ps(y, sz)), _mm256_mul_ps(z, sy));
+		__m256 ny = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(w, sy), _mm256_mul_ps(y, sw)), _mm256_mul_ps(z, sx)), _mm256_mul_ps(x, sz));
+		__m256 nz = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(w, sz), _mm256_mul_ps(z, sw)), _mm256_mul_ps(x, sy)), _mm256_mul_ps(y, sx));
+		__m256 nw = _mm256_sub_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_mul_ps(w, sw), _mm256_mul_ps(x, sx)), _mm256_mul_ps(y, sy)), _mm256_mul_ps(z, sz));
+
+		_mm256_storeu_ps(&poses.qx[i], nx);
+		_mm256_storeu_ps(&poses.qy[i], ny);
+		_mm256_storeu_ps(&poses.qz[i], nz);
+		_mm256_storeu_ps(&poses.qw[i], nw);
+	}
+	return i;
+}
+
+TARGET_AVX2 static int MovePosesForwardAVX2(TurtlePoses& poses, float distance, int begin, int end)
+{
+	const __m256 d = _mm256_set1_ps(distance), d2 = _mm256_set1_ps(2.0f * distance);
+
+	int i = begin;
+	for (; i + 8 <= end; i += 8) {
+		__m256 x = _mm256_loadu_ps(&poses.qx[i]), y = _mm256_loadu_ps(&poses.qy[i]);
+		__m256 z = _mm256_loadu_ps(&poses.qz[i]), w = _mm256_loadu_ps(&poses.qw[i]);
+
+		__m256 fx = _mm256_mul_ps(d2, _mm256_add_ps(_mm256_mul_ps(x, z), _mm256_mul_ps(w, y)));
+		__m256 fy = _mm256_mul_ps(d2, _mm256_sub_ps(_mm256_mul_ps(y, z), _mm256_mul_ps(w, x)));
+		__m256 fz = _mm256_mul_ps(d, _mm256_sub_ps(_mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(w, w), _mm256_mul_ps(z, z)), _mm256_mul_ps(x, x)), _mm256_mul_ps(y, y)));
+
+		_mm256_storeu_ps(&poses.px[i], _mm256_add_ps(_mm256_loadu_ps(&poses.px[i]), fx));
+		_mm256_storeu_ps(&poses.py[i], _mm256_add_ps(_mm256_loadu_ps(&poses.py[i]), fy));
+		_mm256_storeu_ps(&poses.pz[i], _mm256_add_ps(_mm256_loadu_ps(&poses.pz[i]), fz));
+	}
+	return i;
+}
+
+TARGET_AVX2 static int NormalizePosesAVX2(TurtlePoses& poses, int begin, int end)
+{
+	int i = begin;
+	for (; i + 8 <= end; i += 8) {
+		__m256 x = _mm256_loadu_ps(&poses.qx[i]), y = _mm256_loadu_ps(&poses.qy[i]);
+		__m256 z = _mm256_loadu_ps(&poses.qz[i]), w = _mm256_loadu_ps(&poses.qw[i]);
+
+		__m256 l = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z)), _mm256_mul_ps(w, w)));
+
+		_mm256_storeu_ps(&poses.qx[i], _mm256_div_ps(x, l));
+		_mm256_storeu_ps(&poses.qy[i], _mm256_div_ps(y, l));
+		_mm256_storeu_ps(&poses.qz[i], _mm256_div_ps(z, l));
+		_mm256_storeu_ps(&poses.qw[i], _mm256_div_ps(w, l));
+	}
+	return i;
+}
+
+#endif // POSES_X86
+
+//|____________________________________________________________________
+//|
+//| Function: AddPose
+//|
+//! \param poses   [in,out] Turtle poses.
+//! \param p       [in] Position.
+//! \param q       [in] Orientation.
+//! \return Index of the new turtle.
+//|____________________________________________________________________
+
+int AddPose(TurtlePoses& poses, const gmtl::Point4f& p, const gmtl::Quatf& q)
+{
+	poses.px.push_back(p[0]);
+	poses.py.push_back(p[1]);
+	poses.pz.push_back(p[2]);
+	poses.qx.push_back(q[0]);
+	poses.qy.push_back(q[1]);
+	poses.qz.push_back(q[2]);
+	poses.qw.push_back(q[3]);
+	return PoseCount(poses) - 1;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: GetPose
+//|
+//! \param poses   [in] Turtle poses.
+//! \param turtle  [in] Turtle index.
+//! \param p       [out] Position (w = 1).
+//! \param q       [out] Orientation.
+//! \return None.
+//|____________________________________________________________________
+
+void GetPose(const TurtlePoses& poses, int turtle, gmtl::Point4f& p, gmtl::Quatf& q)
+{
+	p.set(poses.px[turtle], poses.py[turtle], poses.pz[turtle], 1.0f);
+	q.set(poses.qx[turtle], poses.qy[turtle], poses.qz[turtle], poses.qw[turtle]);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: PoseKernelSupported
+//|
+//! \param kernel  [in] Kernel variant.
+//! \return True if this machine can run it.
+//|____________________________________________________________________
+
+bool PoseKernelSupported(PoseKernel kernel)
+{
+	switch (kernel) {
+	case POSE_KERNEL_SCALAR: return true;
+	case POSE_KERNEL_SSE:    return POSES_X86 != 0;
+	case POSE_KERNEL_AVX2:   return CpuHasAvx2();
+	default:                 return false;
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SetPoseKernel
+//|
+//! \param kernel  [in] Kernel variant; ignored if unsupported.
+//! \return None.
+//!
+//! Overrides the variant picked at startup (the widest supported one).
+//|____________________________________________________________________
+
+void SetPoseKernel(PoseKernel kernel)
+{
+	if (PoseKernelSupported(kernel)) {
+		pose_kernel = kernel;
+	}
+}
+
+PoseKernel GetPoseKernel()
+{
+	return pose_kernel;
+}
+
+const char* PoseKernelName(PoseKernel kernel)
+{
+	static const char* NAMES[POSE_KERNEL_COUNT] = { "scalar", "sse", "avx2" };
+	return NAMES[kernel];
+}
+
+//|____________________________________________________________________
+//|
+//| Function: RotatePoses
+//|
+//! \param poses   [in,out] Turtle poses.
+//! \param step    [in] Rotation applied in each turtle's local frame
+//!                     (e.g. zrotp_q for a roll).
+//! \param begin   [in] First turtle.
+//! \param end     [in] One past the last turtle.
+//! \return None.
+//|____________________________________________________________________
+
+void RotatePoses(TurtlePoses& poses, const gmtl::Quatf& step, int begin, int end)
+{
+	int i = begin;
+#if POSES_X86
+	if (pose_kernel == POSE_KERNEL_AVX2) {
+		i = RotatePosesAVX2(poses, step, begin, end);
+	}
+	else if (pose_kernel == POSE_KERNEL_SSE) {
+		i = RotatePosesSSE(poses, step, begin, end);
+	}
+#endif
+	RotatePosesScalar(poses, step, i, end);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: MovePosesForward
+//|
+//! \param poses    [in,out] Turtle poses.
+//! \param distance [in] Distance along each turtle's local +Z (PLANE_FORWARD);
+//!                      negative moves backward.
+//! \param begin    [in] First turtle.
+//! \param end      [in] One past the last turtle.
+//! \return None.
+//|____________________________________________________________________
+
+void MovePosesForward(TurtlePoses& poses, float distance, int begin, int end)
+{
+	int i = begin;
+#if POSES_X86
+	if (pose_kernel == POSE_KERNEL_AVX2) {
+		i = MovePosesForwardAVX2(poses, distance, begin, end);
+	}
+	else if (pose_kernel == POSE_KERNEL_SSE) {
+		i = MovePosesForwardSSE(poses, distance, begin, end);
+	}
+#endif
+	MovePosesForwardScalar(poses, distance, i, end);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: NormalizePoses
+//|
+//! \param poses   [in,out] Turtle poses.
+//! \param begin   [in] First turtle.
+//! \param end     [in] One past the last turtle.
+//! \return None.
+//|____________________________________________________________________
+
+void NormalizePoses(TurtlePoses& poses, int begin, int end)
+{
+	int i = begin;
+#if POSES_X86
+	if (pose_kernel == POSE_KERNEL_AVX2) {
+		i = NormalizePosesAVX2(poses, begin, end);
+	}
+	else if (pose_kernel == POSE_KERNEL_SSE) {
+		i = NormalizePosesSSE(poses, begin, end);
+	}
+#endif
+	NormalizePosesScalar(poses, i, end);
+}
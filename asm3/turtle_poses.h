@@ -0,0 +1,61 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_poses.h
+//!
+//! \brief Batched pose updates over structure-of-arrays turtle state.
+//!
+//! Positions and quaternions are stored one component per array, so the
+//! kernels below process 4 (SSE) or 8 (AVX2) turtles per instruction. They
+//! perform the same operations as KeyboardFunc() on a single turtle:
+//! q = q * step for a rotation key, p += q * forward * conj(q) for a move
+//! key. A scalar version is always available and is used for the tail of
+//! every range and on CPUs without SSE/AVX2.
+//|___________________________________________________________________
+
+#pragma once
+
+#include <vector>
+
+#include <gmtl/gmtl.h>
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+enum PoseKernel {
+	POSE_KERNEL_SCALAR = 0,
+	POSE_KERNEL_SSE,            // 4 turtles per step
+	POSE_KERNEL_AVX2,           // 8 turtles per step
+	POSE_KERNEL_COUNT
+};
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+struct TurtlePoses
+{
+	std::vector<float> px, py, pz;              // Positions
+	std::vector<float> qx, qy, qz, qw;          // Orientations (quaternion x, y, z, w)
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+int AddPose(TurtlePoses& poses, const gmtl::Point4f& p, const gmtl::Quatf& q);
+void GetPose(const TurtlePoses& poses, int turtle, gmtl::Point4f& p, gmtl::Quatf& q);
+
+bool PoseKernelSupported(PoseKernel kernel);
+void SetPoseKernel(PoseKernel kernel);
+PoseKernel GetPoseKernel();
+const char* PoseKernelName(PoseKernel kernel);
+
+void RotatePoses(TurtlePoses& poses, const gmtl::Quatf& step, int begin, int end);
+void MovePosesForward(TurtlePoses& poses, float distance, int begin, int end);
+void NormalizePoses(TurtlePoses& poses, int begin, int end);
+
+inline int PoseCount(const TurtlePoses& poses) { return (int)poses.px.size(); }
@@ -0,0 +1,1107 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_scene.cpp
+//!
+//! \brief Scene state and frame rendering, independent of GLUT.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <math.h>
+#include <stdio.h>
+
+#include "frame_profiler.h"
+#include "pose_math.h"
+#include "render_queue.h"
+#include "scene_file.h"
+#include "turtle_culling.h"
+#include "turtle_lod.h"
+#include "turtle_mesh.h"
+#include "turtle_model.h"
+#include "turtle_scene.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+// Turtle 1's subparts are posed once and never animated
+const float TURTLE1_WING_ANGLE = 30.0f;
+const float TURTLE1_CANNON_BASE_ANGLE = 45.0f;
+const float TURTLE1_CANNON_ANGLE = -70.0f;
+
+// Extra turtles (crowd) laid out on a grid below the two controllable turtles
+const float CROWD_SPACING = 12.0f;
+const float CROWD_HEIGHT = -15.0f;
+const float CROWD_YAW_STEP = 37.0f;                 // Yaw difference between neighbours (degs)
+
+// Keyframe animation: each turtle's clip starts at its own phase and plays at its own speed
+const int ANIM_PHASE_STEP = 37;                     // Phase difference between neighbours (ticks)
+const float ANIM_MIN_SPEED = 0.75f;                 // Clip ticks per simulation tick
+const float ANIM_MAX_SPEED = 1.25f;
+const int ANIM_GRAIN = 256;                         // Turtles per ParallelFor() chunk of a tick's animation step
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+// Visibility of the scene from one camera, kept from frame to frame
+struct ViewState
+{
+	std::vector<unsigned char> turtle_lods;         // Per turtle, for the hysteresis
+	CullStats cull_stats;
+	LodStats lod_stats;
+};
+
+// A tick's animation step, shared by its chunks
+struct AnimationContext
+{
+	SceneGraph* scene;
+	TurtleAnimations* animations;
+	const AnimLibrary* library;
+	float* joints;                                  // Sampled angles, laid out as scene.joints
+	unsigned char* staged;                          // Per turtle, bit per joint its clip changed
+};
+
+//|___________________
+//|
+//| Global Variables
+//|___________________
+
+// Track window dimensions, initialized to 800x600
+int w_width = 800;
+int w_height = 600;
+
+// Plane pose (position-quaternion pair)
+gmtl::Point4f turtle_p2;      // Position for plane 2 (using explicit homogeneous form; see Quaternion example code)
+gmtl::Quatf plane_q2;        // Quaternion for plane 2
+
+gmtl::Point4f turtle_p1;      // Position for plane 1 (using explicit homogeneous form; see Quaternion example code)
+gmtl::Quatf plane_q1;        // Quaternion for plane 1
+
+// Retained hierarchy of all turtles (see scene_graph.h)
+SceneGraph scene;
+int turtle1_id;
+int turtle2_id;
+int crowd_size = 0;                     // Number of extra turtles, set from the command line
+SceneFile scene_file;                   // Mapped scene file, if any (see scene_file.h)
+
+// Instanced rendering (see turtle_instancing.h)
+bool instancing_supported = false;
+bool use_instancing = false;
+InstancingPath instancing_path = INSTANCING_GLSL120;
+
+// Frustum culling (see turtle_culling.h)
+bool use_culling = true;
+CullStats cull_stats;                   // Of the view of cam_id
+
+// Render queue of the per-node draws (see render_queue.h)
+bool use_sorting = true;
+static RenderQueue render_queue;
+int queued_draws = 0;                   // Of the view of cam_id
+
+// Static subtrees merged into one mesh per turtle pose (see turtle_baking.h)
+bool use_baking = true;
+BakeStats bake_stats;
+static TurtleBaking baking;
+
+// Level of detail (see turtle_lod.h)
+bool use_lod = true;
+LodStats lod_stats;
+
+// Split screen: every camera's view at once
+bool split_screen = false;
+static ViewState views[CAM_COUNT];      // Per camera, so each view keeps its own LOD hysteresis
+
+// Keyframe animation (see turtle_animation.h)
+bool use_animation = false;
+static AnimLibrary anim_library;
+static TurtleAnimations animations;
+static std::vector<float> anim_joints;  // Sampled angles, laid out as scene.joints
+static std::vector<unsigned char> anim_staged;  // Per turtle, bit per joint its clip changed this tick
+
+// Workers of the per-tick update
+ThreadPool* tick_pool = NULL;
+
+// CPU rasterizer (see soft_raster.h)
+bool use_software = false;
+SoftRaster soft_raster;
+static bool meshes_built = false;       // By InitSceneGL() or InitSceneSoftware()
+
+// Per-frame data: visible lists, level buckets, instances, render queue (see frame_arena.h)
+FrameArenas frame_arenas;
+
+// Cannon shells (see turtle_shells.h)
+ShellPool shells;
+
+// Pose publication (see pose_share.h)
+PoseShare pose_share;
+
+// Quaternions to rotate plane
+gmtl::Quatf zrotp_q;        // Positive and negative Z rotations
+gmtl::Quatf zrotn_q;
+
+gmtl::Quatf xrotp_q;        // Positive and negative X rotations
+gmtl::Quatf xrotn_q;
+
+gmtl::Quatf yrotp_q;
+gmtl::Quatf yrotn_q;
+
+// Propeller rotation (subpart)
+float wing_angle_right = 0;         // Rotation angle
+float wing_angle_left = 0;	// Rotation angle for the left propeller (new)
+float cannon_angle_top = 0;	// top propeller
+float cannon_angle_subsubpart = 0; // subsub part propeller
+
+// Cameras
+int cam_id = 0;                                // Selects which camera to view
+int camctrl_id = 0;                                // Selects which camera to control
+float distance[3] = { 20.0f,  20.0f,  20.0f };                 // Distance of the camera from world's origin.
+float elevation[3] = { -45.0f, -45.0f, -45.0f };                 // Elevation of the camera. (in degs)
+float azimuth[3] = { 15.0f,  15.0f,  15.0f };                 // Azimuth of the camera. (in degs)
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+static void AddCrowd(int count);
+static void AddFileTurtles();
+static void InitTurtleAnimations();
+static void StepAnimationChunk(int begin, int end, void* context);
+static void DrawCoordinateFrame(const float l);
+static void DrawTurtleCamera(int turtle, int cam);
+static void CameraFrameMatrix(int cam, float m[16]);
+static void SoftDrawCameraFrames(int cam, const float view_projection[16]);
+static void SoftDrawFrame(const float view_projection[16], const float* world, float l);
+static void RenderView(int cam, int x, int y, int width, int height);
+static void CameraViewMatrix(int cam, float view[16]);
+static void DrawViewBorders(int left, int bottom);
+static void DrawShells();
+
+//|____________________________________________________________________
+//|
+//| Function: InitTransforms
+//|
+//! \param None.
+//! \return None.
+//!
+//! Initializes all the transforms
+//|____________________________________________________________________
+
+void InitTransforms()
+{
+	constexpr float COSTHETA_D2 = StepQuatCos(PLANE_ROTATION);     // Evaluated at compile time
+	constexpr float SINTHETA_D2 = StepQuatSin(PLANE_ROTATION);
+
+	// Inits plane 2 pose
+	turtle_p2.set(3.0f, -5.0f, 4.0f, 1.0f);
+	plane_q2.set(0, 0, 0, 1);
+
+	// Inits plane 1 pose
+	turtle_p1.set(-3.0f, 5.0f, 4.0f, 1.0f);
+	plane_q1.set(0, 0, 0, 1);
+
+	// Z rotations (roll)
+	zrotp_q.set(0, 0, SINTHETA_D2, COSTHETA_D2);      // +Z
+	zrotn_q = gmtl::makeConj(zrotp_q);                // -Z
+
+	// X rotation (pitch)
+	xrotp_q.set(SINTHETA_D2, 0, 0, COSTHETA_D2);      // +X
+	xrotn_q = gmtl::makeConj(xrotp_q);                // -X
+
+	// Y rotation (yaw)
+	yrotp_q.set(0, SINTHETA_D2, 0, COSTHETA_D2);      // +Y
+	yrotn_q = gmtl::makeConj(yrotp_q);                // -Y
+
+	// Builds the turtle hierarchies (from scratch, so the scene can be re-initialized)
+	scene = SceneGraph();
+	if (scene_file.header) {
+		AddFileTurtles();
+	}
+	else {
+		turtle1_id = AddTurtle(scene, turtle_p1, plane_q1);
+		turtle2_id = AddTurtle(scene, turtle_p2, plane_q2);
+
+		SetTurtleJoint(scene, turtle1_id, JOINT_WING_RIGHT, -TURTLE1_WING_ANGLE);
+		SetTurtleJoint(scene, turtle1_id, JOINT_WING_LEFT, TURTLE1_WING_ANGLE);
+		SetTurtleJoint(scene, turtle1_id, JOINT_CANNON_BASE, TURTLE1_CANNON_BASE_ANGLE);
+		SetTurtleJoint(scene, turtle1_id, JOINT_CANNON, TURTLE1_CANNON_ANGLE);
+	}
+
+	AddCrowd(crowd_size);
+	ClearTurtleBakes(baking);
+	animations = TurtleAnimations();        // Clips start with the first animated tick
+
+	InitShellPool(shells, SHELL_CAPACITY);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: AddFileTurtles
+//|
+//! \param None.
+//! \return None.
+//!
+//! Takes every turtle of the mapped scene file: the scene graph views
+//! the file's graph arrays in place when it has them, otherwise it is
+//! built from the turtle records. The first two become turtle 1 and
+//! turtle 2, whose poses and subpart angles are also the controls'.
+//|____________________________________________________________________
+
+static void AddFileTurtles()
+{
+	const SceneFileTurtle* turtles = scene_file.turtles;
+	int count = (int)scene_file.header->turtle_count;
+
+	if (!ViewSceneFileGraph(scene_file, scene)) {
+		ReserveTurtles(scene, count + crowd_size);
+		for (int i = 0; i < count; i++) {
+			const SceneFileTurtle& t = turtles[i];
+			int id = AddTurtle(scene, gmtl::Point4f(t.position[0], t.position[1], t.position[2], 1.0f),
+			                   gmtl::Quatf(t.orientation[0], t.orientation[1], t.orientation[2], t.orientation[3]));
+			for (int j = 0; j < JOINT_COUNT; j++) {
+				SetTurtleJoint(scene, id, (TurtleJoint)j, t.joints[j]);
+			}
+		}
+	}
+
+	turtle1_id = 0;
+	turtle2_id = 1;
+	turtle_p1 = scene.position[turtle1_id];
+	plane_q1 = scene.orientation[turtle1_id];
+	turtle_p2 = scene.position[turtle2_id];
+	plane_q2 = scene.orientation[turtle2_id];
+
+	wing_angle_right = turtles[1].joints[JOINT_WING_RIGHT];
+	wing_angle_left = turtles[1].joints[JOINT_WING_LEFT];
+	cannon_angle_top = turtles[1].joints[JOINT_CANNON_BASE];
+	cannon_angle_subsubpart = turtles[1].joints[JOINT_CANNON];
+}
+
+//|____________________________________________________________________
+//|
+//| Function: AddCrowd
+//|
+//! \param count  [in] Number of turtles to add.
+//! \return None.
+//!
+//! Adds uncontrolled turtles on a square grid, each yawed differently.
+//|____________________________________________________________________
+
+static void AddCrowd(int count)
+{
+	int side = (int)ceil(sqrt((float)count));
+
+	ReserveTurtles(scene, TurtleCount(scene) + count);
+
+	for (int i = 0; i < count; i++) {
+		float x = (i % side - (side - 1) * 0.5f) * CROWD_SPACING;
+		float z = (i / side - (side - 1) * 0.5f) * CROWD_SPACING;
+
+		gmtl::Quatf q;
+		gmtl::set(q, gmtl::AxisAnglef(gmtl::Math::deg2Rad(i * CROWD_YAW_STEP), 0.0f, 1.0f, 0.0f));
+
+		AddTurtle(scene, gmtl::Point4f(x, CROWD_HEIGHT, z, 1.0f), q);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: InitTurtleAnimations
+//|
+//! \param None.
+//! \return None.
+//!
+//! Gives every turtle but the two controlled ones a default clip, with a
+//! phase and speed of its own so that no two move in step. Runs at the
+//! first animated tick, so that a large scene starts without it.
+//|____________________________________________________________________
+
+static void InitTurtleAnimations()
+{
+	int count = TurtleCount(scene);
+
+	BuildDefaultClips(anim_library);
+	animations = TurtleAnimations();
+	ResizeAnimations(animations, count);
+	for (int t = 0; t < count; t++) {
+		if (t == turtle1_id || t == turtle2_id) {
+			continue;
+		}
+		int clip = t % ANIM_DEFAULT_CLIP_COUNT;
+		PlayAnimation(animations, anim_library, t, clip, (float)(t * ANIM_PHASE_STEP % anim_library.clips[clip].length),
+		              ANIM_MIN_SPEED + (ANIM_MAX_SPEED - ANIM_MIN_SPEED) * (t * 53 % 101) / 100.0f);
+	}
+	anim_joints.assign(scene.joints.begin(), scene.joints.end());
+	anim_staged.assign(count, 0);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: InitSceneGL
+//|
+//! \param load   [in] Loader for GL entry points past OpenGL 1.1.
+//! \return None.
+//!
+//! OpenGL initializations; requires a current context.
+//|____________________________________________________________________
+
+void InitSceneGL(GLProcLoader load)
+{
+	glClearColor(CLEAR_COLOUR[0], CLEAR_COLOUR[1], CLEAR_COLOUR[2], 1.0f);
+	glEnable(GL_DEPTH_TEST);
+	glShadeModel(GL_SMOOTH);
+
+	// Part meshes live in a vertex buffer when the driver has them, in client memory otherwise
+	if (!LoadGLExtensions(load)) {
+		printf("Vertex buffers unavailable, drawing meshes from client memory\n");
+	}
+	InitMeshes();
+	InitTurtleBounds();
+	InitTurtleLod();
+	InitTurtleBaking(baking);
+	meshes_built = true;
+
+	// All turtles in O(part types) draw calls when instancing is supported, GLSL 3.30 core preferred
+	instancing_supported = InitTurtleInstancing();
+	use_instancing = instancing_supported;
+	instancing_path = IsInstancingPathSupported(INSTANCING_GLSL330_CORE) ? INSTANCING_GLSL330_CORE : INSTANCING_GLSL120;
+	printf("Instanced rendering %s%s\n", use_instancing ? "on" : "unavailable",
+		!use_instancing ? "" : instancing_path == INSTANCING_GLSL330_CORE ? " (GLSL 3.30 core)" : " (GLSL 1.20)");
+}
+
+//|____________________________________________________________________
+//|
+//| Function: InitSceneSoftware
+//|
+//! \param threads [in] Threads of the CPU rasterizer; 0 or less uses every
+//!                     hardware thread.
+//! \return None.
+//!
+//! CPU rasterizer initializations. Without a GL context (InitSceneGL()
+//! not called) the meshes are built here, in client memory.
+//|____________________________________________________________________
+
+void InitSceneSoftware(int threads)
+{
+	if (!meshes_built) {
+		InitMeshes();
+		InitTurtleBounds();
+		InitTurtleLod();
+		InitTurtleBaking(baking);
+		meshes_built = true;
+	}
+	InitSoftRaster(soft_raster, threads);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: InitSceneThreads
+//|
+//! \param threads [in] Workers of the per-tick update; 0 or less uses
+//!                     every hardware thread, 1 runs it serially.
+//! \return None.
+//|____________________________________________________________________
+
+void InitSceneThreads(int threads)
+{
+	FreeSceneThreads();
+	if (threads != 1) {
+		tick_pool = CreateThreadPool(threads);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: FreeSceneThreads
+//|
+//! \param None.
+//! \return None.
+//|____________________________________________________________________
+
+void FreeSceneThreads()
+{
+	DestroyThreadPool(tick_pool);
+	tick_pool = NULL;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: RenderScene
+//|
+//! \param None.
+//! \return None.
+//!
+//! Draws one frame into the current framebuffer (without swapping).
+//! World matrices are updated once; in split screen the viewed camera
+//! takes the left half of the window and the other two cameras share the
+//! right half, each view culled on its own. With use_software the frame
+//! goes to the CPU rasterizer's framebuffer instead, without GL calls
+//! (but for the baked meshes' upload when a context is current); there
+//! is no instancing then.
+//|____________________________________________________________________
+
+void RenderScene()
+{
+	if (use_software) {
+		BeginSoftFrame(soft_raster, w_width, w_height);
+	}
+	else {
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
+
+	//|____________________________________________________________________
+	//|
+	//| Draw traversal begins, start from world (root) node
+	//|____________________________________________________________________
+
+	// Turtle nodes: world matrices are cached and only refreshed for the subtrees that moved
+	BeginProfileScope("world transforms");
+	UpdateWorldTransforms(scene);
+	EndProfileScope();
+
+	// Baked meshes follow the joints that changed since the last frame
+	if (use_baking && (!use_instancing || use_software)) {
+		BeginProfileScope("baking");
+		UpdateTurtleBakes(baking, scene);
+		UploadTurtleBakes(baking);
+		bake_stats = baking.stats;
+		EndProfileScope();
+	}
+
+	if (!split_screen) {
+		RenderView(cam_id, 0, 0, w_width, w_height);
+		return;
+	}
+
+	int left = w_width / 2;
+	int bottom = w_height / 2;
+	RenderView(cam_id, 0, 0, left, w_height);
+	RenderView((cam_id + 1) % CAM_COUNT, left, bottom, w_width - left, w_height - bottom);
+	RenderView((cam_id + 2) % CAM_COUNT, left, 0, w_width - left, bottom);
+	DrawViewBorders(left, bottom);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: PresentSoftFrame
+//|
+//! \param None.
+//! \return None.
+//!
+//! Copies the CPU rasterizer's last frame into the whole window of the
+//! current GL context.
+//|____________________________________________________________________
+
+void PresentSoftFrame()
+{
+	const SoftFramebuffer& fb = soft_raster.framebuffer;
+	if (fb.colour.empty()) {
+		return;
+	}
+
+	glViewport(0, 0, w_width, w_height);
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	gluOrtho2D(0, w_width, 0, w_height);
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+
+	glDisable(GL_DEPTH_TEST);
+	glRasterPos2i(0, 0);
+	glDrawPixels(fb.width, fb.height, GL_RGBA, GL_UNSIGNED_BYTE, &fb.colour[0]);
+	glEnable(GL_DEPTH_TEST);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: RenderView
+//|
+//! \param cam    [in] Camera id (0 = world-relative, 1/2 = plane-relative).
+//! \param x, y   [in] Lower left corner of the viewport (pixels).
+//! \param width  [in] Viewport size (pixels).
+//! \param height [in]
+//! \return None.
+//!
+//! Draws the scene as seen by one camera into a viewport; world matrices
+//! must be up to date. Culling and levels of detail are the camera's own,
+//! the meshes and instance buffers are shared by all views. The lists the
+//! view builds come from the current frame arena. With use_software the
+//! view is one pass of the CPU rasterizer.
+//|____________________________________________________________________
+
+static void RenderView(int cam, int x, int y, int width, int height)
+{
+	ViewState& v = views[cam];
+	FrameArena& arena = CurrentArena(frame_arenas);
+	float view[16];         // World to camera
+	float projection[16];   // Camera to clip
+	float view_projection[16];
+	float aspect = (float)width / height;
+
+	BeginProfileScope("camera");
+
+	//|____________________________________________________________________
+	//|
+	//| Setting up view transform by:
+	//| "move up to the world frame by composing all of the (inverse) transforms from the camera up to the world node"
+	//|____________________________________________________________________
+
+	CameraViewMatrix(cam, view);                // Kept on the CPU for culling as well
+	if (use_software) {
+		PerspectiveMatrix(CAM_FOV, aspect, CAM_NEAR, CAM_FAR, projection);
+	}
+	else {
+		glViewport(x, y, width, height);
+
+		glMatrixMode(GL_PROJECTION);
+		glLoadIdentity();
+		gluPerspective(CAM_FOV, aspect, CAM_NEAR, CAM_FAR);     // Check MSDN: google "gluPerspective msdn"
+
+		glMatrixMode(GL_MODELVIEW);
+		glLoadMatrixf(view);
+		glGetFloatv(GL_PROJECTION_MATRIX, projection);
+	}
+	MultMatrix(projection, view, view_projection);      // For the shaders and the CPU rasterizer
+	EndProfileScope();
+
+	// Turtles and nodes in view: whole turtles are rejected by their root's bound first
+	BeginProfileScope("culling");
+	int* visible_turtles = ArenaArray<int>(arena, TurtleCount(scene));
+	int* visible_nodes = ArenaArray<int>(arena, scene.world.size());
+	if (use_culling) {
+		Frustum frustum;
+		BuildFrustum(frustum, view, CAM_FOV, aspect, CAM_NEAR, CAM_FAR);
+		v.cull_stats = CullScene(scene, frustum, visible_turtles, visible_nodes);
+	}
+	else {
+		v.cull_stats.turtles_visible = TurtleCount(scene);
+		v.cull_stats.nodes_visible = (int)scene.world.size();
+		for (int i = 0; i < v.cull_stats.turtles_visible; i++) {
+			visible_turtles[i] = i;
+		}
+		for (int i = 0; i < v.cull_stats.nodes_visible; i++) {
+			visible_nodes[i] = i;
+		}
+	}
+	int visible_count = v.cull_stats.turtles_visible;
+	EndProfileScope();
+
+	// Level of each visible turtle from its projected size; without LOD every turtle is full
+	BeginProfileScope("lod");
+	if (use_lod) {
+		v.lod_stats = SelectTurtleLods(scene, visible_turtles, visible_count, view, LodPixelScale(CAM_FOV, height),
+		                               v.turtle_lods);
+	}
+	else {
+		v.turtle_lods.assign(TurtleCount(scene), LOD_FULL);
+		v.lod_stats = LodStats();
+		v.lod_stats.turtles[LOD_FULL] = visible_count;
+	}
+
+	// Visible turtles grouped by level: lod_turtles[lod] holds lod_stats.turtles[lod] of them
+	int* lod_turtles[LOD_COUNT];
+	int* lod_order = ArenaArray<int>(arena, visible_count);
+	int* lod_end[LOD_COUNT];
+	for (int lod = 0, first = 0; lod < LOD_COUNT; lod++) {
+		lod_turtles[lod] = lod_end[lod] = lod_order + first;
+		first += v.lod_stats.turtles[lod];
+	}
+	for (int k = 0; k < visible_count; k++) {
+		*lod_end[v.turtle_lods[visible_turtles[k]]]++ = visible_turtles[k];
+	}
+	const int* lod_counts = v.lod_stats.turtles;
+	EndProfileScope();
+
+	if (cam == cam_id) {
+		cull_stats = v.cull_stats;
+		lod_stats = v.lod_stats;
+	}
+	bool instanced = use_instancing && !use_software;
+	bool baked = use_baking && !instanced;
+
+	// Turtles: one instanced draw per part type (or per merged mesh) and level
+	BeginProfileScope("draw");
+	if (instanced) {
+		TurtleInstance* instances = ArenaArray<TurtleInstance>(arena, visible_count);
+		for (int lod = 0; lod < LOD_COUNT; lod++) {
+			if (lod_counts[lod] > 0) {
+				PackTurtleInstances(scene, lod_turtles[lod], lod_counts[lod], instances);
+				DrawTurtlesInstanced(instances, lod_counts[lod], (TurtleLod)lod, view_projection, instancing_path);
+			}
+		}
+	}
+
+	// Every part below is a single draw from the shared mesh buffer
+	if (use_software) {
+		BeginSoftPass(soft_raster, arena, x, y, width, height, CLEAR_COLOUR);
+		SoftDrawCameraFrames(cam, view_projection);
+	}
+	else {
+		BindMeshes();
+
+		// World node: draws world coordinate frame
+		DrawCoordinateFrame(10);
+
+		// World-relative camera:
+		if (cam != 0) {
+			glPushMatrix();
+				glRotatef(azimuth[0], 0, 1, 0);
+				glRotatef(elevation[0], 1, 0, 0);
+				glTranslatef(0, 0, distance[0]);
+				DrawCoordinateFrame(1);
+			glPopMatrix();
+		}
+	}
+
+	// Turtles without instancing: the baked subtrees of each full turtle from its body's world
+	// matrix, one draw per other visible node from its cached one, and one merged mesh per
+	// coarser turtle from its body's, queued and sorted by material and front to back
+	if (!instanced) {
+		// Each visible node with its frame, or each full turtle's two baked ranges, or each coarser turtle
+		BeginRenderQueue(render_queue, arena, 2 * v.cull_stats.nodes_visible + 2 * lod_counts[LOD_FULL] + visible_count);
+		for (int k = 0; k < v.cull_stats.nodes_visible; k++) {
+			int i = visible_nodes[k];
+			if (v.turtle_lods[i / TN_COUNT] != LOD_FULL || (baked && IsNodeBaked(baking, i))) {
+				continue;
+			}
+			PushDrawItem(render_queue, TurtlePartMesh(NodeType(i)), scene.world[i], 1.0f, view, CAM_NEAR, CAM_FAR);
+			if (TurtlePartFrame(NodeType(i)) > 0) {
+				PushDrawItem(render_queue, MESH_FRAME, scene.world[i], TurtlePartFrame(NodeType(i)), view, CAM_NEAR, CAM_FAR);
+			}
+		}
+		for (int k = 0; baked && k < lod_counts[LOD_FULL]; k++) {
+			int t = lod_turtles[LOD_FULL][k];
+			int b = baking.bake[t];
+			if (b != BAKE_NONE) {
+				const gmtl::Matrix44f& body = scene.world[TurtleNodeId(t, TN_BODY)];
+				PushDrawRange(render_queue, baking.meshes[b].solid, MESH_COUNT + b, body, 1.0f, view, CAM_NEAR, CAM_FAR);
+				PushDrawRange(render_queue, baking.meshes[b].lines, MESH_COUNT + b, body, 1.0f, view, CAM_NEAR, CAM_FAR);
+			}
+		}
+		for (int lod = LOD_FULL + 1; lod < LOD_COUNT; lod++) {
+			for (int k = 0; k < lod_counts[lod]; k++) {
+				int body = TurtleNodeId(lod_turtles[lod][k], TN_BODY);
+				PushDrawItem(render_queue, TurtleLodMesh((TurtleLod)lod), scene.world[body], 1.0f, view, CAM_NEAR, CAM_FAR);
+			}
+		}
+		if (use_sorting) {
+			SortRenderQueue(render_queue);
+		}
+		if (use_software) {
+			SubmitSoftRenderQueue(render_queue, soft_raster, view_projection);
+		}
+		else {
+			SubmitRenderQueue(render_queue);
+		}
+	}
+	if (cam == cam_id) {
+		queued_draws = instanced ? 0 : render_queue.count;
+	}
+
+	if (use_software) {
+		if (shells.count > 0) {
+			SoftDrawPoints(soft_raster, view_projection, &shells.position[0], shells.count, SHELL_POINT_SIZE,
+			               GetTurtleModel().colours[COLOUR_DARKER_GRAY]);
+		}
+		EndProfileScope();
+
+		// Binning and the tiles on the raster threads
+		BeginProfileScope("raster");
+		EndSoftPass(soft_raster);
+		EndProfileScope();
+		return;
+	}
+
+	// Turtles' cameras:
+	if (cam != 1) {
+		DrawTurtleCamera(turtle1_id, 1);
+	}
+	if (cam != 2) {
+		DrawTurtleCamera(turtle2_id, 2);
+	}
+
+	UnbindMeshes();
+
+	// Shells: one draw of points straight from the pool
+	DrawShells();
+	EndProfileScope();
+}
+
+//|____________________________________________________________________
+//|
+//| Function: DrawViewBorders
+//|
+//! \param left   [in] Width of the left view (pixels).
+//! \param bottom [in] Height of the bottom right view (pixels).
+//! \return None.
+//!
+//! Draws the lines between the split-screen views over the whole window.
+//|____________________________________________________________________
+
+static void DrawViewBorders(int left, int bottom)
+{
+	const float lines[4][2] = {
+		{ left + 0.5f, 0.0f }, { left + 0.5f, (float)w_height },
+		{ (float)left, bottom + 0.5f }, { (float)w_width, bottom + 0.5f },
+	};
+
+	// The same pixels as the lines: column left, and row bottom to its right
+	if (use_software) {
+		const float black[3] = { 0.0f, 0.0f, 0.0f };
+		FillSoftRect(soft_raster.framebuffer, left, 0, 1, w_height, black);
+		FillSoftRect(soft_raster.framebuffer, left, bottom, w_width - left, 1, black);
+		return;
+	}
+
+	glViewport(0, 0, w_width, w_height);
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	gluOrtho2D(0, w_width, 0, w_height);
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+
+	glDisable(GL_DEPTH_TEST);
+	glColor3f(0.0f, 0.0f, 0.0f);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(2, GL_FLOAT, 0, lines);
+	glDrawArrays(GL_LINES, 0, 4);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glEnable(GL_DEPTH_TEST);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: CameraViewMatrix
+//|
+//! \param cam    [in] Camera id (0 = world-relative, 1/2 = plane-relative).
+//! \param view   [out] World to camera transform, column-major.
+//! \return None.
+//!
+//! T(0, 0, -distance) * Rx(-elevation) * Ry(-azimuth), followed for a
+//! plane-relative camera by the inverse of the plane's pose.
+//|____________________________________________________________________
+
+static void CameraViewMatrix(int cam, float view[16])
+{
+	gmtl::Matrix44f orbit = gmtl::makeTrans<gmtl::Matrix44f>(gmtl::Vec3f(0, 0, -distance[cam])) *
+	                        gmtl::makeRot<gmtl::Matrix44f>(gmtl::AxisAnglef(gmtl::Math::deg2Rad(-elevation[cam]), 1.0f, 0.0f, 0.0f)) *
+	                        gmtl::makeRot<gmtl::Matrix44f>(gmtl::AxisAnglef(gmtl::Math::deg2Rad(-azimuth[cam]), 0.0f, 1.0f, 0.0f));
+	float pose_inverse[16];
+
+	switch (cam) {
+	case 1:
+		// For plane1's camera
+		PoseInverseMatrix(turtle_p1, plane_q1, pose_inverse);   // Inverse rotation, then inverse translation
+		MultMatrix(orbit.getData(), pose_inverse, view);
+		break;
+
+	case 2:
+		// For plane2's camera
+		PoseInverseMatrix(turtle_p2, plane_q2, pose_inverse);
+		MultMatrix(orbit.getData(), pose_inverse, view);
+		break;
+
+	default:
+		// For the world-relative camera
+		for (int i = 0; i < 16; i++) {
+			view[i] = orbit.getData()[i];
+		}
+		break;
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SyncSceneGraph
+//|
+//! \param None.
+//! \return None.
+//!
+//! Pushes the turtles' poses and turtle 2's subpart angles into the scene
+//! graph. Values that did not change leave their nodes clean.
+//|____________________________________________________________________
+
+void SyncSceneGraph()
+{
+	SetTurtlePose(scene, turtle1_id, turtle_p1, plane_q1);
+	SetTurtlePose(scene, turtle2_id, turtle_p2, plane_q2);
+
+	SetTurtleJoint(scene, turtle2_id, JOINT_WING_RIGHT, wing_angle_right);
+	SetTurtleJoint(scene, turtle2_id, JOINT_WING_LEFT, wing_angle_left);
+	SetTurtleJoint(scene, turtle2_id, JOINT_CANNON_BASE, cannon_angle_top);
+	SetTurtleJoint(scene, turtle2_id, JOINT_CANNON, cannon_angle_subsubpart);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: FireTurtleCannons
+//|
+//! \param turtle2 [in] Turtle 2 fires one shell.
+//! \param all     [in] Every turtle fires, each on its own ticks (see FireCannons()).
+//! \param tick    [in] Simulation tick.
+//! \return None.
+//!
+//! Shells leave the cannons as posed in the scene graph, so call after
+//! SyncSceneGraph() with the tick's state.
+//|____________________________________________________________________
+
+void FireTurtleCannons(bool turtle2, bool all, unsigned int tick)
+{
+	gmtl::Vec3f muzzle(GetTurtleModel().wing_width * CANNON_MUZZLE, 0, 0);
+
+	UpdateWorldTransforms(scene);
+	if (turtle2) {
+		FireShell(shells, scene.world[TurtleNodeId(turtle2_id, TN_CANNON)], muzzle);
+	}
+	if (all) {
+		FireCannons(shells, scene, tick, muzzle);
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: PublishTurtlePoses
+//|
+//! \param tick   [in] Simulation tick.
+//! \return None.
+//!
+//! Writes every turtle's pose and joint angles, as posed in the scene
+//! graph, into the next slot of the pose share (if one is mapped). Call
+//! after SyncSceneGraph() with the tick's state.
+//|____________________________________________________________________
+
+void PublishTurtlePoses(unsigned int tick)
+{
+	if (!pose_share.header) {
+		return;
+	}
+
+	int count = TurtleCount(scene);
+	if ((uint64_t)count > pose_share.header->turtle_capacity) {
+		count = (int)pose_share.header->turtle_capacity;
+	}
+	SceneFileTurtle* records = BeginPosePublish(pose_share, tick, count);
+	PackSceneFileTurtles(scene, records, count);
+	EndPosePublish(pose_share);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: StepTurtleAnimations
+//|
+//! \param None.
+//! \return None.
+//!
+//! Advances every turtle's clip by one tick and sets the joints the clips
+//! drive in the scene graph. The clips are sampled and the joints staged
+//! in chunks on tick_pool; only the commits of the changed turtles run
+//! serially, in turtle order, so the result does not depend on the number
+//! of threads. Call once per tick.
+//|____________________________________________________________________
+
+void StepTurtleAnimations()
+{
+	int count = TurtleCount(scene);
+	if (count == 0) {
+		return;
+	}
+	if (AnimationCount(animations) != count) {
+		InitTurtleAnimations();
+	}
+
+	AnimationContext context = { &scene, &animations, &anim_library, &anim_joints[0], &anim_staged[0] };
+	if (tick_pool) {
+		ParallelFor(tick_pool, count, ANIM_GRAIN, StepAnimationChunk, &context);
+	}
+	else {
+		for (int begin = 0; begin < count; begin += ANIM_GRAIN) {
+			StepAnimationChunk(begin, begin + ANIM_GRAIN < count ? begin + ANIM_GRAIN : count, &context);
+		}
+	}
+
+	for (int t = 0; t < count; t++) {
+		if (anim_staged[t]) {
+			CommitTurtleJoints(scene, t, anim_staged[t]);
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: StepAnimationChunk
+//|
+//! \param begin   [in] First turtle.
+//! \param end     [in] One past the last turtle.
+//! \param context [in,out] AnimationContext.
+//! \return None.
+//!
+//! One tick of the clips of a range of turtles: samples them and stages
+//! the joints they drive. Touches nothing outside the range.
+//|____________________________________________________________________
+
+static void StepAnimationChunk(int begin, int end, void* context)
+{
+	AnimationContext& a = *(AnimationContext*)context;
+	StepAnimations(*a.animations, *a.library, a.joints, begin, end);
+
+	for (int t = begin; t < end; t++) {
+		unsigned char staged = 0;
+		int c = a.animations->clip[t];
+		if (c != ANIM_NO_CLIP) {
+			const AnimClip& clip = a.library->clips[c];
+			for (int j = 0; j < JOINT_COUNT; j++) {
+				if (clip.tracks[j] != ANIM_NO_TRACK &&
+				    StageTurtleJoint(*a.scene, t, (TurtleJoint)j, a.joints[t * JOINT_COUNT + j])) {
+					staged |= (unsigned char)(1 << j);
+				}
+			}
+		}
+		a.staged[t] = staged;
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: DrawShells
+//|
+//! \param None.
+//! \return None.
+//!
+//! Draws the live shells as points in the world frame (the modelview
+//! must hold the view transform).
+//|____________________________________________________________________
+
+static void DrawShells()
+{
+	if (shells.count == 0) {
+		return;
+	}
+
+	const float* colour = GetTurtleModel().colours[COLOUR_DARKER_GRAY];
+	glPointSize(SHELL_POINT_SIZE);
+	glColor3f(colour[0], colour[1], colour[2]);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, &shells.position[0]);
+	glDrawArrays(GL_POINTS, 0, shells.count);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glPointSize(1.0f);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: DrawCoordinateFrame
+//|
+//! \param l      [in] length of the three axes.
+//! \return None.
+//!
+//! Draws coordinate frame consisting of the three principal axes.
+//|____________________________________________________________________
+
+static void DrawCoordinateFrame(const float l)
+{
+	glPushMatrix();
+		glScalef(l, l, l);
+		DrawMesh(MESH_FRAME);
+	glPopMatrix();
+}
+
+//|____________________________________________________________________
+//|
+//| Function: DrawTurtleCamera
+//|
+//! \param turtle [in] Turtle the camera is attached to.
+//! \param cam    [in] Camera id (index into azimuth/elevation/distance).
+//! \return None.
+//!
+//! Draws the coordinate frame of a turtle-relative camera.
+//|____________________________________________________________________
+
+static void DrawTurtleCamera(int turtle, int cam)
+{
+	glPushMatrix();
+		glMultMatrixf(scene.world[TurtleNodeId(turtle, TN_BODY)].getData());
+		glRotatef(azimuth[cam], 0, 1, 0);
+		glRotatef(elevation[cam], 1, 0, 0);
+		glTranslatef(0, 0, distance[cam]);
+		DrawCoordinateFrame(1);
+	glPopMatrix();
+}
+
+//|____________________________________________________________________
+//|
+//| Function: CameraFrameMatrix
+//|
+//! \param cam    [in] Camera id (index into azimuth/elevation/distance).
+//! \param m      [out] Ry(azimuth) * Rx(elevation) * T(0, 0, distance):
+//!                     the camera's frame in its parent's, column-major.
+//! \return None.
+//|____________________________________________________________________
+
+static void CameraFrameMatrix(int cam, float m[16])
+{
+	gmtl::Matrix44f frame = gmtl::makeRot<gmtl::Matrix44f>(gmtl::AxisAnglef(gmtl::Math::deg2Rad(azimuth[cam]), 0.0f, 1.0f, 0.0f)) *
+	                        gmtl::makeRot<gmtl::Matrix44f>(gmtl::AxisAnglef(gmtl::Math::deg2Rad(elevation[cam]), 1.0f, 0.0f, 0.0f)) *
+	                        gmtl::makeTrans<gmtl::Matrix44f>(gmtl::Vec3f(0, 0, distance[cam]));
+	for (int i = 0; i < 16; i++) {
+		m[i] = frame.getData()[i];
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SoftDrawCameraFrames
+//|
+//! \param cam             [in] Camera viewed.
+//! \param view_projection [in] World to clip transform, column-major.
+//! \return None.
+//!
+//! Sets up on the CPU rasterizer the coordinate frames RenderView() draws
+//! with GL: the world's and those of the cameras not viewed.
+//|____________________________________________________________________
+
+static void SoftDrawCameraFrames(int cam, const float view_projection[16])
+{
+	float frame[16];
+	float world[16];
+
+	gmtl::Matrix44f identity;
+	SoftDrawFrame(view_projection, identity.getData(), 10);
+
+	if (cam != 0) {
+		CameraFrameMatrix(0, frame);
+		SoftDrawFrame(view_projection, frame, 1);
+	}
+	for (int c = 1; c <= 2; c++) {
+		if (cam != c) {
+			CameraFrameMatrix(c, frame);
+			MultMatrix(scene.world[TurtleNodeId(c == 1 ? turtle1_id : turtle2_id, TN_BODY)].getData(), frame, world);
+			SoftDrawFrame(view_projection, world, 1);
+		}
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: SoftDrawFrame
+//|
+//! \param view_projection [in] World to clip transform, column-major.
+//! \param world           [in] Frame's world matrix, column-major.
+//! \param l               [in] Length of the three axes.
+//! \return None.
+//|____________________________________________________________________
+
+static void SoftDrawFrame(const float view_projection[16], const float* world, float l)
+{
+	float mvp[16];
+	MultMatrix(view_projection, world, mvp);
+	for (int i = 0; i < 12; i++) {
+		mvp[i] *= l;
+	}
+	SoftDrawArrays(soft_raster, mvp, GetMeshVertices(), GetMeshRange(MESH_FRAME));
+}
@@ -0,0 +1,164 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_scene.h
+//!
+//! \brief Scene state and frame rendering, independent of GLUT.
+//!
+//! Holds the turtles' poses, subpart angles and cameras, and draws one
+//! frame of the scene into whatever context is current. The GLUT program
+//! drives it from its callbacks; headless tools drive it directly.
+//|___________________________________________________________________
+
+#pragma once
+
+#include <vector>
+
+#include <gmtl/gmtl.h>
+
+#include "frame_arena.h"
+#include "gl_ext.h"
+#include "scene_graph.h"
+#include "soft_raster.h"
+#include "turtle_animation.h"
+#include "turtle_baking.h"
+#include "turtle_culling.h"
+#include "turtle_instancing.h"
+#include "turtle_lod.h"
+#include "turtle_shells.h"
+#include "pose_share.h"
+#include "scene_file.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+// Simulation tick (see turtle_control.h)
+const float SIM_RATE = 60.0f;                           // Ticks per second
+const float SIM_STEP = 1.0f / SIM_RATE;                 // Seconds per tick
+
+// Plane transforms
+const gmtl::Vec3f PLANE_FORWARD(0, 0, 0.25f);           // Plane's forward translation vector per tick (w.r.t. local frame), 15 units/s
+constexpr float PLANE_ROTATION = 1.5f;                     // Plane rotated by 1.5 degs per tick, 90 degs/s
+
+// Propeller transforms
+const float DELTA_ROTATION = 1.5f;                  // Propeller rotated by 1.5 degs per tick, 90 degs/s
+
+// Camera's view frustum 
+const float CAM_FOV = 90.0f;                     // Field of view in degs
+const float CAM_NEAR = 0.1f;                     // Near and far clipping distances
+const float CAM_FAR = 1000.0f;
+const int CAM_COUNT = 3;                         // World-relative camera, turtle 1's, turtle 2's
+
+// Cannon shells, drawn as points
+const float SHELL_POINT_SIZE = 3.0f;                // Pixels
+
+// Background
+const float CLEAR_COLOUR[3] = { 0.7f, 0.7f, 0.7f };
+
+//|___________________
+//|
+//| Global Variables
+//|___________________
+
+// Track window dimensions, initialized to 800x600
+extern int w_width;
+extern int w_height;
+
+// Plane pose (position-quaternion pair)
+extern gmtl::Point4f turtle_p2;
+extern gmtl::Quatf plane_q2;
+
+extern gmtl::Point4f turtle_p1;
+extern gmtl::Quatf plane_q1;
+
+// Retained hierarchy of all turtles
+extern SceneGraph scene;
+extern int turtle1_id;
+extern int turtle2_id;
+extern int crowd_size;
+extern SceneFile scene_file;
+
+// Instanced rendering
+extern bool instancing_supported;
+extern bool use_instancing;
+extern InstancingPath instancing_path;          // Shader version of the instanced draws
+
+// Frustum culling
+extern bool use_culling;
+extern CullStats cull_stats;                    // Visible turtles and nodes in the last frame
+
+// Sorting of the per-node draws by material and depth
+extern bool use_sorting;
+extern int queued_draws;                        // Per-node draws queued in the last frame
+
+// Baking of the static subtrees into one mesh per turtle pose
+extern bool use_baking;
+extern BakeStats bake_stats;                    // Turtles baked and meshes in use in the last frame
+
+// Level of detail
+extern bool use_lod;
+extern LodStats lod_stats;                      // Visible turtles at each level in the last frame
+
+// Split screen: the viewed camera on the left half, the other two stacked on the right
+extern bool split_screen;
+
+// Keyframe animation of the uncontrolled turtles' joints
+extern bool use_animation;
+
+// CPU rasterizer instead of OpenGL (see soft_raster.h): RenderScene() draws into its framebuffer,
+// PresentSoftFrame() copies that to the current GL framebuffer
+extern bool use_software;
+extern SoftRaster soft_raster;
+
+// Workers of the per-tick update (the crowd's animation step), NULL to run it serially
+extern ThreadPool* tick_pool;
+
+// Arenas of the per-frame lists; the frame's driver calls BeginArenaFrame() before RenderScene()
+extern FrameArenas frame_arenas;
+
+// Cannon shells in flight
+extern ShellPool shells;
+
+// Poses published to other processes every tick, when mapped
+extern PoseShare pose_share;
+
+// Quaternions to rotate plane
+extern gmtl::Quatf zrotp_q;
+extern gmtl::Quatf zrotn_q;
+
+extern gmtl::Quatf xrotp_q;
+extern gmtl::Quatf xrotn_q;
+
+extern gmtl::Quatf yrotp_q;
+extern gmtl::Quatf yrotn_q;
+
+// Propeller rotation (subpart)
+extern float wing_angle_right;
+extern float wing_angle_left;
+extern float cannon_angle_top;
+extern float cannon_angle_subsubpart;
+
+// Cameras
+extern int cam_id;
+extern int camctrl_id;
+extern float distance[3];
+extern float elevation[3];
+extern float azimuth[3];
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void InitTransforms();
+void InitSceneGL(GLProcLoader load);
+void InitSceneSoftware(int threads);
+void InitSceneThreads(int threads);
+void FreeSceneThreads();
+void RenderScene();
+void PresentSoftFrame();
+void SyncSceneGraph();
+void FireTurtleCannons(bool turtle2, bool all, unsigned int tick);
+void PublishTurtlePoses(unsigned int tick);
+void StepTurtleAnimations();
@@ -0,0 +1,164 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_shells.cpp
+//!
+//! \brief Fixed-capacity pool of cannon shells in ballistic flight.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <math.h>
+
+#include "turtle_shells.h"
+
+//|____________________________________________________________________
+//|
+//| Function: InitShellPool
+//|
+//! \param pool     [out] Shell pool.
+//! \param capacity [in] Shells alive at once.
+//! \return None.
+//!
+//! Allocates every slot up front; nothing is allocated afterwards.
+//|____________________________________________________________________
+
+void InitShellPool(ShellPool& pool, int capacity)
+{
+	pool.capacity = capacity;
+	pool.position.assign((size_t)capacity * 3, 0.0f);
+	pool.velocity.assign((size_t)capacity * 3, 0.0f);
+	pool.life.assign(capacity, 0.0f);
+	ClearShells(pool);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: ClearShells
+//|
+//! \param pool   [in,out] Shell pool.
+//! \return None.
+//!
+//! Removes every shell and resets the counters, keeping the slots.
+//|____________________________________________________________________
+
+void ClearShells(ShellPool& pool)
+{
+	pool.count = 0;
+	pool.fired = 0;
+	pool.dropped = 0;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: FireShell
+//|
+//! \param pool   [in,out] Shell pool.
+//! \param cannon [in] World matrix of a cannon node (barrel along its +X axis).
+//! \param muzzle [in] End of the barrel w.r.t. the cannon's frame.
+//! \return False if the pool is full and the shot was dropped.
+//|____________________________________________________________________
+
+bool FireShell(ShellPool& pool, const gmtl::Matrix44f& cannon, const gmtl::Vec3f& muzzle)
+{
+	pool.fired++;
+	if (pool.count == pool.capacity) {
+		pool.dropped++;
+		return false;
+	}
+
+	// Barrel direction: the cannon's X axis in world coordinates (the matrix is a rigid transform)
+	float dx = cannon(0, 0), dy = cannon(1, 0), dz = cannon(2, 0);
+	float scale = SHELL_SPEED / sqrtf(dx * dx + dy * dy + dz * dz);
+
+	int i = pool.count++;
+	float* p = &pool.position[i * 3];
+	float* v = &pool.velocity[i * 3];
+	for (int k = 0; k < 3; k++) {
+		p[k] = cannon(k, 0) * muzzle[0] + cannon(k, 1) * muzzle[1] + cannon(k, 2) * muzzle[2] + cannon(k, 3);
+	}
+	v[0] = dx * scale;
+	v[1] = dy * scale;
+	v[2] = dz * scale;
+	pool.life[i] = SHELL_LIFETIME;
+	return true;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: FireCannons
+//|
+//! \param pool   [in,out] Shell pool.
+//! \param scene  [in] Scene graph with up-to-date world matrices.
+//! \param tick   [in] Simulation tick.
+//! \param muzzle [in] End of the barrel w.r.t. the cannon's frame.
+//! \return Shells added.
+//!
+//! Every turtle fires once per SHELL_FIRE_INTERVAL ticks. Turtle t fires
+//! on the ticks where (tick + t) is a multiple of the interval, so a
+//! crowd spreads its shots evenly over the ticks instead of firing all at
+//! once.
+//|____________________________________________________________________
+
+int FireCannons(ShellPool& pool, const SceneGraph& scene, unsigned int tick, const gmtl::Vec3f& muzzle)
+{
+	int count = pool.count;
+	int first = (SHELL_FIRE_INTERVAL - (int)(tick % SHELL_FIRE_INTERVAL)) % SHELL_FIRE_INTERVAL;
+
+	for (int t = first; t < TurtleCount(scene); t += SHELL_FIRE_INTERVAL) {
+		FireShell(pool, scene.world[TurtleNodeId(t, TN_CANNON)], muzzle);
+	}
+	return pool.count - count;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: StepShells
+//|
+//! \param pool   [in,out] Shell pool.
+//! \param dt     [in] Time step (seconds).
+//! \return None.
+//!
+//! Integrates every live shell (semi-implicit Euler: gravity changes the
+//! velocity, then the new velocity moves the shell), then removes the
+//! expired ones. Each pass is one flat loop over the packed arrays.
+//|____________________________________________________________________
+
+void StepShells(ShellPool& pool, float dt)
+{
+	int n = pool.count;
+	if (n == 0) {
+		return;
+	}
+
+	float* p = &pool.position[0];
+	float* v = &pool.velocity[0];
+	float* life = &pool.life[0];
+
+	for (int i = 0; i < n; i++) {
+		v[i * 3 + 1] -= SHELL_GRAVITY * dt;
+	}
+	for (int i = 0; i < n * 3; i++) {
+		p[i] += v[i] * dt;
+	}
+	for (int i = 0; i < n; i++) {
+		life[i] -= dt;
+	}
+
+	// Expired shells are replaced by the last live one
+	for (int i = 0; i < n; ) {
+		if (life[i] > 0) {
+			i++;
+			continue;
+		}
+		n--;
+		for (int k = 0; k < 3; k++) {
+			p[i * 3 + k] = p[n * 3 + k];
+			v[i * 3 + k] = v[n * 3 + k];
+		}
+		life[i] = life[n];
+	}
+	pool.count = n;
+}
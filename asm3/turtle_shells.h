@@ -0,0 +1,62 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_shells.h
+//!
+//! \brief Fixed-capacity pool of cannon shells in ballistic flight.
+//!
+//! Shells leave a cannon's muzzle along its barrel, computed from the
+//! cannon node's world matrix, then fly under gravity until their
+//! lifetime runs out. The pool is a structure of arrays allocated once:
+//! firing writes the next free slot and an expired shell is replaced by
+//! the last live one, so live shells stay packed at the front and no shot
+//! ever touches the heap. A full pool drops new shots.
+//!
+//! Positions are packed xyz so the live shells are drawn straight from
+//! the pool as one array of points.
+//|___________________________________________________________________
+
+#pragma once
+
+#include <vector>
+
+#include <gmtl/gmtl.h>
+
+#include "scene_graph.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const int SHELL_CAPACITY = 65536;           // Shells alive at once
+const float SHELL_SPEED = 40.0f;            // Muzzle speed (units/s)
+const float SHELL_GRAVITY = 20.0f;          // Downward acceleration (units/s^2)
+const float SHELL_LIFETIME = 3.0f;          // Seconds before a shell is removed
+const int SHELL_FIRE_INTERVAL = 6;          // Ticks between two shots of one cannon (10 shots/s at 60 Hz)
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+struct ShellPool
+{
+	int capacity;
+	int count;                              // Live shells, in slots [0, count)
+	std::vector<float> position;            // xyz per slot
+	std::vector<float> velocity;            // xyz per slot
+	std::vector<float> life;                // Seconds left per slot
+	unsigned int fired;                     // Shots since InitShellPool()
+	unsigned int dropped;                   // Shots lost to a full pool
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void InitShellPool(ShellPool& pool, int capacity);
+void ClearShells(ShellPool& pool);
+bool FireShell(ShellPool& pool, const gmtl::Matrix44f& cannon, const gmtl::Vec3f& muzzle);
+int FireCannons(ShellPool& pool, const SceneGraph& scene, unsigned int tick, const gmtl::Vec3f& muzzle);
+void StepShells(ShellPool& pool, float dt);
@@ -0,0 +1,147 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_sim.cpp
+//!
+//! \brief Per-tick update of autonomous turtles, run in parallel chunks.
+//|___________________________________________________________________
+
+//|___________________
+//|
+//| Includes
+//|___________________
+
+#include <math.h>
+
+#include "turtle_sim.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+static const float PHASE_STEP = 2.3999632f;     // Golden angle (rads): neighbours flap out of step
+
+//|___________________
+//|
+//| Local Functions
+//|___________________
+
+//|____________________________________________________________________
+//|
+//| Function: AnimateChunk
+//|
+//! \param sim     [in,out] Simulation.
+//! \param begin   [in] First turtle.
+//! \param end     [in] One past the last turtle.
+//! \return None.
+//!
+//! Sets the wing angles from the tick and each turtle's phase, and yaws
+//! each cannon base to face the target (seen from the turtle's frame).
+//|____________________________________________________________________
+
+static void AnimateChunk(TurtleSim& sim, int begin, int end)
+{
+	const TurtlePoses& poses = sim.poses;
+
+	for (int i = begin; i < end; i++) {
+		float* joints = &sim.joints[i * JOINT_COUNT];
+
+		float flap = WING_FLAP_AMPLITUDE * sinf(i * PHASE_STEP + sim.tick * WING_FLAP_RATE);
+		joints[JOINT_WING_RIGHT] = -flap;
+		joints[JOINT_WING_LEFT] = flap;
+
+		// Target direction in the turtle's frame: conj(q) * d * q, via the transposed rotation
+		float x = poses.qx[i], y = poses.qy[i], z = poses.qz[i], w = poses.qw[i];
+		float dx = sim.target[0] - poses.px[i];
+		float dy = sim.target[1] - poses.py[i];
+		float dz = sim.target[2] - poses.pz[i];
+		float local_x = (1 - 2 * (y * y + z * z)) * dx + 2 * (x * y + w * z) * dy + 2 * (x * z - w * y) * dz;
+		float local_z = 2 * (x * z + w * y) * dx + 2 * (y * z - w * x) * dy + (1 - 2 * (x * x + y * y)) * dz;
+		joints[JOINT_CANNON_BASE] = gmtl::Math::rad2Deg(atan2f(local_x, local_z));
+	}
+}
+
+//|____________________________________________________________________
+//|
+//| Function: StepChunk
+//|
+//! \param begin   [in] First turtle.
+//! \param end     [in] One past the last turtle.
+//! \param context [in,out] The TurtleSim.
+//! \return None.
+//!
+//! One tick for a range of turtles. Touches nothing outside the range.
+//|____________________________________________________________________
+
+static void StepChunk(int begin, int end, void* context)
+{
+	TurtleSim& sim = *(TurtleSim*)context;
+
+	RotatePoses(sim.poses, sim.turn, begin, end);
+	MovePosesForward(sim.poses, sim.speed, begin, end);
+	NormalizePoses(sim.poses, begin, end);
+	AnimateChunk(sim, begin, end);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: InitSim
+//|
+//! \param sim     [out] Simulation, emptied.
+//! \param turn    [in] Rotation per tick in each turtle's frame.
+//! \param speed   [in] Distance per tick.
+//! \param target  [in] Cannon target.
+//! \return None.
+//|____________________________________________________________________
+
+void InitSim(TurtleSim& sim, const gmtl::Quatf& turn, float speed, const gmtl::Point3f& target)
+{
+	sim.poses = TurtlePoses();
+	sim.joints.clear();
+	sim.turn = turn;
+	sim.speed = speed;
+	sim.target = target;
+	sim.tick = 0;
+}
+
+//|____________________________________________________________________
+//|
+//| Function: AddSimTurtle
+//|
+//! \param sim     [in,out] Simulation.
+//! \param p       [in] Initial position.
+//! \param q       [in] Initial orientation.
+//! \return Index of the new turtle.
+//|____________________________________________________________________
+
+int AddSimTurtle(TurtleSim& sim, const gmtl::Point4f& p, const gmtl::Quatf& q)
+{
+	sim.joints.resize(sim.joints.size() + JOINT_COUNT, 0.0f);
+	return AddPose(sim.poses, p, q);
+}
+
+//|____________________________________________________________________
+//|
+//| Function: StepSim
+//|
+//! \param sim     [in,out] Simulation.
+//! \param pool    [in,out] Thread pool, or NULL to run on the calling thread.
+//! \return None.
+//!
+//! Advances every turtle by one tick.
+//|____________________________________________________________________
+
+void StepSim(TurtleSim& sim, ThreadPool* pool)
+{
+	int count = PoseCount(sim.poses);
+
+	if (pool) {
+		ParallelFor(pool, count, SIM_GRAIN, StepChunk, &sim);
+	}
+	else {
+		for (int begin = 0; begin < count; begin += SIM_GRAIN) {
+			StepChunk(begin, begin + SIM_GRAIN < count ? begin + SIM_GRAIN : count, &sim);
+		}
+	}
+	sim.tick++;
+}
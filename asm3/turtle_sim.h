@@ -0,0 +1,56 @@
+//|___________________________________________________________________
+//!
+//! \file turtle_sim.h
+//!
+//! \brief Per-tick update of autonomous turtles, run in parallel chunks.
+//!
+//! Every tick each turtle turns and flies forward (pose kernels of
+//! turtle_poses.h), flaps its wings and swings its cannon base towards a
+//! shared target. Turtles are independent, so the population is split
+//! into chunks on a ThreadPool; every turtle's result is the same whatever
+//! the number of threads.
+//|___________________________________________________________________
+
+#pragma once
+
+#include <vector>
+
+#include <gmtl/gmtl.h>
+
+#include "scene_graph.h"
+#include "thread_pool.h"
+#include "turtle_poses.h"
+
+//|___________________
+//|
+//| Constants
+//|___________________
+
+const int SIM_GRAIN = 1024;                     // Turtles per chunk (a multiple of the SIMD width)
+const float WING_FLAP_AMPLITUDE = 30.0f;        // Wing swing either side of rest (degs)
+const float WING_FLAP_RATE = 0.2f;              // Wing phase advance per tick (rads)
+
+//|___________________
+//|
+//| Types
+//|___________________
+
+struct TurtleSim
+{
+	TurtlePoses poses;
+	std::vector<float> joints;      // JOINT_COUNT angles per turtle, laid out as SceneGraph::joints
+
+	gmtl::Quatf turn;               // Rotation applied per tick in each turtle's frame
+	float speed;                    // Distance flown per tick along local +Z
+	gmtl::Point3f target;           // Point every cannon turns towards
+	int tick;                       // Ticks run so far
+};
+
+//|___________________
+//|
+//| Function Prototypes
+//|___________________
+
+void InitSim(TurtleSim& sim, const gmtl::Quatf& turn, float speed, const gmtl::Point3f& target);
+int AddSimTurtle(TurtleSim& sim, const gmtl::Point4f& p, const gmtl::Quatf& q);
+void StepSim(TurtleSim& sim, ThreadPool* pool);